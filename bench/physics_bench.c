@@ -0,0 +1,781 @@
+#include <float.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "badgl.h"
+#include "triangle_mesh.h"
+
+/**
+ * headless physics benchmark, no window or gl context is created.
+ * usage: physics_bench [scenario|all] [steps] [threads]
+ *        physics_bench fuzz [cases]
+ *
+ * every scenario is built the same way from a fixed seed and stepped a fixed number of ticks, then
+ * the bodies are hashed. the checksum only depends on the simulation, so comparing it between
+ * builds or thread counts catches anything that makes the physics nondeterministic.
+ * threads counts the calling thread, 0 uses every processor
+ *
+ * fuzz checks the narrowphase kernels against a brute force reference instead of timing anything,
+ * and exits non-zero if any random pair disagrees with it
+ */
+
+#define BENCH_COLLIDERS 20000
+#define BENCH_STEPS 600 // 10s at 60hz
+#define BENCH_DT (1.0f / 60.0f)
+#define BENCH_FRAME_MS (1000.0 / 60.0)
+#define BENCH_KERNEL_PAIRS 4096 // pairs per narrowphase kernel run
+#define BENCH_KERNEL_RUNS 50
+#define BENCH_SEED 0x12345678
+
+#define BENCH_FUZZ_CASES 20000 // per shape pair
+#define BENCH_FUZZ_DIRECTIONS 2048 // sampled by the reference before refining the best
+#define BENCH_FUZZ_STARTS 4 // lowest sampled directions the reference refines
+#define BENCH_FUZZ_PATTERN 16 // directions tried around the current one per refining step
+#define BENCH_FUZZ_TOUCH_TOLERANCE 0.005f // reference depth past which the kernel has to agree on touching
+#define BENCH_FUZZ_DEPTH_TOLERANCE 0.01f
+#define BENCH_FUZZ_DEPTH_RELATIVE 0.03f // box/box prefers a face within 2% of the least penetrating axis
+#define BENCH_FUZZ_POINT_TOLERANCE 0.01f // distance from a point's surface, clipping keeps points 0.005 outside a face
+#define BENCH_FUZZ_SPECULATIVE 0.02f // separation at which face points are still kept
+#define BENCH_FUZZ_MAX_REPORTS 8 // mismatches printed per shape pair
+
+#define BENCH_STACK_PYRAMIDS 4
+#define BENCH_STACK_ROWS 16
+#define BENCH_RAGDOLLS 200
+#define BENCH_SPHERES 10000
+#define BENCH_TERRAIN_CELLS 64 // per side, 1m each
+#define BENCH_PROJECTILES_PER_STEP 8
+#define BENCH_MAX_PROJECTILES 4000
+
+typedef struct BenchScene
+{
+    World world;
+    PhysicsWorld physics;
+    TriangleMesh terrain;
+    bool has_terrain;
+
+    /* hashed in spawn order */
+    Entity* bodies;
+    u32 body_count;
+    u32 body_capacity;
+} BenchScene;
+
+typedef struct BenchScenario
+{
+    const char* name;
+    void (*setup)(BenchScene* scene);
+    void (*update)(BenchScene* scene, u32 step); // NULL if nothing is spawned while stepping
+} BenchScenario;
+
+static u32 rng_state = BENCH_SEED;
+
+f32 bench_randf(f32 min, f32 max)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return min + (max - min) * (f32)(rng_state >> 8) / (f32)(1u << 24);
+}
+
+void bench_spawn_colliders(World* world, u32 count)
+{
+    const ComponentMask mask = BGL_COMPONENT_BIT(BGL_COMPONENT_TRANSFORM) | BGL_COMPONENT_BIT(BGL_COMPONENT_MODEL_MATRIX) |
+                               BGL_COMPONENT_BIT(BGL_COMPONENT_VELOCITY) | BGL_COMPONENT_BIT(BGL_COMPONENT_COLLIDER);
+    Entity* entities = BGL_MALLOC(count * sizeof(Entity));
+    ecs_create_entities(world, mask, count, NULL, entities);
+
+    for(u32 i = 0; i < count; i++)
+    {
+        Transform transform;
+        transform_reset(&transform);
+        transform.pos = VEC3(bench_randf(-150.0f, 150.0f), bench_randf(0.0f, 20.0f), bench_randf(-150.0f, 150.0f));
+        ecs_set_component(world, entities[i], BGL_COMPONENT_TRANSFORM, &transform);
+
+        /* a quarter of the colliders are static level geometry */
+        if(i % 4 != 0)
+        {
+            Velocity velocity = { .linear = VEC3(bench_randf(-2.0f, 2.0f), bench_randf(-0.5f, 0.5f), bench_randf(-2.0f, 2.0f)) };
+            ecs_set_component(world, entities[i], BGL_COMPONENT_VELOCITY, &velocity);
+        }
+
+        Collider collider;
+        switch(i % 4)
+        {
+            case 0:  collider = collider_aabb(VEC3(0.0f, 0.0f, 0.0f), VEC3(0.5f, 0.5f, 0.5f)); break;
+            case 1:  collider = collider_sphere(VEC3(0.0f, 0.0f, 0.0f), 0.5f); break;
+            case 2:  collider = collider_obb(VEC3(0.0f, 0.0f, 0.0f), VEC3(0.4f, 0.25f, 0.6f)); break;
+            default: collider = collider_capsule(VEC3(0.0f, 0.0f, 0.0f), 0.3f, 0.5f); break;
+        }
+        if(i % 4 == 0) collider.flags |= BGL_COLLIDER_STATIC;
+        ecs_set_component(world, entities[i], BGL_COMPONENT_COLLIDER, &collider);
+    }
+
+    BGL_FREE(entities);
+}
+
+/* random shape of a type near the origin, so about half the pairs touch */
+CollisionShape bench_random_shape(ColliderType type)
+{
+    Transform transform;
+    transform_reset(&transform);
+    transform.pos = VEC3(bench_randf(-1.0f, 1.0f), bench_randf(-1.0f, 1.0f), bench_randf(-1.0f, 1.0f));
+    transform.euler = VEC3(bench_randf(0.0f, 360.0f), bench_randf(0.0f, 360.0f), bench_randf(0.0f, 360.0f));
+    mat4 model;
+    transform_to_matrix(&transform, &model);
+
+    Collider collider;
+    switch(type)
+    {
+        case BGL_COLLIDER_SPHERE: collider = collider_sphere(VEC3(0.0f, 0.0f, 0.0f), 0.5f); break;
+        case BGL_COLLIDER_OBB: collider = collider_obb(VEC3(0.0f, 0.0f, 0.0f), VEC3(0.4f, 0.25f, 0.6f)); break;
+        default: collider = collider_capsule(VEC3(0.0f, 0.0f, 0.0f), 0.3f, 0.5f); break;
+    }
+
+    CollisionShape shape;
+    collider_compute_shape(&collider, &model, &shape);
+    return shape;
+}
+
+/* throughput of each narrowphase kernel on its own */
+void bench_narrowphase_kernels(void)
+{
+    static const ColliderType kind_types[BGL_NARROWPHASE_KIND_COUNT][2] = {
+        { BGL_COLLIDER_SPHERE, BGL_COLLIDER_SPHERE },
+        { BGL_COLLIDER_SPHERE, BGL_COLLIDER_OBB },
+        { BGL_COLLIDER_OBB, BGL_COLLIDER_OBB },
+        { BGL_COLLIDER_CAPSULE, BGL_COLLIDER_OBB },
+    };
+    static const char* kind_names[BGL_NARROWPHASE_KIND_COUNT] = { "sphere/sphere", "sphere/box", "box/box", "convex (gjk/epa)" };
+
+    CollisionShape* shapes = BGL_MALLOC(2 * BENCH_KERNEL_PAIRS * sizeof(CollisionShape));
+    PhysicsPair* pairs = BGL_MALLOC(BENCH_KERNEL_PAIRS * sizeof(PhysicsPair));
+    ContactManifold* manifolds = BGL_MALLOC(BENCH_KERNEL_PAIRS * sizeof(ContactManifold));
+
+    for(u32 kind = 0; kind < BGL_NARROWPHASE_KIND_COUNT; kind++)
+    {
+        /* mesh pairs need a world to find their triangles, the projectile scenario covers them */
+        if(kind_names[kind] == NULL) continue;
+
+        for(u32 i = 0; i < BENCH_KERNEL_PAIRS; i++)
+        {
+            shapes[2 * i] = bench_random_shape(kind_types[kind][0]);
+            shapes[2 * i + 1] = bench_random_shape(kind_types[kind][1]);
+            pairs[i] = (PhysicsPair){ 2 * i, 2 * i + 1, 2 * i, 2 * i + 1 };
+        }
+
+        u32 touching = 0;
+        f64 start_time = platform_get_time();
+        for(u32 run = 0; run < BENCH_KERNEL_RUNS; run++)
+        {
+            touching = narrowphase_collide(kind, shapes, pairs, BENCH_KERNEL_PAIRS, manifolds);
+        }
+        f64 seconds = platform_get_time() - start_time;
+
+        printf("narrowphase %-16s %7.2f Mpairs/s, %.0f%% touching\n", kind_names[kind],
+               (f64)BENCH_KERNEL_PAIRS * BENCH_KERNEL_RUNS / seconds / 1e6, touching * 100.0 / BENCH_KERNEL_PAIRS);
+    }
+
+    BGL_FREE(shapes);
+    BGL_FREE(pairs);
+    BGL_FREE(manifolds);
+}
+
+/**
+ * brute force reference for the narrowphase. a and b overlap along a unit axis n (pointing from a
+ * to b) by support_a(n) + support_b(-n), and the least overlap over every axis is the penetration
+ * depth, or minus the distance when they're apart. the reference evaluates it over a dense set of
+ * directions and the shapes' own axes, then refines the best one by shrinking steps
+ */
+f32 bench_fuzz_support(const CollisionShape* shape, vec3 n)
+{
+    f32 extent = vec3_dot(shape->centre, n);
+    switch(shape->type)
+    {
+        case BGL_COLLIDER_SPHERE: return extent + shape->radius;
+        case BGL_COLLIDER_CAPSULE: return extent + shape->half_height * fabsf(vec3_dot(shape->axes[1], n)) + shape->radius;
+        default:
+            for(u32 i = 0; i < 3; i++) extent += shape->half_extents.data[i] * fabsf(vec3_dot(shape->axes[i], n));
+            return extent;
+    }
+}
+
+f32 bench_fuzz_overlap(const CollisionShape* a, const CollisionShape* b, vec3 n)
+{
+    return bench_fuzz_support(a, n) + bench_fuzz_support(b, vec3_scale(n, -1.0f));
+}
+
+vec3 bench_fuzz_normalised(vec3 v)
+{
+    f32 length = sqrtf(vec3_dot(v, v));
+    return length > 1e-6f ? vec3_scale(v, 1.0f / length) : VEC3(0.0f, 1.0f, 0.0f);
+}
+
+/* pattern search over the sphere of directions around normal, stepping until no step lowers the overlap */
+f32 bench_fuzz_refine(const CollisionShape* a, const CollisionShape* b, vec3* normal, f32 overlap)
+{
+    for(f32 step = 0.05f; step > 1e-6f;)
+    {
+        const vec3 side = fabsf(normal->x) < 0.9f ? VEC3(1.0f, 0.0f, 0.0f) : VEC3(0.0f, 1.0f, 0.0f);
+        const vec3 u = bench_fuzz_normalised(vec_cross(*normal, side));
+        const vec3 v = vec_cross(*normal, u);
+
+        bool improved = false;
+        for(u32 k = 0; k < BENCH_FUZZ_PATTERN; k++)
+        {
+            const f32 angle = (f32)k * 6.28318531f / (f32)BENCH_FUZZ_PATTERN;
+            const vec3 offset = vec3_add(vec3_scale(u, cosf(angle) * step), vec3_scale(v, sinf(angle) * step));
+            const vec3 dir = bench_fuzz_normalised(vec3_add(*normal, offset));
+            const f32 dir_overlap = bench_fuzz_overlap(a, b, dir);
+            if(dir_overlap < overlap)
+            {
+                overlap = dir_overlap;
+                *normal = dir;
+                improved = true;
+            }
+        }
+        if(!improved) step *= 0.5f;
+    }
+    return overlap;
+}
+
+f32 bench_fuzz_reference(const CollisionShape* a, const CollisionShape* b, vec3* normal_out)
+{
+    /* the exact answer for boxes is one of these, the samples find the rest's basin */
+    vec3 candidates[16];
+    u32 candidate_count = 0;
+    candidates[candidate_count++] = vec3_sub(b->centre, a->centre);
+    for(u32 i = 0; i < 3; i++)
+    {
+        candidates[candidate_count++] = a->axes[i];
+        candidates[candidate_count++] = b->axes[i];
+        for(u32 j = 0; j < 3; j++) candidates[candidate_count++] = vec_cross(a->axes[i], b->axes[j]);
+    }
+
+    /* the lowest few, the overlap has kinks where a support switches corner that a single search can stall on */
+    f32 starts[BENCH_FUZZ_STARTS];
+    vec3 start_normals[BENCH_FUZZ_STARTS];
+    for(u32 i = 0; i < BENCH_FUZZ_STARTS; i++) starts[i] = FLT_MAX;
+
+    for(u32 i = 0; i < candidate_count + BENCH_FUZZ_DIRECTIONS; i++)
+    {
+        vec3 n;
+        if(i < candidate_count)
+        {
+            if(vec3_dot(candidates[i], candidates[i]) < 1e-8f) continue;
+            n = bench_fuzz_normalised(candidates[i]);
+        }
+        else
+        {
+            /* fibonacci sphere */
+            const f32 k = (f32)(i - candidate_count) + 0.5f;
+            const f32 y = 1.0f - 2.0f * k / (f32)BENCH_FUZZ_DIRECTIONS;
+            const f32 ring = sqrtf(MAX(1.0f - y * y, 0.0f));
+            const f32 angle = k * 2.39996323f;
+            n = VEC3(ring * cosf(angle), y, ring * sinf(angle));
+        }
+
+        for(u32 sign = 0; sign < 2; sign++)
+        {
+            const vec3 dir = sign == 0 ? n : vec3_scale(n, -1.0f);
+            f32 overlap = bench_fuzz_overlap(a, b, dir);
+            if(overlap >= starts[BENCH_FUZZ_STARTS - 1]) continue;
+
+            u32 slot = BENCH_FUZZ_STARTS - 1;
+            for(; slot > 0 && starts[slot - 1] > overlap; slot--)
+            {
+                starts[slot] = starts[slot - 1];
+                start_normals[slot] = start_normals[slot - 1];
+            }
+            starts[slot] = overlap;
+            start_normals[slot] = dir;
+        }
+    }
+
+    f32 best = FLT_MAX;
+    for(u32 i = 0; i < BENCH_FUZZ_STARTS; i++)
+    {
+        vec3 normal = start_normals[i];
+        const f32 overlap = bench_fuzz_refine(a, b, &normal, starts[i]);
+        if(overlap < best)
+        {
+            best = overlap;
+            *normal_out = normal;
+        }
+    }
+    return best;
+}
+
+/* distance from the shape's surface, negative inside */
+f32 bench_fuzz_surface_distance(const CollisionShape* shape, vec3 point)
+{
+    const vec3 d = vec3_sub(point, shape->centre);
+    switch(shape->type)
+    {
+        case BGL_COLLIDER_SPHERE: return sqrtf(vec3_dot(d, d)) - shape->radius;
+
+        case BGL_COLLIDER_CAPSULE:
+        {
+            f32 t = vec3_dot(d, shape->axes[1]);
+            t = MAX(-shape->half_height, MIN(t, shape->half_height));
+            vec3 e = vec3_sub(d, vec3_scale(shape->axes[1], t));
+            return sqrtf(vec3_dot(e, e)) - shape->radius;
+        }
+
+        default:
+        {
+            f32 outside = 0.0f, inside = -FLT_MAX;
+            for(u32 i = 0; i < 3; i++)
+            {
+                f32 q = fabsf(vec3_dot(d, shape->axes[i])) - shape->half_extents.data[i];
+                outside += q > 0.0f ? q * q : 0.0f;
+                inside = MAX(inside, q);
+            }
+            return outside > 0.0f ? sqrtf(outside) : inside;
+        }
+    }
+}
+
+/* random shape of a type near the origin, a quarter are axis aligned so faces and capsules line up */
+CollisionShape bench_fuzz_random_shape(ColliderType type)
+{
+    Transform transform;
+    transform_reset(&transform);
+    transform.pos = VEC3(bench_randf(-1.0f, 1.0f), bench_randf(-1.0f, 1.0f), bench_randf(-1.0f, 1.0f));
+    if(bench_randf(0.0f, 1.0f) > 0.25f)
+    {
+        transform.euler = VEC3(bench_randf(0.0f, 360.0f), bench_randf(0.0f, 360.0f), bench_randf(0.0f, 360.0f));
+    }
+    mat4 model;
+    transform_to_matrix(&transform, &model);
+
+    Collider collider;
+    switch(type)
+    {
+        case BGL_COLLIDER_SPHERE: collider = collider_sphere(VEC3(0.0f, 0.0f, 0.0f), bench_randf(0.2f, 0.8f)); break;
+        case BGL_COLLIDER_OBB:
+            collider = collider_obb(VEC3(0.0f, 0.0f, 0.0f), VEC3(bench_randf(0.1f, 0.8f), bench_randf(0.1f, 0.8f), bench_randf(0.1f, 0.8f)));
+            break;
+        default: collider = collider_capsule(VEC3(0.0f, 0.0f, 0.0f), bench_randf(0.1f, 0.5f), bench_randf(0.1f, 0.8f)); break;
+    }
+
+    CollisionShape shape;
+    collider_compute_shape(&collider, &model, &shape);
+    return shape;
+}
+
+/* reason the kernel's manifold disagrees with the reference, NULL if it doesn't */
+const char* bench_fuzz_check(const CollisionShape* a, const CollisionShape* b, bool hit, const ContactManifold* manifold, f32 ref_depth)
+{
+    if(!hit) return ref_depth > BENCH_FUZZ_TOUCH_TOLERANCE ? "missed a penetrating pair" : NULL;
+    if(ref_depth < -(BENCH_FUZZ_SPECULATIVE + BENCH_FUZZ_TOUCH_TOLERANCE)) return "contact between separated shapes";
+    if(manifold->point_count == 0 || manifold->point_count > BGL_MAX_CONTACT_POINTS) return "bad point count";
+
+    const vec3 n = manifold->normal;
+    if(fabsf(vec3_dot(n, n) - 1.0f) > 1e-3f) return "normal isn't unit length";
+
+    const f32 tolerance = BENCH_FUZZ_DEPTH_TOLERANCE + BENCH_FUZZ_DEPTH_RELATIVE * fabsf(ref_depth);
+    f32 depth = -FLT_MAX;
+    for(u32 i = 0; i < manifold->point_count; i++) depth = MAX(depth, manifold->points[i].depth);
+    if(fabsf(depth - ref_depth) > tolerance) return "depth";
+
+    /* ties between axes give different but equally good normals, so the normal is judged by its overlap */
+    if(bench_fuzz_overlap(a, b, n) - ref_depth > tolerance) return "normal";
+
+    for(u32 i = 0; i < manifold->point_count; i++)
+    {
+        const ContactPoint* point = &manifold->points[i];
+        const vec3 on_a = vec3_add(point->pos, vec3_scale(n, point->depth * 0.5f));
+        const vec3 on_b = vec3_sub(point->pos, vec3_scale(n, point->depth * 0.5f));
+        if(fabsf(bench_fuzz_surface_distance(a, on_a)) > BENCH_FUZZ_POINT_TOLERANCE ||
+           fabsf(bench_fuzz_surface_distance(b, on_b)) > BENCH_FUZZ_POINT_TOLERANCE) return "point placement";
+    }
+    return NULL;
+}
+
+/* every kernel but the mesh one against bench_fuzz_reference, returns the number of mismatches */
+u32 bench_fuzz(u32 cases)
+{
+    static const ColliderType pair_types[][2] = {
+        { BGL_COLLIDER_SPHERE, BGL_COLLIDER_SPHERE },
+        { BGL_COLLIDER_SPHERE, BGL_COLLIDER_OBB },
+        { BGL_COLLIDER_OBB, BGL_COLLIDER_OBB },
+        { BGL_COLLIDER_CAPSULE, BGL_COLLIDER_OBB },
+        { BGL_COLLIDER_CAPSULE, BGL_COLLIDER_SPHERE },
+        { BGL_COLLIDER_CAPSULE, BGL_COLLIDER_CAPSULE },
+    };
+    static const char* type_names[] = { [BGL_COLLIDER_SPHERE] = "sphere", [BGL_COLLIDER_OBB] = "box", [BGL_COLLIDER_CAPSULE] = "capsule" };
+    static const char* kind_names[BGL_NARROWPHASE_KIND_COUNT] = { "sphere/sphere", "sphere/box", "box/box sat", "gjk/epa", "mesh" };
+
+    rng_state = BENCH_SEED;
+    u32 total_mismatches = 0;
+    for(u32 p = 0; p < sizeof(pair_types) / sizeof(pair_types[0]); p++)
+    {
+        bool swap;
+        const NarrowphaseKind kind = narrowphase_pair_kind(pair_types[p][0], pair_types[p][1], &swap);
+
+        u32 mismatches = 0, touching = 0;
+        for(u32 i = 0; i < cases; i++)
+        {
+            CollisionShape shapes[2] = { bench_fuzz_random_shape(pair_types[p][0]), bench_fuzz_random_shape(pair_types[p][1]) };
+            if(swap)
+            {
+                CollisionShape temp = shapes[0];
+                shapes[0] = shapes[1];
+                shapes[1] = temp;
+            }
+
+            const PhysicsPair pair = { 0, 1, 0, 1 };
+            ContactManifold manifold;
+            const bool hit = narrowphase_collide(kind, shapes, &pair, 1, &manifold) == 1;
+            touching += hit;
+
+            vec3 ref_normal;
+            const f32 ref_depth = bench_fuzz_reference(&shapes[0], &shapes[1], &ref_normal);
+            const char* reason = bench_fuzz_check(&shapes[0], &shapes[1], hit, &manifold, ref_depth);
+            if(reason == NULL) continue;
+
+            if(mismatches++ < BENCH_FUZZ_MAX_REPORTS)
+            {
+                printf("  case %u %s: reference depth %.4f normal (%.3f %.3f %.3f)", i, reason, ref_depth,
+                       ref_normal.x, ref_normal.y, ref_normal.z);
+                if(hit)
+                {
+                    printf(", kernel depth %.4f normal (%.3f %.3f %.3f) %u points", manifold.points[0].depth,
+                           manifold.normal.x, manifold.normal.y, manifold.normal.z, manifold.point_count);
+                }
+                printf("\n");
+            }
+        }
+
+        printf("fuzz %-7s/%-7s (%-13s) %6u cases, %5.1f%% touching, %u mismatches\n", type_names[pair_types[p][0]],
+               type_names[pair_types[p][1]], kind_names[kind], cases, touching * 100.0 / cases, mismatches);
+        total_mismatches += mismatches;
+    }
+    return total_mismatches;
+}
+
+/* broadphase over velocity driven colliders without rigid bodies */
+void bench_broadphase(u32 steps)
+{
+    World world;
+    ecs_create(&world);
+    physics_system_register(&world);
+    transform_system_register(&world);
+
+    PhysicsWorld physics;
+    physics_world_create(&physics);
+
+    bench_spawn_colliders(&world, BENCH_COLLIDERS);
+
+    /* first step inserts every proxy and does the full sort */
+    ecs_run_systems(&world, BENCH_DT);
+    physics_world_step(&physics, &world, BENCH_DT);
+    printf("broadphase build: %.3f ms, %u dynamic + %u static colliders, %u pairs\n",
+           physics.broadphase_time, physics.dynamic_tree.leaf_count, physics.static_tree.leaf_count, physics.pair_count);
+
+    f64 total = 0.0, worst = 0.0, narrowphase_total = 0.0;
+    u64 pairs = 0, manifolds = 0;
+    for(u32 i = 0; i < steps; i++)
+    {
+        ecs_run_systems(&world, BENCH_DT);
+        physics_world_step(&physics, &world, BENCH_DT);
+
+        total += physics.broadphase_time;
+        worst = MAX(worst, physics.broadphase_time);
+        narrowphase_total += physics.narrowphase_time;
+        pairs += physics.pair_count;
+        manifolds += physics.manifold_count;
+    }
+
+    f64 average = total / (f64)steps;
+    printf("broadphase update: %.3f ms avg, %.3f ms worst over %u steps, %.1f pairs/step\n",
+           average, worst, steps, (f64)pairs / (f64)steps);
+    printf("narrowphase update: %.3f ms avg, %.1f manifolds/step\n", narrowphase_total / (f64)steps, (f64)manifolds / (f64)steps);
+    printf("%.1f%% of a 60hz frame\n", (total + narrowphase_total) / (f64)steps / BENCH_FRAME_MS * 100.0);
+
+    physics_world_free(&physics);
+    ecs_free(&world);
+}
+
+Entity bench_spawn_body(BenchScene* scene, vec3 pos, vec3 euler, Collider collider, const RigidBody* rigid_body)
+{
+    ComponentMask mask = BGL_COMPONENT_BIT(BGL_COMPONENT_TRANSFORM) | BGL_COMPONENT_BIT(BGL_COMPONENT_MODEL_MATRIX) |
+                         BGL_COMPONENT_BIT(BGL_COMPONENT_COLLIDER);
+    if(rigid_body) mask |= BGL_COMPONENT_BIT(BGL_COMPONENT_RIGID_BODY);
+
+    Entity entity;
+    ecs_create_entities(&scene->world, mask, 1, NULL, &entity);
+
+    Transform transform;
+    transform_reset(&transform);
+    transform.pos = pos;
+    transform.euler = euler;
+    ecs_set_component(&scene->world, entity, BGL_COMPONENT_TRANSFORM, &transform);
+    ecs_set_component(&scene->world, entity, BGL_COMPONENT_COLLIDER, &collider);
+
+    if(rigid_body)
+    {
+        ecs_set_component(&scene->world, entity, BGL_COMPONENT_RIGID_BODY, rigid_body);
+        ecs_grow((void**)&scene->bodies, &scene->body_capacity, scene->body_count + 1, sizeof(Entity));
+        scene->bodies[scene->body_count++] = entity;
+    }
+    return entity;
+}
+
+void bench_spawn_ground(BenchScene* scene, f32 half_size)
+{
+    Collider ground = collider_obb(VEC3(0.0f, 0.0f, 0.0f), VEC3(half_size, 0.5f, half_size));
+    ground.flags |= BGL_COLLIDER_STATIC;
+    bench_spawn_body(scene, VEC3(0.0f, -0.5f, 0.0f), VEC3(0.0f, 0.0f, 0.0f), ground, NULL);
+}
+
+/* pyramids of boxes resting on each other, the solver's worst case */
+void bench_setup_stack(BenchScene* scene)
+{
+    bench_spawn_ground(scene, 100.0f);
+
+    const Collider box = collider_obb(VEC3(0.0f, 0.0f, 0.0f), VEC3(0.5f, 0.5f, 0.5f));
+    const RigidBody rigid_body = rigid_body_create(1.0f);
+    for(u32 pyramid = 0; pyramid < BENCH_STACK_PYRAMIDS; pyramid++)
+    {
+        const f32 z = ((f32)pyramid - (f32)(BENCH_STACK_PYRAMIDS - 1) * 0.5f) * 4.0f;
+        for(u32 row = 0; row < BENCH_STACK_ROWS; row++)
+        {
+            const u32 row_count = BENCH_STACK_ROWS - row;
+            for(u32 i = 0; i < row_count; i++)
+            {
+                vec3 pos = VEC3(((f32)i - (f32)(row_count - 1) * 0.5f) * 1.05f, 0.5f + (f32)row, z);
+                bench_spawn_body(scene, pos, VEC3(0.0f, 0.0f, 0.0f), box, &rigid_body);
+            }
+        }
+    }
+}
+
+/**
+ * there are no joints, so a ragdoll is its parts (box torso, sphere head, capsule limbs) spawned in
+ * a pose and left to fall apart into the pile. the contacts between mixed convex shapes are what's measured
+ */
+void bench_setup_ragdolls(BenchScene* scene)
+{
+    bench_spawn_ground(scene, 100.0f);
+
+    /* walls keep the pile from spreading out */
+    for(u32 i = 0; i < 4; i++)
+    {
+        const f32 side = i % 2 == 0 ? 1.0f : -1.0f;
+        Collider wall = i < 2 ? collider_obb(VEC3(0.0f, 0.0f, 0.0f), VEC3(0.5f, 5.0f, 6.0f)) : collider_obb(VEC3(0.0f, 0.0f, 0.0f), VEC3(6.0f, 5.0f, 0.5f));
+        wall.flags |= BGL_COLLIDER_STATIC;
+        vec3 pos = i < 2 ? VEC3(side * 6.5f, 5.0f, 0.0f) : VEC3(0.0f, 5.0f, side * 6.5f);
+        bench_spawn_body(scene, pos, VEC3(0.0f, 0.0f, 0.0f), wall, NULL);
+    }
+
+    const RigidBody rigid_body = rigid_body_create(1.0f);
+    for(u32 i = 0; i < BENCH_RAGDOLLS; i++)
+    {
+        const vec3 hips = VEC3(bench_randf(-4.0f, 4.0f), 2.0f + (f32)i * 0.6f, bench_randf(-4.0f, 4.0f));
+        const vec3 euler = VEC3(0.0f, bench_randf(0.0f, 360.0f), bench_randf(-30.0f, 30.0f));
+        const f32 yaw = RADIANS(euler.y);
+        const vec3 side = VEC3(cosf(yaw), 0.0f, -sinf(yaw));
+
+        bench_spawn_body(scene, vec3_add(hips, VEC3(0.0f, 0.35f, 0.0f)), euler, collider_obb(VEC3(0.0f, 0.0f, 0.0f), VEC3(0.2f, 0.3f, 0.12f)), &rigid_body);
+        bench_spawn_body(scene, vec3_add(hips, VEC3(0.0f, 0.85f, 0.0f)), euler, collider_sphere(VEC3(0.0f, 0.0f, 0.0f), 0.13f), &rigid_body);
+        for(u32 limb = 0; limb < 4; limb++)
+        {
+            /* legs hang below the hips, arms stick out sideways from the shoulders */
+            const f32 sign = limb % 2 == 0 ? 1.0f : -1.0f;
+            const bool arm = limb >= 2;
+            vec3 pos = arm ? vec3_add(hips, vec3_add(vec3_scale(side, sign * 0.5f), VEC3(0.0f, 0.55f, 0.0f)))
+                           : vec3_add(hips, vec3_add(vec3_scale(side, sign * 0.1f), VEC3(0.0f, -0.4f, 0.0f)));
+            vec3 limb_euler = arm ? VEC3(euler.x, euler.y, euler.z + 90.0f) : euler;
+            bench_spawn_body(scene, pos, limb_euler, collider_capsule(VEC3(0.0f, 0.0f, 0.0f), 0.07f, 0.25f), &rigid_body);
+        }
+    }
+}
+
+/* a block of spheres dropped on the ground, mostly broadphase and sphere contacts */
+void bench_setup_spheres(BenchScene* scene)
+{
+    bench_spawn_ground(scene, 100.0f);
+
+    const Collider sphere = collider_sphere(VEC3(0.0f, 0.0f, 0.0f), 0.5f);
+    const RigidBody rigid_body = rigid_body_create(1.0f);
+    const u32 side = 50;
+    for(u32 i = 0; i < BENCH_SPHERES; i++)
+    {
+        const u32 layer = i / (side * side);
+        const u32 x = i % side, z = (i / side) % side;
+        vec3 pos = VEC3(((f32)x - (f32)side * 0.5f) * 1.2f + bench_randf(-0.1f, 0.1f), 1.0f + (f32)layer * 1.5f,
+                        ((f32)z - (f32)side * 0.5f) * 1.2f + bench_randf(-0.1f, 0.1f));
+        bench_spawn_body(scene, pos, VEC3(0.0f, 0.0f, 0.0f), sphere, &rigid_body);
+    }
+}
+
+/* rolling heightfield as a triangle mesh for the projectiles to hit */
+void bench_setup_projectiles(BenchScene* scene)
+{
+    const u32 side = BENCH_TERRAIN_CELLS + 1;
+    vec3* vertices = BGL_MALLOC(side * side * sizeof(vec3));
+    u32* indices = BGL_MALLOC(BENCH_TERRAIN_CELLS * BENCH_TERRAIN_CELLS * 6 * sizeof(u32));
+
+    for(u32 z = 0; z < side; z++)
+    {
+        for(u32 x = 0; x < side; x++)
+        {
+            const f32 fx = (f32)x - (f32)BENCH_TERRAIN_CELLS * 0.5f, fz = (f32)z - (f32)BENCH_TERRAIN_CELLS * 0.5f;
+            vertices[z * side + x] = VEC3(fx, 1.5f * sinf(fx * 0.3f) * cosf(fz * 0.2f), fz);
+        }
+    }
+
+    u32 index_count = 0;
+    for(u32 z = 0; z < BENCH_TERRAIN_CELLS; z++)
+    {
+        for(u32 x = 0; x < BENCH_TERRAIN_CELLS; x++)
+        {
+            const u32 corner = z * side + x;
+            const u32 quad[6] = { corner, corner + side, corner + 1, corner + 1, corner + side, corner + side + 1 };
+            memcpy(&indices[index_count], quad, sizeof(quad));
+            index_count += 6;
+        }
+    }
+
+    scene->has_terrain = triangle_mesh_create(&scene->terrain, vertices, side * side, indices, index_count);
+    BGL_FREE(vertices);
+    BGL_FREE(indices);
+    BGL_ASSERT(scene->has_terrain, "failed to build the benchmark terrain");
+
+    u32 mesh = physics_world_add_mesh(&scene->physics, &scene->terrain);
+    bench_spawn_body(scene, VEC3(0.0f, 0.0f, 0.0f), VEC3(0.0f, 0.0f, 0.0f), collider_mesh(mesh, &scene->terrain), NULL);
+}
+
+/* fast projectiles fired down at the terrain every step, they'd tunnel through without continuous collision */
+void bench_update_projectiles(BenchScene* scene, u32 step)
+{
+    (void)step;
+    if(scene->body_count + BENCH_PROJECTILES_PER_STEP > BENCH_MAX_PROJECTILES) return;
+
+    for(u32 i = 0; i < BENCH_PROJECTILES_PER_STEP; i++)
+    {
+        RigidBody rigid_body = rigid_body_create(0.1f);
+        rigid_body.flags |= BGL_RIGID_BODY_FAST;
+        rigid_body.linear_velocity = VEC3(bench_randf(-30.0f, 30.0f), bench_randf(-250.0f, -150.0f), bench_randf(-30.0f, 30.0f));
+
+        Collider collider = i % 2 == 0 ? collider_sphere(VEC3(0.0f, 0.0f, 0.0f), 0.1f) : collider_capsule(VEC3(0.0f, 0.0f, 0.0f), 0.05f, 0.2f);
+        vec3 pos = VEC3(bench_randf(-25.0f, 25.0f), bench_randf(20.0f, 30.0f), bench_randf(-25.0f, 25.0f));
+        bench_spawn_body(scene, pos, VEC3(0.0f, 0.0f, 0.0f), collider, &rigid_body);
+    }
+}
+
+/* fnv-1a over the state of every body in spawn order */
+u64 bench_checksum(BenchScene* scene)
+{
+    u64 hash = 0xCBF29CE484222325ull;
+    for(u32 i = 0; i < scene->body_count; i++)
+    {
+        const Transform* transform = ecs_get_component(&scene->world, scene->bodies[i], BGL_COMPONENT_TRANSFORM);
+        const RigidBody* rigid_body = ecs_get_component(&scene->world, scene->bodies[i], BGL_COMPONENT_RIGID_BODY);
+        const vec3 state[4] = { transform->pos, transform->euler, rigid_body->linear_velocity, rigid_body->angular_velocity };
+
+        const u8* bytes = (const u8*)state;
+        for(u64 byte = 0; byte < sizeof(state); byte++) hash = (hash ^ bytes[byte]) * 0x100000001B3ull;
+    }
+    return hash;
+}
+
+void bench_run_scenario(const BenchScenario* scenario, u32 steps)
+{
+    rng_state = BENCH_SEED;
+
+    BenchScene scene;
+    memset(&scene, 0, sizeof(BenchScene));
+    ecs_create(&scene.world);
+    transform_system_register(&scene.world);
+    physics_world_create(&scene.physics);
+
+    scenario->setup(&scene);
+
+    f64 stages[4] = { 0.0 }; // broadphase, narrowphase, solve, integrate
+    f64 total = 0.0, worst = 0.0;
+    u64 contacts = 0;
+    for(u32 i = 0; i < steps; i++)
+    {
+        if(scenario->update) scenario->update(&scene, i);
+
+        f64 start_time = platform_get_time();
+        ecs_run_systems(&scene.world, BENCH_DT);
+        physics_world_step(&scene.physics, &scene.world, BENCH_DT);
+        f64 step_time = (platform_get_time() - start_time) * 1000.0;
+
+        stages[0] += scene.physics.broadphase_time;
+        stages[1] += scene.physics.narrowphase_time;
+        stages[2] += scene.physics.solver_time;
+        stages[3] += scene.physics.integrate_time;
+        total += step_time;
+        worst = MAX(worst, step_time);
+        contacts += scene.physics.contact_count;
+    }
+
+    const f64 count = (f64)steps;
+    printf("%-12s %6u bodies %8.1f contacts | broadphase %7.3f  narrowphase %7.3f  solve %7.3f  integrate %7.3f | "
+           "step %7.3f ms avg %7.3f worst | checksum %016llx\n",
+           scenario->name, scene.body_count, (f64)contacts / count, stages[0] / count, stages[1] / count, stages[2] / count,
+           stages[3] / count, total / count, worst, (unsigned long long)bench_checksum(&scene));
+
+    physics_world_free(&scene.physics);
+    ecs_free(&scene.world);
+    if(scene.has_terrain) triangle_mesh_free(&scene.terrain);
+    BGL_FREE(scene.bodies);
+}
+
+int main(int argc, char** argv)
+{
+    static const BenchScenario scenarios[] = {
+        { "stack", bench_setup_stack, NULL },
+        { "ragdolls", bench_setup_ragdolls, NULL },
+        { "spheres", bench_setup_spheres, NULL },
+        { "projectiles", bench_setup_projectiles, bench_update_projectiles },
+    };
+    const u32 scenario_count = sizeof(scenarios) / sizeof(scenarios[0]);
+
+    const char* name = argc > 1 ? argv[1] : "all";
+    u32 steps = argc > 2 ? (u32)atoi(argv[2]) : BENCH_STEPS;
+    if(steps == 0) steps = BENCH_STEPS;
+    const u32 threads = argc > 3 ? (u32)atoi(argv[3]) : 0;
+
+    if(strcmp(name, "fuzz") == 0)
+    {
+        const u32 cases = argc > 2 && atoi(argv[2]) > 0 ? (u32)atoi(argv[2]) : BENCH_FUZZ_CASES;
+        return bench_fuzz(cases) == 0 ? 0 : 1;
+    }
+
+    /* a single thread needs no pool, jobs_parallel_for runs everything inline */
+    if(threads != 1) jobs_init(threads == 0 ? 0 : threads - 1);
+    platform_reset_time();
+    printf("%u threads, %u steps\n", jobs_thread_count(), steps);
+
+    bool all = strcmp(name, "all") == 0;
+    bool found = all;
+    for(u32 i = 0; i < scenario_count; i++)
+    {
+        if(!all && strcmp(name, scenarios[i].name) != 0) continue;
+        bench_run_scenario(&scenarios[i], steps);
+        found = true;
+    }
+
+    if(all || strcmp(name, "broadphase") == 0)
+    {
+        bench_broadphase(steps);
+        found = true;
+    }
+    if(all || strcmp(name, "kernels") == 0)
+    {
+        bench_narrowphase_kernels();
+        found = true;
+    }
+
+    if(!found)
+    {
+        printf("unknown scenario %s, pick one of:", name);
+        for(u32 i = 0; i < scenario_count; i++) printf(" %s", scenarios[i].name);
+        printf(" broadphase kernels all fuzz\n");
+    }
+
+    jobs_free();
+    return found ? 0 : 1;
+}
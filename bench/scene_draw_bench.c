@@ -0,0 +1,161 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "badgl.h"
+
+/**
+ * headless scene draw benchmark, no window or gl context is created.
+ * usage: scene_draw_bench [models] [frames]
+ *
+ * fills a scene through scene_add_model, then each frame fills and sorts its render queue twice:
+ * once walking the models the way scene_draw used to, and once with scene_queue_draws, which walks
+ * the packed draw list for scene_draw now. only the cpu side of scene_draw is measured,
+ * nothing is submitted, so the scene is set up without scene_create and the queue's gl buffers
+ * are never created
+ */
+
+#define BENCH_MODELS 100000
+#define BENCH_FRAMES 100
+#define BENCH_MESHES 64 // shared by the models, like instances of a few assets
+#define BENCH_MATERIALS 16
+#define BENCH_SHADERS 4
+#define BENCH_SEED 0x12345678
+
+static u32 rng_state = BENCH_SEED;
+static Mesh meshes[BENCH_MESHES];
+
+f32 bench_randf(f32 min, f32 max)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return min + (max - min) * (f32)(rng_state >> 8) / (f32)(1u << 24);
+}
+
+/* only what the walks read, the vao ids keep the meshes apart in the sort keys */
+void bench_create_meshes(void)
+{
+    for(u32 i = 0; i < BENCH_MESHES; i++)
+    {
+        Mesh* mesh = &meshes[i];
+        memset(mesh, 0, sizeof(Mesh));
+        mesh->vao.id = i + 1;
+        mesh->ind_count = 36;
+        mesh->vert_count = 24;
+        mesh->bounds_min = VEC3(-0.5f, -0.5f, -0.5f);
+        mesh->bounds_max = VEC3(0.5f, 0.5f, 0.5f);
+    }
+}
+
+/* the parts of scene_create scene_queue_draws reads, without a renderer or gl */
+void bench_create_scene(Scene* scene, u32 model_count)
+{
+    memset(scene, 0, sizeof(Scene));
+    camera_create(&scene->cam, VEC3(0.0f, 10.0f, 0.0f), 0.0f, -90.0f, 1.0f, 1.0f);
+    camera_update_proj(&scene->cam, 45.0f, 16.0f / 9.0f, 0.1f, 500.0f);
+    ecs_create(&scene->world);
+    material_table_create(&scene->draw_list.materials);
+
+    Material materials[BENCH_MATERIALS];
+    for(u32 i = 0; i < BENCH_MATERIALS; i++)
+    {
+        /* textures aren't read by the walks, so they're left out to keep this free of gl */
+        memset(&materials[i], 0, sizeof(Material));
+        materials[i].ambient = materials[i].diffuse = VEC3(bench_randf(0.0f, 1.0f), bench_randf(0.0f, 1.0f), bench_randf(0.0f, 1.0f));
+        materials[i].specular = VEC3(1.0f, 1.0f, 1.0f);
+        materials[i].shininess = 32.0f;
+        materials[i].opacity = 1.0f;
+        if(i % 4 == 3) material_set_blend(&materials[i], BGL_MATERIAL_BLEND_TRANSPARENT, 0.5f);
+    }
+
+    for(u32 i = 0; i < model_count; i++)
+    {
+        Model model;
+        memset(&model, 0, sizeof(Model));
+        model.meshes = &meshes[i % (BENCH_MESHES - 2)];
+        model.mesh_count = 1 + i % 3;
+        model.shader_idx = i % BENCH_SHADERS;
+        model.material = materials[i % BENCH_MATERIALS];
+
+        transform_reset(&model.transform);
+        model.transform.pos = VEC3(bench_randf(-400.0f, 400.0f), bench_randf(-20.0f, 20.0f), bench_randf(-400.0f, 400.0f));
+        model.transform.euler = VEC3(0.0f, bench_randf(0.0f, 360.0f), 0.0f);
+        transform_to_matrix(&model.transform, &model.model);
+
+        scene_add_model(scene, &model);
+    }
+}
+
+/* scene_free would free the meshes and the queue's indirect buffer, neither of which were created */
+void bench_free_scene(Scene* scene)
+{
+    BGL_FREE(scene->queue.items);
+    BGL_FREE(scene->queue.entries);
+    BGL_FREE(scene->queue.scratch);
+    BGL_FREE(scene->queue.batches);
+    BGL_FREE(scene->queue.commands);
+    BGL_FREE(scene->models);
+    BGL_FREE(scene->draw_list.items);
+    material_table_free(&scene->draw_list.materials);
+    ecs_free(&scene->world);
+}
+
+/* what scene_draw did before the draw list, every field but the material id comes from the models */
+void bench_queue_models(Scene* scene)
+{
+    render_queue_clear(&scene->queue);
+    for(u32 i = 0; i < scene->model_count; i++)
+    {
+        Model* model = &scene->models[i];
+        vec3 pos = VEC3(model->model.m14, model->model.m24, model->model.m34);
+        render_queue_push_meshes(&scene->queue, 0, model->meshes, model->mesh_count, &model->material,
+                                 scene->draw_list.items[i].material_id, model->shader_idx, &model->model, render_queue_depth(&scene->cam, pos));
+    }
+}
+
+void bench_run_queue(Scene* scene, const char* name, void (*queue_draws)(Scene* scene), u32 frames)
+{
+    queue_draws(scene); // grows the queue so no frame measured reallocates it
+    render_queue_sort(&scene->queue);
+    render_queue_build_batches(&scene->queue);
+
+    f64 walk_total = 0.0, sort_total = 0.0, worst = 0.0;
+    for(u32 i = 0; i < frames; i++)
+    {
+        f64 start_time = platform_get_time();
+        queue_draws(scene);
+        f64 sort_time = platform_get_time();
+        render_queue_sort(&scene->queue);
+        f64 end_time = platform_get_time();
+
+        walk_total += (sort_time - start_time) * 1000.0;
+        sort_total += (end_time - sort_time) * 1000.0;
+        worst = MAX(worst, (end_time - start_time) * 1000.0);
+    }
+
+    const f64 count = (f64)frames;
+    printf("%-10s %7u draws %6u batches | walk %7.3f ms  sort %7.3f ms | total %7.3f ms avg %7.3f worst\n",
+           name, scene->queue.count, scene->queue.batch_count, walk_total / count, sort_total / count, (walk_total + sort_total) / count, worst);
+}
+
+int main(int argc, char** argv)
+{
+    u32 model_count = argc > 1 ? (u32)atoi(argv[1]) : BENCH_MODELS;
+    if(model_count == 0) model_count = BENCH_MODELS;
+    u32 frames = argc > 2 ? (u32)atoi(argv[2]) : BENCH_FRAMES;
+    if(frames == 0) frames = BENCH_FRAMES;
+
+    platform_reset_time();
+    bench_create_meshes();
+
+    Scene* scene = BGL_MALLOC(sizeof(Scene));
+    BGL_ASSERT(scene != NULL, "benchmark scene allocation failed");
+    bench_create_scene(scene, model_count);
+    printf("%u models (%zu bytes each, %zu per draw item), %u materials, %u frames\n", model_count, sizeof(Model), sizeof(SceneDrawItem),
+           scene->draw_list.materials.used, frames);
+
+    bench_run_queue(scene, "models", bench_queue_models, frames);
+    bench_run_queue(scene, "draw list", scene_queue_draws, frames);
+
+    bench_free_scene(scene);
+    BGL_FREE(scene);
+    return 0;
+}
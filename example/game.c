@@ -126,6 +126,7 @@ void sphere_scene_update(Scene* scene)
     Transform sphere = scene->models[0].transform;
     sphere.euler = VEC3(0.0f, rotate_speed * time, 0.0f);
     model_update_transform(&scene->models[0], &sphere); // TODO: use some identifier for models in scene? strings?
+    scene_sync_model(scene, 0);
 }
 
 void game_add_models(Arena* arena)
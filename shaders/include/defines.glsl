@@ -10,6 +10,15 @@
 #define BGL_GLSL_TEXTURE_SPECULAR texture_specular
 #define BGL_GLSL_TEXTURE_NORMAL texture_normal
 
-#define BGL_GLSL_INT_SIZE 4
+/* uniform block bindings, the shaders use the numbers directly since < 4.2 bindings are parsed from them */
+#define BGL_GLSL_LIGHTS_BINDING 0
+#define BGL_GLSL_FRAME_BINDING 1
+#define BGL_GLSL_DRAW_BINDING 2
+
+/* draws visible through the Draws block at once, 64 * 256 bytes is the 16kb every gl guarantees for a block */
+#define BGL_GLSL_DRAWS_PER_BLOCK 64
+
+/* per instance uint attribute indexing the Draws block */
+#define BGL_GLSL_INSTANCE_DRAW_LOCATION 3
 
 #endif
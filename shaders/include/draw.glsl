@@ -0,0 +1,17 @@
+#ifndef BGL_DRAW_GLSL
+#define BGL_DRAW_GLSL
+
+/* c and glsl polyglot include for per draw data, written to the renderer's draw ring and read from the
+ * Draws block by the index in the BGL_GLSL_INSTANCE_DRAW_LOCATION attribute.
+ * 256 bytes so every draw starts at an offset glBindBufferRange accepts on any gpu */
+struct DrawData {
+    mat4 model;
+    mat4 normal_matrix; // inverse transpose of model view, only the upper 3x3 is used
+    mat4 mvp;
+    vec4 material_ambient; // w unused
+    vec4 material_diffuse; // w is the opacity
+    vec4 material_specular; // w is the shininess
+    vec4 padding;
+};
+
+#endif
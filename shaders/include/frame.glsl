@@ -0,0 +1,20 @@
+#ifndef BGL_FRAME_GLSL
+#define BGL_FRAME_GLSL
+
+/* c and glsl polyglot include for the per frame uniform block, uploaded once a frame by the renderer.
+ * the block is std140 so only vec4 and mat4 are used, which c lays out the same way */
+struct FrameData {
+    mat4 view;
+    mat4 projection;
+    mat4 view_projection;
+    vec4 camera_pos; // w unused
+    vec4 dir_light_dir; // direction the light comes from, w unused
+    vec4 dir_light_ambient;
+    vec4 dir_light_diffuse;
+    vec4 dir_light_specular;
+    float time; // seconds since the window opened
+    int light_count; // point lights in the Lights block
+    vec2 padding; // round up to a vec4
+};
+
+#endif
@@ -3,7 +3,7 @@
 
 vec3 compute_dir_light(DirLight light, vec3 normal, vec3 frag_pos, tex_coord_t tex_coord)
 {
-    vec3 view_light_dir = (mat3(view) * normalize(-light.dir));
+    vec3 view_light_dir = (mat3(frame.view) * normalize(-light.dir));
 
     /* ambient */
 
@@ -26,7 +26,7 @@ vec3 compute_dir_light(DirLight light, vec3 normal, vec3 frag_pos, tex_coord_t t
 
 vec3 compute_point_light(Light light, vec3 normal, vec3 frag_pos, vec3 world_pos, tex_coord_t tex_coord)
 {
-    vec3 view_light_pos = (view * light.pos).xyz;
+    vec3 view_light_pos = (frame.view * light.pos).xyz;
 
     /* attenuation */
 
@@ -55,15 +55,16 @@ vec3 compute_point_light(Light light, vec3 normal, vec3 frag_pos, vec3 world_pos
     return attenuation * (ambient + diffuse + specular);
 }
 
-/* assumes light_buffer and dir_light exist,
+/* assumes light_buffer and frame exist,
  * since passing light_buffer as a parameter gives literally 3 fps on some devices
  * this is because all parameters are copied, so each pixel copies the entire light buffer */
 vec3 compute_phong_light(vec3 normal, vec3 frag_pos, vec3 world_pos, tex_coord_t tex_coord)
 {
     normal = normalize(normal);
 
+    DirLight dir_light = DirLight(frame.dir_light_dir.xyz, frame.dir_light_ambient.xyz, frame.dir_light_diffuse.xyz, frame.dir_light_specular.xyz);
     vec3 result = compute_dir_light(dir_light, normal, frag_pos, tex_coord);
-    for(int i = 0; i < light_count; i++)
+    for(int i = 0; i < frame.light_count; i++)
     {
         result += compute_point_light(light_buffer[i], normal, frag_pos, world_pos, tex_coord);
     }
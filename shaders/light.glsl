@@ -1,22 +1,56 @@
 #type vertex
+#include "include/defines.glsl"
+#include "include/phong_types.glsl"
+#include "include/frame.glsl"
+#include "include/draw.glsl"
+
 layout (location = 0) in vec3 v_pos;
+layout (location = BGL_GLSL_INSTANCE_DRAW_LOCATION) in uint i_draw;
 
-uniform mat4 mvp;
+flat out vec3 f_colour;
+
+layout(std140, binding = 0) uniform Lights
+{
+    Light light_buffer[BGL_GLSL_MAX_POINT_LIGHTS];
+};
+layout(std140, binding = 1) uniform Frame
+{
+    FrameData frame;
+};
+layout(std140, binding = 2) uniform Draws
+{
+    DrawData draws[BGL_GLSL_DRAWS_PER_BLOCK];
+};
 
 void main()
 {
-    gl_Position = mvp * vec4(v_pos, 1.0);
+    gl_Position = draws[i_draw].mvp * vec4(v_pos, 1.0);
+
+    /* light models sit on their light, so the nearest light gives the colour. this lets every
+     * light share one material and be drawn as instances of one draw */
+    vec3 centre = draws[i_draw].model[3].xyz;
+    int nearest = 0;
+    float nearest_dist = 1e30;
+    for(int i = 0; i < frame.light_count; i++)
+    {
+        vec3 offset = light_buffer[i].pos.xyz - centre;
+        float dist = dot(offset, offset);
+        if(dist < nearest_dist)
+        {
+            nearest = i;
+            nearest_dist = dist;
+        }
+    }
+    f_colour = light_buffer[nearest].diffuse.xyz;
 }
 
 #type fragment
-#include "include/phong_types.glsl"
-
 out vec4 frag_colour;
 
-uniform Material material;
+flat in vec3 f_colour;
 
 void main()
 {
     /* multiply diffuse by arbitrary value because it looks nicer */
-    frag_colour = vec4(2.0 * material.diffuse, 1.0);
+    frag_colour = vec4(2.0 * f_colour, 1.0);
 }
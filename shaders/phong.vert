@@ -1,30 +1,39 @@
 #include "include/defines.glsl"
 #include "include/phong_types.glsl"
+#include "include/frame.glsl"
+#include "include/draw.glsl"
 
 layout (location = 0) in vec3 v_pos;
 layout (location = 1) in vec3 v_normal;
 layout (location = 2) in tex_coord_t v_uv;
+layout (location = BGL_GLSL_INSTANCE_DRAW_LOCATION) in uint i_draw;
 
 out VSOut vs_out;
+flat out uint f_draw;
 
 layout(std140, binding = 0) uniform Lights
 {
     Light light_buffer[BGL_GLSL_MAX_POINT_LIGHTS];
-    int light_count;
 };
-uniform mat4 mvp;
-uniform mat4 model_view;
-uniform mat4 model;
-uniform mat4 view;
+layout(std140, binding = 1) uniform Frame
+{
+    FrameData frame;
+};
+layout(std140, binding = 2) uniform Draws
+{
+    DrawData draws[BGL_GLSL_DRAWS_PER_BLOCK];
+};
 
 void main()
 {
-    gl_Position = mvp * vec4(v_pos, 1.0);
+    vec4 world_pos = draws[i_draw].model * vec4(v_pos, 1.0f);
+    gl_Position = draws[i_draw].mvp * vec4(v_pos, 1.0f);
 
-    mat3 normal_matrix = mat3(transpose(inverse(model_view))); // remove translation
+    mat3 normal_matrix = mat3(draws[i_draw].normal_matrix); // computed once per draw on the cpu
 
-    vs_out.frag_pos = (model_view * vec4(v_pos, 1.0f)).xyz;
-    vs_out.world_pos = (model * vec4(v_pos, 1.0f)).xyz;
+    vs_out.frag_pos = (frame.view * world_pos).xyz;
+    vs_out.world_pos = world_pos.xyz;
     vs_out.normal = normalize(normal_matrix * v_normal); // transform vertex normals to match model
     vs_out.tex_coord = v_uv;
+    f_draw = i_draw;
 } // all vertices are divided by w after vertex shader
@@ -3,19 +3,28 @@
 /* need to define this for phong_lighting.glsl so it uses vec3 for tex coords instead of vec2 */
 #define tex_coord_t vec3
 #include "include/phong_types.glsl"
+#include "include/frame.glsl"
+#include "include/draw.glsl"
 
 out vec4 frag_colour;
 
 in VSOut vs_out;
+flat in uint f_draw;
 
 layout(std140, binding = 0) uniform Lights
 {
     Light light_buffer[BGL_GLSL_MAX_POINT_LIGHTS];
-    int light_count;
 };
-uniform DirLight dir_light;
-uniform Material material;
-uniform mat4 view;
+layout(std140, binding = 1) uniform Frame
+{
+    FrameData frame;
+};
+layout(std140, binding = 2) uniform Draws
+{
+    DrawData draws[BGL_GLSL_DRAWS_PER_BLOCK];
+};
+
+Material material; // read by phong_lighting.glsl, filled from the draw's data
 uniform samplerCube BGL_GLSL_TEXTURE_DIFFUSE;
 uniform samplerCube BGL_GLSL_TEXTURE_SPECULAR;
 
@@ -23,6 +32,10 @@ uniform samplerCube BGL_GLSL_TEXTURE_SPECULAR;
 
 void main()
 {
+    material = Material(draws[f_draw].material_ambient.xyz, draws[f_draw].material_diffuse.xyz,
+                        draws[f_draw].material_specular.xyz, draws[f_draw].material_specular.w);
+
     vec3 phong = compute_phong_light(vs_out.normal, vs_out.frag_pos, vs_out.world_pos, vs_out.tex_coord);
-    frag_colour = vec4(phong, 1.0);
+    /* the alpha only matters to transparent materials, opaque ones are drawn without blending */
+    frag_colour = vec4(phong, draws[f_draw].material_diffuse.w * texture(BGL_GLSL_TEXTURE_DIFFUSE, vs_out.tex_coord).a);
 }
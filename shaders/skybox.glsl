@@ -1,16 +1,22 @@
 #type vertex
+#include "include/frame.glsl"
+
 layout (location = 0) in vec3 v_pos;
 layout (location = 1) in vec3 v_normal;
 
 out vec3 f_pos;
 
-uniform mat4 mvp; // mvp without the translation (or the model)
+layout(std140, binding = 1) uniform Frame
+{
+    FrameData frame;
+};
 
 void main()
 {
     f_pos = v_pos;
 
-    vec4 corrected_pos = mvp * vec4(v_pos, 1.0);
+    mat4 view_rotation = mat4(mat3(frame.view)); // no translation allowed to keep skybox at consistent distance
+    vec4 corrected_pos = frame.projection * view_rotation * vec4(v_pos, 1.0);
     gl_Position = corrected_pos.xyww; // ensure all NDC z values are 1.0
 }
 
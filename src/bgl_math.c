@@ -197,6 +197,27 @@ void mat4_transpose(mat4* out, mat4 mat)
     out->m44 = mat.m44;
 }
 
+void mat4_normal_matrix(mat4* out, mat4 mat)
+{
+    /* inverse transpose is the cofactor matrix divided by the determinant */
+    const f32 c11 = mat.m22 * mat.m33 - mat.m23 * mat.m32;
+    const f32 c12 = mat.m23 * mat.m31 - mat.m21 * mat.m33;
+    const f32 c13 = mat.m21 * mat.m32 - mat.m22 * mat.m31;
+    const f32 det = mat.m11 * c11 + mat.m12 * c12 + mat.m13 * c13;
+    const f32 inv_det = det != 0.0f ? 1.0f / det : 0.0f;
+
+    mat4_identity(out);
+    out->m11 = c11 * inv_det;
+    out->m12 = c12 * inv_det;
+    out->m13 = c13 * inv_det;
+    out->m21 = (mat.m13 * mat.m32 - mat.m12 * mat.m33) * inv_det;
+    out->m22 = (mat.m11 * mat.m33 - mat.m13 * mat.m31) * inv_det;
+    out->m23 = (mat.m12 * mat.m31 - mat.m11 * mat.m32) * inv_det;
+    out->m31 = (mat.m12 * mat.m23 - mat.m13 * mat.m22) * inv_det;
+    out->m32 = (mat.m13 * mat.m21 - mat.m11 * mat.m23) * inv_det;
+    out->m33 = (mat.m11 * mat.m22 - mat.m12 * mat.m21) * inv_det;
+}
+
 void mat4_scale(mat4* out, vec3 s)
 {
     mat4 mat = {
@@ -370,3 +391,168 @@ void mat_look_at(mat4* out, vec3 t, vec3 k, vec3 i)
     out->m31 = -k.x; out->m32 = -k.y; out->m33 = -k.z; out->m34 = vec3_dot(t, k);
     out->m41 = out->m42 = out->m43 = 0.0f; out->m44 = 1.0f;
 }
+
+void mat4_transform_aabb(vec3* min_out, vec3* max_out, mat4 mat, vec3 min, vec3 max)
+{
+    /* transform the centre, then the extents by the absolute rotation/scale part */
+    vec3 centre = vec3_scale(vec3_add(min, max), 0.5f);
+    vec3 extent = vec3_scale(vec3_sub(max, min), 0.5f);
+
+    for(u32 i = 0; i < 3; i++)
+    {
+        f32 c = mat.cols[3].data[i];
+        f32 e = 0.0f;
+        for(u32 j = 0; j < 3; j++)
+        {
+            c += mat.cols[j].data[i] * centre.data[j];
+            e += fabsf(mat.cols[j].data[i]) * extent.data[j];
+        }
+        min_out->data[i] = c - e;
+        max_out->data[i] = c + e;
+    }
+}
+
+void mat4_frustum_planes(vec4* planes_out, mat4 view_proj)
+{
+    /* each plane is the last row of the matrix plus or minus one of the others (gribb/hartmann) */
+    for(u32 i = 0; i < 6; i++)
+    {
+        u32 row = i / 2;
+        f32 sign = (i % 2 == 0) ? 1.0f : -1.0f;
+
+        vec4 plane;
+        for(u32 j = 0; j < 4; j++)
+        {
+            plane.data[j] = view_proj.cols[j].data[3] + sign * view_proj.cols[j].data[row];
+        }
+
+        f32 inv_len = 1.0f / sqrtf(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+        for(u32 j = 0; j < 4; j++)
+        {
+            planes_out[i].data[j] = plane.data[j] * inv_len;
+        }
+    }
+}
+
+vec3 mat3_mul_vec3(mat3 m, vec3 v)
+{
+    return VEC3(m.m11 * v.x + m.m12 * v.y + m.m13 * v.z,
+                m.m21 * v.x + m.m22 * v.y + m.m23 * v.z,
+                m.m31 * v.x + m.m32 * v.y + m.m33 * v.z);
+}
+
+void mat3_from_mat4(mat3* out, mat4 m)
+{
+    for(u32 i = 0; i < 3; i++)
+    {
+        out->cols[i] = VEC4TOVEC3(m.cols[i]);
+    }
+}
+
+vec4 quat_identity(void)
+{
+    return VEC4(0.0f, 0.0f, 0.0f, 1.0f);
+}
+
+vec4 quat_mul(vec4 q1, vec4 q2)
+{
+    return VEC4(q1.w * q2.x + q1.x * q2.w + q1.y * q2.z - q1.z * q2.y,
+                q1.w * q2.y - q1.x * q2.z + q1.y * q2.w + q1.z * q2.x,
+                q1.w * q2.z + q1.x * q2.y - q1.y * q2.x + q1.z * q2.w,
+                q1.w * q2.w - q1.x * q2.x - q1.y * q2.y - q1.z * q2.z);
+}
+
+vec4 quat_norm(vec4 q)
+{
+    f32 len_sq = q.x * q.x + q.y * q.y + q.z * q.z + q.w * q.w;
+    if(len_sq == 0.0f) return quat_identity();
+
+    f32 inv_len = 1.0f / sqrtf(len_sq);
+    return VEC4(q.x * inv_len, q.y * inv_len, q.z * inv_len, q.w * inv_len);
+}
+
+vec4 quat_nlerp(vec4 q1, vec4 q2, f32 t)
+{
+    /* q and -q are the same rotation, flip q2 if it's the long way round */
+    f32 dot = q1.x * q2.x + q1.y * q2.y + q1.z * q2.z + q1.w * q2.w;
+    f32 t2 = dot < 0.0f ? -t : t;
+    f32 t1 = 1.0f - t;
+    return quat_norm(VEC4(q1.x * t1 + q2.x * t2, q1.y * t1 + q2.y * t2, q1.z * t1 + q2.z * t2, q1.w * t1 + q2.w * t2));
+}
+
+vec3 quat_rotate(vec4 q, vec3 v)
+{
+    /* v + 2w(u x v) + 2u x (u x v) */
+    vec3 u = VEC3(q.x, q.y, q.z);
+    vec3 t = vec3_scale(vec_cross(u, v), 2.0f);
+    return vec3_add(vec3_add(v, vec3_scale(t, q.w)), vec_cross(u, t));
+}
+
+vec4 quat_integrate(vec4 q, vec3 angular_velocity, f32 dt)
+{
+    /* dq/dt = 0.5 * (w, 0) * q, first order is fine with the renormalise */
+    vec4 spin = quat_mul(VEC4(angular_velocity.x, angular_velocity.y, angular_velocity.z, 0.0f), q);
+    f32 h = 0.5f * dt;
+    return quat_norm(VEC4(q.x + spin.x * h, q.y + spin.y * h, q.z + spin.z * h, q.w + spin.w * h));
+}
+
+void quat_to_mat3(mat3* out, vec4 q)
+{
+    f32 xx = q.x * q.x, yy = q.y * q.y, zz = q.z * q.z;
+    f32 xy = q.x * q.y, xz = q.x * q.z, yz = q.y * q.z;
+    f32 wx = q.w * q.x, wy = q.w * q.y, wz = q.w * q.z;
+
+    out->cols[0] = VEC3(1.0f - 2.0f * (yy + zz), 2.0f * (xy + wz), 2.0f * (xz - wy));
+    out->cols[1] = VEC3(2.0f * (xy - wz), 1.0f - 2.0f * (xx + zz), 2.0f * (yz + wx));
+    out->cols[2] = VEC3(2.0f * (xz + wy), 2.0f * (yz - wx), 1.0f - 2.0f * (xx + yy));
+}
+
+vec4 quat_from_mat3(mat3 m)
+{
+    /* branch on the largest component so the sqrt is never of something tiny (shepperd) */
+    f32 trace = m.m11 + m.m22 + m.m33;
+    vec4 q;
+    if(trace > 0.0f)
+    {
+        f32 s = 2.0f * sqrtf(trace + 1.0f);
+        q = VEC4((m.m32 - m.m23) / s, (m.m13 - m.m31) / s, (m.m21 - m.m12) / s, 0.25f * s);
+    }
+    else if(m.m11 > m.m22 && m.m11 > m.m33)
+    {
+        f32 s = 2.0f * sqrtf(1.0f + m.m11 - m.m22 - m.m33);
+        q = VEC4(0.25f * s, (m.m12 + m.m21) / s, (m.m13 + m.m31) / s, (m.m32 - m.m23) / s);
+    }
+    else if(m.m22 > m.m33)
+    {
+        f32 s = 2.0f * sqrtf(1.0f + m.m22 - m.m11 - m.m33);
+        q = VEC4((m.m12 + m.m21) / s, 0.25f * s, (m.m23 + m.m32) / s, (m.m13 - m.m31) / s);
+    }
+    else
+    {
+        f32 s = 2.0f * sqrtf(1.0f + m.m33 - m.m11 - m.m22);
+        q = VEC4((m.m13 + m.m31) / s, (m.m23 + m.m32) / s, 0.25f * s, (m.m21 - m.m12) / s);
+    }
+    return quat_norm(q);
+}
+
+vec4 quat_from_euler(vec3 euler)
+{
+    vec4 qx = VEC4(sinf(euler.x * 0.5f), 0.0f, 0.0f, cosf(euler.x * 0.5f));
+    vec4 qy = VEC4(0.0f, sinf(euler.y * 0.5f), 0.0f, cosf(euler.y * 0.5f));
+    vec4 qz = VEC4(0.0f, 0.0f, sinf(euler.z * 0.5f), cosf(euler.z * 0.5f));
+    return quat_mul(qz, quat_mul(qy, qx));
+}
+
+vec3 quat_to_euler(vec4 q)
+{
+    mat3 m;
+    quat_to_mat3(&m, q);
+
+    /* m = rz * ry * rx, so m31 = -sin(y). at +-90 degrees x and z turn about the same axis, put it all in x */
+    f32 sin_y = CLAMP(-m.m31, -1.0f, 1.0f);
+    if(fabsf(sin_y) > 0.99999f)
+    {
+        return VEC3(atan2f(-m.m23, m.m22), asinf(sin_y), 0.0f);
+    }
+    return VEC3(atan2f(m.m32, m.m33), asinf(sin_y), atan2f(m.m21, m.m11));
+}
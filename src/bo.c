@@ -1,13 +1,46 @@
 #include "bo.h"
 
 #include <stdio.h>
+#include <string.h>
 #include "defines.h"
+#include "renderer.h"
+
+#define FENCE_WAIT_NS 1000000 // between checks for a fence, the commands are flushed each time
+
+static struct
+{
+    bool buffer_storage;
+    size_t uniform_alignment;
+} bo_ctx;
+
+/**
+ * internal functions
+ */
+void bo_stream_allocate(BOStream* self, size_t size);
+
+/* without dsa buffers are edited through GL_COPY_WRITE_BUFFER, nothing draws from it so the
+ * vao's element buffer and the buffers bound for drawing are left alone */
+static inline GLenum bo_bind_for_edit(BO self)
+{
+    glBindBuffer(GL_COPY_WRITE_BUFFER, self.id);
+    return GL_COPY_WRITE_BUFFER;
+}
+
+void bo_init(bool buffer_storage)
+{
+    bo_ctx.buffer_storage = buffer_storage;
+
+    i32 alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    bo_ctx.uniform_alignment = alignment > 0 ? (size_t)alignment : 256;
+}
 
 BO bo_create(GLenum type)
 {
     BO self;
     self.type = type;
-    glGenBuffers(1, &self.id);
+    if(rd_state_dsa()) glCreateBuffers(1, &self.id);
+    else glGenBuffers(1, &self.id);
     return self;
 }
 
@@ -24,12 +57,61 @@ void bo_unbind(BO self)
 void bo_set_buffer(BO self, const void* data, size_t size, bool dynamic)
 {
     GLenum usage = dynamic ? GL_DYNAMIC_DRAW : GL_STATIC_DRAW;
-    glBufferData(self.type, (GLsizeiptr)size, data, usage);
+    if(rd_state_dsa()) glNamedBufferData(self.id, (GLsizeiptr)size, data, usage);
+    else glBufferData(bo_bind_for_edit(self), (GLsizeiptr)size, data, usage);
 }
 
 void bo_set_buffer_region(BO self, const void* data, i32 offset, size_t size)
 {
-    glBufferSubData(self.type, (GLintptr)offset, (GLsizeiptr)size, data);
+    if(rd_state_dsa()) glNamedBufferSubData(self.id, (GLintptr)offset, (GLsizeiptr)size, data);
+    else glBufferSubData(bo_bind_for_edit(self), (GLintptr)offset, (GLsizeiptr)size, data);
+}
+
+bool bo_buffer_storage(void)
+{
+    return bo_ctx.buffer_storage;
+}
+
+void* bo_set_storage_mapped(BO self, size_t size)
+{
+    const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+    void* data;
+    if(rd_state_dsa())
+    {
+        glNamedBufferStorage(self.id, (GLsizeiptr)size, NULL, flags);
+        data = glMapNamedBufferRange(self.id, 0, (GLsizeiptr)size, flags);
+    }
+    else
+    {
+        const GLenum target = bo_bind_for_edit(self);
+        glBufferStorage(target, (GLsizeiptr)size, NULL, flags);
+        data = glMapBufferRange(target, 0, (GLsizeiptr)size, flags);
+    }
+    BGL_ASSERT(data != NULL, "failed to persistently map %zu bytes", size);
+    return data;
+}
+
+void* bo_map_range_unsynchronized(BO self, size_t offset, size_t size)
+{
+    const GLbitfield access = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+    void* data;
+    if(rd_state_dsa()) data = glMapNamedBufferRange(self.id, (GLintptr)offset, (GLsizeiptr)size, access);
+    else data = glMapBufferRange(bo_bind_for_edit(self), (GLintptr)offset, (GLsizeiptr)size, access);
+    BGL_ASSERT(data != NULL, "failed to map %zu bytes", size);
+    return data;
+}
+
+void bo_unmap(BO self)
+{
+    if(rd_state_dsa()) glUnmapNamedBuffer(self.id);
+    else glUnmapBuffer(bo_bind_for_edit(self));
+}
+
+void bo_fence_wait(GLsync fence)
+{
+    GLenum result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_NS);
+    while(result == GL_TIMEOUT_EXPIRED) result = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, FENCE_WAIT_NS);
+    if(result == GL_WAIT_FAILED) BGL_LOG_ERROR("waiting on a fence failed");
 }
 
 void bo_free(BO self)
@@ -37,6 +119,86 @@ void bo_free(BO self)
     glDeleteBuffers(1, &self.id);
 }
 
+void bo_stream_create(BOStream* self, GLenum type, size_t size)
+{
+    memset(self, 0, sizeof(BOStream));
+    self->bo.type = type;
+    bo_stream_allocate(self, size);
+}
+
+void bo_stream_free(BOStream* self)
+{
+    for(u32 i = 0; i < BGL_BO_STREAM_REGIONS; i++)
+    {
+        if(self->fences[i] != NULL) glDeleteSync(self->fences[i]);
+    }
+    bo_free(self->bo); // unmaps as well
+    memset(self, 0, sizeof(BOStream));
+}
+
+void* bo_stream_begin(BOStream* self, size_t size)
+{
+    if(size > self->region_size) bo_stream_allocate(self, size);
+
+    if(self->mapped == NULL)
+    {
+        /* orphan, whatever the gpu is still reading keeps the old memory */
+        if(rd_state_dsa()) glNamedBufferData(self->bo.id, (GLsizeiptr)self->region_size, NULL, GL_STREAM_DRAW);
+        else glBufferData(bo_bind_for_edit(self->bo), (GLsizeiptr)self->region_size, NULL, GL_STREAM_DRAW);
+        return bo_map_range_unsynchronized(self->bo, 0, size);
+    }
+
+    /* every command reading the region being left has been issued, so it can be fenced now */
+    if(self->fences[self->region] != NULL) glDeleteSync(self->fences[self->region]);
+    self->fences[self->region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    self->region = (self->region + 1) % BGL_BO_STREAM_REGIONS;
+    if(self->fences[self->region] != NULL)
+    {
+        bo_fence_wait(self->fences[self->region]);
+        glDeleteSync(self->fences[self->region]);
+        self->fences[self->region] = NULL;
+    }
+    return self->mapped + self->region * self->region_size;
+}
+
+void bo_stream_end(BOStream* self)
+{
+    /* persistent mappings are coherent, the writes are seen by the next draw without a flush */
+    if(self->mapped == NULL) bo_unmap(self->bo);
+}
+
+size_t bo_stream_offset(const BOStream* self)
+{
+    return self->mapped != NULL ? self->region * self->region_size : 0;
+}
+
+void bo_stream_allocate(BOStream* self, size_t size)
+{
+    size = (size + bo_ctx.uniform_alignment - 1) / bo_ctx.uniform_alignment * bo_ctx.uniform_alignment;
+
+    if(!bo_ctx.buffer_storage)
+    {
+        /* allocated by the orphaning in bo_stream_begin */
+        if(self->bo.id == 0) self->bo = bo_create(self->bo.type);
+        self->region_size = size;
+        return;
+    }
+
+    /* immutable storage can't be resized, so it's replaced. draws still reading the old buffer keep it alive */
+    if(self->bo.id != 0) bo_free(self->bo);
+    for(u32 i = 0; i < BGL_BO_STREAM_REGIONS; i++)
+    {
+        if(self->fences[i] != NULL) glDeleteSync(self->fences[i]);
+        self->fences[i] = NULL;
+    }
+
+    self->bo = bo_create(self->bo.type);
+    self->region_size = size;
+    self->region = 0;
+    self->mapped = (u8*)bo_set_storage_mapped(self->bo, size * BGL_BO_STREAM_REGIONS);
+}
+
 void ubo_bind_buffer_base(UBO self, u32 index)
 {
     glBindBufferBase(GL_UNIFORM_BUFFER, index, self.id);
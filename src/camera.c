@@ -47,16 +47,30 @@ void camera_update_proj(Camera* self, f32 fov, f32 aspect_ratio, f32 znear, f32
     mat_perspective_fov(&self->projection, fov, aspect_ratio, znear, zfar);
 }
 
-void camera_update(Camera* self, BGLWindow* window, f32 delta_time)
+void camera_screen_ray(const Camera* self, f32 x, f32 y, f32 width, f32 height, vec3* origin_out, vec3* dir_out)
 {
-    const f32 aspect_ratio = (f32)(window->width) / (f32)(window->height);
-    if(aspect_ratio != self->aspect_ratio)
-    {
-        camera_update_proj(self, self->fov, aspect_ratio, self->znear, self->zfar);
-    }
+    const f32 ndc_x = 2.0f * x / width - 1.0f;
+    const f32 ndc_y = 1.0f - 2.0f * y / height; // window y goes down
+    const f32 tan_half_fov = tanf(0.5f * self->fov); // same as mat_perspective_fov
+    const vec3 up = vec_cross(self->right, self->dir);
 
+    vec3 dir = vec3_add(self->dir, vec3_add(vec3_scale(self->right, ndc_x * tan_half_fov * self->aspect_ratio), vec3_scale(up, ndc_y * tan_half_fov)));
+    vec3_norm(&dir);
+
+    *origin_out = self->pos;
+    *dir_out = dir;
+}
+
+void camera_update(Camera* self, BGLWindow* window, f32 delta_time)
+{
     const f32 cam_step = self->speed * (f32)delta_time;
+    self->pos = vec3_add(self->pos, vec3_scale(camera_move_input(self, window), cam_step));
 
+    camera_update_look(self, window);
+}
+
+vec3 camera_move_input(const Camera* self, BGLWindow* window)
+{
     // remove y component from "velocity" vecs to keep moving on flat plane
     vec3 flat_dir = VEC3( 
         self->dir.x,
@@ -74,36 +88,22 @@ void camera_update(Camera* self, BGLWindow* window, f32 delta_time)
 
     vec3 world_up = VEC3(0.0f, 1.0f, 0.0f);
 
-    vec3 step_vec;
-    if(window_key_pressed(window, GLFW_KEY_W))
-    {
-        step_vec = vec3_scale(flat_dir, cam_step);
-        self->pos = vec3_add(self->pos, step_vec);
-    }
-    if(window_key_pressed(window, GLFW_KEY_S))
-    {
-        step_vec = vec3_scale(flat_dir, cam_step);
-        self->pos = vec3_sub(self->pos, step_vec);
-    }
-    if(window_key_pressed(window, GLFW_KEY_A))
-    {
-        step_vec = vec3_scale(flat_right, cam_step);
-        self->pos = vec3_sub(self->pos, step_vec);
-    }
-    if(window_key_pressed(window, GLFW_KEY_D))
-    {
-        step_vec = vec3_scale(flat_right, cam_step);
-        self->pos = vec3_add(self->pos, step_vec);
-    }
-    if(window_key_pressed(window, GLFW_KEY_SPACE))
-    {
-        step_vec = vec3_scale(world_up, cam_step);
-        self->pos = vec3_add(self->pos, step_vec);
-    }
-    if(window_key_pressed(window, GLFW_KEY_LEFT_CONTROL))
+    vec3 input = VEC3(0.0f, 0.0f, 0.0f);
+    if(window_key_pressed(window, GLFW_KEY_W)) input = vec3_add(input, flat_dir);
+    if(window_key_pressed(window, GLFW_KEY_S)) input = vec3_sub(input, flat_dir);
+    if(window_key_pressed(window, GLFW_KEY_A)) input = vec3_sub(input, flat_right);
+    if(window_key_pressed(window, GLFW_KEY_D)) input = vec3_add(input, flat_right);
+    if(window_key_pressed(window, GLFW_KEY_SPACE)) input = vec3_add(input, world_up);
+    if(window_key_pressed(window, GLFW_KEY_LEFT_CONTROL)) input = vec3_sub(input, world_up);
+    return input;
+}
+
+void camera_update_look(Camera* self, BGLWindow* window)
+{
+    const f32 aspect_ratio = (f32)(window->width) / (f32)(window->height);
+    if(aspect_ratio != self->aspect_ratio)
     {
-        step_vec = vec3_scale(world_up, cam_step);
-        self->pos = vec3_sub(self->pos, step_vec);
+        camera_update_proj(self, self->fov, aspect_ratio, self->znear, self->zfar);
     }
 
     f64 cursor_x, cursor_y;
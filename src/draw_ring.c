@@ -0,0 +1,147 @@
+#include "draw_ring.h"
+
+#include <string.h>
+#include "defines.h"
+#include "defines.glsl"
+
+/**
+ * internal functions
+ */
+void draw_ring_resize(DrawRing* self, u32 capacity);
+void draw_ring_retire(DrawRing* self);
+
+void draw_ring_create(DrawRing* self, u32 capacity)
+{
+    memset(self, 0, sizeof(DrawRing));
+
+    i32 alignment = 0;
+    glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+    BGL_ASSERT(alignment > 0 && sizeof(DrawData) % (u32)alignment == 0, "draw data (%zu bytes) doesn't meet the uniform buffer offset alignment of %d",
+               sizeof(DrawData), alignment);
+
+    self->indices = vbo_create();
+    draw_ring_resize(self, capacity);
+}
+
+void draw_ring_free(DrawRing* self)
+{
+    for(u32 i = 0; i < self->fence_count; i++)
+    {
+        glDeleteSync(self->fences[(self->fence_first + i) % BGL_DRAW_RING_MAX_FENCES].sync);
+    }
+    ubo_free(self->buffer);
+    vbo_free(self->indices);
+    memset(self, 0, sizeof(DrawRing));
+}
+
+DrawData* draw_ring_map(DrawRing* self, u32 count, u32* first_out)
+{
+    if(count * BGL_DRAW_RING_FRAMES > self->capacity) draw_ring_resize(self, count * BGL_DRAW_RING_FRAMES);
+
+    /* a map is never split, so the slots left at the end are skipped when it doesn't fit */
+    const u32 skip = self->head + count > self->capacity ? self->capacity - self->head : 0;
+    while(self->used + skip + count > self->capacity)
+    {
+        if(self->fence_count == 0) draw_ring_fence(self); // this frame alone filled the ring
+        draw_ring_retire(self);
+    }
+
+    const u32 first = skip > 0 ? 0 : self->head;
+    self->head = first + count;
+    self->used += skip + count;
+    self->frame_used += skip + count;
+
+    *first_out = first;
+    if(self->mapped != NULL) return self->mapped + first;
+
+    /* the fences keep the gpu off these slots, so there's nothing for the driver to synchronise */
+    return (DrawData*)bo_map_range_unsynchronized(self->buffer, first * sizeof(DrawData), count * sizeof(DrawData));
+}
+
+void draw_ring_unmap(DrawRing* self)
+{
+    /* a persistent mapping is coherent, so there's nothing to flush */
+    if(self->mapped != NULL) return;
+
+    bo_unmap(self->buffer);
+}
+
+void draw_ring_bind_window(DrawRing* self, u32 slot)
+{
+    if(self->window == slot) return;
+
+    ubo_bind_buffer_range(self->buffer, BGL_GLSL_DRAW_BINDING, (i32)(slot * sizeof(DrawData)), BGL_GLSL_DRAWS_PER_BLOCK * sizeof(DrawData));
+    self->window = slot;
+}
+
+void draw_ring_fence(DrawRing* self)
+{
+    if(self->frame_used == 0) return;
+    if(self->fence_count == BGL_DRAW_RING_MAX_FENCES) draw_ring_retire(self);
+
+    DrawRingFence* fence = &self->fences[(self->fence_first + self->fence_count) % BGL_DRAW_RING_MAX_FENCES];
+    fence->sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    fence->size = self->frame_used;
+    self->fence_count++;
+    self->frame_used = 0;
+}
+
+void draw_data_write(DrawData* out, const mat4* view, const mat4* view_projection, const mat4* model, const Material* material)
+{
+    /* built on the stack so the mapped memory is written once, in order */
+    DrawData data;
+    mat4 model_view;
+    mat4_mul(&model_view, *view, *model);
+
+    data.model = *model;
+    mat4_normal_matrix(&data.normal_matrix, model_view);
+    mat4_mul(&data.mvp, *view_projection, *model);
+    data.material_ambient = VEC3TOVEC4(material->ambient, 1.0f);
+    data.material_diffuse = VEC3TOVEC4(material->diffuse, material->opacity);
+    data.material_specular = VEC3TOVEC4(material->specular, material->shininess);
+    data.padding = VEC4(0.0f, 0.0f, 0.0f, 0.0f);
+    *out = data;
+}
+
+void draw_ring_resize(DrawRing* self, u32 capacity)
+{
+    u32 new_capacity = BGL_GLSL_DRAWS_PER_BLOCK;
+    while(new_capacity < capacity) new_capacity *= 2;
+
+    /* a new buffer, so draws still reading the old one keep it alive and the fences aren't needed.
+     * immutable storage can't be respecified, otherwise the old storage would just be orphaned */
+    for(u32 i = 0; i < self->fence_count; i++)
+    {
+        glDeleteSync(self->fences[(self->fence_first + i) % BGL_DRAW_RING_MAX_FENCES].sync);
+    }
+    self->fence_first = self->fence_count = 0;
+    self->head = self->used = self->frame_used = 0;
+    self->window = BGL_DRAW_RING_NO_WINDOW;
+    self->capacity = new_capacity;
+
+    const size_t size = (new_capacity + BGL_GLSL_DRAWS_PER_BLOCK) * sizeof(DrawData);
+    if(self->buffer.id != 0) ubo_free(self->buffer); // unmaps as well
+    self->buffer = ubo_create();
+    if(bo_buffer_storage()) self->mapped = (DrawData*)bo_set_storage_mapped(self->buffer, size);
+    else ubo_set_buffer(self->buffer, NULL, size, true);
+
+    u32* indices = (u32*)BGL_MALLOC(new_capacity * sizeof(u32));
+    BGL_ASSERT(indices != NULL, "draw ring index allocation failed");
+    for(u32 i = 0; i < new_capacity; i++)
+    {
+        indices[i] = i % BGL_GLSL_DRAWS_PER_BLOCK;
+    }
+    vbo_set_buffer(self->indices, indices, new_capacity * sizeof(u32), false);
+    BGL_FREE(indices);
+}
+
+void draw_ring_retire(DrawRing* self)
+{
+    DrawRingFence* fence = &self->fences[self->fence_first];
+
+    bo_fence_wait(fence->sync);
+    glDeleteSync(fence->sync);
+    self->used -= fence->size;
+    self->fence_first = (self->fence_first + 1) % BGL_DRAW_RING_MAX_FENCES;
+    self->fence_count--;
+}
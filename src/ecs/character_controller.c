@@ -0,0 +1,274 @@
+#include "ecs/character_controller.h"
+
+#include "jobs.h"
+
+#define DEFAULT_STEP_HEIGHT 0.3f
+#define DEFAULT_MAX_SLOPE_COS 0.70710678f // 45 degrees
+#define DEFAULT_SNAP_DISTANCE 0.3f
+#define DEFAULT_SKIN 0.01f
+#define MOVE_EPSILON 1e-5f
+#define DEPENETRATION_ITERATIONS 2
+#define EDGE_PROBE 0.02f // how far past an edge the surface next to it is looked for
+#define CHARACTER_BATCH_SIZE 16
+
+typedef struct CharacterBatch
+{
+    CharacterController* controllers;
+    const vec3* walk_velocities;
+    const PhysicsWorld* world;
+    f32 delta_time;
+} CharacterBatch;
+
+/**
+ * internal functions
+ */
+vec3 character_controller_slide(const CharacterController* self, const PhysicsWorld* world, vec3 pos, vec3 displacement, bool walls, PhysicsHit* hit_out);
+bool character_controller_cast(const CharacterController* self, const PhysicsWorld* world, vec3 pos, vec3 displacement, PhysicsHit* hit_out);
+bool character_controller_probe_edge(const CharacterController* self, const PhysicsWorld* world, vec3 pos, const PhysicsHit* hit, vec3* normal_out);
+vec3 character_controller_depenetrate(const CharacterController* self, const PhysicsWorld* world, vec3 pos);
+void character_controller_batch(void* data, u32 start, u32 end, u32 worker);
+
+static inline void character_controller_shape(const CharacterController* self, vec3 pos, CollisionShape* shape_out)
+{
+    *shape_out = (CollisionShape){
+        .type = BGL_COLLIDER_CAPSULE,
+        .centre = VEC3(pos.x, pos.y + 0.5f * self->height, pos.z),
+        .axes = { VEC3(1.0f, 0.0f, 0.0f), VEC3(0.0f, 1.0f, 0.0f), VEC3(0.0f, 0.0f, 1.0f) },
+        .radius = self->radius,
+        .half_height = MAX(0.5f * self->height - self->radius, 0.0f),
+    };
+}
+
+/* the hit point, moved skin away from the surface */
+static inline vec3 character_controller_contact(const CharacterController* self, vec3 pos, vec3 displacement, const PhysicsHit* hit)
+{
+    return vec3_add(vec3_add(pos, vec3_scale(displacement, hit->t)), vec3_scale(hit->normal, self->skin));
+}
+
+void character_controller_create(CharacterController* self, vec3 pos, f32 radius, f32 height)
+{
+    *self = (CharacterController){
+        .pos = pos,
+        .radius = radius,
+        .height = MAX(height, 2.0f * radius),
+        .step_height = DEFAULT_STEP_HEIGHT,
+        .max_slope_cos = DEFAULT_MAX_SLOPE_COS,
+        .snap_distance = DEFAULT_SNAP_DISTANCE,
+        .skin = DEFAULT_SKIN,
+        .proxy = BGL_PHYSICS_QUERY_NO_PROXY,
+        .ground_normal = VEC3(0.0f, 1.0f, 0.0f),
+        .ground = BGL_ENTITY_NULL,
+    };
+}
+
+void character_controller_move(CharacterController* self, const PhysicsWorld* world, vec3 displacement)
+{
+    const vec3 start = character_controller_depenetrate(self, world, self->pos);
+    const vec3 side = VEC3(displacement.x, 0.0f, displacement.z);
+    const bool walking = self->grounded && displacement.y <= 0.0f;
+    const bool moving = vec3_dot(side, side) > MOVE_EPSILON * MOVE_EPSILON;
+
+    PhysicsHit hit;
+    bool stepped = walking && moving && self->step_height > 0.0f;
+    vec3 pos;
+    while(true)
+    {
+        /* up, the step and any upwards movement */
+        pos = start;
+        const f32 up = (stepped ? self->step_height : 0.0f) + MAX(displacement.y, 0.0f);
+        f32 climbed = up;
+        if(up > 0.0f)
+        {
+            if(character_controller_cast(self, world, pos, VEC3(0.0f, up, 0.0f), &hit))
+            {
+                pos = character_controller_contact(self, pos, VEC3(0.0f, up, 0.0f), &hit);
+                climbed = MAX(pos.y - start.y, 0.0f);
+                if(displacement.y > 0.0f) self->velocity.y = MIN(self->velocity.y, 0.0f); // head hit a ceiling
+            }
+            else pos.y += up;
+        }
+
+        /* side */
+        if(moving) pos = character_controller_slide(self, world, pos, side, true, &hit);
+
+        /* down, with the step taken back and the snap searched for the ground */
+        const f32 step_back = displacement.y > 0.0f ? 0.0f : climbed;
+        const f32 fall = step_back + MAX(-displacement.y, 0.0f);
+        const f32 search = fall + (walking ? self->snap_distance : 0.0f);
+        self->grounded = false;
+        self->ground = BGL_ENTITY_NULL;
+        self->ground_normal = VEC3(0.0f, 1.0f, 0.0f);
+        if(search <= 0.0f) break;
+
+        const vec3 down = VEC3(0.0f, -search, 0.0f);
+        if(!character_controller_cast(self, world, pos, down, &hit))
+        {
+            pos.y -= fall;
+            break;
+        }
+        vec3 ground_normal = hit.normal;
+        if(ground_normal.y >= self->max_slope_cos || character_controller_probe_edge(self, world, pos, &hit, &ground_normal))
+        {
+            pos = character_controller_contact(self, pos, down, &hit);
+            self->grounded = true;
+            self->ground = hit.entity;
+            self->ground_normal = ground_normal;
+            break;
+        }
+
+        /* landed on something too steep to stand on, a step onto it is taken back */
+        if(stepped)
+        {
+            stepped = false;
+            continue;
+        }
+        if(fall > 0.0f) pos = character_controller_slide(self, world, pos, VEC3(0.0f, -fall, 0.0f), false, &hit);
+        break;
+    }
+
+    if(self->grounded) self->velocity.y = MIN(self->velocity.y, 0.0f);
+    self->pos = pos;
+}
+
+void character_controller_update(CharacterController* self, const PhysicsWorld* world, vec3 walk_velocity, f32 jump_speed, f32 delta_time)
+{
+    if(self->grounded) self->velocity.y = jump_speed > 0.0f ? jump_speed : 0.0f;
+    else self->velocity.y += world->gravity.y * delta_time;
+    self->velocity.x = walk_velocity.x;
+    self->velocity.z = walk_velocity.z;
+
+    character_controller_move(self, world, vec3_scale(self->velocity, delta_time));
+}
+
+void character_controller_update_batch(CharacterController* controllers, const vec3* walk_velocities, u32 count, const PhysicsWorld* world, f32 delta_time)
+{
+    CharacterBatch batch = { controllers, walk_velocities, world, delta_time };
+    jobs_parallel_for(count, CHARACTER_BATCH_SIZE, character_controller_batch, &batch);
+}
+
+void character_controller_attach_camera(const CharacterController* self, Camera* camera, f32 eye_height)
+{
+    camera->pos = VEC3(self->pos.x, self->pos.y + eye_height, self->pos.z);
+    camera_update_view(camera);
+}
+
+/**
+ * move until something is hit, then carry on with what's left of the move along the surface. walls
+ * keeps a horizontal move horizontal by treating slopes too steep to walk as vertical walls
+ */
+vec3 character_controller_slide(const CharacterController* self, const PhysicsWorld* world, vec3 pos, vec3 displacement, bool walls, PhysicsHit* hit_out)
+{
+    const vec3 original = displacement;
+    for(u32 i = 0; i < BGL_CHARACTER_MAX_SLIDES; i++)
+    {
+        if(vec3_dot(displacement, displacement) <= MOVE_EPSILON * MOVE_EPSILON) break;
+        if(!character_controller_cast(self, world, pos, displacement, hit_out))
+        {
+            pos = vec3_add(pos, displacement);
+            break;
+        }
+        pos = character_controller_contact(self, pos, displacement, hit_out);
+
+        vec3 normal = hit_out->normal;
+        if(walls && normal.y < self->max_slope_cos)
+        {
+            normal.y = 0.0f;
+            if(vec3_dot(normal, normal) <= MOVE_EPSILON) break; // a ceiling in the way of a horizontal move
+            vec3_norm(&normal);
+        }
+
+        const vec3 rest = vec3_scale(displacement, 1.0f - hit_out->t);
+        displacement = vec3_sub(rest, vec3_scale(normal, vec3_dot(rest, normal)));
+        if(vec3_dot(displacement, original) <= 0.0f) break; // corners would bounce it back and forth
+    }
+    return pos;
+}
+
+bool character_controller_cast(const CharacterController* self, const PhysicsWorld* world, vec3 pos, vec3 displacement, PhysicsHit* hit_out)
+{
+    CollisionShape capsule;
+    character_controller_shape(self, pos, &capsule);
+    return physics_world_shape_cast(world, &capsule, displacement, 1.0f, self->proxy, hit_out);
+}
+
+/**
+ * the round bottom touching an edge, like the nose of a stair, gets a normal tilted towards the
+ * capsule's axis however flat the top of the edge is. a ray just past the contact, away from the
+ * axis, finds the surface the capsule is actually standing on
+ */
+bool character_controller_probe_edge(const CharacterController* self, const PhysicsWorld* world, vec3 pos, const PhysicsHit* hit, vec3* normal_out)
+{
+    vec3 outward = VEC3(hit->pos.x - pos.x, 0.0f, hit->pos.z - pos.z);
+    if(vec3_dot(outward, outward) <= MOVE_EPSILON * MOVE_EPSILON || hit->pos.y > pos.y + self->radius) return false;
+    vec3_norm(&outward);
+
+    /* a point cast rather than a raycast so the character's own collider is skipped */
+    const CollisionShape point = {
+        .type = BGL_COLLIDER_SPHERE,
+        .centre = vec3_add(hit->pos, VEC3(outward.x * EDGE_PROBE, EDGE_PROBE, outward.z * EDGE_PROBE)),
+        .axes = { VEC3(1.0f, 0.0f, 0.0f), VEC3(0.0f, 1.0f, 0.0f), VEC3(0.0f, 0.0f, 1.0f) },
+    };
+    PhysicsHit probe;
+    if(!physics_world_shape_cast(world, &point, VEC3(0.0f, -2.0f * EDGE_PROBE, 0.0f), 1.0f, self->proxy, &probe)) return false;
+
+    /* starting inside means the surface past the contact rises faster than the probe, too steep */
+    if(probe.t <= 0.0f || probe.normal.y < self->max_slope_cos) return false;
+
+    *normal_out = probe.normal;
+    return true;
+}
+
+/* push out of colliders which moved into the capsule since the last move, so casts start outside */
+vec3 character_controller_depenetrate(const CharacterController* self, const PhysicsWorld* world, vec3 pos)
+{
+    const BroadphaseProxy* own = self->proxy != BGL_PHYSICS_QUERY_NO_PROXY ? &world->proxies[self->proxy] : NULL;
+    for(u32 iteration = 0; iteration < DEPENETRATION_ITERATIONS; iteration++)
+    {
+        CollisionShape shapes[2];
+        character_controller_shape(self, pos, &shapes[0]);
+        const vec3 extent = VEC3(self->radius, 0.5f * self->height, self->radius);
+        const vec3 min = vec3_sub(shapes[0].centre, extent), max = vec3_add(shapes[0].centre, extent);
+
+        AABBTreeHit hits[BGL_CHARACTER_MAX_OVERLAPS];
+        u32 count = MIN(aabb_tree_query_overlap(&world->static_tree, &min, &max, 1, hits, BGL_CHARACTER_MAX_OVERLAPS), BGL_CHARACTER_MAX_OVERLAPS);
+        count += MIN(aabb_tree_query_overlap(&world->dynamic_tree, &min, &max, 1, hits + count, BGL_CHARACTER_MAX_OVERLAPS - count),
+                     BGL_CHARACTER_MAX_OVERLAPS - count);
+
+        vec3 push = VEC3(0.0f, 0.0f, 0.0f);
+        for(u32 i = 0; i < count; i++)
+        {
+            const u32 index = hits[i].user;
+            const BroadphaseProxy* proxy = &world->proxies[index];
+            if(index == self->proxy || proxy->entity == BGL_ENTITY_NULL) continue;
+            if(own != NULL && ((proxy->layer & own->ignore) || (own->layer & proxy->ignore))) continue;
+
+            shapes[1] = world->shapes[index];
+            bool swap;
+            const NarrowphaseKind kind = narrowphase_pair_kind(shapes[0].type, shapes[1].type, &swap);
+            const PhysicsPair pair = swap ? (PhysicsPair){ .proxy_a = 1, .proxy_b = 0 } : (PhysicsPair){ .proxy_a = 0, .proxy_b = 1 };
+            ContactManifold manifold;
+            if(narrowphase_collide(kind, shapes, &pair, 1, &manifold) == 0) continue;
+
+            f32 depth = 0.0f;
+            for(u32 j = 0; j < manifold.point_count; j++) depth = MAX(depth, manifold.points[j].depth);
+            if(depth <= 0.0f) continue;
+
+            /* the normal points from a to b, away from the capsule unless the pair was swapped */
+            push = vec3_add(push, vec3_scale(manifold.normal, swap ? depth + self->skin : -(depth + self->skin)));
+        }
+
+        if(vec3_dot(push, push) <= 0.0f) break;
+        pos = vec3_add(pos, push);
+    }
+    return pos;
+}
+
+void character_controller_batch(void* data, u32 start, u32 end, u32 worker)
+{
+    (void)worker;
+    CharacterBatch* batch = (CharacterBatch*)data;
+    for(u32 i = start; i < end; i++)
+    {
+        character_controller_update(&batch->controllers[i], batch->world, batch->walk_velocities[i], 0.0f, batch->delta_time);
+    }
+}
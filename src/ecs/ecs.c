@@ -0,0 +1,656 @@
+#include "ecs/ecs.h"
+
+#include <string.h>
+#include "defines.h"
+#include "jobs.h"
+#include "platform.h"
+
+#define ECS_INITIAL_CAPACITY 64
+
+typedef struct ECSStageJob
+{
+    World* world;
+    ECSWorkItem* items;
+    f32 delta_time;
+    u32 tick;
+} ECSStageJob;
+
+/**
+ * internal functions
+ */
+u32 ecs_alloc_row(World* self, u32 archetype_idx, u32* chunk_out);
+u32 ecs_alloc_rows(World* self, u32 archetype_idx, u32 wanted, const void* const* components, u32* chunk_out, u32* row_out);
+u32 ecs_alloc_record(World* self);
+void ecs_remove_row(World* self, u32 archetype_idx, u32 chunk_idx, u32 row);
+void ecs_move_entity(World* self, Entity entity, ComponentMask new_mask);
+EntityRecord* ecs_get_record(World* self, Entity entity);
+void ecs_stamp(World* self, EntityRecord* record, u32 component, bool added);
+void ecs_log_removed(World* self, Entity entity, ComponentMask mask);
+bool ecs_chunk_changed(Archetype* archetype, Chunk* chunk, ComponentMask filter, u32 last_run_tick);
+void ecs_stage_job(void* data, u32 start, u32 end, u32 worker);
+void ecs_query_chunks(World* self, ComponentMask mask, u32 last_run_tick, SystemFunc func, void* user);
+
+void ecs_create(World* self)
+{
+    memset(self, 0, sizeof(World));
+    self->tick = 1; // 0 is reserved for never run systems
+
+    ecs_register_component(self, "Transform", sizeof(Transform), _Alignof(Transform));
+    ecs_register_component(self, "ModelMatrix", sizeof(mat4), _Alignof(mat4));
+    ecs_register_component(self, "Velocity", sizeof(Velocity), _Alignof(Velocity));
+    ecs_register_component(self, "MeshRef", sizeof(MeshRef), _Alignof(MeshRef));
+    ecs_register_component(self, "Collider", sizeof(Collider), _Alignof(Collider));
+    ecs_register_component(self, "RigidBody", sizeof(RigidBody), _Alignof(RigidBody));
+    BGL_ASSERT(self->component_count == BGL_COMPONENT_BUILTIN_COUNT, "built-in components out of sync with components.h");
+}
+
+void ecs_free(World* self)
+{
+    for(u32 i = 0; i < self->archetype_count; i++)
+    {
+        Archetype* archetype = &self->archetypes[i];
+        for(u32 j = 0; j < archetype->chunk_count; j++)
+        {
+            ecs_chunk_free(self, &archetype->chunks[j]);
+        }
+        if(archetype->chunks != NULL) BGL_FREE(archetype->chunks);
+    }
+
+    if(self->archetypes != NULL) BGL_FREE(self->archetypes);
+    if(self->records != NULL) BGL_FREE(self->records);
+    if(self->free_records != NULL) BGL_FREE(self->free_records);
+    if(self->work_items != NULL) BGL_FREE(self->work_items);
+    for(u32 i = 0; i < BGL_ECS_MAX_COMPONENTS; i++)
+    {
+        if(self->removed[i] != NULL) BGL_FREE(self->removed[i]);
+    }
+    if(self->mapped != NULL) platform_file_unmap(self->mapped, self->mapped_size);
+    memset(self, 0, sizeof(World));
+}
+
+u32 ecs_register_component(World* self, const char* name, u32 size, u32 align)
+{
+    BGL_ASSERT(self->component_count < BGL_ECS_MAX_COMPONENTS, "too many components registered, max is %u", BGL_ECS_MAX_COMPONENTS);
+    BGL_ASSERT(align <= BGL_ECS_MAX_ALIGN, "component %s alignment %u is larger than max %u", name, align, BGL_ECS_MAX_ALIGN);
+    BGL_ASSERT(self->archetype_count == 0, "components must be registered before creating entities");
+
+    ComponentInfo* info = &self->components[self->component_count];
+    info->size = size;
+    info->align = align == 0 ? 1 : align;
+    strncpy(info->name, name, BGL_ECS_MAX_NAME - 1);
+    info->name[BGL_ECS_MAX_NAME - 1] = '\0';
+
+    return self->component_count++;
+}
+
+Entity ecs_create_entity(World* self, ComponentMask mask)
+{
+    BGL_ASSERT(!self->iterating, "cannot create entities while systems are running");
+
+    u32 index = ecs_alloc_record(self);
+    EntityRecord* record = &self->records[index];
+    record->archetype = ecs_find_archetype(self, mask);
+    record->row = ecs_alloc_row(self, record->archetype, &record->chunk);
+
+    Entity entity = BGL_ENTITY_MAKE(index, record->generation);
+    Chunk* chunk = &self->archetypes[record->archetype].chunks[record->chunk];
+    ((Entity*)chunk->data)[record->row] = entity;
+
+    self->entity_count++;
+    return entity;
+}
+
+void ecs_create_entities(World* self, ComponentMask mask, u32 count, const void* const* components, Entity* entities_out)
+{
+    BGL_ASSERT(!self->iterating, "cannot create entities while systems are running");
+    if(count == 0) return;
+
+    /* reserve every record up front so the loop below never reallocates */
+    u32 fresh = count > self->free_count ? count - self->free_count : 0;
+    BGL_ASSERT(self->record_count + fresh < BGL_ENTITY_INDEX_MASK, "reached max entity count");
+    ecs_grow((void**)&self->records, &self->record_capacity, self->record_count + fresh, sizeof(EntityRecord));
+
+    u32 archetype_idx = ecs_find_archetype(self, mask);
+
+    u32 created = 0;
+    while(created < count)
+    {
+        u32 chunk_idx, row;
+        u32 rows = ecs_alloc_rows(self, archetype_idx, count - created, components, &chunk_idx, &row);
+        Entity* chunk_entities = (Entity*)self->archetypes[archetype_idx].chunks[chunk_idx].data;
+
+        for(u32 i = 0; i < rows; i++)
+        {
+            u32 index = ecs_alloc_record(self);
+            EntityRecord* record = &self->records[index];
+            record->archetype = archetype_idx;
+            record->chunk = chunk_idx;
+            record->row = row + i;
+
+            Entity entity = BGL_ENTITY_MAKE(index, record->generation);
+            chunk_entities[row + i] = entity;
+            if(entities_out != NULL) entities_out[created + i] = entity;
+        }
+        created += rows;
+    }
+
+    self->entity_count += count;
+}
+
+void ecs_destroy_entity(World* self, Entity entity)
+{
+    BGL_ASSERT(!self->iterating, "cannot destroy entities while systems are running");
+
+    EntityRecord* record = ecs_get_record(self, entity);
+    if(record == NULL)
+    {
+        BGL_LOG_WARN("trying to destroy dead entity %u", entity);
+        return;
+    }
+
+    ecs_log_removed(self, entity, self->archetypes[record->archetype].mask);
+    ecs_remove_row(self, record->archetype, record->chunk, record->row);
+
+    record->generation = (record->generation + 1) & BGL_ENTITY_MAX_GENERATION;
+    record->archetype = 0xFFFFFFFF;
+
+    ecs_grow((void**)&self->free_records, &self->free_capacity, self->free_count + 1, sizeof(u32));
+    self->free_records[self->free_count++] = BGL_ENTITY_INDEX(entity);
+    self->entity_count--;
+}
+
+bool ecs_entity_alive(World* self, Entity entity)
+{
+    return ecs_get_record(self, entity) != NULL;
+}
+
+void* ecs_get_component(World* self, Entity entity, u32 component)
+{
+    EntityRecord* record = ecs_get_record(self, entity);
+    if(record == NULL) return NULL;
+
+    Archetype* archetype = &self->archetypes[record->archetype];
+    if(!(archetype->mask & BGL_COMPONENT_BIT(component))) return NULL;
+
+    return archetype->chunks[record->chunk].data + archetype->column_offsets[component]
+         + record->row * self->components[component].size;
+}
+
+void* ecs_get_component_mut(World* self, Entity entity, u32 component)
+{
+    void* data = ecs_get_component(self, entity, component);
+    if(data != NULL) ecs_stamp(self, &self->records[BGL_ENTITY_INDEX(entity)], component, false);
+
+    return data;
+}
+
+void ecs_set_component(World* self, Entity entity, u32 component, const void* data)
+{
+    void* dest = ecs_get_component_mut(self, entity, component);
+    BGL_ASSERT(dest != NULL, "entity %u does not have component %s", entity, self->components[component].name);
+
+    memcpy(dest, data, self->components[component].size);
+}
+
+void ecs_add_component(World* self, Entity entity, u32 component, const void* data)
+{
+    EntityRecord* record = ecs_get_record(self, entity);
+    BGL_ASSERT(record != NULL, "adding component to dead entity %u", entity);
+
+    ComponentMask mask = self->archetypes[record->archetype].mask;
+    if(!(mask & BGL_COMPONENT_BIT(component)))
+    {
+        ecs_move_entity(self, entity, mask | BGL_COMPONENT_BIT(component));
+    }
+
+    if(data != NULL) ecs_set_component(self, entity, component, data);
+}
+
+void ecs_remove_component(World* self, Entity entity, u32 component)
+{
+    EntityRecord* record = ecs_get_record(self, entity);
+    BGL_ASSERT(record != NULL, "removing component from dead entity %u", entity);
+
+    ComponentMask mask = self->archetypes[record->archetype].mask;
+    if(mask & BGL_COMPONENT_BIT(component))
+    {
+        ecs_log_removed(self, entity, BGL_COMPONENT_BIT(component));
+        ecs_move_entity(self, entity, mask & ~BGL_COMPONENT_BIT(component));
+    }
+}
+
+void ecs_query(World* self, ComponentMask mask, SystemFunc func, void* user)
+{
+    ecs_query_chunks(self, mask, 0, func, user); // queries have no previous run so everything is new
+}
+
+u32 ecs_query_since(World* self, ComponentMask mask, u32 since_tick, SystemFunc func, void* user)
+{
+    BGL_ASSERT(!self->iterating, "ecs_query_since cannot be used while systems are running");
+
+    ecs_query_chunks(self, mask, since_tick, func, user);
+
+    /* same as after ecs_run_systems, anything changed from now on is newer than this query */
+    return self->tick++;
+}
+
+u32 ecs_add_system(World* self, const char* name, SystemFunc func, ComponentMask read, ComponentMask write, void* user)
+{
+    BGL_ASSERT(self->system_count < BGL_ECS_MAX_SYSTEMS, "too many systems, max is %u", BGL_ECS_MAX_SYSTEMS);
+
+    System* system = &self->systems[self->system_count];
+    strncpy(system->name, name, BGL_ECS_MAX_NAME - 1);
+    system->name[BGL_ECS_MAX_NAME - 1] = '\0';
+    system->func = func;
+    system->read = read;
+    system->write = write;
+    system->user = user;
+    system->changed_filter = 0;
+    system->last_run_tick = 0;
+    system->last_time = 0.0;
+
+    /* go after the latest stage of any earlier system we conflict with */
+    system->stage = 0;
+    for(u32 i = 0; i < self->system_count; i++)
+    {
+        const System* other = &self->systems[i];
+        bool conflict = (write & (other->read | other->write)) || (read & other->write);
+        if(conflict && other->stage + 1 > system->stage) system->stage = other->stage + 1;
+    }
+    if(system->stage + 1 > self->stage_count) self->stage_count = system->stage + 1;
+
+    BGL_LOG_INFO("added system %s to stage %u", system->name, system->stage);
+    return self->system_count++;
+}
+
+void ecs_system_set_filter(World* self, u32 system, ComponentMask changed)
+{
+    BGL_ASSERT(system < self->system_count, "invalid system index %u", system);
+    self->systems[system].changed_filter = changed;
+}
+
+const Entity* ecs_removed(World* self, u32 component, u32* count_out)
+{
+    *count_out = self->removed_count[component];
+    return self->removed[component];
+}
+
+void ecs_run_systems(World* self, f32 delta_time)
+{
+    self->iterating = true;
+
+    for(u32 stage = 0; stage < self->stage_count; stage++)
+    {
+        f64 start_time = platform_get_time();
+        self->tick++; // each stage stamps its own tick so later stages see its changes
+
+        /* flatten every (system, chunk) pair of the stage so systems run alongside each other */
+        u32 item_count = 0;
+        for(u32 i = 0; i < self->system_count; i++)
+        {
+            System* system = &self->systems[i];
+            if(system->stage != stage) continue;
+
+            ComponentMask mask = system->read | system->write;
+            for(u32 j = 0; j < self->archetype_count; j++)
+            {
+                Archetype* archetype = &self->archetypes[j];
+                if((archetype->mask & mask) != mask) continue;
+
+                ecs_grow((void**)&self->work_items, &self->work_capacity,
+                         item_count + archetype->chunk_count, sizeof(ECSWorkItem));
+                for(u32 k = 0; k < archetype->chunk_count; k++)
+                {
+                    if(system->changed_filter && !ecs_chunk_changed(archetype, &archetype->chunks[k], system->changed_filter, system->last_run_tick))
+                    {
+                        continue;
+                    }
+                    self->work_items[item_count++] = (ECSWorkItem){system, j, k};
+                }
+            }
+        }
+
+        ECSStageJob job = {
+            .world = self,
+            .items = self->work_items,
+            .delta_time = delta_time,
+            .tick = self->tick,
+        };
+        jobs_parallel_for(item_count, 1, ecs_stage_job, &job);
+
+        f64 stage_time = (platform_get_time() - start_time) * 1000.0;
+        for(u32 i = 0; i < self->system_count; i++)
+        {
+            if(self->systems[i].stage != stage) continue;
+            self->systems[i].last_time = stage_time;
+            self->systems[i].last_run_tick = self->tick;
+        }
+    }
+
+    memset(self->removed_count, 0, sizeof(self->removed_count));
+    self->tick++; // changes made outside of systems are newer than every system's last run
+    self->iterating = false;
+}
+
+void ecs_stage_job(void* data, u32 start, u32 end, u32 worker)
+{
+    ECSStageJob* job = (ECSStageJob*)data;
+
+    for(u32 i = start; i < end; i++)
+    {
+        ECSWorkItem* item = &job->items[i];
+        Archetype* archetype = &job->world->archetypes[item->archetype];
+
+        ECSIter iter = {
+            .world = job->world,
+            .archetype = archetype,
+            .chunk = &archetype->chunks[item->chunk],
+            .count = archetype->chunks[item->chunk].count,
+            .delta_time = job->delta_time,
+            .worker = worker,
+            .user = item->system->user,
+            .tick = job->tick,
+            .last_run_tick = item->system->last_run_tick,
+        };
+        item->system->func(&iter);
+    }
+}
+
+/* records and work items can get very large so grow geometrically instead of using BLOCK_RESIZE_ARRAY */
+void ecs_grow(void** ptr, u32* capacity, u32 needed, u32 element_size)
+{
+    if(needed <= *capacity) return;
+
+    u32 new_capacity = *capacity == 0 ? ECS_INITIAL_CAPACITY : *capacity;
+    while(new_capacity < needed) new_capacity *= 2;
+
+    *ptr = BGL_REALLOC(*ptr, (u64)new_capacity * element_size);
+    BGL_ASSERT(*ptr != NULL, "ecs array reallocation to %u elements failed", new_capacity);
+    *capacity = new_capacity;
+}
+
+EntityRecord* ecs_get_record(World* self, Entity entity)
+{
+    if(entity == BGL_ENTITY_NULL) return NULL;
+
+    u32 index = BGL_ENTITY_INDEX(entity);
+    if(index >= self->record_count) return NULL;
+
+    EntityRecord* record = &self->records[index];
+    if(record->generation != BGL_ENTITY_GENERATION(entity) || record->archetype == 0xFFFFFFFF) return NULL;
+
+    return record;
+}
+
+u32 ecs_find_archetype(World* self, ComponentMask mask)
+{
+    for(u32 i = 0; i < self->archetype_count; i++)
+    {
+        if(self->archetypes[i].mask == mask) return i;
+    }
+
+    BLOCK_RESIZE_ARRAY(&self->archetypes, Archetype, self->archetype_count, 1);
+    Archetype* archetype = &self->archetypes[self->archetype_count];
+    memset(archetype, 0, sizeof(Archetype));
+    archetype->mask = mask;
+
+    /* worst case padding is MAX_ALIGN per column, so size capacity off that then lay out the columns */
+    u32 entity_size = sizeof(Entity);
+    u32 padding = BGL_ECS_MAX_ALIGN;
+    for(u32 i = 0; i < self->component_count; i++)
+    {
+        if(!(mask & BGL_COMPONENT_BIT(i))) continue;
+        entity_size += self->components[i].size;
+        padding += BGL_ECS_MAX_ALIGN;
+    }
+    archetype->capacity = (BGL_ECS_CHUNK_SIZE - padding) / entity_size;
+    BGL_ASSERT(archetype->capacity > 0, "archetype is too large to fit in a chunk");
+
+    u32 offset = archetype->capacity * (u32)sizeof(Entity);
+    for(u32 i = 0; i < self->component_count; i++)
+    {
+        if(!(mask & BGL_COMPONENT_BIT(i))) continue;
+        offset = ALIGNED_SIZE(offset, self->components[i].align);
+        archetype->column_offsets[i] = offset;
+        offset += archetype->capacity * self->components[i].size;
+
+        archetype->tick_offsets[i] = archetype->column_count * (1 + 2 * archetype->capacity);
+        archetype->column_count++;
+    }
+    BGL_ASSERT(offset <= BGL_ECS_CHUNK_SIZE, "archetype columns overflowed chunk");
+
+    return self->archetype_count++;
+}
+
+u32 ecs_alloc_record(World* self)
+{
+    if(self->free_count > 0) return self->free_records[--self->free_count];
+
+    BGL_ASSERT(self->record_count < BGL_ENTITY_INDEX_MASK, "reached max entity count");
+    ecs_grow((void**)&self->records, &self->record_capacity, self->record_count + 1, sizeof(EntityRecord));
+    self->records[self->record_count].generation = 0;
+
+    return self->record_count++;
+}
+
+u32 ecs_alloc_row(World* self, u32 archetype_idx, u32* chunk_out)
+{
+    u32 row;
+    ecs_alloc_rows(self, archetype_idx, 1, NULL, chunk_out, &row);
+
+    return row;
+}
+
+/**
+ * @brief  allocate up to wanted rows in the archetype's last chunk, filling each component column with components[id] or zeroes
+ * @returns rows allocated, starting at row_out
+ */
+u32 ecs_alloc_rows(World* self, u32 archetype_idx, u32 wanted, const void* const* components, u32* chunk_out, u32* row_out)
+{
+    Archetype* archetype = &self->archetypes[archetype_idx];
+
+    /* only the last chunk can have free rows, removal keeps the others full */
+    if(archetype->chunk_count == 0 || archetype->chunks[archetype->chunk_count - 1].count == archetype->capacity)
+    {
+        BLOCK_RESIZE_ARRAY(&archetype->chunks, Chunk, archetype->chunk_count, 1);
+        Chunk* chunk = &archetype->chunks[archetype->chunk_count++];
+        chunk->data = (u8*)BGL_MALLOC(BGL_ECS_CHUNK_SIZE);
+        chunk->ticks = (u32*)BGL_CALLOC(archetype->column_count * (1 + 2 * archetype->capacity), sizeof(u32));
+        BGL_ASSERT(chunk->data != NULL && chunk->ticks != NULL, "chunk allocation failed");
+        chunk->count = 0;
+        chunk->structure_tick = self->tick;
+    }
+
+    *chunk_out = archetype->chunk_count - 1;
+    Chunk* chunk = &archetype->chunks[*chunk_out];
+    u32 row = chunk->count;
+    u32 rows = MIN(wanted, archetype->capacity - row);
+    chunk->count += rows;
+    chunk->structure_tick = self->tick;
+    *row_out = row;
+
+    for(u32 i = 0; i < self->component_count; i++)
+    {
+        if(!(archetype->mask & BGL_COMPONENT_BIT(i))) continue;
+        u32 size = self->components[i].size;
+        u8* column = chunk->data + archetype->column_offsets[i] + row * size;
+
+        if(components == NULL || components[i] == NULL)
+        {
+            memset(column, 0, rows * size);
+        }
+        else
+        {
+            /* copy the template once then keep doubling the filled region */
+            memcpy(column, components[i], size);
+            u32 filled = 1;
+            while(filled < rows)
+            {
+                u32 copy = MIN(filled, rows - filled);
+                memcpy(column + filled * size, column, copy * size);
+                filled += copy;
+            }
+        }
+
+        u32* ticks = chunk->ticks + archetype->tick_offsets[i];
+        ticks[0] = self->tick;
+        for(u32 j = row; j < row + rows; j++)
+        {
+            ticks[1 + j] = self->tick;
+            ticks[1 + archetype->capacity + j] = self->tick;
+        }
+    }
+
+    return rows;
+}
+
+/* swap the last entity of the archetype into the removed row to keep chunks packed */
+void ecs_remove_row(World* self, u32 archetype_idx, u32 chunk_idx, u32 row)
+{
+    Archetype* archetype = &self->archetypes[archetype_idx];
+    u32 last_chunk_idx = archetype->chunk_count - 1;
+    Chunk* last_chunk = &archetype->chunks[last_chunk_idx];
+    u32 last_row = last_chunk->count - 1;
+
+    if(chunk_idx != last_chunk_idx || row != last_row)
+    {
+        Chunk* chunk = &archetype->chunks[chunk_idx];
+        Entity moved = ((Entity*)last_chunk->data)[last_row];
+        ((Entity*)chunk->data)[row] = moved;
+
+        for(u32 i = 0; i < self->component_count; i++)
+        {
+            if(!(archetype->mask & BGL_COMPONENT_BIT(i))) continue;
+            u32 size = self->components[i].size;
+            u32 column = archetype->column_offsets[i];
+            memcpy(chunk->data + column + row * size, last_chunk->data + column + last_row * size, size);
+
+            u32* ticks = chunk->ticks + archetype->tick_offsets[i];
+            u32* last_ticks = last_chunk->ticks + archetype->tick_offsets[i];
+            ticks[1 + row] = last_ticks[1 + last_row];
+            ticks[1 + archetype->capacity + row] = last_ticks[1 + archetype->capacity + last_row];
+            if(ticks[1 + archetype->capacity + row] > ticks[0]) ticks[0] = ticks[1 + archetype->capacity + row];
+        }
+
+        chunk->structure_tick = self->tick;
+        EntityRecord* record = &self->records[BGL_ENTITY_INDEX(moved)];
+        record->chunk = chunk_idx;
+        record->row = row;
+    }
+
+    last_chunk->count--;
+    last_chunk->structure_tick = self->tick;
+    if(last_chunk->count == 0)
+    {
+        ecs_chunk_free(self, last_chunk);
+        archetype->chunk_count--;
+    }
+}
+
+void ecs_move_entity(World* self, Entity entity, ComponentMask new_mask)
+{
+    BGL_ASSERT(!self->iterating, "cannot add or remove components while systems are running");
+
+    EntityRecord* record = &self->records[BGL_ENTITY_INDEX(entity)];
+    u32 old_archetype_idx = record->archetype;
+    u32 old_chunk_idx = record->chunk;
+    u32 old_row = record->row;
+
+    u32 new_archetype_idx = ecs_find_archetype(self, new_mask); // may realloc archetypes, so get ptrs after
+    u32 new_chunk_idx;
+    u32 new_row = ecs_alloc_row(self, new_archetype_idx, &new_chunk_idx);
+
+    Archetype* old_archetype = &self->archetypes[old_archetype_idx];
+    Archetype* new_archetype = &self->archetypes[new_archetype_idx];
+    Chunk* old_chunk = &old_archetype->chunks[old_chunk_idx];
+    Chunk* new_chunk = &new_archetype->chunks[new_chunk_idx];
+
+    ((Entity*)new_chunk->data)[new_row] = entity;
+    ComponentMask shared = old_archetype->mask & new_mask;
+    for(u32 i = 0; i < self->component_count; i++)
+    {
+        if(!(shared & BGL_COMPONENT_BIT(i))) continue;
+        u32 size = self->components[i].size;
+        memcpy(new_chunk->data + new_archetype->column_offsets[i] + new_row * size,
+               old_chunk->data + old_archetype->column_offsets[i] + old_row * size, size);
+
+        /* moving doesn't count as a change, keep the old ticks */
+        u32* new_ticks = new_chunk->ticks + new_archetype->tick_offsets[i];
+        u32* old_ticks = old_chunk->ticks + old_archetype->tick_offsets[i];
+        new_ticks[1 + new_row] = old_ticks[1 + old_row];
+        new_ticks[1 + new_archetype->capacity + new_row] = old_ticks[1 + old_archetype->capacity + old_row];
+    }
+
+    ecs_remove_row(self, old_archetype_idx, old_chunk_idx, old_row);
+
+    record->archetype = new_archetype_idx;
+    record->chunk = new_chunk_idx;
+    record->row = new_row;
+}
+
+void ecs_stamp(World* self, EntityRecord* record, u32 component, bool added)
+{
+    Archetype* archetype = &self->archetypes[record->archetype];
+    u32* ticks = archetype->chunks[record->chunk].ticks + archetype->tick_offsets[component];
+
+    ticks[0] = self->tick;
+    ticks[1 + archetype->capacity + record->row] = self->tick;
+    if(added) ticks[1 + record->row] = self->tick;
+}
+
+void ecs_log_removed(World* self, Entity entity, ComponentMask mask)
+{
+    for(u32 i = 0; i < self->component_count; i++)
+    {
+        if(!(mask & BGL_COMPONENT_BIT(i))) continue;
+
+        ecs_grow((void**)&self->removed[i], &self->removed_capacity[i], self->removed_count[i] + 1, sizeof(Entity));
+        self->removed[i][self->removed_count[i]++] = entity;
+    }
+}
+
+bool ecs_chunk_changed(Archetype* archetype, Chunk* chunk, ComponentMask filter, u32 last_run_tick)
+{
+    for(u32 i = 0; i < BGL_ECS_MAX_COMPONENTS; i++)
+    {
+        if(!(filter & BGL_COMPONENT_BIT(i)) || !(archetype->mask & BGL_COMPONENT_BIT(i))) continue;
+        if(chunk->ticks[archetype->tick_offsets[i]] > last_run_tick) return true;
+    }
+
+    return false;
+}
+
+void ecs_chunk_free(World* self, Chunk* chunk)
+{
+    /* chunks loaded from a snapshot live in the mapped file, see snapshot_load */
+    if(self->mapped != NULL && chunk->data >= self->mapped && chunk->data < self->mapped + self->mapped_size) return;
+
+    BGL_FREE(chunk->data);
+    BGL_FREE(chunk->ticks);
+}
+
+void ecs_query_chunks(World* self, ComponentMask mask, u32 last_run_tick, SystemFunc func, void* user)
+{
+    ECSIter iter = {
+        .world = self,
+        .delta_time = 0.0f,
+        .worker = 0,
+        .user = user,
+        .tick = self->tick,
+        .last_run_tick = last_run_tick,
+    };
+
+    for(u32 i = 0; i < self->archetype_count; i++)
+    {
+        Archetype* archetype = &self->archetypes[i];
+        if((archetype->mask & mask) != mask) continue;
+
+        iter.archetype = archetype;
+        for(u32 j = 0; j < archetype->chunk_count; j++)
+        {
+            iter.chunk = &archetype->chunks[j];
+            iter.count = iter.chunk->count;
+            func(&iter);
+        }
+    }
+}
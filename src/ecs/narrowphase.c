@@ -0,0 +1,1503 @@
+#include "ecs/narrowphase.h"
+
+#include <float.h>
+#include <string.h>
+
+#define NARROWPHASE_EPSILON 1e-6f
+#define SAT_RELATIVE_TOLERANCE 0.98f // prefer a face of a, then of b, then an edge pair unless they separate clearly more
+#define SAT_ABSOLUTE_TOLERANCE 0.001f
+#define CLIP_MAX_POINTS 8
+#define CLIP_TOLERANCE 0.005f // incident points this far outside a side still count as in, so equal faces keep their corners
+#define SPECULATIVE_DISTANCE 0.02f // clipped points this far above the reference face are kept, so tilting doesn't drop corners
+#define CAPSULE_FLAT_TOLERANCE 0.1f // sine of the angle between a capsule and a surface below which it lies on two points
+#define CAPSULE_PARALLEL_TOLERANCE 0.005f // how far from 1 the cosine between the normal and a box face, or two capsules, can be
+#define GJK_MAX_ITERATIONS 32
+#define EPA_MAX_ITERATIONS 64
+#define EPA_MAX_VERTICES 96
+#define EPA_MAX_FACES 192
+#define EPA_MAX_EDGES 96
+#define EPA_TOLERANCE 1e-3f
+#define CORE_TOLERANCE 1e-4f // distance a support point has to get closer than the current one by to keep going
+#define CORE_MIN_DISTANCE 1e-4f // cores closer than this overlap as far as the normal is concerned, epa takes them
+#define MESH_MAX_TRIANGLES 64 // triangles tested per pair, the rest are dropped
+#define MESH_NORMAL_TOLERANCE 0.95f // cosine to the deepest triangle's normal above which another triangle's points are kept
+#define MESH_EDGE_ID 0xF // feature of a triangle's single gjk/epa point, corners and capsule ends are below it
+#define CAST_MAX_ITERATIONS 32
+#define CAST_TOLERANCE 1e-4f // distance from the ray's point to the minkowski difference that counts as touching
+
+/* point of the minkowski difference a - b, with the point on a it came from for the contact position */
+typedef struct SupportPoint
+{
+    vec3 p;
+    vec3 a;
+} SupportPoint;
+
+typedef struct EPAFace
+{
+    u32 v[3];
+    vec3 normal;
+    f32 dist;
+} EPAFace;
+
+/* contact against one triangle of a mesh */
+typedef struct MeshContact
+{
+    vec3 normal; // from the shape to the triangle
+    f32 depth; // deepest point
+    u32 point_count;
+    ContactPoint points[8];
+} MeshContact;
+
+/**
+ * internal functions
+ */
+u32 narrowphase_sphere_sphere(const CollisionShape* shapes, const PhysicsPair* pairs, u32 count, ContactManifold* manifolds_out);
+u32 narrowphase_sphere_box(const CollisionShape* shapes, const PhysicsPair* pairs, u32 count, ContactManifold* manifolds_out);
+bool narrowphase_box_box(const CollisionShape* a, const CollisionShape* b, ContactManifold* manifold);
+bool narrowphase_box_box_face(const CollisionShape* ref, const CollisionShape* inc, u32 ref_axis, bool flip, ContactManifold* manifold);
+bool narrowphase_convex(const CollisionShape* a, const CollisionShape* b, ContactManifold* manifold);
+bool narrowphase_core_closest(const CollisionShape* a, const CollisionShape* b, vec3* on_a_out, vec3* on_b_out);
+bool narrowphase_mesh(const CollisionShape* a, const CollisionShape* b, ContactManifold* manifold);
+bool narrowphase_mesh_triangle(const CollisionShape* a, const CollisionShape* triangle_shape, u32 triangle, MeshContact* contact_out);
+bool narrowphase_mesh_face(const CollisionShape* a, const vec3 corners[3], vec3 face_normal, u32 triangle, MeshContact* contact);
+bool narrowphase_triangle_contains(const vec3 corners[3], vec3 face_normal, vec3 point);
+vec3 narrowphase_triangle_closest(const vec3 corners[3], vec3 point, f32 weights_out[3]);
+vec3 narrowphase_cast_closest(const vec3* points, u32* count, u32 keep_out[4], f32 weights_out[4]);
+void narrowphase_capsule_segment(const CollisionShape* capsule, const CollisionShape* other, vec3 dir, ContactManifold* manifold);
+bool narrowphase_clip_segment(f32 offset, f32 slope, f32 limit, f32* t_min, f32* t_max);
+vec3 narrowphase_support(const CollisionShape* shape, vec3 dir);
+SupportPoint narrowphase_minkowski_support(const CollisionShape* a, const CollisionShape* b, vec3 dir);
+bool narrowphase_gjk(const CollisionShape* a, const CollisionShape* b, SupportPoint simplex_out[4]);
+bool narrowphase_gjk_simplex3(SupportPoint* s, u32* count, vec3* dir);
+bool narrowphase_gjk_simplex4(SupportPoint* s, u32* count, vec3* dir);
+bool narrowphase_epa(const CollisionShape* a, const CollisionShape* b, const SupportPoint simplex[4], ContactManifold* manifold);
+void narrowphase_epa_face(EPAFace* face, const SupportPoint* verts, u32 v0, u32 v1, u32 v2, vec3 interior);
+bool narrowphase_epa_barycentric(const EPAFace* face, const SupportPoint* verts, vec3 point, f32 weights_out[3]);
+u32 narrowphase_reduce_points(ContactPoint* points, u32 count, vec3 normal);
+
+static inline vec3 vec3_normalised(vec3 v)
+{
+    f32 len = sqrtf(v.x * v.x + v.y * v.y + v.z * v.z);
+    return len > NARROWPHASE_EPSILON ? vec3_scale(v, 1.0f / len) : VEC3(0.0f, 0.0f, 0.0f);
+}
+
+NarrowphaseKind narrowphase_pair_kind(ColliderType a, ColliderType b, bool* swap_out)
+{
+    /* aabbs are boxes in world space by now */
+    bool box_a = a == BGL_COLLIDER_AABB || a == BGL_COLLIDER_OBB;
+    bool box_b = b == BGL_COLLIDER_AABB || b == BGL_COLLIDER_OBB;
+
+    *swap_out = false;
+    if(a == BGL_COLLIDER_MESH || b == BGL_COLLIDER_MESH)
+    {
+        *swap_out = a == BGL_COLLIDER_MESH;
+        return BGL_NARROWPHASE_MESH;
+    }
+    if(a == BGL_COLLIDER_CAPSULE || b == BGL_COLLIDER_CAPSULE) return BGL_NARROWPHASE_CONVEX;
+    if(box_a && box_b) return BGL_NARROWPHASE_BOX_BOX;
+    if(!box_a && !box_b) return BGL_NARROWPHASE_SPHERE_SPHERE;
+
+    *swap_out = box_a;
+    return BGL_NARROWPHASE_SPHERE_BOX;
+}
+
+u32 narrowphase_collide(NarrowphaseKind kind, const CollisionShape* shapes, const PhysicsPair* pairs, u32 count, ContactManifold* manifolds_out)
+{
+    switch(kind)
+    {
+        case BGL_NARROWPHASE_SPHERE_SPHERE: return narrowphase_sphere_sphere(shapes, pairs, count, manifolds_out);
+        case BGL_NARROWPHASE_SPHERE_BOX: return narrowphase_sphere_box(shapes, pairs, count, manifolds_out);
+        default: break;
+    }
+
+    u32 written = 0;
+    for(u32 i = 0; i < count; i++)
+    {
+        const PhysicsPair* pair = &pairs[i];
+        ContactManifold* manifold = &manifolds_out[written];
+        const CollisionShape* a = &shapes[pair->proxy_a];
+        const CollisionShape* b = &shapes[pair->proxy_b];
+        bool touching = kind == BGL_NARROWPHASE_BOX_BOX ? narrowphase_box_box(a, b, manifold) :
+                        kind == BGL_NARROWPHASE_MESH ? narrowphase_mesh(a, b, manifold) :
+                                                       narrowphase_convex(a, b, manifold);
+        if(!touching) continue;
+
+        manifold->a = pair->a;
+        manifold->b = pair->b;
+        manifold->proxy_a = pair->proxy_a;
+        manifold->proxy_b = pair->proxy_b;
+        written++;
+    }
+    return written;
+}
+
+void collider_compute_shape(const Collider* collider, const mat4* model, CollisionShape* shape_out)
+{
+    f32 scale[3];
+    vec3 cols[3];
+    for(u32 i = 0; i < 3; i++)
+    {
+        cols[i] = VEC4TOVEC3(model->cols[i]);
+        scale[i] = sqrtf(vec3_dot(cols[i], cols[i]));
+    }
+    const f32 max_scale = MAX(scale[0], MAX(scale[1], scale[2]));
+
+    /* same placement as collider_compute_bounds */
+    shape_out->centre = VEC4TOVEC3(model->cols[3]);
+    for(u32 i = 0; i < 3; i++)
+    {
+        shape_out->centre = vec3_add(shape_out->centre, vec3_scale(cols[i], collider->offset.data[i]));
+        shape_out->half_extents.data[i] = collider->half_extents.data[i] * scale[i];
+
+        if(collider->type == BGL_COLLIDER_AABB || scale[i] == 0.0f)
+        {
+            shape_out->axes[i] = VEC3(i == 0 ? 1.0f : 0.0f, i == 1 ? 1.0f : 0.0f, i == 2 ? 1.0f : 0.0f);
+        }
+        else
+        {
+            shape_out->axes[i] = vec3_scale(cols[i], 1.0f / scale[i]);
+        }
+    }
+
+    shape_out->type = collider->type == BGL_COLLIDER_AABB ? BGL_COLLIDER_OBB : collider->type;
+    shape_out->radius = collider->radius * max_scale;
+    shape_out->half_height = collider->half_height * scale[1];
+    shape_out->mesh = NULL;
+
+    /* the triangles are placed by the model itself, offset and half_extents are only their bounds */
+    if(collider->type == BGL_COLLIDER_MESH)
+    {
+        shape_out->centre = VEC4TOVEC3(model->cols[3]);
+        shape_out->half_extents = VEC3(scale[0], scale[1], scale[2]);
+    }
+}
+
+bool narrowphase_mesh_local_bounds(const CollisionShape* mesh, vec3 min, vec3 max, vec3* local_min_out, vec3* local_max_out)
+{
+    const vec3 offset = vec3_sub(vec3_scale(vec3_add(min, max), 0.5f), mesh->centre);
+    const vec3 extent = vec3_scale(vec3_sub(max, min), 0.5f);
+    for(u32 i = 0; i < 3; i++)
+    {
+        const f32 scale = mesh->half_extents.data[i];
+        if(scale <= NARROWPHASE_EPSILON) return false;
+
+        const vec3 axis = mesh->axes[i];
+        const f32 centre = vec3_dot(offset, axis) / scale;
+        const f32 half = (fabsf(axis.x) * extent.x + fabsf(axis.y) * extent.y + fabsf(axis.z) * extent.z) / scale;
+        local_min_out->data[i] = centre - half;
+        local_max_out->data[i] = centre + half;
+    }
+    return true;
+}
+
+void narrowphase_mesh_triangle_shape(const CollisionShape* mesh, u32 triangle, CollisionShape* triangle_out)
+{
+    vec3 local[3];
+    triangle_mesh_get_triangle(mesh->mesh, triangle, local);
+
+    /* a mirroring scale flips the winding, swapping two corners flips it back */
+    const bool mirrored = vec3_dot(vec_cross(mesh->axes[0], mesh->axes[1]), mesh->axes[2]) < 0.0f;
+    *triangle_out = (CollisionShape){ .type = BGL_COLLIDER_MESH };
+    for(u32 i = 0; i < 3; i++)
+    {
+        vec3 corner = mesh->centre;
+        for(u32 k = 0; k < 3; k++) corner = vec3_add(corner, vec3_scale(mesh->axes[k], local[i].data[k] * mesh->half_extents.data[k]));
+        triangle_out->axes[mirrored && i > 0 ? 3 - i : i] = corner;
+        triangle_out->centre = vec3_add(triangle_out->centre, vec3_scale(corner, 1.0f / 3.0f));
+    }
+}
+
+/* gather a batch into arrays, test all of it without branching, then write the touching pairs */
+u32 narrowphase_sphere_sphere(const CollisionShape* shapes, const PhysicsPair* pairs, u32 count, ContactManifold* manifolds_out)
+{
+    f32 dx[BGL_NARROWPHASE_BATCH], dy[BGL_NARROWPHASE_BATCH], dz[BGL_NARROWPHASE_BATCH];
+    f32 radius[BGL_NARROWPHASE_BATCH], dist_sq[BGL_NARROWPHASE_BATCH];
+    u32 written = 0;
+
+    for(u32 base = 0; base < count; base += BGL_NARROWPHASE_BATCH)
+    {
+        const u32 n = MIN(BGL_NARROWPHASE_BATCH, count - base);
+        for(u32 i = 0; i < n; i++)
+        {
+            const CollisionShape* a = &shapes[pairs[base + i].proxy_a];
+            const CollisionShape* b = &shapes[pairs[base + i].proxy_b];
+            dx[i] = b->centre.x - a->centre.x;
+            dy[i] = b->centre.y - a->centre.y;
+            dz[i] = b->centre.z - a->centre.z;
+            radius[i] = a->radius + b->radius;
+        }
+
+        for(u32 i = 0; i < n; i++)
+        {
+            dist_sq[i] = dx[i] * dx[i] + dy[i] * dy[i] + dz[i] * dz[i] - radius[i] * radius[i];
+        }
+
+        for(u32 i = 0; i < n; i++)
+        {
+            if(dist_sq[i] > 0.0f) continue;
+
+            const PhysicsPair* pair = &pairs[base + i];
+            const CollisionShape* a = &shapes[pair->proxy_a];
+            f32 dist = sqrtf(dx[i] * dx[i] + dy[i] * dy[i] + dz[i] * dz[i]);
+            vec3 normal = dist > NARROWPHASE_EPSILON ? VEC3(dx[i] / dist, dy[i] / dist, dz[i] / dist) : VEC3(0.0f, 1.0f, 0.0f);
+            f32 depth = radius[i] - dist;
+
+            ContactManifold* manifold = &manifolds_out[written++];
+            manifold->a = pair->a;
+            manifold->b = pair->b;
+            manifold->proxy_a = pair->proxy_a;
+            manifold->proxy_b = pair->proxy_b;
+            manifold->normal = normal;
+            manifold->point_count = 1;
+            manifold->points[0] = (ContactPoint){
+                .pos = vec3_add(a->centre, vec3_scale(normal, a->radius - depth * 0.5f)),
+                .depth = depth,
+                .id = 0,
+            };
+        }
+    }
+    return written;
+}
+
+/* a is the sphere. the sphere centre is moved into the box's space and clamped to the box */
+u32 narrowphase_sphere_box(const CollisionShape* shapes, const PhysicsPair* pairs, u32 count, ContactManifold* manifolds_out)
+{
+    f32 px[BGL_NARROWPHASE_BATCH], py[BGL_NARROWPHASE_BATCH], pz[BGL_NARROWPHASE_BATCH];
+    f32 axes[9][BGL_NARROWPHASE_BATCH];
+    f32 hx[BGL_NARROWPHASE_BATCH], hy[BGL_NARROWPHASE_BATCH], hz[BGL_NARROWPHASE_BATCH];
+    f32 radius[BGL_NARROWPHASE_BATCH];
+    f32 lx[BGL_NARROWPHASE_BATCH], ly[BGL_NARROWPHASE_BATCH], lz[BGL_NARROWPHASE_BATCH];
+    f32 cx[BGL_NARROWPHASE_BATCH], cy[BGL_NARROWPHASE_BATCH], cz[BGL_NARROWPHASE_BATCH];
+    f32 dist_sq[BGL_NARROWPHASE_BATCH];
+    u32 written = 0;
+
+    for(u32 base = 0; base < count; base += BGL_NARROWPHASE_BATCH)
+    {
+        const u32 n = MIN(BGL_NARROWPHASE_BATCH, count - base);
+        for(u32 i = 0; i < n; i++)
+        {
+            const CollisionShape* a = &shapes[pairs[base + i].proxy_a];
+            const CollisionShape* b = &shapes[pairs[base + i].proxy_b];
+            px[i] = a->centre.x - b->centre.x;
+            py[i] = a->centre.y - b->centre.y;
+            pz[i] = a->centre.z - b->centre.z;
+            for(u32 j = 0; j < 9; j++) axes[j][i] = b->axes[j / 3].data[j % 3];
+            hx[i] = b->half_extents.x;
+            hy[i] = b->half_extents.y;
+            hz[i] = b->half_extents.z;
+            radius[i] = a->radius;
+        }
+
+        for(u32 i = 0; i < n; i++)
+        {
+            lx[i] = px[i] * axes[0][i] + py[i] * axes[1][i] + pz[i] * axes[2][i];
+            ly[i] = px[i] * axes[3][i] + py[i] * axes[4][i] + pz[i] * axes[5][i];
+            lz[i] = px[i] * axes[6][i] + py[i] * axes[7][i] + pz[i] * axes[8][i];
+            cx[i] = fminf(fmaxf(lx[i], -hx[i]), hx[i]);
+            cy[i] = fminf(fmaxf(ly[i], -hy[i]), hy[i]);
+            cz[i] = fminf(fmaxf(lz[i], -hz[i]), hz[i]);
+            f32 ex = lx[i] - cx[i], ey = ly[i] - cy[i], ez = lz[i] - cz[i];
+            dist_sq[i] = ex * ex + ey * ey + ez * ez;
+        }
+
+        for(u32 i = 0; i < n; i++)
+        {
+            if(dist_sq[i] > radius[i] * radius[i]) continue;
+
+            const PhysicsPair* pair = &pairs[base + i];
+            const CollisionShape* a = &shapes[pair->proxy_a];
+            const CollisionShape* b = &shapes[pair->proxy_b];
+
+            vec3 local_normal;
+            f32 depth;
+            if(dist_sq[i] > NARROWPHASE_EPSILON * NARROWPHASE_EPSILON)
+            {
+                /* towards the closest point on the box */
+                f32 dist = sqrtf(dist_sq[i]);
+                local_normal = VEC3((cx[i] - lx[i]) / dist, (cy[i] - ly[i]) / dist, (cz[i] - lz[i]) / dist);
+                depth = radius[i] - dist;
+            }
+            else
+            {
+                /* centre inside the box, push out through the closest face */
+                f32 pen[3] = { hx[i] - fabsf(lx[i]), hy[i] - fabsf(ly[i]), hz[i] - fabsf(lz[i]) };
+                f32 local[3] = { lx[i], ly[i], lz[i] };
+                u32 k = pen[0] < pen[1] ? (pen[0] < pen[2] ? 0 : 2) : (pen[1] < pen[2] ? 1 : 2);
+                local_normal = VEC3(0.0f, 0.0f, 0.0f);
+                local_normal.data[k] = local[k] >= 0.0f ? -1.0f : 1.0f;
+                depth = pen[k] + radius[i];
+            }
+
+            vec3 normal = vec3_add(vec3_add(vec3_scale(b->axes[0], local_normal.x), vec3_scale(b->axes[1], local_normal.y)),
+                                   vec3_scale(b->axes[2], local_normal.z));
+
+            ContactManifold* manifold = &manifolds_out[written++];
+            manifold->a = pair->a;
+            manifold->b = pair->b;
+            manifold->proxy_a = pair->proxy_a;
+            manifold->proxy_b = pair->proxy_b;
+            manifold->normal = normal;
+            manifold->point_count = 1;
+            manifold->points[0] = (ContactPoint){
+                .pos = vec3_add(a->centre, vec3_scale(normal, a->radius - depth * 0.5f)),
+                .depth = depth,
+                .id = 0,
+            };
+        }
+    }
+    return written;
+}
+
+/**
+ * separating axis test over the 3 face axes of each box and the 9 edge cross products. the axis of
+ * least penetration decides between a face contact, clipped to up to 4 points, or one point between
+ * two edges
+ */
+bool narrowphase_box_box(const CollisionShape* a, const CollisionShape* b, ContactManifold* manifold)
+{
+    const vec3 t = vec3_sub(b->centre, a->centre);
+    f32 r[3][3], abs_r[3][3], ta[3], tb[3];
+    for(u32 i = 0; i < 3; i++)
+    {
+        ta[i] = vec3_dot(t, a->axes[i]);
+        tb[i] = vec3_dot(t, b->axes[i]);
+        for(u32 j = 0; j < 3; j++)
+        {
+            r[i][j] = vec3_dot(a->axes[i], b->axes[j]);
+            abs_r[i][j] = fabsf(r[i][j]) + NARROWPHASE_EPSILON; // keeps near parallel edge axes from reporting false separation
+        }
+    }
+    const f32* ha = a->half_extents.data;
+    const f32* hb = b->half_extents.data;
+
+    f32 face_a_sep = -FLT_MAX, face_b_sep = -FLT_MAX;
+    u32 face_a = 0, face_b = 0;
+    for(u32 i = 0; i < 3; i++)
+    {
+        f32 sep = fabsf(ta[i]) - (ha[i] + hb[0] * abs_r[i][0] + hb[1] * abs_r[i][1] + hb[2] * abs_r[i][2]);
+        if(sep > 0.0f) return false;
+        if(sep > face_a_sep)
+        {
+            face_a_sep = sep;
+            face_a = i;
+        }
+    }
+    for(u32 j = 0; j < 3; j++)
+    {
+        f32 sep = fabsf(tb[j]) - (ha[0] * abs_r[0][j] + ha[1] * abs_r[1][j] + ha[2] * abs_r[2][j] + hb[j]);
+        if(sep > 0.0f) return false;
+        if(sep > face_b_sep)
+        {
+            face_b_sep = sep;
+            face_b = j;
+        }
+    }
+
+    f32 edge_sep = -FLT_MAX;
+    u32 edge_i = 0, edge_j = 0;
+    for(u32 i = 0; i < 3; i++)
+    {
+        const u32 i1 = (i + 1) % 3, i2 = (i + 2) % 3;
+        for(u32 j = 0; j < 3; j++)
+        {
+            const u32 j1 = (j + 1) % 3, j2 = (j + 2) % 3;
+            f32 len = sqrtf(r[i1][j] * r[i1][j] + r[i2][j] * r[i2][j]); // |a_i x b_j|, 1 - r[i][j]^2 loses too much precision
+            if(len < 1e-3f) continue; // parallel edges, covered by the face axes
+
+            f32 ra = ha[i1] * abs_r[i2][j] + ha[i2] * abs_r[i1][j];
+            f32 rb = hb[j1] * abs_r[i][j2] + hb[j2] * abs_r[i][j1];
+            f32 sep = (fabsf(ta[i2] * r[i1][j] - ta[i1] * r[i2][j]) - (ra + rb)) / len;
+            if(sep > 0.0f) return false;
+            if(sep > edge_sep)
+            {
+                edge_sep = sep;
+                edge_i = i;
+                edge_j = j;
+            }
+        }
+    }
+
+    f32 face_sep = face_a_sep;
+    bool use_b = face_b_sep > SAT_RELATIVE_TOLERANCE * face_a_sep + SAT_ABSOLUTE_TOLERANCE;
+    if(use_b) face_sep = face_b_sep;
+
+    if(edge_sep <= SAT_RELATIVE_TOLERANCE * face_sep + SAT_ABSOLUTE_TOLERANCE)
+    {
+        return use_b ? narrowphase_box_box_face(b, a, face_b, true, manifold) : narrowphase_box_box_face(a, b, face_a, false, manifold);
+    }
+
+    /* edge contact, closest points between the two supporting edges */
+    vec3 normal = vec3_normalised(vec_cross(a->axes[edge_i], b->axes[edge_j]));
+    if(vec3_dot(normal, t) < 0.0f) normal = vec3_scale(normal, -1.0f);
+
+    vec3 pa = a->centre, pb = b->centre;
+    for(u32 k = 0; k < 3; k++)
+    {
+        if(k != edge_i) pa = vec3_add(pa, vec3_scale(a->axes[k], vec3_dot(normal, a->axes[k]) >= 0.0f ? ha[k] : -ha[k]));
+        if(k != edge_j) pb = vec3_add(pb, vec3_scale(b->axes[k], vec3_dot(normal, b->axes[k]) >= 0.0f ? -hb[k] : hb[k]));
+    }
+
+    const vec3 da = a->axes[edge_i], db = b->axes[edge_j];
+    vec3 diff = vec3_sub(pa, pb);
+    f32 dot_ab = vec3_dot(da, db), c = vec3_dot(da, diff), f = vec3_dot(db, diff);
+    f32 denom = 1.0f - dot_ab * dot_ab;
+    f32 s = denom > NARROWPHASE_EPSILON ? (dot_ab * f - c) / denom : 0.0f;
+    s = fminf(fmaxf(s, -ha[edge_i]), ha[edge_i]);
+    f32 u = dot_ab * s + f;
+    if(fabsf(u) > hb[edge_j])
+    {
+        /* clamped on b's edge, move back along a's */
+        u = fminf(fmaxf(u, -hb[edge_j]), hb[edge_j]);
+        s = fminf(fmaxf(dot_ab * u - c, -ha[edge_i]), ha[edge_i]);
+    }
+
+    vec3 ca = vec3_add(pa, vec3_scale(da, s));
+    vec3 cb = vec3_add(pb, vec3_scale(db, u));
+
+    manifold->normal = normal;
+    manifold->point_count = 1;
+    manifold->points[0] = (ContactPoint){
+        .pos = vec3_scale(vec3_add(ca, cb), 0.5f),
+        .depth = -edge_sep,
+        .id = 0x600 | (edge_i << 4) | edge_j, // after the face ids
+    };
+    return true;
+}
+
+/**
+ * clip the incident box face most facing the reference face against the reference face's sides.
+ * flip is set when the reference box is b of the pair, the normal is always written from a to b
+ */
+bool narrowphase_box_box_face(const CollisionShape* ref, const CollisionShape* inc, u32 ref_axis, bool flip, ContactManifold* manifold)
+{
+    vec3 normal = ref->axes[ref_axis];
+    if(vec3_dot(normal, vec3_sub(inc->centre, ref->centre)) < 0.0f) normal = vec3_scale(normal, -1.0f);
+
+    /* incident face is the one most against the reference normal */
+    u32 inc_axis = 0;
+    f32 best = -1.0f;
+    for(u32 k = 0; k < 3; k++)
+    {
+        f32 d = fabsf(vec3_dot(normal, inc->axes[k]));
+        if(d > best)
+        {
+            best = d;
+            inc_axis = k;
+        }
+    }
+    f32 inc_sign = vec3_dot(normal, inc->axes[inc_axis]) > 0.0f ? -1.0f : 1.0f;
+
+    const u32 k1 = (inc_axis + 1) % 3, k2 = (inc_axis + 2) % 3;
+    vec3 face_centre = vec3_add(inc->centre, vec3_scale(inc->axes[inc_axis], inc_sign * inc->half_extents.data[inc_axis]));
+    vec3 u = vec3_scale(inc->axes[k1], inc->half_extents.data[k1]);
+    vec3 v = vec3_scale(inc->axes[k2], inc->half_extents.data[k2]);
+
+    vec3 poly[CLIP_MAX_POINTS], clipped[CLIP_MAX_POINTS];
+    u32 ids[CLIP_MAX_POINTS], clipped_ids[CLIP_MAX_POINTS];
+    poly[0] = vec3_add(face_centre, vec3_add(u, v));
+    poly[1] = vec3_add(face_centre, vec3_sub(v, u));
+    poly[2] = vec3_sub(face_centre, vec3_add(u, v));
+    poly[3] = vec3_add(face_centre, vec3_sub(u, v));
+    for(u32 i = 0; i < 4; i++) ids[i] = i;
+    u32 count = 4;
+
+    /* sutherland-hodgman against the 4 side planes of the reference face */
+    const u32 r1 = (ref_axis + 1) % 3, r2 = (ref_axis + 2) % 3;
+    for(u32 plane = 0; plane < 4 && count > 0; plane++)
+    {
+        const u32 axis = plane < 2 ? r1 : r2;
+        const vec3 plane_normal = vec3_scale(ref->axes[axis], plane % 2 == 0 ? 1.0f : -1.0f);
+        const f32 plane_offset = vec3_dot(plane_normal, ref->centre) + ref->half_extents.data[axis];
+
+        u32 out = 0;
+        for(u32 i = 0; i < count; i++)
+        {
+            const u32 next = (i + 1) % count;
+            f32 d0 = vec3_dot(plane_normal, poly[i]) - plane_offset - CLIP_TOLERANCE;
+            f32 d1 = vec3_dot(plane_normal, poly[next]) - plane_offset - CLIP_TOLERANCE;
+
+            if(d0 <= 0.0f && out < CLIP_MAX_POINTS)
+            {
+                clipped[out] = poly[i];
+                clipped_ids[out++] = ids[i];
+            }
+            if((d0 <= 0.0f) != (d1 <= 0.0f) && out < CLIP_MAX_POINTS)
+            {
+                f32 alpha = d0 / (d0 - d1);
+                clipped[out] = vec3_add(poly[i], vec3_scale(vec3_sub(poly[next], poly[i]), alpha));
+                clipped_ids[out++] = 4 + plane * 4 + ids[i] % 4; // clip plane and the edge it cut
+            }
+        }
+        memcpy(poly, clipped, out * sizeof(vec3));
+        memcpy(ids, clipped_ids, out * sizeof(u32));
+        count = out;
+    }
+
+    /* keep points below or just above the reference face, moved halfway to it */
+    const f32 ref_offset = vec3_dot(normal, ref->centre) + ref->half_extents.data[ref_axis];
+    ContactPoint points[CLIP_MAX_POINTS];
+    u32 point_count = 0;
+    for(u32 i = 0; i < count; i++)
+    {
+        f32 depth = ref_offset - vec3_dot(normal, poly[i]);
+        if(depth < -SPECULATIVE_DISTANCE) continue;
+
+        points[point_count++] = (ContactPoint){
+            .pos = vec3_add(poly[i], vec3_scale(normal, depth * 0.5f)),
+            .depth = depth,
+            .id = ((flip ? 3 + ref_axis : ref_axis) << 8) | ((inc_axis * 2 + (inc_sign > 0.0f)) << 5) | ids[i],
+        };
+    }
+    if(point_count == 0) return false;
+
+    point_count = narrowphase_reduce_points(points, point_count, normal);
+    manifold->normal = flip ? vec3_scale(normal, -1.0f) : normal;
+    manifold->point_count = point_count;
+    memcpy(manifold->points, points, point_count * sizeof(ContactPoint));
+    return true;
+}
+
+/* keep the deepest point, the one furthest from it, then the two spanning the most area either side */
+u32 narrowphase_reduce_points(ContactPoint* points, u32 count, vec3 normal)
+{
+    if(count <= BGL_MAX_CONTACT_POINTS) return count;
+
+    u32 chosen[BGL_MAX_CONTACT_POINTS] = { 0 };
+    for(u32 i = 1; i < count; i++)
+    {
+        if(points[i].depth > points[chosen[0]].depth) chosen[0] = i;
+    }
+
+    f32 best = -1.0f;
+    for(u32 i = 0; i < count; i++)
+    {
+        vec3 d = vec3_sub(points[i].pos, points[chosen[0]].pos);
+        f32 dist_sq = vec3_dot(d, d);
+        if(dist_sq > best)
+        {
+            best = dist_sq;
+            chosen[1] = i;
+        }
+    }
+
+    vec3 edge = vec3_sub(points[chosen[1]].pos, points[chosen[0]].pos);
+    f32 max_area = 0.0f, min_area = 0.0f;
+    chosen[2] = chosen[0];
+    chosen[3] = chosen[0];
+    for(u32 i = 0; i < count; i++)
+    {
+        f32 area = vec3_dot(vec_cross(edge, vec3_sub(points[i].pos, points[chosen[0]].pos)), normal);
+        if(area > max_area)
+        {
+            max_area = area;
+            chosen[2] = i;
+        }
+        if(area < min_area)
+        {
+            min_area = area;
+            chosen[3] = i;
+        }
+    }
+
+    ContactPoint reduced[BGL_MAX_CONTACT_POINTS];
+    u32 reduced_count = 0;
+    for(u32 i = 0; i < BGL_MAX_CONTACT_POINTS; i++)
+    {
+        bool duplicate = false;
+        for(u32 j = 0; j < i; j++) duplicate |= chosen[j] == chosen[i];
+        if(!duplicate) reduced[reduced_count++] = points[chosen[i]];
+    }
+    memcpy(points, reduced, reduced_count * sizeof(ContactPoint));
+    return reduced_count;
+}
+
+/**
+ * a capsule is a segment and a sphere a point grown by their radius. while those cores are apart the
+ * contact comes exactly from their closest points, epa on the rounded shapes only gets within its
+ * tolerance of the normal and puts the point off the surfaces. overlapping cores fall back to epa
+ */
+bool narrowphase_convex(const CollisionShape* a, const CollisionShape* b, ContactManifold* manifold)
+{
+    vec3 on_a, on_b;
+    if(narrowphase_core_closest(a, b, &on_a, &on_b))
+    {
+        const f32 radius_a = a->type == BGL_COLLIDER_OBB ? 0.0f : a->radius;
+        const f32 radius_b = b->type == BGL_COLLIDER_OBB ? 0.0f : b->radius;
+        const vec3 d = vec3_sub(on_b, on_a);
+        const f32 dist = sqrtf(vec3_dot(d, d));
+        const f32 depth = radius_a + radius_b - dist;
+        if(depth < 0.0f) return false;
+
+        manifold->normal = vec3_scale(d, 1.0f / dist);
+        manifold->point_count = 1;
+        manifold->points[0] = (ContactPoint){
+            .pos = vec3_add(on_a, vec3_scale(manifold->normal, radius_a - depth * 0.5f)),
+            .depth = depth,
+            .id = 0,
+        };
+    }
+    else
+    {
+        SupportPoint simplex[4];
+        if(!narrowphase_gjk(a, b, simplex)) return false;
+        if(!narrowphase_epa(a, b, simplex, manifold)) return false;
+    }
+
+    if(a->type == BGL_COLLIDER_CAPSULE) narrowphase_capsule_segment(a, b, manifold->normal, manifold);
+    else if(b->type == BGL_COLLIDER_CAPSULE) narrowphase_capsule_segment(b, a, vec3_scale(manifold->normal, -1.0f), manifold);
+    return true;
+}
+
+/**
+ * closest points of the cores of sphere, capsule or box a and b, false if the cores are closer than
+ * CORE_MIN_DISTANCE. gjk distance with the cast's simplex solver, the cores are polytopes so it ends
+ * on the exact points
+ */
+bool narrowphase_core_closest(const CollisionShape* a, const CollisionShape* b, vec3* on_a_out, vec3* on_b_out)
+{
+    CollisionShape core_a = *a, core_b = *b;
+    core_a.radius = core_b.radius = 0.0f;
+
+    vec3 simplex[4], on_a[4], on_b[4];
+    f32 weights[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+    u32 count = 0;
+    vec3 v = vec3_sub(a->centre, b->centre); // closest point of the cores' minkowski difference a - b so far
+
+    /* the centres are on the cores */
+    if(vec3_dot(v, v) < CORE_MIN_DISTANCE * CORE_MIN_DISTANCE) return false;
+
+    for(u32 iteration = 0; iteration < GJK_MAX_ITERATIONS; iteration++)
+    {
+        const vec3 point_a = narrowphase_support(&core_a, vec3_scale(v, -1.0f));
+        const vec3 point_b = narrowphase_support(&core_b, v);
+        const vec3 w = vec3_sub(point_a, point_b);
+        if(count > 0 && vec3_dot(v, v) - vec3_dot(v, w) <= CORE_TOLERANCE * sqrtf(vec3_dot(v, v))) break;
+
+        /* a point already in the simplex would only make it degenerate */
+        bool repeated = false;
+        for(u32 i = 0; i < count; i++)
+        {
+            const vec3 d = vec3_sub(simplex[i], w);
+            repeated |= vec3_dot(d, d) < NARROWPHASE_EPSILON * NARROWPHASE_EPSILON;
+        }
+        if(repeated) break;
+
+        simplex[count] = w;
+        on_a[count] = point_a;
+        on_b[count] = point_b;
+        count++;
+
+        u32 keep[4];
+        v = narrowphase_cast_closest(simplex, &count, keep, weights);
+        for(u32 i = 0; i < count; i++)
+        {
+            simplex[i] = simplex[keep[i]];
+            on_a[i] = on_a[keep[i]];
+            on_b[i] = on_b[keep[i]];
+        }
+        if(count == 4 || vec3_dot(v, v) < CORE_MIN_DISTANCE * CORE_MIN_DISTANCE) return false;
+    }
+
+    *on_a_out = *on_b_out = VEC3(0.0f, 0.0f, 0.0f);
+    for(u32 i = 0; i < count; i++)
+    {
+        *on_a_out = vec3_add(*on_a_out, vec3_scale(on_a[i], weights[i]));
+        *on_b_out = vec3_add(*on_b_out, vec3_scale(on_b[i], weights[i]));
+    }
+    return true;
+}
+
+/**
+ * a against the triangles of mesh b under a's bounds. triangles are one sided and only push a out of
+ * their front. the deepest triangle gives the normal and the points of triangles facing about the
+ * same way are merged with it, so a box lying across two triangles keeps the corners on both
+ */
+bool narrowphase_mesh(const CollisionShape* a, const CollisionShape* b, ContactManifold* manifold)
+{
+    if(a->type == BGL_COLLIDER_MESH || b->mesh == NULL) return false;
+
+    vec3 extent = VEC3(0.0f, 0.0f, 0.0f);
+    for(u32 k = 0; k < 3; k++)
+    {
+        if(a->type == BGL_COLLIDER_SPHERE) extent.data[k] = a->radius;
+        else if(a->type == BGL_COLLIDER_CAPSULE) extent.data[k] = fabsf(a->axes[1].data[k]) * a->half_height + a->radius;
+        else
+        {
+            for(u32 i = 0; i < 3; i++) extent.data[k] += fabsf(a->axes[i].data[k]) * a->half_extents.data[i];
+        }
+        extent.data[k] += SPECULATIVE_DISTANCE;
+    }
+
+    vec3 local_min, local_max;
+    if(!narrowphase_mesh_local_bounds(b, vec3_sub(a->centre, extent), vec3_add(a->centre, extent), &local_min, &local_max)) return false;
+
+    u32 triangles[MESH_MAX_TRIANGLES];
+    const u32 found = MIN(triangle_mesh_query_box(b->mesh, local_min, local_max, triangles, MESH_MAX_TRIANGLES), MESH_MAX_TRIANGLES);
+
+    MeshContact contacts[MESH_MAX_TRIANGLES];
+    u32 contact_count = 0, deepest = 0;
+    for(u32 i = 0; i < found; i++)
+    {
+        CollisionShape triangle;
+        narrowphase_mesh_triangle_shape(b, triangles[i], &triangle);
+        if(!narrowphase_mesh_triangle(a, &triangle, triangles[i], &contacts[contact_count])) continue;
+        if(contact_count == 0 || contacts[contact_count].depth > contacts[deepest].depth) deepest = contact_count;
+        contact_count++;
+    }
+    if(contact_count == 0) return false;
+
+    /* deepest triangle first so its points survive the cap. a corner inside two triangles keeps the deeper one */
+    const vec3 normal = contacts[deepest].normal;
+    ContactPoint points[MESH_MAX_TRIANGLES];
+    u32 point_count = 0;
+    for(u32 i = 0; i < contact_count; i++)
+    {
+        const MeshContact* contact = &contacts[(deepest + i) % contact_count];
+        if(vec3_dot(contact->normal, normal) < MESH_NORMAL_TOLERANCE) continue;
+
+        for(u32 j = 0; j < contact->point_count; j++)
+        {
+            const ContactPoint* point = &contact->points[j];
+            const u32 feature = point->id & MESH_EDGE_ID;
+            u32 existing = point_count;
+            for(u32 k = 0; k < point_count && feature != MESH_EDGE_ID; k++)
+            {
+                if((points[k].id & MESH_EDGE_ID) == feature) existing = k;
+            }
+
+            if(existing < point_count)
+            {
+                if(point->depth > points[existing].depth) points[existing] = *point;
+            }
+            else if(point_count < MESH_MAX_TRIANGLES) points[point_count++] = *point;
+        }
+    }
+
+    point_count = narrowphase_reduce_points(points, point_count, normal);
+    manifold->normal = normal;
+    manifold->point_count = point_count;
+    memcpy(manifold->points, points, point_count * sizeof(ContactPoint));
+    return true;
+}
+
+/**
+ * spheres use the closest point on the triangle. other shapes go through gjk and epa, and when the
+ * face separates about as well as epa's direction the corners or capsule ends under the face are
+ * used instead, so shapes rest flat and don't catch on the edges between triangles
+ */
+bool narrowphase_mesh_triangle(const CollisionShape* a, const CollisionShape* triangle_shape, u32 triangle, MeshContact* contact_out)
+{
+    const vec3* corners = triangle_shape->axes;
+    const vec3 cross = vec_cross(vec3_sub(corners[1], corners[0]), vec3_sub(corners[2], corners[0]));
+    const f32 len = sqrtf(vec3_dot(cross, cross));
+    if(len <= NARROWPHASE_EPSILON) return false;
+    const vec3 face_normal = vec3_scale(cross, 1.0f / len);
+
+    /* shapes whose centre is behind the triangle are left to the triangles they're in front of */
+    if(vec3_dot(face_normal, vec3_sub(a->centre, corners[0])) < 0.0f) return false;
+
+    if(a->type == BGL_COLLIDER_SPHERE)
+    {
+        f32 weights[3];
+        const vec3 d = vec3_sub(narrowphase_triangle_closest(corners, a->centre, weights), a->centre);
+        const f32 dist_sq = vec3_dot(d, d);
+        if(dist_sq > a->radius * a->radius) return false;
+
+        const f32 dist = sqrtf(dist_sq);
+        contact_out->normal = dist > NARROWPHASE_EPSILON ? vec3_scale(d, 1.0f / dist) : vec3_scale(face_normal, -1.0f);
+        contact_out->depth = a->radius - dist;
+        contact_out->point_count = 1;
+        contact_out->points[0] = (ContactPoint){
+            .pos = vec3_add(a->centre, vec3_scale(contact_out->normal, a->radius - contact_out->depth * 0.5f)),
+            .depth = contact_out->depth,
+            .id = triangle << 4,
+        };
+        return true;
+    }
+
+    /* the triangle's plane separates most of the triangles under a's bounds, skip gjk for those */
+    const vec3 lowest = narrowphase_support(a, vec3_scale(face_normal, -1.0f));
+    const f32 face_depth = vec3_dot(face_normal, vec3_sub(corners[0], lowest));
+    if(face_depth < 0.0f) return false;
+
+    SupportPoint simplex[4];
+    ContactManifold manifold;
+    if(!narrowphase_gjk(a, triangle_shape, simplex)) return false;
+    if(!narrowphase_epa(a, triangle_shape, simplex, &manifold)) return false;
+
+    const bool face = face_depth <= manifold.points[0].depth + CLIP_TOLERANCE || vec3_dot(manifold.normal, face_normal) > 0.0f;
+    if(face && narrowphase_mesh_face(a, corners, face_normal, triangle, contact_out)) return true;
+
+    /* an edge or corner of the triangle, or a face with none of a's corners over it */
+    contact_out->normal = face ? vec3_scale(face_normal, -1.0f) : manifold.normal;
+    contact_out->depth = face ? face_depth : manifold.points[0].depth;
+    contact_out->point_count = 1;
+    contact_out->points[0] = (ContactPoint){
+        .pos = manifold.points[0].pos,
+        .depth = contact_out->depth,
+        .id = triangle << 4 | MESH_EDGE_ID,
+    };
+    return true;
+}
+
+/* corners of a box or ends of a capsule that are under the face and over the triangle, false if none are touching */
+bool narrowphase_mesh_face(const CollisionShape* a, const vec3 corners[3], vec3 face_normal, u32 triangle, MeshContact* contact)
+{
+    vec3 candidates[8];
+    u32 candidate_count = 0;
+    if(a->type == BGL_COLLIDER_CAPSULE)
+    {
+        const vec3 down = vec3_scale(face_normal, -a->radius);
+        candidates[candidate_count++] = vec3_add(vec3_add(a->centre, vec3_scale(a->axes[1], -a->half_height)), down);
+        candidates[candidate_count++] = vec3_add(vec3_add(a->centre, vec3_scale(a->axes[1], a->half_height)), down);
+    }
+    else
+    {
+        for(u32 i = 0; i < 8; i++)
+        {
+            vec3 p = a->centre;
+            for(u32 k = 0; k < 3; k++) p = vec3_add(p, vec3_scale(a->axes[k], (i >> k) & 1 ? a->half_extents.data[k] : -a->half_extents.data[k]));
+            candidates[candidate_count++] = p;
+        }
+    }
+
+    const f32 plane = vec3_dot(face_normal, corners[0]);
+    f32 deepest = -FLT_MAX;
+    contact->point_count = 0;
+    for(u32 i = 0; i < candidate_count; i++)
+    {
+        const f32 depth = plane - vec3_dot(face_normal, candidates[i]);
+        if(depth < -SPECULATIVE_DISTANCE || !narrowphase_triangle_contains(corners, face_normal, candidates[i])) continue;
+
+        contact->points[contact->point_count++] = (ContactPoint){
+            .pos = vec3_add(candidates[i], vec3_scale(face_normal, depth * 0.5f)),
+            .depth = depth,
+            .id = triangle << 4 | i,
+        };
+        deepest = MAX(deepest, depth);
+    }
+    if(deepest < 0.0f) return false;
+
+    contact->normal = vec3_scale(face_normal, -1.0f);
+    contact->depth = deepest;
+    return true;
+}
+
+/* true if point projects inside the triangle, or within CLIP_TOLERANCE of it */
+bool narrowphase_triangle_contains(const vec3 corners[3], vec3 face_normal, vec3 point)
+{
+    for(u32 i = 0; i < 3; i++)
+    {
+        const vec3 edge = vec3_sub(corners[(i + 1) % 3], corners[i]);
+        const f32 side = vec3_dot(vec_cross(edge, vec3_sub(point, corners[i])), face_normal);
+        if(side < -CLIP_TOLERANCE * sqrtf(vec3_dot(edge, edge))) return false;
+    }
+    return true;
+}
+
+/* closest point on a triangle by the voronoi region point falls in, with its barycentric weights */
+vec3 narrowphase_triangle_closest(const vec3 corners[3], vec3 point, f32 weights_out[3])
+{
+    const vec3 ab = vec3_sub(corners[1], corners[0]), ac = vec3_sub(corners[2], corners[0]);
+    const vec3 ap = vec3_sub(point, corners[0]);
+    const f32 d1 = vec3_dot(ab, ap), d2 = vec3_dot(ac, ap);
+    f32 v, w;
+    const vec3 bp = vec3_sub(point, corners[1]);
+    const f32 d3 = vec3_dot(ab, bp), d4 = vec3_dot(ac, bp);
+    const vec3 cp = vec3_sub(point, corners[2]);
+    const f32 d5 = vec3_dot(ab, cp), d6 = vec3_dot(ac, cp);
+    const f32 va = d3 * d6 - d5 * d4, vb = d5 * d2 - d1 * d6, vc = d1 * d4 - d3 * d2;
+
+    if(d1 <= 0.0f && d2 <= 0.0f) v = w = 0.0f;
+    else if(d3 >= 0.0f && d4 <= d3)
+    {
+        v = 1.0f;
+        w = 0.0f;
+    }
+    else if(vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f)
+    {
+        v = d1 / (d1 - d3);
+        w = 0.0f;
+    }
+    else if(d6 >= 0.0f && d5 <= d6)
+    {
+        v = 0.0f;
+        w = 1.0f;
+    }
+    else if(vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f)
+    {
+        v = 0.0f;
+        w = d2 / (d2 - d6);
+    }
+    else if(va <= 0.0f && d4 - d3 >= 0.0f && d5 - d6 >= 0.0f)
+    {
+        w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+        v = 1.0f - w;
+    }
+    else
+    {
+        const f32 denom = 1.0f / (va + vb + vc);
+        v = vb * denom;
+        w = vc * denom;
+    }
+
+    weights_out[0] = 1.0f - v - w;
+    weights_out[1] = v;
+    weights_out[2] = w;
+    return vec3_add(corners[0], vec3_add(vec3_scale(ab, v), vec3_scale(ac, w)));
+}
+
+/**
+ * epa finds one point, which a capsule lying flat rocks on. when the capsule is side on to the normal
+ * and the other shape is a box face or a parallel capsule, the single point is replaced by the ends
+ * of the capsule's segment clipped to the part over the other shape
+ * dir: normal pointing from the capsule to the other shape
+ */
+void narrowphase_capsule_segment(const CollisionShape* capsule, const CollisionShape* other, vec3 dir, ContactManifold* manifold)
+{
+    const vec3 axis = capsule->axes[1];
+    if(fabsf(vec3_dot(axis, dir)) > CAPSULE_FLAT_TOLERANCE) return;
+
+    const vec3 offset = vec3_sub(capsule->centre, other->centre);
+    f32 t_min = -capsule->half_height, t_max = capsule->half_height;
+    u32 face_axis = 0;
+    vec3 face_normal = VEC3(0.0f, 0.0f, 0.0f);
+
+    if(other->type == BGL_COLLIDER_CAPSULE)
+    {
+        if(fabsf(vec3_dot(axis, other->axes[1])) < 1.0f - CAPSULE_PARALLEL_TOLERANCE) return;
+        if(!narrowphase_clip_segment(vec3_dot(offset, other->axes[1]), vec3_dot(axis, other->axes[1]), other->half_height, &t_min, &t_max)) return;
+    }
+    else if(other->type == BGL_COLLIDER_OBB)
+    {
+        /* the face the capsule lies on, edge contacts keep the single point */
+        f32 best = -1.0f;
+        for(u32 k = 0; k < 3; k++)
+        {
+            f32 d = fabsf(vec3_dot(dir, other->axes[k]));
+            if(d > best)
+            {
+                best = d;
+                face_axis = k;
+            }
+        }
+        if(best < 1.0f - CAPSULE_PARALLEL_TOLERANCE) return;
+        face_normal = vec3_dot(dir, other->axes[face_axis]) > 0.0f ? vec3_scale(other->axes[face_axis], -1.0f) : other->axes[face_axis];
+
+        /* the whole capsule must come out through the face, deeper than epa's minimum means it doesn't */
+        const f32 lowest = vec3_dot(face_normal, capsule->centre) - fabsf(vec3_dot(face_normal, axis)) * capsule->half_height - capsule->radius;
+        if(vec3_dot(face_normal, other->centre) + other->half_extents.data[face_axis] - lowest > manifold->points[0].depth + CLIP_TOLERANCE) return;
+
+        for(u32 k = 1; k < 3; k++)
+        {
+            const u32 side = (face_axis + k) % 3;
+            if(!narrowphase_clip_segment(vec3_dot(offset, other->axes[side]), vec3_dot(axis, other->axes[side]), other->half_extents.data[side] + CLIP_TOLERANCE, &t_min, &t_max)) return;
+        }
+    }
+    else return;
+
+    if(t_max - t_min < NARROWPHASE_EPSILON) return;
+
+    ContactPoint points[2];
+    const f32 ts[2] = { t_min, t_max };
+    for(u32 i = 0; i < 2; i++)
+    {
+        const vec3 end = vec3_add(capsule->centre, vec3_scale(axis, ts[i]));
+        vec3 down = dir; // from the end through the deepest point of the capsule
+        f32 depth;
+        if(other->type == BGL_COLLIDER_CAPSULE)
+        {
+            /* the end is over the other segment, so the closest point on it is the projection */
+            vec3 closest = vec3_add(other->centre, vec3_scale(other->axes[1], vec3_dot(vec3_sub(end, other->centre), other->axes[1])));
+            vec3 d = vec3_sub(end, closest);
+            depth = capsule->radius + other->radius - sqrtf(vec3_dot(d, d));
+        }
+        else
+        {
+            down = vec3_scale(face_normal, -1.0f);
+            depth = vec3_dot(face_normal, other->centre) + other->half_extents.data[face_axis] - vec3_dot(face_normal, end) + capsule->radius;
+        }
+        if(depth < -SPECULATIVE_DISTANCE) return;
+
+        const vec3 surface = vec3_add(end, vec3_scale(down, capsule->radius));
+        points[i] = (ContactPoint){
+            .pos = vec3_sub(surface, vec3_scale(down, depth * 0.5f)),
+            .depth = depth,
+            .id = i + 1,
+        };
+    }
+
+    /* the points were measured against the box face, so its normal is the one to push along */
+    if(other->type == BGL_COLLIDER_OBB) manifold->normal = vec3_dot(manifold->normal, dir) > 0.0f ? vec3_scale(face_normal, -1.0f) : face_normal;
+    manifold->point_count = 2;
+    memcpy(manifold->points, points, sizeof(points));
+}
+
+/* narrow [t_min, t_max] to where |offset + slope * t| <= limit, false if nothing is left */
+bool narrowphase_clip_segment(f32 offset, f32 slope, f32 limit, f32* t_min, f32* t_max)
+{
+    if(fabsf(slope) < NARROWPHASE_EPSILON) return fabsf(offset) <= limit;
+
+    f32 t0 = (-limit - offset) / slope, t1 = (limit - offset) / slope;
+    if(t0 > t1)
+    {
+        f32 tmp = t0;
+        t0 = t1;
+        t1 = tmp;
+    }
+    *t_min = MAX(*t_min, t0);
+    *t_max = MIN(*t_max, t1);
+    return *t_min < *t_max;
+}
+
+vec3 narrowphase_support(const CollisionShape* shape, vec3 dir)
+{
+    switch(shape->type)
+    {
+        case BGL_COLLIDER_SPHERE:
+            return vec3_add(shape->centre, vec3_scale(vec3_normalised(dir), shape->radius));
+
+        case BGL_COLLIDER_CAPSULE:
+        {
+            f32 h = vec3_dot(dir, shape->axes[1]) >= 0.0f ? shape->half_height : -shape->half_height;
+            return vec3_add(vec3_add(shape->centre, vec3_scale(shape->axes[1], h)), vec3_scale(vec3_normalised(dir), shape->radius));
+        }
+
+        case BGL_COLLIDER_MESH:
+        {
+            /* a single triangle of a mesh, the corners are in axes */
+            u32 best = 0;
+            for(u32 i = 1; i < 3; i++)
+            {
+                if(vec3_dot(dir, shape->axes[i]) > vec3_dot(dir, shape->axes[best])) best = i;
+            }
+            return shape->axes[best];
+        }
+
+        default:
+        {
+            vec3 p = shape->centre;
+            for(u32 i = 0; i < 3; i++)
+            {
+                f32 h = vec3_dot(dir, shape->axes[i]) >= 0.0f ? shape->half_extents.data[i] : -shape->half_extents.data[i];
+                p = vec3_add(p, vec3_scale(shape->axes[i], h));
+            }
+            return p;
+        }
+    }
+}
+
+SupportPoint narrowphase_minkowski_support(const CollisionShape* a, const CollisionShape* b, vec3 dir)
+{
+    SupportPoint point;
+    point.a = narrowphase_support(a, dir);
+    point.p = vec3_sub(point.a, narrowphase_support(b, vec3_scale(dir, -1.0f)));
+    return point;
+}
+
+/**
+ * gjk on the minkowski difference a - b, true if it contains the origin. the simplex is ordered
+ * newest first and wound so the final tetrahedron's faces point out, which epa relies on
+ */
+bool narrowphase_gjk(const CollisionShape* a, const CollisionShape* b, SupportPoint simplex_out[4])
+{
+    SupportPoint* s = simplex_out;
+    vec3 dir = vec3_sub(b->centre, a->centre);
+    if(vec3_dot(dir, dir) < NARROWPHASE_EPSILON) dir = VEC3(1.0f, 0.0f, 0.0f);
+
+    s[1] = narrowphase_minkowski_support(a, b, dir);
+    dir = vec3_scale(s[1].p, -1.0f);
+    s[0] = narrowphase_minkowski_support(a, b, dir);
+    if(vec3_dot(s[0].p, dir) < 0.0f) return false;
+
+    /* perpendicular to the line towards the origin */
+    vec3 cb = vec3_sub(s[1].p, s[0].p);
+    dir = vec_cross(vec_cross(cb, vec3_scale(s[0].p, -1.0f)), cb);
+    if(vec3_dot(dir, dir) < NARROWPHASE_EPSILON)
+    {
+        dir = vec_cross(cb, VEC3(1.0f, 0.0f, 0.0f));
+        if(vec3_dot(dir, dir) < NARROWPHASE_EPSILON) dir = vec_cross(cb, VEC3(0.0f, 0.0f, -1.0f));
+    }
+    u32 count = 2;
+
+    for(u32 i = 0; i < GJK_MAX_ITERATIONS; i++)
+    {
+        /* shift the simplex so the new point is s[0] */
+        memmove(&s[1], &s[0], count * sizeof(SupportPoint));
+        s[0] = narrowphase_minkowski_support(a, b, dir);
+        if(vec3_dot(s[0].p, dir) < 0.0f) return false;
+        count++;
+
+        if(count == 3)
+        {
+            narrowphase_gjk_simplex3(s, &count, &dir);
+        }
+        else if(narrowphase_gjk_simplex4(s, &count, &dir))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* triangle s[0] s[1] s[2], reduce to the feature closest to the origin */
+bool narrowphase_gjk_simplex3(SupportPoint* s, u32* count, vec3* dir)
+{
+    const vec3 ab = vec3_sub(s[1].p, s[0].p), ac = vec3_sub(s[2].p, s[0].p), ao = vec3_scale(s[0].p, -1.0f);
+    const vec3 n = vec_cross(ab, ac);
+    *count = 2;
+
+    if(vec3_dot(vec_cross(ab, n), ao) > 0.0f)
+    {
+        /* edge ab, wound b a so the next triangle faces the right way */
+        SupportPoint temp = s[0];
+        s[0] = s[1];
+        s[1] = temp;
+        *dir = vec_cross(vec_cross(ab, ao), ab);
+        return false;
+    }
+    if(vec3_dot(vec_cross(n, ac), ao) > 0.0f)
+    {
+        /* edge ac */
+        s[1] = s[2];
+        *dir = vec_cross(vec_cross(ac, ao), ac);
+        return false;
+    }
+
+    *count = 3;
+    if(vec3_dot(n, ao) > 0.0f)
+    {
+        *dir = n;
+        return false;
+    }
+
+    /* below, swap winding so the triangle faces the origin */
+    SupportPoint temp = s[1];
+    s[1] = s[2];
+    s[2] = temp;
+    *dir = vec3_scale(n, -1.0f);
+    return false;
+}
+
+/* tetrahedron, s[0] is the newest point */
+bool narrowphase_gjk_simplex4(SupportPoint* s, u32* count, vec3* dir)
+{
+    const vec3 ab = vec3_sub(s[1].p, s[0].p), ac = vec3_sub(s[2].p, s[0].p), ad = vec3_sub(s[3].p, s[0].p);
+    const vec3 ao = vec3_scale(s[0].p, -1.0f);
+    const vec3 abc = vec_cross(ab, ac), acd = vec_cross(ac, ad), adb = vec_cross(ad, ab);
+    *count = 3;
+
+    if(vec3_dot(abc, ao) > 0.0f)
+    {
+        *dir = abc;
+        return false;
+    }
+    if(vec3_dot(acd, ao) > 0.0f)
+    {
+        s[1] = s[2];
+        s[2] = s[3];
+        *dir = acd;
+        return false;
+    }
+    if(vec3_dot(adb, ao) > 0.0f)
+    {
+        s[2] = s[1];
+        s[1] = s[3];
+        *dir = adb;
+        return false;
+    }
+
+    *count = 4;
+    return true;
+}
+
+/* expand the gjk tetrahedron towards the surface of the minkowski difference closest to the origin */
+bool narrowphase_epa(const CollisionShape* a, const CollisionShape* b, const SupportPoint simplex[4], ContactManifold* manifold)
+{
+    SupportPoint verts[EPA_MAX_VERTICES];
+    EPAFace faces[EPA_MAX_FACES];
+    u32 edges[EPA_MAX_EDGES][2];
+    memcpy(verts, simplex, 4 * sizeof(SupportPoint));
+    u32 vert_count = 4, face_count = 0;
+
+    /* the polytope only grows, so the tetrahedron's centre stays inside and orients every face. the
+       origin can be on the tetrahedron's surface, so face distances alone can't */
+    const vec3 interior = vec3_scale(vec3_add(vec3_add(verts[0].p, verts[1].p), vec3_add(verts[2].p, verts[3].p)), 0.25f);
+    static const u32 start_faces[4][3] = { { 0, 1, 2 }, { 0, 2, 3 }, { 0, 3, 1 }, { 1, 3, 2 } };
+    for(u32 i = 0; i < 4; i++)
+    {
+        narrowphase_epa_face(&faces[face_count++], verts, start_faces[i][0], start_faces[i][1], start_faces[i][2], interior);
+    }
+
+    u32 closest = 0;
+    for(u32 iteration = 0;; iteration++)
+    {
+        closest = 0;
+        for(u32 i = 1; i < face_count; i++)
+        {
+            if(faces[i].dist < faces[closest].dist) closest = i;
+        }
+        if(iteration == EPA_MAX_ITERATIONS || vert_count == EPA_MAX_VERTICES) break;
+
+        const vec3 dir = faces[closest].normal;
+        const SupportPoint p = narrowphase_minkowski_support(a, b, dir);
+        if(vec3_dot(p.p, dir) - faces[closest].dist < EPA_TOLERANCE) break;
+        const u32 p_index = vert_count;
+        verts[vert_count++] = p;
+
+        /* remove faces the new point can see, keeping the edges of the hole they leave */
+        u32 edge_count = 0;
+        for(u32 i = 0; i < face_count; i++)
+        {
+            if(vec3_dot(faces[i].normal, vec3_sub(p.p, verts[faces[i].v[0]].p)) <= 0.0f) continue;
+
+            for(u32 j = 0; j < 3; j++)
+            {
+                u32 e0 = faces[i].v[j], e1 = faces[i].v[(j + 1) % 3];
+                bool shared = false;
+                for(u32 k = 0; k < edge_count; k++)
+                {
+                    if(edges[k][0] == e1 && edges[k][1] == e0)
+                    {
+                        edges[k][0] = edges[edge_count - 1][0];
+                        edges[k][1] = edges[edge_count - 1][1];
+                        edge_count--;
+                        shared = true;
+                        break;
+                    }
+                }
+                if(!shared && edge_count < EPA_MAX_EDGES)
+                {
+                    edges[edge_count][0] = e0;
+                    edges[edge_count][1] = e1;
+                    edge_count++;
+                }
+            }
+            faces[i--] = faces[--face_count];
+        }
+
+        /* fill the hole with faces to the new point */
+        for(u32 i = 0; i < edge_count && face_count < EPA_MAX_FACES; i++)
+        {
+            narrowphase_epa_face(&faces[face_count++], verts, edges[i][0], edges[i][1], p_index, interior);
+        }
+        if(face_count == 0) return false;
+    }
+
+    /* contact on a from the barycentric coordinates of the origin's projection onto the closest face.
+       faces of the minkowski difference are often split into coplanar triangles and the projection
+       can land in a neighbour, where extrapolating would put the point off a's surface */
+    const vec3 proj = vec3_scale(faces[closest].normal, faces[closest].dist);
+    f32 weights[3];
+    const EPAFace* face = &faces[closest];
+    const EPAFace* weighted = face;
+    if(!narrowphase_epa_barycentric(face, verts, proj, weights))
+    {
+        for(u32 i = 0; i < face_count; i++)
+        {
+            if(faces[i].dist - faces[closest].dist > EPA_TOLERANCE || vec3_dot(faces[i].normal, faces[closest].normal) < 0.999f) continue;
+            if(narrowphase_epa_barycentric(&faces[i], verts, proj, weights))
+            {
+                weighted = &faces[i];
+                break;
+            }
+        }
+        if(weighted == face)
+        {
+            /* clamp into the triangle */
+            f32 sum = 0.0f;
+            for(u32 i = 0; i < 3; i++) sum += weights[i] = MAX(weights[i], 0.0f);
+            for(u32 i = 0; i < 3; i++) weights[i] = sum > NARROWPHASE_EPSILON ? weights[i] / sum : 1.0f / 3.0f;
+        }
+    }
+
+    vec3 point_a = VEC3(0.0f, 0.0f, 0.0f);
+    for(u32 i = 0; i < 3; i++) point_a = vec3_add(point_a, vec3_scale(verts[weighted->v[i]].a, weights[i]));
+
+    manifold->normal = face->normal;
+    manifold->point_count = 1;
+    manifold->points[0] = (ContactPoint){
+        .pos = vec3_sub(point_a, vec3_scale(face->normal, face->dist * 0.5f)),
+        .depth = face->dist,
+        .id = 0,
+    };
+    return true;
+}
+
+void narrowphase_epa_face(EPAFace* face, const SupportPoint* verts, u32 v0, u32 v1, u32 v2, vec3 interior)
+{
+    vec3 normal = vec3_normalised(vec_cross(vec3_sub(verts[v1].p, verts[v0].p), vec3_sub(verts[v2].p, verts[v0].p)));
+    bool flip = vec3_dot(normal, vec3_sub(verts[v0].p, interior)) < 0.0f;
+
+    face->v[0] = flip ? v1 : v0;
+    face->v[1] = flip ? v0 : v1;
+    face->v[2] = v2;
+    face->normal = flip ? vec3_scale(normal, -1.0f) : normal;
+    face->dist = vec3_dot(face->normal, verts[v0].p);
+}
+
+/* true if point is inside the face */
+bool narrowphase_epa_barycentric(const EPAFace* face, const SupportPoint* verts, vec3 point, f32 weights_out[3])
+{
+    const vec3 v0 = verts[face->v[0]].p;
+    const vec3 e0 = vec3_sub(verts[face->v[1]].p, v0), e1 = vec3_sub(verts[face->v[2]].p, v0), e2 = vec3_sub(point, v0);
+    f32 d00 = vec3_dot(e0, e0), d01 = vec3_dot(e0, e1), d11 = vec3_dot(e1, e1), d20 = vec3_dot(e2, e0), d21 = vec3_dot(e2, e1);
+    f32 denom = d00 * d11 - d01 * d01;
+    if(fabsf(denom) <= NARROWPHASE_EPSILON)
+    {
+        weights_out[0] = weights_out[1] = weights_out[2] = 1.0f / 3.0f;
+        return false;
+    }
+
+    weights_out[1] = (d11 * d20 - d01 * d21) / denom;
+    weights_out[2] = (d00 * d21 - d01 * d20) / denom;
+    weights_out[0] = 1.0f - weights_out[1] - weights_out[2];
+    return weights_out[0] >= -EPA_TOLERANCE && weights_out[1] >= -EPA_TOLERANCE && weights_out[2] >= -EPA_TOLERANCE;
+}
+
+/**
+ * gjk ray casting (van den Bergen): a ray from the origin along dir against the minkowski difference
+ * b - a. whenever the support point shows a plane separating the ray's current point from b - a,
+ * the point jumps forward to that plane. the simplex is kept as support points and rebuilt around
+ * the current point each iteration, it closes in on the point once it's on the surface
+ */
+bool narrowphase_cast(const CollisionShape* a, vec3 dir, f32 max_t, const CollisionShape* b, f32* t_out, vec3* normal_out, vec3* point_out)
+{
+    vec3 support[4], on_b[4], simplex[4];
+    u32 count = 0;
+    f32 t = 0.0f;
+    vec3 x = VEC3(0.0f, 0.0f, 0.0f); // dir * t
+    vec3 normal = VEC3(0.0f, 0.0f, 0.0f);
+    vec3 v = vec3_sub(a->centre, b->centre); // from a point of b - a to x
+    f32 weights[4] = { 1.0f, 0.0f, 0.0f, 0.0f };
+
+    for(u32 iteration = 0; iteration < CAST_MAX_ITERATIONS && vec3_dot(v, v) > CAST_TOLERANCE * CAST_TOLERANCE; iteration++)
+    {
+        const vec3 point_b = narrowphase_support(b, v);
+        const vec3 p = vec3_sub(point_b, narrowphase_support(a, vec3_scale(v, -1.0f)));
+        const f32 vw = vec3_dot(v, vec3_sub(x, p));
+        if(vw > 0.0f)
+        {
+            /* separated, move up to the plane or miss if the ray runs parallel to it or away */
+            const f32 vr = vec3_dot(v, dir);
+            if(vr >= 0.0f) return false;
+            t -= vw / vr;
+            if(t > max_t) return false;
+            x = vec3_scale(dir, t);
+            normal = v;
+        }
+
+        support[count] = p;
+        on_b[count] = point_b;
+        count++;
+
+        for(u32 i = 0; i < count; i++) simplex[i] = vec3_sub(x, support[i]);
+        u32 keep[4];
+        v = narrowphase_cast_closest(simplex, &count, keep, weights);
+        for(u32 i = 0; i < count; i++)
+        {
+            support[i] = support[keep[i]];
+            on_b[i] = on_b[keep[i]];
+        }
+        if(count == 4) break; // x is inside
+    }
+
+    vec3 point = VEC3(0.0f, 0.0f, 0.0f);
+    for(u32 i = 0; i < count; i++) point = vec3_add(point, vec3_scale(on_b[i], weights[i]));
+
+    /* overlapping from the start has no plane to take a normal from */
+    *t_out = t;
+    *normal_out = vec3_dot(normal, normal) > 0.0f ? vec3_normalised(normal) : vec3_scale(vec3_normalised(dir), -1.0f);
+    *point_out = count > 0 ? point : b->centre;
+    return true;
+}
+
+/**
+ * closest point of a simplex to the origin. count is reduced to the points needed to reach it,
+ * keep_out lists which ones in order and weights_out their barycentric weights. 4 points left means
+ * the origin is inside
+ */
+vec3 narrowphase_cast_closest(const vec3* points, u32* count, u32 keep_out[4], f32 weights_out[4])
+{
+    const vec3 origin = VEC3(0.0f, 0.0f, 0.0f);
+    f32 weights[3];
+    vec3 closest;
+    u32 candidate_count = 3;
+    u32 candidates[3] = { 0, 1, 2 };
+
+    switch(*count)
+    {
+        case 1:
+            keep_out[0] = 0;
+            weights_out[0] = 1.0f;
+            return points[0];
+
+        case 2:
+        {
+            const vec3 ab = vec3_sub(points[1], points[0]);
+            const f32 len_sq = vec3_dot(ab, ab);
+            const f32 t = len_sq > NARROWPHASE_EPSILON ? MIN(MAX(-vec3_dot(points[0], ab) / len_sq, 0.0f), 1.0f) : 0.0f;
+            weights[0] = 1.0f - t;
+            weights[1] = t;
+            weights[2] = 0.0f;
+            closest = vec3_add(points[0], vec3_scale(ab, t));
+            candidate_count = 2;
+        } break;
+
+        case 3:
+        {
+            const vec3 corners[3] = { points[0], points[1], points[2] };
+            closest = narrowphase_triangle_closest(corners, origin, weights);
+        } break;
+
+        default:
+        {
+            /* the closest of the faces the origin is outside of, or the origin itself */
+            static const u32 faces[4][4] = { { 0, 1, 2, 3 }, { 0, 1, 3, 2 }, { 0, 2, 3, 1 }, { 1, 2, 3, 0 } };
+            f32 best = FLT_MAX;
+            closest = origin;
+            for(u32 i = 0; i < 4; i++)
+            {
+                const vec3 corners[3] = { points[faces[i][0]], points[faces[i][1]], points[faces[i][2]] };
+                const vec3 normal = vec_cross(vec3_sub(corners[1], corners[0]), vec3_sub(corners[2], corners[0]));
+                const f32 side_origin = -vec3_dot(normal, corners[0]);
+                const f32 side_opposite = vec3_dot(normal, vec3_sub(points[faces[i][3]], corners[0]));
+                if(side_origin * side_opposite > 0.0f) continue;
+
+                f32 face_weights[3];
+                const vec3 p = narrowphase_triangle_closest(corners, origin, face_weights);
+                if(vec3_dot(p, p) >= best) continue;
+                best = vec3_dot(p, p);
+                closest = p;
+                memcpy(weights, face_weights, sizeof(weights));
+                memcpy(candidates, faces[i], sizeof(candidates));
+            }
+            if(best == FLT_MAX)
+            {
+                for(u32 i = 0; i < 4; i++)
+                {
+                    keep_out[i] = i;
+                    weights_out[i] = 0.25f;
+                }
+                return origin;
+            }
+        } break;
+    }
+
+    u32 kept = 0;
+    for(u32 i = 0; i < candidate_count; i++)
+    {
+        if(weights[i] <= 0.0f) continue;
+        keep_out[kept] = candidates[i];
+        weights_out[kept] = weights[i];
+        kept++;
+    }
+    if(kept == 0)
+    {
+        keep_out[0] = candidates[0];
+        weights_out[0] = 1.0f;
+        kept = 1;
+    }
+    *count = kept;
+    return closest;
+}
@@ -0,0 +1,448 @@
+#include "ecs/physics_query.h"
+
+#include <float.h>
+#include <string.h>
+
+#define QUERY_MIN_DIR 1e-20f // dir components are kept this far from 0, so inverse dirs are finite and node tests never see NaN
+#define QUERY_MESH_SECTIONS 16 // most pieces a cast against a mesh is split into
+#define QUERY_EPSILON 1e-12f
+
+/* queries walking a tree together, the node test reads them as structure of arrays */
+typedef struct QueryPacket
+{
+    f32 origin[3][BGL_PHYSICS_QUERY_PACKET];
+    f32 inv_dir[3][BGL_PHYSICS_QUERY_PACKET];
+    f32 best_t[BGL_PHYSICS_QUERY_PACKET]; // closest hit so far, -1 for unused lanes so they never pass
+    u32 queries[BGL_PHYSICS_QUERY_PACKET];
+} QueryPacket;
+
+/* shape swept by every query of a call, placed at each query's origin */
+typedef struct QueryCast
+{
+    CollisionShape shape; // a sphere of radius 0 for rays
+    vec3 extent; // half size of the shape's bounds, node bounds are grown by it
+    bool ray;
+} QueryCast;
+
+typedef struct QueryBatch
+{
+    const PhysicsWorld* world;
+    const QueryCast* cast;
+    const vec3* origins;
+    const vec3* dirs;
+    u32 layer, ignore; // filter like a collider's
+    u32 skip_proxy;
+    PhysicsHit* hits;
+} QueryBatch;
+
+/**
+ * internal functions
+ */
+u32 physics_query_run(const QueryBatch* batch, u32 count, f32 max_t);
+void physics_query_tree(const QueryBatch* batch, const AABBTree* tree, QueryPacket* packet);
+bool physics_query_shape(const QueryCast* cast, vec3 origin, vec3 dir, f32 max_t, const CollisionShape* shape, PhysicsHit* hit_out);
+bool physics_query_ray_sphere(vec3 origin, vec3 dir, f32 max_t, const CollisionShape* shape, PhysicsHit* hit_out);
+bool physics_query_ray_box(vec3 origin, vec3 dir, f32 max_t, const CollisionShape* shape, PhysicsHit* hit_out);
+bool physics_query_ray_mesh(vec3 origin, vec3 dir, f32 max_t, const CollisionShape* shape, PhysicsHit* hit_out);
+bool physics_query_cast_mesh(const QueryCast* cast, vec3 origin, vec3 dir, f32 max_t, const CollisionShape* shape, PhysicsHit* hit_out);
+
+/* slab test of every lane against a box, returns a bit per lane that enters it before its best hit */
+static inline u32 physics_query_packet_test(const QueryPacket* packet, vec3 min, vec3 max)
+{
+    bool hit[BGL_PHYSICS_QUERY_PACKET];
+    for(u32 lane = 0; lane < BGL_PHYSICS_QUERY_PACKET; lane++)
+    {
+        f32 t_min = 0.0f, t_max = packet->best_t[lane];
+        for(u32 i = 0; i < 3; i++)
+        {
+            const f32 t1 = (min.data[i] - packet->origin[i][lane]) * packet->inv_dir[i][lane];
+            const f32 t2 = (max.data[i] - packet->origin[i][lane]) * packet->inv_dir[i][lane];
+            t_min = MAX(t_min, MIN(t1, t2));
+            t_max = MIN(t_max, MAX(t1, t2));
+        }
+        hit[lane] = t_min <= t_max;
+    }
+
+    u32 mask = 0;
+    for(u32 lane = 0; lane < BGL_PHYSICS_QUERY_PACKET; lane++) mask |= (u32)hit[lane] << lane;
+    return mask;
+}
+
+u32 physics_world_raycast_closest(const PhysicsWorld* self, const vec3* origins, const vec3* dirs, u32 count, f32 max_t, u32 ignore, PhysicsHit* hits_out)
+{
+    QueryCast cast = {
+        .shape = { .type = BGL_COLLIDER_SPHERE, .axes = { VEC3(1.0f, 0.0f, 0.0f), VEC3(0.0f, 1.0f, 0.0f), VEC3(0.0f, 0.0f, 1.0f) } },
+        .ray = true,
+    };
+    const QueryBatch batch = { self, &cast, origins, dirs, 0, ignore, BGL_PHYSICS_QUERY_NO_PROXY, hits_out };
+    return physics_query_run(&batch, count, max_t);
+}
+
+u32 physics_world_sphere_cast(const PhysicsWorld* self, const vec3* origins, const vec3* dirs, u32 count, f32 radius, f32 max_t, u32 ignore, PhysicsHit* hits_out)
+{
+    QueryCast cast = {
+        .shape = { .type = BGL_COLLIDER_SPHERE, .radius = radius, .axes = { VEC3(1.0f, 0.0f, 0.0f), VEC3(0.0f, 1.0f, 0.0f), VEC3(0.0f, 0.0f, 1.0f) } },
+        .extent = VEC3(radius, radius, radius),
+    };
+    const QueryBatch batch = { self, &cast, origins, dirs, 0, ignore, BGL_PHYSICS_QUERY_NO_PROXY, hits_out };
+    return physics_query_run(&batch, count, max_t);
+}
+
+u32 physics_world_box_cast(const PhysicsWorld* self, const vec3* origins, const vec3* dirs, u32 count, vec3 half_extents, vec4 rot, f32 max_t, u32 ignore, PhysicsHit* hits_out)
+{
+    mat3 basis;
+    quat_to_mat3(&basis, quat_norm(rot));
+
+    QueryCast cast = { .shape = { .type = BGL_COLLIDER_OBB, .half_extents = half_extents } };
+    for(u32 i = 0; i < 3; i++)
+    {
+        cast.shape.axes[i] = basis.cols[i];
+        for(u32 k = 0; k < 3; k++) cast.extent.data[k] += fabsf(basis.cols[i].data[k]) * half_extents.data[i];
+    }
+    const QueryBatch batch = { self, &cast, origins, dirs, 0, ignore, BGL_PHYSICS_QUERY_NO_PROXY, hits_out };
+    return physics_query_run(&batch, count, max_t);
+}
+
+bool physics_world_shape_cast(const PhysicsWorld* self, const CollisionShape* shape, vec3 dir, f32 max_t, u32 proxy, PhysicsHit* hit_out)
+{
+    BGL_ASSERT(shape->type != BGL_COLLIDER_MESH, "mesh shapes can't be cast");
+
+    QueryCast cast = { .shape = *shape };
+    switch(shape->type)
+    {
+        case BGL_COLLIDER_SPHERE:
+        {
+            cast.extent = VEC3(shape->radius, shape->radius, shape->radius);
+        } break;
+
+        case BGL_COLLIDER_CAPSULE:
+        {
+            const vec3 axis = shape->axes[1];
+            cast.extent = vec3_add_scalar(vec3_scale(VEC3(fabsf(axis.x), fabsf(axis.y), fabsf(axis.z)), shape->half_height), shape->radius);
+        } break;
+
+        default:
+        {
+            for(u32 i = 0; i < 3; i++)
+            {
+                for(u32 k = 0; k < 3; k++) cast.extent.data[k] += fabsf(shape->axes[i].data[k]) * shape->half_extents.data[i];
+            }
+        } break;
+    }
+
+    const BroadphaseProxy* own = proxy != BGL_PHYSICS_QUERY_NO_PROXY ? &self->proxies[proxy] : NULL;
+    const QueryBatch batch = {
+        .world = self,
+        .cast = &cast,
+        .origins = &shape->centre,
+        .dirs = &dir,
+        .layer = own != NULL ? own->layer : 0,
+        .ignore = own != NULL ? own->ignore : 0,
+        .skip_proxy = proxy,
+        .hits = hit_out,
+    };
+    return physics_query_run(&batch, 1, max_t) != 0;
+}
+
+u32 physics_query_run(const QueryBatch* batch, u32 count, f32 max_t)
+{
+    const PhysicsWorld* world = batch->world;
+    const vec3* origins = batch->origins;
+    const vec3* dirs = batch->dirs;
+    PhysicsHit* hits_out = batch->hits;
+
+    for(u32 base = 0; base < count; base += BGL_PHYSICS_QUERY_BLOCK)
+    {
+        const u32 n = MIN(BGL_PHYSICS_QUERY_BLOCK, count - base);
+
+        /* counting sort by the octant of the direction, so the queries in a packet visit children in the same order */
+        u8 octants[BGL_PHYSICS_QUERY_BLOCK];
+        u32 order[BGL_PHYSICS_QUERY_BLOCK];
+        u32 offsets[8] = { 0 };
+        for(u32 i = 0; i < n; i++)
+        {
+            const vec3 dir = dirs[base + i];
+            octants[i] = (u8)((dir.x < 0.0f) | (dir.y < 0.0f) << 1 | (dir.z < 0.0f) << 2);
+            offsets[octants[i]]++;
+        }
+        for(u32 i = 0, sum = 0; i < 8; i++)
+        {
+            const u32 bucket = offsets[i];
+            offsets[i] = sum;
+            sum += bucket;
+        }
+        for(u32 i = 0; i < n; i++) order[offsets[octants[i]]++] = base + i;
+
+        for(u32 first = 0; first < n; first += BGL_PHYSICS_QUERY_PACKET)
+        {
+            QueryPacket packet;
+            for(u32 lane = 0; lane < BGL_PHYSICS_QUERY_PACKET; lane++)
+            {
+                const bool used = first + lane < n;
+                const u32 query = used ? order[first + lane] : order[first];
+                const vec3 origin = origins[query], dir = dirs[query];
+                for(u32 i = 0; i < 3; i++)
+                {
+                    const f32 d = fabsf(dir.data[i]) > QUERY_MIN_DIR ? dir.data[i] : (dir.data[i] < 0.0f ? -QUERY_MIN_DIR : QUERY_MIN_DIR);
+                    packet.origin[i][lane] = origin.data[i];
+                    packet.inv_dir[i][lane] = 1.0f / d;
+                }
+                packet.best_t[lane] = used ? max_t : -1.0f;
+                packet.queries[lane] = query;
+                if(used) hits_out[query] = (PhysicsHit){ .entity = BGL_ENTITY_NULL, .t = max_t, .triangle = BGL_TRIANGLE_NULL };
+            }
+
+            physics_query_tree(batch, &world->static_tree, &packet);
+            physics_query_tree(batch, &world->dynamic_tree, &packet);
+        }
+    }
+
+    u32 hit_count = 0;
+    for(u32 i = 0; i < count; i++) hit_count += hits_out[i].entity != BGL_ENTITY_NULL;
+    return hit_count;
+}
+
+void physics_query_tree(const QueryBatch* batch, const AABBTree* tree, QueryPacket* packet)
+{
+    if(tree->root == BGL_AABB_TREE_NULL) return;
+
+    const PhysicsWorld* world = batch->world;
+    const vec3 extent = batch->cast->extent;
+    const vec3 lead_dir = batch->dirs[packet->queries[0]]; // the packet mostly shares its octant, children are ordered by the first lane
+
+    u32 stack[BGL_AABB_TREE_MAX_DEPTH];
+    u32 top = 0;
+    stack[top++] = tree->root;
+    while(top > 0)
+    {
+        const AABBTreeNode* node = &tree->nodes[stack[--top]];
+        u32 mask = physics_query_packet_test(packet, vec3_sub(node->min, extent), vec3_add(node->max, extent));
+        if(mask == 0) continue;
+
+        if(node->height > 0)
+        {
+            /* nearer child on top, hits found in it shorten the rays before the other is tested */
+            const AABBTreeNode* child1 = &tree->nodes[node->child1];
+            const AABBTreeNode* child2 = &tree->nodes[node->child2];
+            const bool first_nearer = vec3_dot(vec3_add(child1->min, child1->max), lead_dir) <= vec3_dot(vec3_add(child2->min, child2->max), lead_dir);
+            stack[top++] = first_nearer ? node->child2 : node->child1;
+            stack[top++] = first_nearer ? node->child1 : node->child2;
+            continue;
+        }
+
+        /* fattened leaves first, then the proxy's own bounds, then the shape */
+        const u32 index = node->user;
+        const BroadphaseProxy* proxy = &world->proxies[index];
+        if((proxy->layer & batch->ignore) || (batch->layer & proxy->ignore) || index == batch->skip_proxy) continue;
+        mask &= physics_query_packet_test(packet, vec3_sub(proxy->min, extent), vec3_add(proxy->max, extent));
+
+        for(u32 lane = 0; lane < BGL_PHYSICS_QUERY_PACKET; lane++)
+        {
+            if(!(mask & (1u << lane))) continue;
+
+            const u32 query = packet->queries[lane];
+            PhysicsHit hit;
+            if(!physics_query_shape(batch->cast, batch->origins[query], batch->dirs[query], packet->best_t[lane], &world->shapes[index], &hit)) continue;
+
+            hit.entity = proxy->entity;
+            packet->best_t[lane] = hit.t;
+            batch->hits[query] = hit;
+        }
+    }
+}
+
+bool physics_query_shape(const QueryCast* cast, vec3 origin, vec3 dir, f32 max_t, const CollisionShape* shape, PhysicsHit* hit_out)
+{
+    if(shape->type == BGL_COLLIDER_MESH)
+    {
+        if(shape->mesh == NULL) return false;
+        return cast->ray ? physics_query_ray_mesh(origin, dir, max_t, shape, hit_out) : physics_query_cast_mesh(cast, origin, dir, max_t, shape, hit_out);
+    }
+    if(cast->ray && shape->type == BGL_COLLIDER_SPHERE) return physics_query_ray_sphere(origin, dir, max_t, shape, hit_out);
+    if(cast->ray && shape->type == BGL_COLLIDER_OBB) return physics_query_ray_box(origin, dir, max_t, shape, hit_out);
+
+    CollisionShape moving = cast->shape;
+    moving.centre = origin;
+    *hit_out = (PhysicsHit){ .entity = BGL_ENTITY_NULL, .triangle = BGL_TRIANGLE_NULL };
+    return narrowphase_cast(&moving, dir, max_t, shape, &hit_out->t, &hit_out->normal, &hit_out->pos);
+}
+
+bool physics_query_ray_sphere(vec3 origin, vec3 dir, f32 max_t, const CollisionShape* shape, PhysicsHit* hit_out)
+{
+    const vec3 m = vec3_sub(origin, shape->centre);
+    const f32 a = vec3_dot(dir, dir), b = vec3_dot(m, dir), c = vec3_dot(m, m) - shape->radius * shape->radius;
+    if(a <= QUERY_EPSILON || (c > 0.0f && b > 0.0f)) return false;
+
+    const f32 discriminant = b * b - a * c;
+    if(discriminant < 0.0f) return false;
+
+    const f32 t = MAX((-b - sqrtf(discriminant)) / a, 0.0f);
+    if(t > max_t) return false;
+
+    const vec3 pos = vec3_add(origin, vec3_scale(dir, t));
+    vec3 normal = t > 0.0f ? vec3_sub(pos, shape->centre) : vec3_scale(dir, -1.0f);
+    vec3_norm(&normal);
+    *hit_out = (PhysicsHit){ .entity = BGL_ENTITY_NULL, .t = t, .pos = pos, .normal = normal, .triangle = BGL_TRIANGLE_NULL };
+    return true;
+}
+
+/* slab test in the box's space, the last slab entered is the face hit */
+bool physics_query_ray_box(vec3 origin, vec3 dir, f32 max_t, const CollisionShape* shape, PhysicsHit* hit_out)
+{
+    const vec3 offset = vec3_sub(origin, shape->centre);
+    f32 t_min = 0.0f, t_max = max_t;
+    vec3 normal = vec3_scale(dir, -1.0f); // starting inside
+    for(u32 i = 0; i < 3; i++)
+    {
+        const f32 o = vec3_dot(offset, shape->axes[i]), d = vec3_dot(dir, shape->axes[i]);
+        const f32 half = shape->half_extents.data[i];
+        if(fabsf(d) <= QUERY_EPSILON)
+        {
+            if(fabsf(o) > half) return false;
+            continue;
+        }
+
+        f32 t1 = (-half - o) / d, t2 = (half - o) / d;
+        f32 side = -1.0f; // entering through the negative face when d is positive
+        if(t1 > t2)
+        {
+            const f32 temp = t1;
+            t1 = t2;
+            t2 = temp;
+            side = 1.0f;
+        }
+        if(t1 > t_min)
+        {
+            t_min = t1;
+            normal = vec3_scale(shape->axes[i], side);
+        }
+        t_max = MIN(t_max, t2);
+        if(t_min > t_max) return false;
+    }
+
+    vec3_norm(&normal);
+    *hit_out = (PhysicsHit){
+        .entity = BGL_ENTITY_NULL,
+        .t = t_min,
+        .pos = vec3_add(origin, vec3_scale(dir, t_min)),
+        .normal = normal,
+        .triangle = BGL_TRIANGLE_NULL,
+    };
+    return true;
+}
+
+/* the ray moves into the mesh's unscaled space, which keeps t the same */
+bool physics_query_ray_mesh(vec3 origin, vec3 dir, f32 max_t, const CollisionShape* shape, PhysicsHit* hit_out)
+{
+    vec3 local_origin, local_dir;
+    const vec3 offset = vec3_sub(origin, shape->centre);
+    for(u32 i = 0; i < 3; i++)
+    {
+        const f32 scale = shape->half_extents.data[i];
+        if(scale <= QUERY_EPSILON) return false;
+        local_origin.data[i] = vec3_dot(offset, shape->axes[i]) / scale;
+        local_dir.data[i] = vec3_dot(dir, shape->axes[i]) / scale;
+    }
+
+    TriangleMeshHit mesh_hit;
+    if(!triangle_mesh_raycast(shape->mesh, local_origin, local_dir, max_t, &mesh_hit)) return false;
+
+    /* normals go back through the inverse transpose, then face the ray since either side can be hit */
+    vec3 normal = VEC3(0.0f, 0.0f, 0.0f);
+    for(u32 i = 0; i < 3; i++) normal = vec3_add(normal, vec3_scale(shape->axes[i], mesh_hit.normal.data[i] / shape->half_extents.data[i]));
+    vec3_norm(&normal);
+    if(vec3_dot(normal, dir) > 0.0f) normal = vec3_scale(normal, -1.0f);
+
+    *hit_out = (PhysicsHit){
+        .entity = BGL_ENTITY_NULL,
+        .t = mesh_hit.t,
+        .pos = vec3_add(origin, vec3_scale(dir, mesh_hit.t)),
+        .normal = normal,
+        .triangle = shape->mesh->source_ids[mesh_hit.triangle],
+    };
+    return true;
+}
+
+/**
+ * the part of the sweep over the mesh's bounds is cut into sections, and each section's triangles
+ * are cast against in order until one is hit, so a long cast doesn't gather the whole mesh.
+ * triangles facing away from the sweep are skipped
+ */
+bool physics_query_cast_mesh(const QueryCast* cast, vec3 origin, vec3 dir, f32 max_t, const CollisionShape* shape, PhysicsHit* hit_out)
+{
+    /* the sweep's extent against the mesh's bounds grown by the cast shape */
+    vec3 bounds_min, bounds_max;
+    triangle_mesh_get_bounds(shape->mesh, &bounds_min, &bounds_max);
+    f32 t_min = 0.0f, t_max = max_t;
+    const vec3 offset = vec3_sub(origin, shape->centre);
+    for(u32 i = 0; i < 3; i++)
+    {
+        const f32 scale = shape->half_extents.data[i];
+        if(scale <= QUERY_EPSILON) return false;
+
+        const vec3 axis = shape->axes[i];
+        const f32 grow = (fabsf(axis.x) * cast->extent.x + fabsf(axis.y) * cast->extent.y + fabsf(axis.z) * cast->extent.z) / scale;
+        const f32 o = vec3_dot(offset, axis) / scale, d = vec3_dot(dir, axis) / scale;
+        const f32 min = bounds_min.data[i] - grow, max = bounds_max.data[i] + grow;
+        if(fabsf(d) <= QUERY_EPSILON)
+        {
+            if(o < min || o > max) return false;
+            continue;
+        }
+        const f32 t1 = (min - o) / d, t2 = (max - o) / d;
+        t_min = MAX(t_min, MIN(t1, t2));
+        t_max = MIN(t_max, MAX(t1, t2));
+    }
+    if(t_min > t_max) return false;
+
+    /* sections about 4 cast shapes long */
+    const f32 length = (t_max - t_min) * sqrtf(vec3_dot(dir, dir));
+    const f32 size = 4.0f * MAX(cast->extent.x, MAX(cast->extent.y, cast->extent.z));
+    const u32 sections = size > QUERY_EPSILON ? (u32)MIN(MAX(ceilf(length / size), 1.0f), (f32)QUERY_MESH_SECTIONS) : 1;
+
+    CollisionShape moving = cast->shape;
+    moving.centre = origin;
+    f32 best_t = max_t;
+    bool hit = false;
+    for(u32 section = 0; section < sections; section++)
+    {
+        const f32 start = t_min + (t_max - t_min) * (f32)section / (f32)sections;
+        const f32 end = t_min + (t_max - t_min) * (f32)(section + 1) / (f32)sections;
+        if(start > best_t) break;
+
+        const vec3 from = vec3_add(origin, vec3_scale(dir, start)), to = vec3_add(origin, vec3_scale(dir, end));
+        const vec3 min = vec3_sub(VEC3(MIN(from.x, to.x), MIN(from.y, to.y), MIN(from.z, to.z)), cast->extent);
+        const vec3 max = vec3_add(VEC3(MAX(from.x, to.x), MAX(from.y, to.y), MAX(from.z, to.z)), cast->extent);
+        vec3 local_min, local_max;
+        if(!narrowphase_mesh_local_bounds(shape, min, max, &local_min, &local_max)) return false;
+
+        u32 triangles[BGL_PHYSICS_QUERY_MESH_TRIANGLES];
+        const u32 found = MIN(triangle_mesh_query_box(shape->mesh, local_min, local_max, triangles, BGL_PHYSICS_QUERY_MESH_TRIANGLES),
+                              BGL_PHYSICS_QUERY_MESH_TRIANGLES);
+        for(u32 i = 0; i < found; i++)
+        {
+            CollisionShape triangle;
+            narrowphase_mesh_triangle_shape(shape, triangles[i], &triangle);
+            const vec3 face = vec_cross(vec3_sub(triangle.axes[1], triangle.axes[0]), vec3_sub(triangle.axes[2], triangle.axes[0]));
+            if(vec3_dot(face, dir) >= 0.0f) continue;
+
+            f32 t;
+            vec3 normal, pos;
+            if(!narrowphase_cast(&moving, dir, best_t, &triangle, &t, &normal, &pos) || t > best_t) continue;
+
+            best_t = t;
+            hit = true;
+            *hit_out = (PhysicsHit){
+                .entity = BGL_ENTITY_NULL,
+                .t = t,
+                .pos = pos,
+                .normal = normal,
+                .triangle = shape->mesh->source_ids[triangles[i]],
+            };
+        }
+
+        /* a triangle reaching into the next section can be hit after a triangle in it */
+        if(hit && best_t <= end) break;
+    }
+    return hit;
+}
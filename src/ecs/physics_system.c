@@ -0,0 +1,1830 @@
+#include "ecs/physics_system.h"
+
+#include <float.h>
+#include <stdlib.h>
+#include <string.h>
+#include "transform.h"
+#include "platform.h"
+#include "jobs.h"
+#include "ecs/physics_query.h"
+
+#define SAP_RESORT_FRACTION 8 // full sort when more than 1/8 of entries are new
+#define SAP_AXIS_HYSTERESIS 1.5f // only switch axis when another spreads proxies this much more
+#define DYNAMIC_TREE_MARGIN 0.2f
+#define DYNAMIC_TREE_DISPLACEMENT_SCALE 4.0f // fattened bounds cover this many steps of movement ahead
+#define STEP_TOLERANCE 0.999f // frames of exactly fixed_dt shouldn't alternate between 0 and 2 steps
+#define SLEEP_LINEAR_VELOCITY 0.05f
+#define SLEEP_ANGULAR_VELOCITY 0.05f // radians per second
+#define TIME_TO_SLEEP 0.5f
+#define ISLAND_BATCH_SIZE 4
+#define FAST_BODY_BATCH_SIZE 16
+#define CCD_DEPTH (2.0f * BGL_SOLVER_SLOP) // how far a swept body is left inside what it hit, so the next step finds the contact
+#define DEFAULT_FRICTION 0.6f // colliders without a RigidBody
+#define ISLAND_NONE 0xFFFFFFFF
+#define CONTACT_TABLE_EMPTY 0xFFFFFFFF
+
+/**
+ * internal functions
+ */
+void physics_sync_colliders(ECSIter* iter);
+void physics_write_bodies(ECSIter* iter);
+void physics_world_sync(PhysicsWorld* self, World* world);
+void physics_world_simulate(PhysicsWorld* self);
+void physics_find_pairs(PhysicsWorld* self);
+u32 physics_alloc_proxy(PhysicsWorld* self, Entity entity, bool is_static);
+void physics_set_proxy_static(PhysicsWorld* self, u32 index, bool is_static);
+void physics_update_proxy_leaf(PhysicsWorld* self, u32 index, vec3 min, vec3 max);
+void physics_remove_unseen_proxies(PhysicsWorld* self);
+void physics_compact_sap(PhysicsWorld* self);
+void physics_load_body(PhysicsWorld* self, u32 index, const Collider* collider, const mat4* model, const RigidBody* rigid_body, const Velocity* velocity, bool fresh);
+void physics_add_awake(PhysicsWorld* self, u32 index);
+void physics_compact_awake(PhysicsWorld* self);
+void physics_wake_island(PhysicsWorld* self, u32 index);
+void physics_queue_overlapping(PhysicsWorld* self, vec3 min, vec3 max);
+void physics_queue_wake(PhysicsWorld* self, u32 index);
+void physics_process_wake_queue(PhysicsWorld* self);
+void physics_sleep_island(PhysicsWorld* self, const PhysicsIsland* island);
+u32 physics_build_contacts(PhysicsWorld* self);
+void physics_build_islands(PhysicsWorld* self, u32 contact_count);
+u32 physics_find_island(PhysicsWorld* self, u32 index);
+void physics_solve_islands(void* data, u32 start, u32 end, u32 worker);
+void physics_sweep_fast_bodies(PhysicsWorld* self);
+void physics_sweep_fast_batch(void* data, u32 start, u32 end, u32 worker);
+void physics_update_bodies(PhysicsWorld* self);
+bool physics_choose_axis(PhysicsWorld* self);
+void physics_gather_sap(PhysicsWorld* self);
+void physics_sort_sap(PhysicsWorld* self, bool full_sort);
+void physics_sweep(PhysicsWorld* self);
+void physics_find_static_pairs(PhysicsWorld* self);
+void physics_add_pair(PhysicsWorld* self, u32 proxy_a, u32 proxy_b);
+i32 physics_sap_compare(const void* a, const void* b);
+
+u32 aabb_tree_alloc_node(AABBTree* self);
+void aabb_tree_free_node(AABBTree* self, u32 index);
+void aabb_tree_insert_leaf(AABBTree* self, u32 leaf);
+void aabb_tree_remove_leaf(AABBTree* self, u32 leaf);
+void aabb_tree_refit(AABBTree* self, u32 index);
+u32 aabb_tree_balance(AABBTree* self, u32 index);
+u32 aabb_tree_overlap_impl(const AABBTree* self, const BroadphaseProxy* proxies, vec3 min, vec3 max, u32 query, AABBTreeHit* hits_out, u32 total, u32 max_hits);
+u32 aabb_tree_raycast_impl(const AABBTree* self, const BroadphaseProxy* proxies, vec3 origin, vec3 dir, f32 max_t, u32 query, AABBTreeHit* hits_out, u32 total, u32 max_hits);
+u32 aabb_tree_frustum_impl(const AABBTree* self, const BroadphaseProxy* proxies, const vec4* planes, AABBTreeHit* hits_out, u32 total, u32 max_hits);
+
+static inline bool aabb_overlap(vec3 min_a, vec3 max_a, vec3 min_b, vec3 max_b)
+{
+    return (min_a.x <= max_b.x) & (min_b.x <= max_a.x) & (min_a.y <= max_b.y) & (min_b.y <= max_a.y) & (min_a.z <= max_b.z) & (min_b.z <= max_a.z);
+}
+
+static inline bool aabb_contains(vec3 outer_min, vec3 outer_max, vec3 min, vec3 max)
+{
+    return outer_min.x <= min.x && outer_min.y <= min.y && outer_min.z <= min.z && max.x <= outer_max.x && max.y <= outer_max.y && max.z <= outer_max.z;
+}
+
+static inline f32 aabb_area(vec3 min, vec3 max)
+{
+    vec3 d = vec3_sub(max, min);
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+static inline f32 aabb_union_area(vec3 min_a, vec3 max_a, vec3 min_b, vec3 max_b)
+{
+    return aabb_area(VEC3(MIN(min_a.x, min_b.x), MIN(min_a.y, min_b.y), MIN(min_a.z, min_b.z)),
+                     VEC3(MAX(max_a.x, max_b.x), MAX(max_a.y, max_b.y), MAX(max_a.z, max_b.z)));
+}
+
+/**
+ * slab test, inv_dir components may be infinite for axis aligned rays. a ray in the plane of a face
+ * gives 0 * inf = NaN, the comparisons are written so NaN is ignored and that counts as a hit
+ */
+static inline bool aabb_raycast(vec3 origin, vec3 inv_dir, f32 max_t, vec3 min, vec3 max, f32* t_out)
+{
+    f32 t_min = 0.0f, t_max = max_t;
+    for(u32 i = 0; i < 3; i++)
+    {
+        f32 t1 = (min.data[i] - origin.data[i]) * inv_dir.data[i];
+        f32 t2 = (max.data[i] - origin.data[i]) * inv_dir.data[i];
+        if(t1 > t2)
+        {
+            f32 temp = t1;
+            t1 = t2;
+            t2 = temp;
+        }
+        if(t1 > t_min) t_min = t1;
+        if(t2 < t_max) t_max = t2;
+    }
+    *t_out = t_min;
+    return t_min <= t_max;
+}
+
+static inline void physics_shape_bounds(const CollisionShape* shape, vec3* min_out, vec3* max_out)
+{
+    vec3 centre = shape->centre, extent;
+    switch(shape->type)
+    {
+        case BGL_COLLIDER_MESH:
+        {
+            /* the mesh's local bounds as a box, half_extents is the scale */
+            vec3 local_min = VEC3(0.0f, 0.0f, 0.0f), local_max = VEC3(0.0f, 0.0f, 0.0f);
+            if(shape->mesh != NULL) triangle_mesh_get_bounds(shape->mesh, &local_min, &local_max);
+            extent = VEC3(0.0f, 0.0f, 0.0f);
+            for(u32 i = 0; i < 3; i++)
+            {
+                const f32 mid = (local_min.data[i] + local_max.data[i]) * 0.5f * shape->half_extents.data[i];
+                const f32 half = (local_max.data[i] - local_min.data[i]) * 0.5f * shape->half_extents.data[i];
+                const vec3 axis = shape->axes[i];
+                centre = vec3_add(centre, vec3_scale(axis, mid));
+                extent = vec3_add(extent, VEC3(fabsf(axis.x) * half, fabsf(axis.y) * half, fabsf(axis.z) * half));
+            }
+        } break;
+
+        case BGL_COLLIDER_SPHERE:
+        {
+            extent = VEC3(shape->radius, shape->radius, shape->radius);
+        } break;
+
+        case BGL_COLLIDER_CAPSULE:
+        {
+            const vec3 axis = shape->axes[1];
+            extent = vec3_add_scalar(vec3_scale(VEC3(fabsf(axis.x), fabsf(axis.y), fabsf(axis.z)), shape->half_height), shape->radius);
+        } break;
+
+        default:
+        {
+            for(u32 i = 0; i < 3; i++)
+            {
+                extent.data[i] = fabsf(shape->axes[0].data[i]) * shape->half_extents.x + fabsf(shape->axes[1].data[i]) * shape->half_extents.y +
+                                 fabsf(shape->axes[2].data[i]) * shape->half_extents.z;
+            }
+        } break;
+    }
+    *min_out = vec3_sub(centre, extent);
+    *max_out = vec3_add(centre, extent);
+}
+
+/* radius of the largest sphere around the centre that fits inside the shape */
+static inline f32 physics_shape_inner_radius(const CollisionShape* shape)
+{
+    switch(shape->type)
+    {
+        case BGL_COLLIDER_SPHERE:
+        case BGL_COLLIDER_CAPSULE: return shape->radius;
+        default: return MIN(shape->half_extents.x, MIN(shape->half_extents.y, shape->half_extents.z));
+    }
+}
+
+/* whether a body touching a sleeping one should wake it */
+static inline bool physics_body_wakes_others(const SolverBody* body)
+{
+    if(body->flags & BGL_SOLVER_BODY_SLEEPING) return false;
+    if(body->flags & (BGL_SOLVER_BODY_DYNAMIC | BGL_SOLVER_BODY_MOVED)) return true;
+
+    const vec3 v = body->linear_velocity, w = body->angular_velocity;
+    return v.x != 0.0f || v.y != 0.0f || v.z != 0.0f || w.x != 0.0f || w.y != 0.0f || w.z != 0.0f;
+}
+
+static inline u32 physics_contact_slot(u32 body_a, u32 body_b, u32 mask)
+{
+    u64 key = body_a < body_b ? ((u64)body_a << 32) | body_b : ((u64)body_b << 32) | body_a;
+    return (u32)((key * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+/* only tests the corner furthest along each plane normal, so boxes near frustum corners can pass */
+static inline bool aabb_in_frustum(const vec4* planes, vec3 min, vec3 max)
+{
+    for(u32 i = 0; i < 6; i++)
+    {
+        const vec4 p = planes[i];
+        f32 d = p.x * (p.x >= 0.0f ? max.x : min.x) + p.y * (p.y >= 0.0f ? max.y : min.y) + p.z * (p.z >= 0.0f ? max.z : min.z) + p.w;
+        if(d < 0.0f) return false;
+    }
+    return true;
+}
+
+u32 physics_system_register(World* world)
+{
+    return ecs_add_system(world, "physics integrate", physics_system_integrate,
+                          BGL_COMPONENT_BIT(BGL_COMPONENT_VELOCITY),
+                          BGL_COMPONENT_BIT(BGL_COMPONENT_TRANSFORM), NULL);
+}
+
+void physics_system_integrate(ECSIter* iter)
+{
+    Transform* transforms = ECS_ITER_COLUMN(iter, Transform, BGL_COMPONENT_TRANSFORM);
+    const Velocity* velocities = ECS_ITER_COLUMN(iter, Velocity, BGL_COMPONENT_VELOCITY);
+    const f32 dt = iter->delta_time;
+
+    for(u32 i = 0; i < iter->count; i++)
+    {
+        // resting bodies don't touch their transform so dependant systems can skip them
+        const vec3 l = velocities[i].linear, a = velocities[i].angular;
+        if(l.x == 0.0f && l.y == 0.0f && l.z == 0.0f && a.x == 0.0f && a.y == 0.0f && a.z == 0.0f) continue;
+
+        transforms[i].pos = vec3_add(transforms[i].pos, vec3_scale(velocities[i].linear, dt));
+        transforms[i].euler = vec3_add(transforms[i].euler, vec3_scale(velocities[i].angular, dt));
+        ecs_iter_mark_changed(iter, BGL_COMPONENT_TRANSFORM, i);
+    }
+}
+
+void physics_world_create(PhysicsWorld* self)
+{
+    memset(self, 0, sizeof(PhysicsWorld));
+    aabb_tree_create(&self->static_tree, 0.0f);
+    aabb_tree_create(&self->dynamic_tree, DYNAMIC_TREE_MARGIN);
+    self->static_epoch = 1;
+    self->gravity = VEC3(0.0f, -9.81f, 0.0f);
+    self->fixed_dt = BGL_PHYSICS_FIXED_DT;
+    self->max_substeps = BGL_PHYSICS_MAX_SUBSTEPS;
+}
+
+void physics_world_free(PhysicsWorld* self)
+{
+    if(self->proxies != NULL) BGL_FREE(self->proxies);
+    if(self->free_proxies != NULL) BGL_FREE(self->free_proxies);
+    if(self->sap != NULL) BGL_FREE(self->sap);
+    if(self->pairs != NULL) BGL_FREE(self->pairs);
+    if(self->shapes != NULL) BGL_FREE(self->shapes);
+    if(self->kind_pairs != NULL) BGL_FREE(self->kind_pairs);
+    if(self->manifolds != NULL) BGL_FREE(self->manifolds);
+    if(self->static_candidates != NULL) BGL_FREE(self->static_candidates);
+    if(self->bodies != NULL) BGL_FREE(self->bodies);
+    if(self->body_states != NULL) BGL_FREE(self->body_states);
+    if(self->awake_bodies != NULL) BGL_FREE(self->awake_bodies);
+    if(self->wake_queue != NULL) BGL_FREE(self->wake_queue);
+    if(self->contacts != NULL) BGL_FREE(self->contacts);
+    if(self->contact_scratch != NULL) BGL_FREE(self->contact_scratch);
+    if(self->contact_table != NULL) BGL_FREE(self->contact_table);
+    if(self->islands != NULL) BGL_FREE(self->islands);
+    if(self->island_bodies != NULL) BGL_FREE(self->island_bodies);
+    if(self->fast_bodies != NULL) BGL_FREE(self->fast_bodies);
+    if(self->meshes != NULL) BGL_FREE(self->meshes);
+    aabb_tree_free(&self->static_tree);
+    aabb_tree_free(&self->dynamic_tree);
+    memset(self, 0, sizeof(PhysicsWorld));
+}
+
+u32 physics_world_add_mesh(PhysicsWorld* self, const TriangleMesh* mesh)
+{
+    ecs_grow((void**)&self->meshes, &self->mesh_capacity, self->mesh_count + 1, sizeof(TriangleMesh*));
+    self->meshes[self->mesh_count] = mesh;
+    return self->mesh_count++;
+}
+
+void physics_world_step(PhysicsWorld* self, World* world, f32 delta_time)
+{
+    physics_world_sync(self, world);
+    self->narrowphase_time = 0.0;
+    self->solver_time = 0.0;
+    self->integrate_time = 0.0;
+
+    self->accumulator = MIN(self->accumulator + delta_time, self->fixed_dt * (f32)self->max_substeps);
+    self->substep_count = 0;
+    while(self->accumulator >= self->fixed_dt * STEP_TOLERANCE)
+    {
+        physics_world_simulate(self);
+        self->accumulator = MAX(self->accumulator - self->fixed_dt, 0.0f);
+        self->substep_count++;
+    }
+
+    f64 start_time = platform_get_time();
+
+    /* the write back is stamped with its own tick, so the next sync doesn't take it for outside changes */
+    const ComponentMask mask = BGL_COMPONENT_BIT(BGL_COMPONENT_RIGID_BODY) | BGL_COMPONENT_BIT(BGL_COMPONENT_COLLIDER) |
+                               BGL_COMPONENT_BIT(BGL_COMPONENT_TRANSFORM) | BGL_COMPONENT_BIT(BGL_COMPONENT_MODEL_MATRIX);
+    self->last_tick = ecs_query_since(world, mask, self->last_tick, physics_write_bodies, self);
+
+    self->integrate_time += (platform_get_time() - start_time) * 1000.0;
+}
+
+void physics_world_update_broadphase(PhysicsWorld* self, World* world)
+{
+    physics_world_sync(self, world);
+    physics_find_pairs(self);
+}
+
+void physics_world_update_narrowphase(PhysicsWorld* self)
+{
+    f64 start_time = platform_get_time();
+
+    /* counting sort the pairs by kind so each kernel gets one contiguous run */
+    u32 counts[BGL_NARROWPHASE_KIND_COUNT] = { 0 };
+    for(u32 i = 0; i < self->pair_count; i++)
+    {
+        bool swap;
+        counts[narrowphase_pair_kind(self->shapes[self->pairs[i].proxy_a].type, self->shapes[self->pairs[i].proxy_b].type, &swap)]++;
+    }
+
+    u32 offsets[BGL_NARROWPHASE_KIND_COUNT];
+    u32 offset = 0;
+    for(u32 kind = 0; kind < BGL_NARROWPHASE_KIND_COUNT; kind++)
+    {
+        offsets[kind] = offset;
+        offset += counts[kind];
+    }
+
+    ecs_grow((void**)&self->kind_pairs, &self->kind_pair_capacity, self->pair_count, sizeof(PhysicsPair));
+    for(u32 i = 0; i < self->pair_count; i++)
+    {
+        const PhysicsPair* pair = &self->pairs[i];
+        bool swap;
+        NarrowphaseKind kind = narrowphase_pair_kind(self->shapes[pair->proxy_a].type, self->shapes[pair->proxy_b].type, &swap);
+        self->kind_pairs[offsets[kind]++] = swap ? (PhysicsPair){ pair->b, pair->a, pair->proxy_b, pair->proxy_a } : *pair;
+    }
+
+    ecs_grow((void**)&self->manifolds, &self->manifold_capacity, self->pair_count, sizeof(ContactManifold));
+    self->manifold_count = 0;
+    for(u32 kind = 0; kind < BGL_NARROWPHASE_KIND_COUNT; kind++)
+    {
+        const PhysicsPair* pairs = &self->kind_pairs[offsets[kind] - counts[kind]];
+        self->manifold_count += narrowphase_collide(kind, self->shapes, pairs, counts[kind], &self->manifolds[self->manifold_count]);
+    }
+
+    self->narrowphase_time += (platform_get_time() - start_time) * 1000.0;
+}
+
+u32 physics_world_query_overlap(const PhysicsWorld* self, const vec3* mins, const vec3* maxs, u32 count, AABBTreeHit* hits_out, u32 max_hits)
+{
+    u32 total = 0;
+    for(u32 i = 0; i < count; i++)
+    {
+        total = aabb_tree_overlap_impl(&self->static_tree, self->proxies, mins[i], maxs[i], i, hits_out, total, max_hits);
+        total = aabb_tree_overlap_impl(&self->dynamic_tree, self->proxies, mins[i], maxs[i], i, hits_out, total, max_hits);
+    }
+    return total;
+}
+
+u32 physics_world_raycast(const PhysicsWorld* self, const vec3* origins, const vec3* dirs, u32 count, f32 max_t, AABBTreeHit* hits_out, u32 max_hits)
+{
+    u32 total = 0;
+    for(u32 i = 0; i < count; i++)
+    {
+        total = aabb_tree_raycast_impl(&self->static_tree, self->proxies, origins[i], dirs[i], max_t, i, hits_out, total, max_hits);
+        total = aabb_tree_raycast_impl(&self->dynamic_tree, self->proxies, origins[i], dirs[i], max_t, i, hits_out, total, max_hits);
+    }
+    return total;
+}
+
+u32 physics_world_query_frustum(const PhysicsWorld* self, const vec4* planes, AABBTreeHit* hits_out, u32 max_hits)
+{
+    u32 total = aabb_tree_frustum_impl(&self->static_tree, self->proxies, planes, hits_out, 0, max_hits);
+    return aabb_tree_frustum_impl(&self->dynamic_tree, self->proxies, planes, hits_out, total, max_hits);
+}
+
+Collider collider_sphere(vec3 offset, f32 radius)
+{
+    return (Collider){ .type = BGL_COLLIDER_SPHERE, .offset = offset, .radius = radius };
+}
+
+Collider collider_aabb(vec3 offset, vec3 half_extents)
+{
+    return (Collider){ .type = BGL_COLLIDER_AABB, .offset = offset, .half_extents = half_extents };
+}
+
+Collider collider_obb(vec3 offset, vec3 half_extents)
+{
+    return (Collider){ .type = BGL_COLLIDER_OBB, .offset = offset, .half_extents = half_extents };
+}
+
+Collider collider_capsule(vec3 offset, f32 radius, f32 half_height)
+{
+    return (Collider){ .type = BGL_COLLIDER_CAPSULE, .offset = offset, .radius = radius, .half_height = half_height };
+}
+
+Collider collider_mesh(u32 mesh, const TriangleMesh* triangles)
+{
+    vec3 min, max;
+    triangle_mesh_get_bounds(triangles, &min, &max);
+    return (Collider){
+        .type = BGL_COLLIDER_MESH,
+        .flags = BGL_COLLIDER_STATIC,
+        .offset = vec3_scale(vec3_add(min, max), 0.5f),
+        .half_extents = vec3_scale(vec3_sub(max, min), 0.5f),
+        .mesh = mesh,
+    };
+}
+
+RigidBody rigid_body_create(f32 mass)
+{
+    return (RigidBody){
+        .mass = mass,
+        .friction = 0.6f,
+        .restitution = 0.0f,
+        .rolling_friction = 0.05f,
+        .linear_damping = 0.05f,
+        .angular_damping = 0.05f,
+        .gravity_scale = 1.0f,
+        .flags = mass > 0.0f ? 0 : BGL_RIGID_BODY_KINEMATIC,
+    };
+}
+
+void collider_compute_bounds(const Collider* collider, const mat4* model, vec3* min_out, vec3* max_out)
+{
+    const vec3 scale = VEC3(sqrtf(vec3_dot(VEC4TOVEC3(model->cols[0]), VEC4TOVEC3(model->cols[0]))),
+                            sqrtf(vec3_dot(VEC4TOVEC3(model->cols[1]), VEC4TOVEC3(model->cols[1]))),
+                            sqrtf(vec3_dot(VEC4TOVEC3(model->cols[2]), VEC4TOVEC3(model->cols[2]))));
+    const f32 max_scale = MAX(scale.x, MAX(scale.y, scale.z));
+
+    vec3 centre = VEC4TOVEC3(model->cols[3]);
+    for(u32 i = 0; i < 3; i++)
+    {
+        centre = vec3_add(centre, vec3_scale(VEC4TOVEC3(model->cols[i]), collider->offset.data[i]));
+    }
+
+    switch(collider->type)
+    {
+        case BGL_COLLIDER_SPHERE:
+        {
+            f32 r = collider->radius * max_scale;
+            *min_out = vec3_add_scalar(centre, -r);
+            *max_out = vec3_add_scalar(centre, r);
+        } break;
+
+        case BGL_COLLIDER_AABB:
+        {
+            vec3 half = VEC3(collider->half_extents.x * scale.x, collider->half_extents.y * scale.y, collider->half_extents.z * scale.z);
+            *min_out = vec3_sub(centre, half);
+            *max_out = vec3_add(centre, half);
+        } break;
+
+        case BGL_COLLIDER_OBB:
+        case BGL_COLLIDER_MESH:
+        {
+            mat4_transform_aabb(min_out, max_out, *model,
+                                vec3_sub(collider->offset, collider->half_extents), vec3_add(collider->offset, collider->half_extents));
+        } break;
+
+        case BGL_COLLIDER_CAPSULE:
+        {
+            vec3 axis = vec3_scale(VEC4TOVEC3(model->cols[1]), collider->half_height);
+            vec3 a = vec3_add(centre, axis), b = vec3_sub(centre, axis);
+            f32 r = collider->radius * max_scale;
+            *min_out = vec3_add_scalar(VEC3(MIN(a.x, b.x), MIN(a.y, b.y), MIN(a.z, b.z)), -r);
+            *max_out = vec3_add_scalar(VEC3(MAX(a.x, b.x), MAX(a.y, b.y), MAX(a.z, b.z)), r);
+        } break;
+    }
+}
+
+void aabb_tree_create(AABBTree* self, f32 margin)
+{
+    memset(self, 0, sizeof(AABBTree));
+    self->root = BGL_AABB_TREE_NULL;
+    self->free_list = BGL_AABB_TREE_NULL;
+    self->margin = margin;
+}
+
+void aabb_tree_free(AABBTree* self)
+{
+    if(self->nodes != NULL) BGL_FREE(self->nodes);
+    aabb_tree_create(self, self->margin);
+}
+
+u32 aabb_tree_insert(AABBTree* self, vec3 min, vec3 max, u32 user)
+{
+    u32 leaf = aabb_tree_alloc_node(self);
+    AABBTreeNode* node = &self->nodes[leaf];
+    node->min = vec3_add_scalar(min, -self->margin);
+    node->max = vec3_add_scalar(max, self->margin);
+    node->user = user;
+
+    aabb_tree_insert_leaf(self, leaf);
+    self->leaf_count++;
+    BGL_ASSERT(self->nodes[self->root].height < BGL_AABB_TREE_MAX_DEPTH - 1, "aabb tree is too deep to traverse");
+    return leaf;
+}
+
+void aabb_tree_remove(AABBTree* self, u32 leaf)
+{
+    BGL_ASSERT(leaf < self->node_count && self->nodes[leaf].height == 0, "aabb tree node %u is not a leaf", leaf);
+
+    aabb_tree_remove_leaf(self, leaf);
+    aabb_tree_free_node(self, leaf);
+    self->leaf_count--;
+}
+
+bool aabb_tree_move(AABBTree* self, u32 leaf, vec3 min, vec3 max, vec3 displacement)
+{
+    BGL_ASSERT(leaf < self->node_count && self->nodes[leaf].height == 0, "aabb tree node %u is not a leaf", leaf);
+
+    AABBTreeNode* node = &self->nodes[leaf];
+    if(aabb_contains(node->min, node->max, min, max)) return false;
+
+    aabb_tree_remove_leaf(self, leaf);
+
+    /* stretch towards where the leaf is heading so it stays inside for a few more steps */
+    node->min = vec3_add_scalar(min, -self->margin);
+    node->max = vec3_add_scalar(max, self->margin);
+    for(u32 i = 0; i < 3; i++)
+    {
+        f32 d = displacement.data[i] * DYNAMIC_TREE_DISPLACEMENT_SCALE;
+        if(d < 0.0f) node->min.data[i] += d;
+        else node->max.data[i] += d;
+    }
+
+    aabb_tree_insert_leaf(self, leaf);
+    return true;
+}
+
+u32 aabb_tree_query_overlap(const AABBTree* self, const vec3* mins, const vec3* maxs, u32 count, AABBTreeHit* hits_out, u32 max_hits)
+{
+    u32 total = 0;
+    for(u32 i = 0; i < count; i++)
+    {
+        total = aabb_tree_overlap_impl(self, NULL, mins[i], maxs[i], i, hits_out, total, max_hits);
+    }
+    return total;
+}
+
+u32 aabb_tree_raycast(const AABBTree* self, const vec3* origins, const vec3* dirs, u32 count, f32 max_t, AABBTreeHit* hits_out, u32 max_hits)
+{
+    u32 total = 0;
+    for(u32 i = 0; i < count; i++)
+    {
+        total = aabb_tree_raycast_impl(self, NULL, origins[i], dirs[i], max_t, i, hits_out, total, max_hits);
+    }
+    return total;
+}
+
+u32 aabb_tree_query_frustum(const AABBTree* self, const vec4* planes, AABBTreeHit* hits_out, u32 max_hits)
+{
+    return aabb_tree_frustum_impl(self, NULL, planes, hits_out, 0, max_hits);
+}
+
+void physics_world_sync(PhysicsWorld* self, World* world)
+{
+    f64 start_time = platform_get_time();
+
+    self->step++;
+    self->last_tick = ecs_query_since(world, BGL_COMPONENT_BIT(BGL_COMPONENT_COLLIDER) | BGL_COMPONENT_BIT(BGL_COMPONENT_MODEL_MATRIX),
+                                      self->last_tick, physics_sync_colliders, self);
+    physics_remove_unseen_proxies(self);
+    physics_process_wake_queue(self);
+    physics_compact_awake(self);
+
+    self->broadphase_time = (platform_get_time() - start_time) * 1000.0;
+}
+
+void physics_world_simulate(PhysicsWorld* self)
+{
+    for(u32 i = 0; i < self->awake_count; i++)
+    {
+        const SolverBody* body = &self->bodies[self->awake_bodies[i]];
+        PhysicsBodyState* state = &self->body_states[self->awake_bodies[i]];
+        state->prev_pos = body->pos;
+        state->prev_rot = body->rot;
+    }
+
+    physics_find_pairs(self);
+    physics_world_update_narrowphase(self);
+
+    f64 start_time = platform_get_time();
+
+    physics_build_islands(self, physics_build_contacts(self));
+    jobs_parallel_for(self->island_count, ISLAND_BATCH_SIZE, physics_solve_islands, self);
+
+    f64 integrate_start = platform_get_time();
+    physics_sweep_fast_bodies(self);
+    physics_update_bodies(self);
+    f64 integrate_end = platform_get_time();
+    self->integrate_time += (integrate_end - integrate_start) * 1000.0;
+
+    bool slept = false;
+    for(u32 i = 0; i < self->island_count; i++)
+    {
+        if(self->islands[i].sleep_time < TIME_TO_SLEEP) continue;
+        physics_sleep_island(self, &self->islands[i]);
+        slept = true;
+    }
+
+    /* bodies touched while asleep had no contacts with the rest of their island, so they join the next step */
+    if(self->wake_count > 0) physics_process_wake_queue(self);
+    if(slept) physics_compact_awake(self);
+
+    self->solver_time += (platform_get_time() - start_time - (integrate_end - integrate_start)) * 1000.0;
+}
+
+void physics_find_pairs(PhysicsWorld* self)
+{
+    f64 start_time = platform_get_time();
+
+    physics_compact_sap(self);
+    bool axis_changed = physics_choose_axis(self);
+    physics_gather_sap(self);
+    physics_sort_sap(self, axis_changed || self->sap_unsorted * SAP_RESORT_FRACTION > self->sap_count);
+
+    self->pair_count = 0;
+    physics_sweep(self);
+    physics_find_static_pairs(self);
+
+    self->broadphase_time += (platform_get_time() - start_time) * 1000.0;
+}
+
+void physics_sync_colliders(ECSIter* iter)
+{
+    PhysicsWorld* self = (PhysicsWorld*)iter->user;
+    Collider* colliders = ECS_ITER_COLUMN(iter, Collider, BGL_COMPONENT_COLLIDER);
+    const mat4* matrices = ECS_ITER_COLUMN(iter, mat4, BGL_COMPONENT_MODEL_MATRIX);
+    const Entity* entities = ecs_iter_entities(iter);
+
+    const ComponentMask mask = iter->archetype->mask;
+    const bool has_bodies = (mask & BGL_COMPONENT_BIT(BGL_COMPONENT_RIGID_BODY)) && (mask & BGL_COMPONENT_BIT(BGL_COMPONENT_TRANSFORM));
+    const RigidBody* rigid_bodies = has_bodies ? ECS_ITER_COLUMN(iter, RigidBody, BGL_COMPONENT_RIGID_BODY) : NULL;
+    const Velocity* velocities = (mask & BGL_COMPONENT_BIT(BGL_COMPONENT_VELOCITY)) ? ECS_ITER_COLUMN(iter, Velocity, BGL_COMPONENT_VELOCITY) : NULL;
+
+    for(u32 i = 0; i < iter->count; i++)
+    {
+        Collider* collider = &colliders[i];
+        bool collider_static = (collider->flags & BGL_COLLIDER_STATIC) != 0;
+        const RigidBody* rigid_body = has_bodies && !collider_static ? &rigid_bodies[i] : NULL;
+
+        /* handles can be stale after copying a collider or loading a snapshot, so check the proxy is ours */
+        bool fresh = collider->proxy == 0 || collider->proxy > self->proxy_count ||
+                     self->proxies[collider->proxy - 1].entity != entities[i];
+        if(fresh) collider->proxy = physics_alloc_proxy(self, entities[i], collider_static) + 1;
+
+        u32 index = collider->proxy - 1;
+        BroadphaseProxy* proxy = &self->proxies[index];
+        SolverBody* body = &self->bodies[index];
+        proxy->seen = self->step;
+
+        /* bodies own their pose, their model matrix only changes because of the write back */
+        bool was_body = (body->flags & (BGL_SOLVER_BODY_DYNAMIC | BGL_SOLVER_BODY_KINEMATIC)) != 0;
+        bool changed = fresh || was_body != (rigid_body != NULL) || ecs_iter_changed(iter, BGL_COMPONENT_COLLIDER, i);
+        if(rigid_body != NULL) changed = changed || ecs_iter_changed(iter, BGL_COMPONENT_TRANSFORM, i) || ecs_iter_changed(iter, BGL_COMPONENT_RIGID_BODY, i);
+        else changed = changed || ecs_iter_changed(iter, BGL_COMPONENT_MODEL_MATRIX, i);
+
+        if(!changed)
+        {
+            if(rigid_body == NULL) body->flags &= ~(u32)BGL_SOLVER_BODY_MOVED; // only wakes bodies in the frame it moved
+            continue;
+        }
+
+        /* poking a sleeping body wakes everything it fell asleep with */
+        if(body->flags & BGL_SOLVER_BODY_SLEEPING) physics_wake_island(self, index);
+
+        collider_compute_bounds(collider, &matrices[i], &collider->bounds_min, &collider->bounds_max);
+        collider_compute_shape(collider, &matrices[i], &self->shapes[index]);
+        if(collider->type == BGL_COLLIDER_MESH) self->shapes[index].mesh = collider->mesh < self->mesh_count ? self->meshes[collider->mesh] : NULL;
+        physics_load_body(self, index, collider, &matrices[i], rigid_body, velocities != NULL ? &velocities[i] : NULL, fresh);
+
+        /* sleeping bodies are static until woken */
+        bool is_static = rigid_body != NULL ? (body->flags & BGL_SOLVER_BODY_SLEEPING) != 0 : collider_static;
+        if(proxy->is_static != is_static) physics_set_proxy_static(self, index, is_static);
+
+        /* level geometry moving around under sleeping bodies has to wake them, nothing else would */
+        bool wake_around = collider_static && !fresh;
+        if(wake_around) physics_queue_overlapping(self, proxy->min, proxy->max);
+
+        physics_update_proxy_leaf(self, index, collider->bounds_min, collider->bounds_max);
+
+        proxy->min = collider->bounds_min;
+        proxy->max = collider->bounds_max;
+        proxy->layer = collider->layer;
+        proxy->ignore = collider->ignore;
+        if(wake_around) physics_queue_overlapping(self, proxy->min, proxy->max);
+    }
+}
+
+void physics_write_bodies(ECSIter* iter)
+{
+    PhysicsWorld* self = (PhysicsWorld*)iter->user;
+    Transform* transforms = ECS_ITER_COLUMN(iter, Transform, BGL_COMPONENT_TRANSFORM);
+    mat4* matrices = ECS_ITER_COLUMN(iter, mat4, BGL_COMPONENT_MODEL_MATRIX);
+    RigidBody* rigid_bodies = ECS_ITER_COLUMN(iter, RigidBody, BGL_COMPONENT_RIGID_BODY);
+    Collider* colliders = ECS_ITER_COLUMN(iter, Collider, BGL_COMPONENT_COLLIDER);
+    const Entity* entities = ecs_iter_entities(iter);
+
+    /* show the pose part way from the last step to the next, by how much time is left over */
+    const f32 alpha = CLAMP(self->accumulator / self->fixed_dt, 0.0f, 1.0f);
+
+    for(u32 i = 0; i < iter->count; i++)
+    {
+        Collider* collider = &colliders[i];
+        if(collider->proxy == 0 || collider->proxy > self->proxy_count) continue;
+
+        const u32 index = collider->proxy - 1;
+        SolverBody* body = &self->bodies[index];
+        if(self->proxies[index].entity != entities[i] || !(body->flags & (BGL_SOLVER_BODY_DYNAMIC | BGL_SOLVER_BODY_KINEMATIC))) continue;
+
+        /* awake dynamic bodies move every step, the rest only when flagged */
+        bool awake_dynamic = (body->flags & (BGL_SOLVER_BODY_DYNAMIC | BGL_SOLVER_BODY_SLEEPING)) == BGL_SOLVER_BODY_DYNAMIC;
+        if(!awake_dynamic && !(body->flags & BGL_SOLVER_BODY_MOVED)) continue;
+
+        const PhysicsBodyState* state = &self->body_states[index];
+        const vec3 pos = vec3_add(state->prev_pos, vec3_scale(vec3_sub(body->pos, state->prev_pos), alpha));
+        const vec4 rot = quat_nlerp(state->prev_rot, body->rot, alpha);
+
+        Transform* transform = &transforms[i];
+        mat4* model = &matrices[i];
+        transform->pos = vec3_sub(pos, quat_rotate(rot, state->com_offset));
+        if(!(body->flags & BGL_SOLVER_BODY_LOCK_ROTATION))
+        {
+            vec3 euler = quat_to_euler(rot);
+            transform->euler = VEC3(DEGREES(euler.x), DEGREES(euler.y), DEGREES(euler.z));
+
+            mat3 basis;
+            quat_to_mat3(&basis, rot);
+            for(u32 j = 0; j < 3; j++)
+            {
+                vec3 col = vec3_scale(basis.cols[j], transform->scale.data[j]);
+                model->cols[j] = VEC3TOVEC4(col, 0.0f);
+            }
+        }
+        model->cols[3] = VEC3TOVEC4(transform->pos, 1.0f);
+
+        RigidBody* rigid_body = &rigid_bodies[i];
+        rigid_body->linear_velocity = body->linear_velocity;
+        rigid_body->angular_velocity = body->angular_velocity;
+        if(body->flags & BGL_SOLVER_BODY_SLEEPING) rigid_body->flags |= BGL_RIGID_BODY_SLEEPING;
+        else rigid_body->flags &= (RigidBodyFlags)~BGL_RIGID_BODY_SLEEPING;
+
+        collider->bounds_min = self->proxies[index].min;
+        collider->bounds_max = self->proxies[index].max;
+
+        ecs_iter_mark_changed(iter, BGL_COMPONENT_TRANSFORM, i);
+        ecs_iter_mark_changed(iter, BGL_COMPONENT_MODEL_MATRIX, i);
+        ecs_iter_mark_changed(iter, BGL_COMPONENT_RIGID_BODY, i);
+        body->flags &= ~(u32)BGL_SOLVER_BODY_MOVED;
+    }
+}
+
+u32 physics_alloc_proxy(PhysicsWorld* self, Entity entity, bool is_static)
+{
+    u32 index;
+    if(self->free_proxy_count > 0)
+    {
+        index = self->free_proxies[--self->free_proxy_count];
+    }
+    else
+    {
+        ecs_grow((void**)&self->proxies, &self->proxy_capacity, self->proxy_count + 1, sizeof(BroadphaseProxy));
+        ecs_grow((void**)&self->shapes, &self->shape_capacity, self->proxy_count + 1, sizeof(CollisionShape));
+        ecs_grow((void**)&self->bodies, &self->body_capacity, self->proxy_count + 1, sizeof(SolverBody));
+        ecs_grow((void**)&self->body_states, &self->body_state_capacity, self->proxy_count + 1, sizeof(PhysicsBodyState));
+        index = self->proxy_count++;
+    }
+    memset(&self->bodies[index], 0, sizeof(SolverBody));
+    memset(&self->body_states[index], 0, sizeof(PhysicsBodyState));
+    self->body_states[index].sleep_next = index;
+
+    self->proxies[index].entity = entity;
+    self->proxies[index].is_static = is_static;
+    self->proxies[index].leaf = BGL_AABB_TREE_NULL; // inserted once the bounds are known
+    self->proxies[index].static_count = 0;
+    self->proxies[index].static_epoch = 0;
+
+    if(is_static) return index;
+
+    /* new entries go on the end, the next sort moves them into place */
+    ecs_grow((void**)&self->sap, &self->sap_capacity, self->sap_count + 1, sizeof(SAPEntry));
+    self->sap[self->sap_count++].proxy = index;
+    self->sap_unsorted++;
+
+    return index;
+}
+
+/* move between trees, and in or out of the sap. the leaf is inserted again by physics_update_proxy_leaf */
+void physics_set_proxy_static(PhysicsWorld* self, u32 index, bool is_static)
+{
+    BroadphaseProxy* proxy = &self->proxies[index];
+    if(proxy->is_static == is_static) return;
+
+    /* the proxy might still have an entry from being made static, it has to go before adding another */
+    if(!is_static) physics_compact_sap(self);
+
+    if(proxy->is_static)
+    {
+        if(proxy->leaf != BGL_AABB_TREE_NULL) aabb_tree_remove(&self->static_tree, proxy->leaf);
+        self->static_epoch++;
+    }
+    else
+    {
+        if(proxy->leaf != BGL_AABB_TREE_NULL) aabb_tree_remove(&self->dynamic_tree, proxy->leaf);
+        self->static_candidate_live -= proxy->static_count;
+        proxy->static_count = 0;
+    }
+    proxy->leaf = BGL_AABB_TREE_NULL;
+    proxy->is_static = is_static;
+    if(is_static)
+    {
+        self->sap_compact = true;
+    }
+    else
+    {
+        ecs_grow((void**)&self->sap, &self->sap_capacity, self->sap_count + 1, sizeof(SAPEntry));
+        self->sap[self->sap_count++].proxy = index;
+        self->sap_unsorted++;
+    }
+}
+
+void physics_update_proxy_leaf(PhysicsWorld* self, u32 index, vec3 min, vec3 max)
+{
+    BroadphaseProxy* proxy = &self->proxies[index];
+    AABBTree* tree = proxy->is_static ? &self->static_tree : &self->dynamic_tree;
+
+    bool tree_changed;
+    if(proxy->leaf == BGL_AABB_TREE_NULL)
+    {
+        proxy->leaf = aabb_tree_insert(tree, min, max, index);
+        tree_changed = true;
+    }
+    else
+    {
+        /* static leaves aren't fattened, they are expected to stay put once moved */
+        vec3 displacement = proxy->is_static ? VEC3(0.0f, 0.0f, 0.0f) : vec3_sub(min, proxy->min);
+        tree_changed = aabb_tree_move(tree, proxy->leaf, min, max, displacement);
+    }
+    if(!tree_changed) return;
+
+    /* static changes invalidate every cache, dynamic ones just this proxy's */
+    if(proxy->is_static) self->static_epoch++;
+    else proxy->static_epoch = 0;
+}
+
+void physics_remove_unseen_proxies(PhysicsWorld* self)
+{
+    for(u32 i = 0; i < self->proxy_count; i++)
+    {
+        BroadphaseProxy* proxy = &self->proxies[i];
+        if(proxy->entity == BGL_ENTITY_NULL || proxy->seen == self->step) continue;
+
+        /* the rest of a sleeping island might be resting on it, static colliders could have anything on them */
+        SolverBody* body = &self->bodies[i];
+        if(body->flags & BGL_SOLVER_BODY_SLEEPING) physics_wake_island(self, i);
+        else if(proxy->is_static) physics_queue_overlapping(self, proxy->min, proxy->max);
+        body->flags = 0;
+
+        if(proxy->is_static)
+        {
+            if(proxy->leaf != BGL_AABB_TREE_NULL) aabb_tree_remove(&self->static_tree, proxy->leaf);
+            self->static_epoch++;
+        }
+        else
+        {
+            if(proxy->leaf != BGL_AABB_TREE_NULL) aabb_tree_remove(&self->dynamic_tree, proxy->leaf);
+            self->static_candidate_live -= proxy->static_count;
+            proxy->static_count = 0;
+            self->sap_compact = true;
+        }
+        proxy->entity = BGL_ENTITY_NULL;
+        proxy->leaf = BGL_AABB_TREE_NULL;
+
+        ecs_grow((void**)&self->free_proxies, &self->free_proxy_capacity, self->free_proxy_count + 1, sizeof(u32));
+        self->free_proxies[self->free_proxy_count++] = i;
+    }
+
+    /* freed proxies can be reused by the next sync, their old entries must be gone by then */
+    physics_compact_sap(self);
+}
+
+/* drop the entries of removed and static proxies, keeping the rest in sorted order */
+void physics_compact_sap(PhysicsWorld* self)
+{
+    if(!self->sap_compact) return;
+
+    u32 kept = 0;
+    for(u32 i = 0; i < self->sap_count; i++)
+    {
+        const BroadphaseProxy* proxy = &self->proxies[self->sap[i].proxy];
+        if(proxy->entity != BGL_ENTITY_NULL && !proxy->is_static) self->sap[kept++] = self->sap[i];
+    }
+    self->sap_count = kept;
+    self->sap_compact = false;
+}
+
+void physics_load_body(PhysicsWorld* self, u32 index, const Collider* collider, const mat4* model, const RigidBody* rigid_body, const Velocity* velocity, bool fresh)
+{
+    SolverBody* body = &self->bodies[index];
+    PhysicsBodyState* state = &self->body_states[index];
+    const CollisionShape* shape = &self->shapes[index];
+
+    body->pos = shape->centre;
+
+    /* colliders without a body only ever push, the solver never turns them or reads their rotation */
+    if(rigid_body == NULL)
+    {
+        const bool was_body = (body->flags & (BGL_SOLVER_BODY_DYNAMIC | BGL_SOLVER_BODY_KINEMATIC)) != 0;
+        body->linear_velocity = velocity != NULL ? velocity->linear : VEC3(0.0f, 0.0f, 0.0f);
+        body->flags = BGL_SOLVER_BODY_MOVED;
+        if(!fresh && !was_body) return; // the rest was set when it was loaded first
+
+        body->rot = quat_identity();
+        body->angular_velocity = VEC3(0.0f, 0.0f, 0.0f);
+        body->inv_mass = 0.0f;
+        body->inv_inertia_local = VEC3(0.0f, 0.0f, 0.0f);
+        body->inv_inertia = (mat3){ 0 };
+        body->friction = DEFAULT_FRICTION;
+        body->restitution = 0.0f;
+        body->rolling_friction = 0.0f;
+        return;
+    }
+
+    body->inv_inertia = (mat3){ 0 };
+    state->sleep_time = 0.0f;
+    state->sleep_next = index;
+
+    /* the shape's axes are the model's without scale, aabb shapes have the world axes and don't turn */
+    mat3 basis = { .cols = { shape->axes[0], shape->axes[1], shape->axes[2] } };
+    body->rot = quat_from_mat3(basis);
+    body->linear_velocity = rigid_body->linear_velocity;
+    body->angular_velocity = rigid_body->angular_velocity;
+
+    vec4 inv_rot = VEC4(-body->rot.x, -body->rot.y, -body->rot.z, body->rot.w);
+    state->com_offset = quat_rotate(inv_rot, vec3_sub(shape->centre, VEC4TOVEC3(model->cols[3])));
+    state->prev_pos = body->pos;
+    state->prev_rot = body->rot;
+
+    const bool kinematic = (rigid_body->flags & BGL_RIGID_BODY_KINEMATIC) || rigid_body->mass <= 0.0f || collider->type == BGL_COLLIDER_MESH;
+    body->flags = kinematic ? BGL_SOLVER_BODY_KINEMATIC : BGL_SOLVER_BODY_DYNAMIC;
+    if(rigid_body->flags & BGL_RIGID_BODY_NEVER_SLEEP) body->flags |= BGL_SOLVER_BODY_NEVER_SLEEP;
+    if(rigid_body->flags & BGL_RIGID_BODY_FAST) body->flags |= BGL_SOLVER_BODY_FAST;
+    if(collider->type == BGL_COLLIDER_AABB) body->flags |= BGL_SOLVER_BODY_LOCK_ROTATION;
+
+    body->inv_mass = kinematic ? 0.0f : 1.0f / rigid_body->mass;
+    body->inv_inertia_local = kinematic || collider->type == BGL_COLLIDER_AABB ? VEC3(0.0f, 0.0f, 0.0f) : solver_shape_inv_inertia(shape, rigid_body->mass);
+    body->friction = rigid_body->friction;
+    body->restitution = rigid_body->restitution;
+    body->rolling_friction = rigid_body->rolling_friction;
+    body->linear_damping = rigid_body->linear_damping;
+    body->angular_damping = rigid_body->angular_damping;
+    body->gravity_scale = rigid_body->gravity_scale;
+
+    /* keep loaded piles asleep, they wake one body at a time since the islands they slept in are gone */
+    if(fresh && !kinematic && (rigid_body->flags & BGL_RIGID_BODY_SLEEPING))
+    {
+        body->flags |= BGL_SOLVER_BODY_SLEEPING;
+        return;
+    }
+
+    body->flags |= BGL_SOLVER_BODY_MOVED;
+    physics_add_awake(self, index);
+}
+
+void physics_add_awake(PhysicsWorld* self, u32 index)
+{
+    PhysicsBodyState* state = &self->body_states[index];
+    if(state->listed) return;
+
+    ecs_grow((void**)&self->awake_bodies, &self->awake_capacity, self->awake_count + 1, sizeof(u32));
+    self->awake_bodies[self->awake_count++] = index;
+    state->listed = true;
+}
+
+void physics_compact_awake(PhysicsWorld* self)
+{
+    u32 kept = 0;
+    for(u32 i = 0; i < self->awake_count; i++)
+    {
+        const u32 index = self->awake_bodies[i];
+        const u32 flags = self->bodies[index].flags;
+        if(self->proxies[index].entity != BGL_ENTITY_NULL && (flags & (BGL_SOLVER_BODY_DYNAMIC | BGL_SOLVER_BODY_KINEMATIC)) &&
+           !(flags & BGL_SOLVER_BODY_SLEEPING))
+        {
+            self->awake_bodies[kept++] = index;
+        }
+        else
+        {
+            self->body_states[index].listed = false;
+        }
+    }
+    self->awake_count = kept;
+}
+
+void physics_wake_island(PhysicsWorld* self, u32 index)
+{
+    if(!(self->bodies[index].flags & BGL_SOLVER_BODY_SLEEPING)) return;
+
+    u32 current = index;
+    do
+    {
+        SolverBody* body = &self->bodies[current];
+        PhysicsBodyState* state = &self->body_states[current];
+        const u32 next = state->sleep_next;
+
+        body->flags &= ~(u32)BGL_SOLVER_BODY_SLEEPING;
+        body->flags |= BGL_SOLVER_BODY_MOVED;
+        state->sleep_time = 0.0f;
+        state->sleep_next = current;
+
+        BroadphaseProxy* proxy = &self->proxies[current];
+        physics_set_proxy_static(self, current, false);
+        physics_update_proxy_leaf(self, current, proxy->min, proxy->max);
+        physics_add_awake(self, current);
+
+        current = next;
+    } while(current != index);
+}
+
+/* queue the sleeping bodies in the static tree touching the box */
+void physics_queue_overlapping(PhysicsWorld* self, vec3 min, vec3 max)
+{
+    if(self->static_tree.root == BGL_AABB_TREE_NULL) return;
+
+    u32 stack[BGL_AABB_TREE_MAX_DEPTH];
+    u32 top = 0;
+    stack[top++] = self->static_tree.root;
+    while(top > 0)
+    {
+        const AABBTreeNode* node = &self->static_tree.nodes[stack[--top]];
+        if(!aabb_overlap(min, max, node->min, node->max)) continue;
+
+        if(node->height > 0)
+        {
+            stack[top++] = node->child1;
+            stack[top++] = node->child2;
+            continue;
+        }
+        if(self->bodies[node->user].flags & BGL_SOLVER_BODY_SLEEPING) physics_queue_wake(self, node->user);
+    }
+}
+
+void physics_queue_wake(PhysicsWorld* self, u32 index)
+{
+    ecs_grow((void**)&self->wake_queue, &self->wake_capacity, self->wake_count + 1, sizeof(u32));
+    self->wake_queue[self->wake_count++] = index;
+}
+
+void physics_process_wake_queue(PhysicsWorld* self)
+{
+    for(u32 i = 0; i < self->wake_count; i++)
+    {
+        physics_wake_island(self, self->wake_queue[i]);
+    }
+    self->wake_count = 0;
+}
+
+void physics_sleep_island(PhysicsWorld* self, const PhysicsIsland* island)
+{
+    const u32* bodies = &self->island_bodies[island->body_first];
+    for(u32 i = 0; i < island->body_count; i++)
+    {
+        const u32 index = bodies[i];
+        SolverBody* body = &self->bodies[index];
+        PhysicsBodyState* state = &self->body_states[index];
+
+        body->flags |= BGL_SOLVER_BODY_SLEEPING | BGL_SOLVER_BODY_MOVED;
+        body->linear_velocity = VEC3(0.0f, 0.0f, 0.0f);
+        body->angular_velocity = VEC3(0.0f, 0.0f, 0.0f);
+        state->prev_pos = body->pos;
+        state->prev_rot = body->rot;
+        state->sleep_next = bodies[(i + 1) % island->body_count];
+
+        BroadphaseProxy* proxy = &self->proxies[index];
+        physics_set_proxy_static(self, index, true);
+        physics_update_proxy_leaf(self, index, proxy->min, proxy->max);
+    }
+}
+
+/* turn the manifolds into contacts, warm started from last step's contacts between the same bodies */
+u32 physics_build_contacts(PhysicsWorld* self)
+{
+    u32 table_size = 16;
+    while(table_size < 2 * self->contact_count) table_size *= 2;
+    const u32 mask = table_size - 1;
+
+    ecs_grow((void**)&self->contact_table, &self->contact_table_capacity, table_size, sizeof(u32));
+    memset(self->contact_table, 0xFF, table_size * sizeof(u32));
+    for(u32 i = 0; i < self->contact_count; i++)
+    {
+        u32 slot = physics_contact_slot(self->contacts[i].body_a, self->contacts[i].body_b, mask);
+        while(self->contact_table[slot] != CONTACT_TABLE_EMPTY) slot = (slot + 1) & mask;
+        self->contact_table[slot] = i;
+    }
+
+    ecs_grow((void**)&self->contact_scratch, &self->contact_scratch_capacity, self->manifold_count, sizeof(ContactConstraint));
+    u32 count = 0;
+    for(u32 i = 0; i < self->manifold_count; i++)
+    {
+        const ContactManifold* manifold = &self->manifolds[i];
+        const SolverBody* a = &self->bodies[manifold->proxy_a];
+        const SolverBody* b = &self->bodies[manifold->proxy_b];
+
+        if((a->flags | b->flags) & BGL_SOLVER_BODY_SLEEPING)
+        {
+            if((a->flags & BGL_SOLVER_BODY_SLEEPING) && physics_body_wakes_others(b)) physics_queue_wake(self, manifold->proxy_a);
+            if((b->flags & BGL_SOLVER_BODY_SLEEPING) && physics_body_wakes_others(a)) physics_queue_wake(self, manifold->proxy_b);
+            continue;
+        }
+        if(!((a->flags | b->flags) & BGL_SOLVER_BODY_DYNAMIC)) continue;
+
+        ContactConstraint* contact = &self->contact_scratch[count++];
+        solver_init_contact(contact, self->bodies, manifold);
+
+        u32 slot = physics_contact_slot(contact->body_a, contact->body_b, mask);
+        const ContactConstraint* prev = NULL;
+        for(; self->contact_table[slot] != CONTACT_TABLE_EMPTY; slot = (slot + 1) & mask)
+        {
+            const ContactConstraint* candidate = &self->contacts[self->contact_table[slot]];
+            if((candidate->body_a == contact->body_a && candidate->body_b == contact->body_b) ||
+               (candidate->body_a == contact->body_b && candidate->body_b == contact->body_a))
+            {
+                prev = candidate;
+                break;
+            }
+        }
+        if(prev == NULL) continue;
+
+        /* impulses are carried over as world vectors acting on b, the tangents might not match */
+        const f32 sign = prev->body_b == contact->body_b ? 1.0f : -1.0f;
+        contact->rolling_impulse = vec3_scale(prev->rolling_impulse, sign);
+        for(u32 j = 0; j < contact->point_count; j++)
+        {
+            ContactConstraintPoint* point = &contact->points[j];
+            for(u32 k = 0; k < prev->point_count; k++)
+            {
+                const ContactConstraintPoint* prev_point = &prev->points[k];
+                if(prev_point->id != point->id) continue;
+
+                vec3 impulse = vec3_scale(prev->normal, prev_point->normal_impulse);
+                impulse = vec3_add(impulse, vec3_scale(prev->tangents[0], prev_point->tangent_impulse[0]));
+                impulse = vec3_add(impulse, vec3_scale(prev->tangents[1], prev_point->tangent_impulse[1]));
+                impulse = vec3_scale(impulse, sign);
+
+                point->normal_impulse = MAX(vec3_dot(impulse, contact->normal), 0.0f);
+                point->tangent_impulse[0] = vec3_dot(impulse, contact->tangents[0]);
+                point->tangent_impulse[1] = vec3_dot(impulse, contact->tangents[1]);
+                break;
+            }
+        }
+    }
+    return count;
+}
+
+/* union find over contacts between awake bodies, then group bodies and contacts by island */
+void physics_build_islands(PhysicsWorld* self, u32 contact_count)
+{
+    PhysicsBodyState* states = self->body_states;
+    for(u32 i = 0; i < self->awake_count; i++)
+    {
+        const u32 index = self->awake_bodies[i];
+        states[index].island_parent = index;
+        states[index].island = ISLAND_NONE;
+    }
+
+    /* static and kinematic bodies don't join islands, they are only read by the solver */
+    for(u32 i = 0; i < contact_count; i++)
+    {
+        const ContactConstraint* contact = &self->contact_scratch[i];
+        if(!(self->bodies[contact->body_a].flags & self->bodies[contact->body_b].flags & BGL_SOLVER_BODY_DYNAMIC)) continue;
+
+        u32 root_a = physics_find_island(self, contact->body_a), root_b = physics_find_island(self, contact->body_b);
+        if(root_a != root_b) states[root_a].island_parent = root_b;
+    }
+
+    self->island_count = 0;
+    for(u32 i = 0; i < self->awake_count; i++)
+    {
+        const u32 index = self->awake_bodies[i];
+        if(!(self->bodies[index].flags & BGL_SOLVER_BODY_DYNAMIC)) continue;
+
+        u32 root = physics_find_island(self, index);
+        if(states[root].island == ISLAND_NONE) states[root].island = self->island_count++;
+        states[index].island = states[root].island;
+    }
+
+    /* islands is still NULL while nothing has been awake, and memset of NULL is undefined even for 0 bytes */
+    ecs_grow((void**)&self->islands, &self->island_capacity, self->island_count, sizeof(PhysicsIsland));
+    if(self->island_count > 0) memset(self->islands, 0, self->island_count * sizeof(PhysicsIsland));
+
+    /* counting sort bodies and contacts by island */
+    u32 body_count = 0;
+    for(u32 i = 0; i < self->awake_count; i++)
+    {
+        const u32 index = self->awake_bodies[i];
+        if(!(self->bodies[index].flags & BGL_SOLVER_BODY_DYNAMIC)) continue;
+        self->islands[states[index].island].body_count++;
+        body_count++;
+    }
+    for(u32 i = 0; i < contact_count; i++)
+    {
+        ContactConstraint* contact = &self->contact_scratch[i];
+        const u32 dynamic = (self->bodies[contact->body_a].flags & BGL_SOLVER_BODY_DYNAMIC) ? contact->body_a : contact->body_b;
+        contact->island = states[dynamic].island;
+        self->islands[contact->island].contact_count++;
+    }
+
+    u32 body_offset = 0, contact_offset = 0;
+    for(u32 i = 0; i < self->island_count; i++)
+    {
+        PhysicsIsland* island = &self->islands[i];
+        island->body_first = body_offset;
+        island->contact_first = contact_offset;
+        body_offset += island->body_count;
+        contact_offset += island->contact_count;
+        island->body_count = 0;
+        island->contact_count = 0;
+    }
+
+    ecs_grow((void**)&self->island_bodies, &self->island_body_capacity, body_count, sizeof(u32));
+    for(u32 i = 0; i < self->awake_count; i++)
+    {
+        const u32 index = self->awake_bodies[i];
+        if(!(self->bodies[index].flags & BGL_SOLVER_BODY_DYNAMIC)) continue;
+        PhysicsIsland* island = &self->islands[states[index].island];
+        self->island_bodies[island->body_first + island->body_count++] = index;
+    }
+
+    ecs_grow((void**)&self->contacts, &self->contact_capacity, contact_count, sizeof(ContactConstraint));
+    for(u32 i = 0; i < contact_count; i++)
+    {
+        PhysicsIsland* island = &self->islands[self->contact_scratch[i].island];
+        self->contacts[island->contact_first + island->contact_count++] = self->contact_scratch[i];
+    }
+    self->contact_count = contact_count;
+}
+
+u32 physics_find_island(PhysicsWorld* self, u32 index)
+{
+    /* path halving, every other node on the way points to its grandparent */
+    PhysicsBodyState* states = self->body_states;
+    while(states[index].island_parent != index)
+    {
+        states[index].island_parent = states[states[index].island_parent].island_parent;
+        index = states[index].island_parent;
+    }
+    return index;
+}
+
+/* islands share no dynamic bodies, so each batch has its bodies and contacts to itself */
+void physics_solve_islands(void* data, u32 start, u32 end, u32 worker)
+{
+    (void)worker;
+    PhysicsWorld* self = (PhysicsWorld*)data;
+    const f32 dt = self->fixed_dt;
+
+    for(u32 i = start; i < end; i++)
+    {
+        PhysicsIsland* island = &self->islands[i];
+        const u32* bodies = &self->island_bodies[island->body_first];
+        ContactConstraint* contacts = &self->contacts[island->contact_first];
+
+        solver_integrate_velocities(self->bodies, bodies, island->body_count, self->gravity, dt);
+        solver_prepare_contacts(self->bodies, contacts, island->contact_count, dt);
+        for(u32 iteration = 0; iteration < BGL_SOLVER_ITERATIONS; iteration++)
+        {
+            solver_solve_contacts(self->bodies, contacts, island->contact_count);
+        }
+        solver_integrate_positions(self->bodies, bodies, island->body_count, dt);
+
+        /* the island sleeps once every body in it has been still for long enough */
+        f32 sleep_time = FLT_MAX;
+        for(u32 j = 0; j < island->body_count; j++)
+        {
+            const SolverBody* body = &self->bodies[bodies[j]];
+            PhysicsBodyState* state = &self->body_states[bodies[j]];
+
+            bool still = !(body->flags & BGL_SOLVER_BODY_NEVER_SLEEP) &&
+                         vec3_dot(body->linear_velocity, body->linear_velocity) < SLEEP_LINEAR_VELOCITY * SLEEP_LINEAR_VELOCITY &&
+                         vec3_dot(body->angular_velocity, body->angular_velocity) < SLEEP_ANGULAR_VELOCITY * SLEEP_ANGULAR_VELOCITY;
+            state->sleep_time = still ? state->sleep_time + dt : 0.0f;
+            sleep_time = MIN(sleep_time, state->sleep_time);
+        }
+        island->sleep_time = sleep_time;
+    }
+}
+
+/* the shapes still hold every body's pose from before the step, so each fast body can be swept
+   from where it was to where the solver put it without seeing any other body's new pose */
+void physics_sweep_fast_bodies(PhysicsWorld* self)
+{
+    self->fast_body_count = 0;
+    for(u32 i = 0; i < self->awake_count; i++)
+    {
+        const u32 index = self->awake_bodies[i];
+        const SolverBody* body = &self->bodies[index];
+        if((body->flags & (BGL_SOLVER_BODY_FAST | BGL_SOLVER_BODY_DYNAMIC)) != (BGL_SOLVER_BODY_FAST | BGL_SOLVER_BODY_DYNAMIC)) continue;
+
+        /* bodies moving less than the swept sphere's radius keep their centre in front of anything they
+           were in front of, the discrete contacts handle them */
+        const f32 radius = physics_shape_inner_radius(&self->shapes[index]) * BGL_PHYSICS_CCD_RADIUS;
+        const vec3 motion = vec3_sub(body->pos, self->body_states[index].prev_pos);
+        if(vec3_dot(motion, motion) <= radius * radius) continue;
+
+        ecs_grow((void**)&self->fast_bodies, &self->fast_body_capacity, self->fast_body_count + 1, sizeof(u32));
+        self->fast_bodies[self->fast_body_count++] = index;
+    }
+    jobs_parallel_for(self->fast_body_count, FAST_BODY_BATCH_SIZE, physics_sweep_fast_batch, self);
+}
+
+/* bodies only read the shapes and write their own pose, so batches don't interfere */
+void physics_sweep_fast_batch(void* data, u32 start, u32 end, u32 worker)
+{
+    (void)worker;
+    PhysicsWorld* self = (PhysicsWorld*)data;
+    for(u32 i = start; i < end; i++)
+    {
+        const u32 index = self->fast_bodies[i];
+        SolverBody* body = &self->bodies[index];
+        const vec3 prev_pos = self->body_states[index].prev_pos;
+        const vec3 motion = vec3_sub(body->pos, prev_pos);
+        const f32 inner_radius = physics_shape_inner_radius(&self->shapes[index]);
+
+        CollisionShape sphere = {
+            .type = BGL_COLLIDER_SPHERE,
+            .centre = prev_pos,
+            .axes = { VEC3(1.0f, 0.0f, 0.0f), VEC3(0.0f, 1.0f, 0.0f), VEC3(0.0f, 0.0f, 1.0f) },
+            .radius = inner_radius * BGL_PHYSICS_CCD_RADIUS,
+        };
+        /* already touching at the start means it's in contact, the solver deals with that */
+        PhysicsHit hit;
+        if(!physics_world_shape_cast(self, &sphere, motion, 1.0f, index, &hit) || hit.t <= 0.0f) continue;
+
+        /* back off to where the inner sphere is just inside the surface, the velocity is left for
+           the contact found next step */
+        const f32 closing = -vec3_dot(motion, hit.normal);
+        const f32 back = MAX(inner_radius - CCD_DEPTH - sphere.radius, 0.0f);
+        f32 t = hit.t;
+        if(closing > 0.0f) t = MAX(t - back / closing, 0.0f);
+        body->pos = vec3_add(prev_pos, vec3_scale(motion, t));
+    }
+}
+
+/* move kinematic bodies, then bring the shapes and proxies of everything awake up to date */
+void physics_update_bodies(PhysicsWorld* self)
+{
+    const f32 dt = self->fixed_dt;
+    for(u32 i = 0; i < self->awake_count; i++)
+    {
+        const u32 index = self->awake_bodies[i];
+        SolverBody* body = &self->bodies[index];
+
+        if(body->flags & BGL_SOLVER_BODY_KINEMATIC)
+        {
+            if(!physics_body_wakes_others(body)) continue;
+            body->pos = vec3_add(body->pos, vec3_scale(body->linear_velocity, dt));
+            if(!(body->flags & BGL_SOLVER_BODY_LOCK_ROTATION)) body->rot = quat_integrate(body->rot, body->angular_velocity, dt);
+            body->flags |= BGL_SOLVER_BODY_MOVED;
+        }
+
+        CollisionShape* shape = &self->shapes[index];
+        shape->centre = body->pos;
+        if(!(body->flags & BGL_SOLVER_BODY_LOCK_ROTATION))
+        {
+            mat3 basis;
+            quat_to_mat3(&basis, body->rot);
+            shape->axes[0] = basis.cols[0];
+            shape->axes[1] = basis.cols[1];
+            shape->axes[2] = basis.cols[2];
+        }
+
+        vec3 min, max;
+        physics_shape_bounds(shape, &min, &max);
+        physics_update_proxy_leaf(self, index, min, max);
+
+        BroadphaseProxy* proxy = &self->proxies[index];
+        proxy->min = min;
+        proxy->max = max;
+    }
+}
+
+/* sweep along the axis the proxies are most spread out on, to keep the overlaps per entry low */
+bool physics_choose_axis(PhysicsWorld* self)
+{
+    if(self->sap_count < 2) return false;
+
+    vec3 sum = VEC3(0.0f, 0.0f, 0.0f), sum_sq = VEC3(0.0f, 0.0f, 0.0f);
+    for(u32 i = 0; i < self->proxy_count; i++)
+    {
+        const BroadphaseProxy* proxy = &self->proxies[i];
+        if(proxy->entity == BGL_ENTITY_NULL || proxy->is_static) continue;
+
+        vec3 centre = vec3_add(proxy->min, proxy->max); // 2x centre, doesn't matter for comparing
+        sum = vec3_add(sum, centre);
+        sum_sq = vec3_add(sum_sq, VEC3(centre.x * centre.x, centre.y * centre.y, centre.z * centre.z));
+    }
+
+    f32 inv_count = 1.0f / (f32)self->sap_count;
+    vec3 variance;
+    for(u32 i = 0; i < 3; i++)
+    {
+        variance.data[i] = sum_sq.data[i] * inv_count - (sum.data[i] * inv_count) * (sum.data[i] * inv_count);
+    }
+
+    u32 best = variance.x > variance.y ? (variance.x > variance.z ? 0 : 2) : (variance.y > variance.z ? 1 : 2);
+    if(best == self->sap_axis || variance.data[best] < variance.data[self->sap_axis] * SAP_AXIS_HYSTERESIS) return false;
+
+    self->sap_axis = best;
+    return true;
+}
+
+/* refresh the bounds stored next to the sort keys */
+void physics_gather_sap(PhysicsWorld* self)
+{
+    const u32 axis = self->sap_axis, axis1 = (axis + 1) % 3, axis2 = (axis + 2) % 3;
+    for(u32 i = 0; i < self->sap_count; i++)
+    {
+        SAPEntry* entry = &self->sap[i];
+        const BroadphaseProxy* proxy = &self->proxies[entry->proxy];
+        entry->min = proxy->min.data[axis];
+        entry->max = proxy->max.data[axis];
+        entry->min1 = proxy->min.data[axis1];
+        entry->max1 = proxy->max.data[axis1];
+        entry->min2 = proxy->min.data[axis2];
+        entry->max2 = proxy->max.data[axis2];
+    }
+}
+
+void physics_sort_sap(PhysicsWorld* self, bool full_sort)
+{
+    self->sap_unsorted = 0;
+
+    if(full_sort)
+    {
+        qsort(self->sap, self->sap_count, sizeof(SAPEntry), physics_sap_compare);
+        return;
+    }
+
+    /* entries barely move between steps, so this is close to linear */
+    for(u32 i = 1; i < self->sap_count; i++)
+    {
+        SAPEntry entry = self->sap[i];
+
+        u32 j = i;
+        while(j > 0 && self->sap[j - 1].min > entry.min)
+        {
+            self->sap[j] = self->sap[j - 1];
+            j--;
+        }
+        self->sap[j] = entry;
+    }
+}
+
+void physics_sweep(PhysicsWorld* self)
+{
+    const SAPEntry* sap = self->sap;
+    const u32 count = self->sap_count;
+
+    for(u32 i = 0; i < count; i++)
+    {
+        const SAPEntry a = sap[i];
+
+        for(u32 j = i + 1; j < count && sap[j].min <= a.max; j++)
+        {
+            /* non short circuiting, the result is hard to predict so a branch per axis costs more */
+            const SAPEntry* b = &sap[j];
+            if(!((a.min1 <= b->max1) & (b->min1 <= a.max1) & (a.min2 <= b->max2) & (b->min2 <= a.max2))) continue;
+
+            physics_add_pair(self, a.proxy, b->proxy);
+        }
+    }
+}
+
+/* static proxies aren't in the sap, so dynamic proxies test the static leaves they cached */
+void physics_find_static_pairs(PhysicsWorld* self)
+{
+    if(self->static_tree.root == BGL_AABB_TREE_NULL) return;
+
+    /* drop the replaced caches once they outnumber the live ones, everything is queried again */
+    if(self->static_candidate_count > 2 * self->static_candidate_live + 1024)
+    {
+        for(u32 i = 0; i < self->sap_count; i++) self->proxies[self->sap[i].proxy].static_count = 0;
+        self->static_candidate_count = 0;
+        self->static_candidate_live = 0;
+        self->static_epoch++;
+    }
+
+    for(u32 i = 0; i < self->sap_count; i++)
+    {
+        const u32 index = self->sap[i].proxy;
+        BroadphaseProxy* proxy = &self->proxies[index];
+
+        if(proxy->static_epoch != self->static_epoch)
+        {
+            /* anything overlapping the tight bounds later overlaps the fattened leaf until the leaf moves */
+            const vec3 min = self->dynamic_tree.nodes[proxy->leaf].min, max = self->dynamic_tree.nodes[proxy->leaf].max;
+            const u32 first = self->static_candidate_count;
+
+            u32 stack[BGL_AABB_TREE_MAX_DEPTH];
+            u32 top = 0;
+            stack[top++] = self->static_tree.root;
+            while(top > 0)
+            {
+                const AABBTreeNode* node = &self->static_tree.nodes[stack[--top]];
+                if(!aabb_overlap(min, max, node->min, node->max)) continue;
+
+                if(node->height > 0)
+                {
+                    stack[top++] = node->child1;
+                    stack[top++] = node->child2;
+                    continue;
+                }
+                ecs_grow((void**)&self->static_candidates, &self->static_candidate_capacity, self->static_candidate_count + 1, sizeof(u32));
+                self->static_candidates[self->static_candidate_count++] = node->user;
+            }
+
+            self->static_candidate_live += self->static_candidate_count - first;
+            self->static_candidate_live -= proxy->static_count;
+            proxy->static_first = first;
+            proxy->static_count = self->static_candidate_count - first;
+            proxy->static_epoch = self->static_epoch;
+        }
+
+        for(u32 j = 0; j < proxy->static_count; j++)
+        {
+            const u32 other = self->static_candidates[proxy->static_first + j];
+            const BroadphaseProxy* static_proxy = &self->proxies[other];
+            if(aabb_overlap(proxy->min, proxy->max, static_proxy->min, static_proxy->max)) physics_add_pair(self, index, other);
+        }
+    }
+}
+
+void physics_add_pair(PhysicsWorld* self, u32 proxy_a, u32 proxy_b)
+{
+    const BroadphaseProxy* a = &self->proxies[proxy_a];
+    const BroadphaseProxy* b = &self->proxies[proxy_b];
+    if((a->layer & b->ignore) || (b->layer & a->ignore)) return;
+
+    /* lower proxy first so pairs don't depend on the sort order */
+    if(proxy_a > proxy_b)
+    {
+        u32 temp = proxy_a;
+        proxy_a = proxy_b;
+        proxy_b = temp;
+    }
+
+    ecs_grow((void**)&self->pairs, &self->pair_capacity, self->pair_count + 1, sizeof(PhysicsPair));
+    self->pairs[self->pair_count++] = (PhysicsPair){
+        .a = self->proxies[proxy_a].entity,
+        .b = self->proxies[proxy_b].entity,
+        .proxy_a = proxy_a,
+        .proxy_b = proxy_b,
+    };
+}
+
+i32 physics_sap_compare(const void* a, const void* b)
+{
+    f32 ka = ((const SAPEntry*)a)->min, kb = ((const SAPEntry*)b)->min;
+    return (ka > kb) - (ka < kb);
+}
+
+u32 aabb_tree_alloc_node(AABBTree* self)
+{
+    u32 index;
+    if(self->free_list != BGL_AABB_TREE_NULL)
+    {
+        index = self->free_list;
+        self->free_list = self->nodes[index].parent;
+    }
+    else
+    {
+        ecs_grow((void**)&self->nodes, &self->node_capacity, self->node_count + 1, sizeof(AABBTreeNode));
+        index = self->node_count++;
+    }
+
+    AABBTreeNode* node = &self->nodes[index];
+    node->parent = BGL_AABB_TREE_NULL;
+    node->child1 = BGL_AABB_TREE_NULL;
+    node->child2 = BGL_AABB_TREE_NULL;
+    node->height = 0;
+    node->user = 0;
+    return index;
+}
+
+void aabb_tree_free_node(AABBTree* self, u32 index)
+{
+    self->nodes[index].parent = self->free_list;
+    self->nodes[index].height = -1;
+    self->free_list = index;
+}
+
+void aabb_tree_insert_leaf(AABBTree* self, u32 leaf)
+{
+    if(self->root == BGL_AABB_TREE_NULL)
+    {
+        self->root = leaf;
+        self->nodes[leaf].parent = BGL_AABB_TREE_NULL;
+        return;
+    }
+
+    /* walk down to the sibling which grows the total surface area of the tree the least */
+    const vec3 leaf_min = self->nodes[leaf].min, leaf_max = self->nodes[leaf].max;
+    u32 index = self->root;
+    while(self->nodes[index].height > 0)
+    {
+        const AABBTreeNode* node = &self->nodes[index];
+        const AABBTreeNode* child1 = &self->nodes[node->child1];
+        const AABBTreeNode* child2 = &self->nodes[node->child2];
+
+        f32 area = aabb_area(node->min, node->max);
+        f32 combined_area = aabb_union_area(node->min, node->max, leaf_min, leaf_max);
+
+        /* cost of making a new parent here, and the minimum cost pushing the leaf further down adds to every ancestor */
+        f32 cost = 2.0f * combined_area;
+        f32 inheritance_cost = 2.0f * (combined_area - area);
+
+        f32 cost1 = aabb_union_area(child1->min, child1->max, leaf_min, leaf_max) + inheritance_cost;
+        if(child1->height > 0) cost1 -= aabb_area(child1->min, child1->max);
+        f32 cost2 = aabb_union_area(child2->min, child2->max, leaf_min, leaf_max) + inheritance_cost;
+        if(child2->height > 0) cost2 -= aabb_area(child2->min, child2->max);
+
+        if(cost < cost1 && cost < cost2) break;
+        index = cost1 < cost2 ? node->child1 : node->child2;
+    }
+
+    const u32 sibling = index;
+    const u32 old_parent = self->nodes[sibling].parent;
+    const u32 new_parent = aabb_tree_alloc_node(self); // may move nodes
+
+    AABBTreeNode* parent = &self->nodes[new_parent];
+    parent->parent = old_parent;
+    parent->child1 = sibling;
+    parent->child2 = leaf;
+    parent->height = self->nodes[sibling].height + 1;
+    self->nodes[sibling].parent = new_parent;
+    self->nodes[leaf].parent = new_parent;
+
+    if(old_parent == BGL_AABB_TREE_NULL) self->root = new_parent;
+    else if(self->nodes[old_parent].child1 == sibling) self->nodes[old_parent].child1 = new_parent;
+    else self->nodes[old_parent].child2 = new_parent;
+
+    aabb_tree_refit(self, new_parent);
+}
+
+void aabb_tree_remove_leaf(AABBTree* self, u32 leaf)
+{
+    if(leaf == self->root)
+    {
+        self->root = BGL_AABB_TREE_NULL;
+        return;
+    }
+
+    const u32 parent = self->nodes[leaf].parent;
+    const u32 grand_parent = self->nodes[parent].parent;
+    const u32 sibling = self->nodes[parent].child1 == leaf ? self->nodes[parent].child2 : self->nodes[parent].child1;
+
+    /* the sibling takes the parent's place */
+    self->nodes[sibling].parent = grand_parent;
+    aabb_tree_free_node(self, parent);
+
+    if(grand_parent == BGL_AABB_TREE_NULL)
+    {
+        self->root = sibling;
+        return;
+    }
+
+    if(self->nodes[grand_parent].child1 == parent) self->nodes[grand_parent].child1 = sibling;
+    else self->nodes[grand_parent].child2 = sibling;
+    aabb_tree_refit(self, grand_parent);
+}
+
+/* fix bounds and heights from index to the root, rebalancing on the way */
+void aabb_tree_refit(AABBTree* self, u32 index)
+{
+    while(index != BGL_AABB_TREE_NULL)
+    {
+        index = aabb_tree_balance(self, index);
+
+        AABBTreeNode* node = &self->nodes[index];
+        const AABBTreeNode* child1 = &self->nodes[node->child1];
+        const AABBTreeNode* child2 = &self->nodes[node->child2];
+        node->height = 1 + MAX(child1->height, child2->height);
+        node->min = VEC3(MIN(child1->min.x, child2->min.x), MIN(child1->min.y, child2->min.y), MIN(child1->min.z, child2->min.z));
+        node->max = VEC3(MAX(child1->max.x, child2->max.x), MAX(child1->max.y, child2->max.y), MAX(child1->max.z, child2->max.z));
+
+        index = node->parent;
+    }
+}
+
+/**
+ * if one child of a is more than one level taller than the other, rotate the taller child up.
+ * the shorter grandchild is swapped with a's shorter child, same as an avl tree.
+ *
+ *         a              c
+ *        / \            / \
+ *       b   c    ->    a   f (taller)
+ *          / \        / \
+ *         f   g      b   g
+ *
+ * @returns node now in a's place
+ */
+u32 aabb_tree_balance(AABBTree* self, u32 a)
+{
+    AABBTreeNode* nodes = self->nodes;
+    if(nodes[a].height < 2) return a;
+
+    const i32 balance = nodes[nodes[a].child2].height - nodes[nodes[a].child1].height;
+    if(balance >= -1 && balance <= 1) return a;
+
+    /* the taller child is rotated up, keep the shorter one under a */
+    const bool right = balance > 1;
+    const u32 up = right ? nodes[a].child2 : nodes[a].child1;
+    const u32 keep = right ? nodes[a].child1 : nodes[a].child2;
+    const u32 f = nodes[up].child1, g = nodes[up].child2;
+
+    nodes[up].child1 = a;
+    nodes[up].parent = nodes[a].parent;
+    nodes[a].parent = up;
+
+    if(nodes[up].parent == BGL_AABB_TREE_NULL) self->root = up;
+    else if(nodes[nodes[up].parent].child1 == a) nodes[nodes[up].parent].child1 = up;
+    else nodes[nodes[up].parent].child2 = up;
+
+    /* the taller grandchild stays with up, the shorter replaces up under a */
+    const u32 tall = nodes[f].height > nodes[g].height ? f : g;
+    const u32 short_child = tall == f ? g : f;
+    nodes[up].child2 = tall;
+    if(right) nodes[a].child2 = short_child;
+    else nodes[a].child1 = short_child;
+    nodes[short_child].parent = a;
+
+    const AABBTreeNode* k = &nodes[keep];
+    const AABBTreeNode* s = &nodes[short_child];
+    nodes[a].min = VEC3(MIN(k->min.x, s->min.x), MIN(k->min.y, s->min.y), MIN(k->min.z, s->min.z));
+    nodes[a].max = VEC3(MAX(k->max.x, s->max.x), MAX(k->max.y, s->max.y), MAX(k->max.z, s->max.z));
+    nodes[a].height = 1 + MAX(k->height, s->height);
+
+    return up;
+}
+
+u32 aabb_tree_overlap_impl(const AABBTree* self, const BroadphaseProxy* proxies, vec3 min, vec3 max, u32 query, AABBTreeHit* hits_out, u32 total, u32 max_hits)
+{
+    if(self->root == BGL_AABB_TREE_NULL) return total;
+
+    u32 stack[BGL_AABB_TREE_MAX_DEPTH];
+    u32 top = 0;
+    stack[top++] = self->root;
+    while(top > 0)
+    {
+        const AABBTreeNode* node = &self->nodes[stack[--top]];
+        if(!aabb_overlap(min, max, node->min, node->max)) continue;
+
+        if(node->height > 0)
+        {
+            stack[top++] = node->child1;
+            stack[top++] = node->child2;
+            continue;
+        }
+
+        /* physics world queries check the tight bounds, not the fattened leaf */
+        u32 user = node->user;
+        if(proxies != NULL)
+        {
+            if(!aabb_overlap(min, max, proxies[user].min, proxies[user].max)) continue;
+            user = proxies[user].entity;
+        }
+        if(total < max_hits) hits_out[total] = (AABBTreeHit){ .query = query, .user = user, .t = 0.0f };
+        total++;
+    }
+    return total;
+}
+
+u32 aabb_tree_raycast_impl(const AABBTree* self, const BroadphaseProxy* proxies, vec3 origin, vec3 dir, f32 max_t, u32 query, AABBTreeHit* hits_out, u32 total, u32 max_hits)
+{
+    if(self->root == BGL_AABB_TREE_NULL) return total;
+
+    const vec3 inv_dir = VEC3(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+    u32 stack[BGL_AABB_TREE_MAX_DEPTH];
+    u32 top = 0;
+    stack[top++] = self->root;
+    while(top > 0)
+    {
+        const AABBTreeNode* node = &self->nodes[stack[--top]];
+        f32 t;
+        if(!aabb_raycast(origin, inv_dir, max_t, node->min, node->max, &t)) continue;
+
+        if(node->height > 0)
+        {
+            stack[top++] = node->child1;
+            stack[top++] = node->child2;
+            continue;
+        }
+
+        u32 user = node->user;
+        if(proxies != NULL)
+        {
+            if(!aabb_raycast(origin, inv_dir, max_t, proxies[user].min, proxies[user].max, &t)) continue;
+            user = proxies[user].entity;
+        }
+        if(total < max_hits) hits_out[total] = (AABBTreeHit){ .query = query, .user = user, .t = t };
+        total++;
+    }
+    return total;
+}
+
+u32 aabb_tree_frustum_impl(const AABBTree* self, const BroadphaseProxy* proxies, const vec4* planes, AABBTreeHit* hits_out, u32 total, u32 max_hits)
+{
+    if(self->root == BGL_AABB_TREE_NULL) return total;
+
+    u32 stack[BGL_AABB_TREE_MAX_DEPTH];
+    u32 top = 0;
+    stack[top++] = self->root;
+    while(top > 0)
+    {
+        const AABBTreeNode* node = &self->nodes[stack[--top]];
+        if(!aabb_in_frustum(planes, node->min, node->max)) continue;
+
+        if(node->height > 0)
+        {
+            stack[top++] = node->child1;
+            stack[top++] = node->child2;
+            continue;
+        }
+
+        u32 user = node->user;
+        if(proxies != NULL)
+        {
+            if(!aabb_in_frustum(planes, proxies[user].min, proxies[user].max)) continue;
+            user = proxies[user].entity;
+        }
+        if(total < max_hits) hits_out[total] = (AABBTreeHit){ .query = 0, .user = user, .t = 0.0f };
+        total++;
+    }
+    return total;
+}
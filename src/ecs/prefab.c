@@ -0,0 +1,103 @@
+#include "ecs/prefab.h"
+
+#include <string.h>
+#include "defines.h"
+
+void prefab_create(Prefab* self)
+{
+    memset(self, 0, sizeof(Prefab));
+}
+
+u32 prefab_add_entity(Prefab* self, ComponentMask mask)
+{
+    BGL_ASSERT(!self->frozen, "cannot change a prefab after instantiating it");
+    BGL_ASSERT(self->entity_count < BGL_PREFAB_MAX_ENTITIES, "too many entities in prefab, max is %u", BGL_PREFAB_MAX_ENTITIES);
+
+    self->masks[self->entity_count] = mask;
+    return self->entity_count++;
+}
+
+void prefab_set_component(Prefab* self, World* world, u32 entity, u32 component, const void* data)
+{
+    BGL_ASSERT(!self->frozen, "cannot change a prefab after instantiating it");
+    BGL_ASSERT(entity < self->entity_count, "invalid prefab entity %u", entity);
+    BGL_ASSERT(self->masks[entity] & BGL_COMPONENT_BIT(component), "prefab entity %u does not have component %s", entity, world->components[component].name);
+
+    u32 size = world->components[component].size;
+    if(self->components[entity][component] == NULL)
+    {
+        self->components[entity][component] = BGL_MALLOC(size);
+        BGL_ASSERT(self->components[entity][component] != NULL, "prefab component allocation failed");
+    }
+    memcpy(self->components[entity][component], data, size);
+}
+
+void prefab_set_model(Prefab* self, World* world, u32 entity, const Model* model)
+{
+    BGL_ASSERT(!self->frozen, "cannot change a prefab after instantiating it");
+    BGL_ASSERT(entity < self->entity_count, "invalid prefab entity %u", entity);
+
+    self->masks[entity] |= BGL_COMPONENT_BIT(BGL_COMPONENT_TRANSFORM) | BGL_COMPONENT_BIT(BGL_COMPONENT_MODEL_MATRIX) | BGL_COMPONENT_BIT(BGL_COMPONENT_MESH_REF);
+
+    /* at most one model per entity, so models can't overflow */
+    Model* stored;
+    if(self->components[entity][BGL_COMPONENT_MESH_REF] != NULL)
+    {
+        stored = ((MeshRef*)self->components[entity][BGL_COMPONENT_MESH_REF])->model;
+        model_free(stored);
+    }
+    else
+    {
+        stored = &self->models[self->model_count++];
+    }
+    *stored = *model;
+
+    MeshRef ref = { .model = stored };
+    prefab_set_component(self, world, entity, BGL_COMPONENT_MESH_REF, &ref);
+    if(self->components[entity][BGL_COMPONENT_TRANSFORM] == NULL)
+    {
+        prefab_set_component(self, world, entity, BGL_COMPONENT_TRANSFORM, &model->transform);
+    }
+}
+
+void prefab_instantiate(Prefab* self, World* world, u32 count, const Transform* transforms, Entity* entities_out)
+{
+    self->frozen = true;
+
+    for(u32 e = 0; e < self->entity_count; e++)
+    {
+        Entity* out = entities_out != NULL ? entities_out + e * count : NULL;
+        ecs_create_entities(world, self->masks[e], count, (const void* const*)self->components[e], out);
+
+        if(transforms == NULL || !(self->masks[e] & BGL_COMPONENT_BIT(BGL_COMPONENT_TRANSFORM))) continue;
+        BGL_ASSERT(out != NULL, "prefab_instantiate needs entities_out to apply per-instance transforms");
+
+        /* rows were just stamped as added so writing in place doesn't need to flag anything */
+        for(u32 i = 0; i < count; i++)
+        {
+            Transform* transform = (Transform*)ecs_get_component(world, out[i], BGL_COMPONENT_TRANSFORM);
+            transform->pos = vec3_add(transform->pos, transforms[i].pos);
+            transform->euler = vec3_add(transform->euler, transforms[i].euler);
+            transform->scale = VEC3(transform->scale.x * transforms[i].scale.x,
+                                    transform->scale.y * transforms[i].scale.y,
+                                    transform->scale.z * transforms[i].scale.z);
+        }
+    }
+}
+
+void prefab_free(Prefab* self)
+{
+    for(u32 e = 0; e < self->entity_count; e++)
+    {
+        for(u32 i = 0; i < BGL_ECS_MAX_COMPONENTS; i++)
+        {
+            if(self->components[e][i] != NULL) BGL_FREE(self->components[e][i]);
+        }
+    }
+    for(u32 i = 0; i < self->model_count; i++)
+    {
+        model_free(&self->models[i]);
+    }
+
+    memset(self, 0, sizeof(Prefab));
+}
@@ -0,0 +1,476 @@
+#include "ecs/snapshot.h"
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "defines.h"
+#include "platform.h"
+
+#define SNAPSHOT_BLOB_ALIGN 64
+#define SNAPSHOT_ALIGNED(offset) (((offset) + SNAPSHOT_BLOB_ALIGN - 1) & ~(u64)(SNAPSHOT_BLOB_ALIGN - 1)) // ALIGNED_SIZE truncates to u32
+
+typedef enum SnapshotFlags
+{
+    SNAPSHOT_DELTA = 1 << 0,
+} SnapshotFlags;
+
+/* file layout: header, ComponentInfo[component_count], SnapshotArchetype[archetype_count],
+   SnapshotChunk[every archetype's chunks], EntityRecord[record_count], u32 free records[free_count],
+   then the chunk data and ticks, each aligned to SNAPSHOT_BLOB_ALIGN */
+typedef struct SnapshotHeader
+{
+    u32 magic;
+    u32 version;
+    u32 flags;
+    u32 tick; // world tick when saved
+    u32 base_tick; // delta only, tick of the snapshot this applies on top of
+    u32 chunk_size;
+    u32 component_count;
+    u32 archetype_count;
+    u32 record_count;
+    u32 free_count;
+    u32 entity_count;
+    u32 model_count;
+} SnapshotHeader;
+
+typedef struct SnapshotArchetype
+{
+    ComponentMask mask;
+    u32 capacity;
+    u32 chunk_count;
+} SnapshotArchetype;
+
+typedef struct SnapshotChunk
+{
+    u64 data_offset; // 0 if the chunk is unchanged since the base snapshot (delta only)
+    u64 ticks_offset;
+    u32 count;
+    u32 structure_tick;
+} SnapshotChunk;
+
+/**
+ * internal functions
+ */
+bool snapshot_write(World* world, const char* path, Model** models, u32 model_count, bool delta);
+u8* snapshot_map(World* world, const char* path, u64* size_out, bool delta);
+bool snapshot_read_chunks(World* world, u8* file, u64 file_size, Model** models, u32 model_count, bool delta, u32* archetype_map);
+bool snapshot_read_records(World* world, u8* file, u64 file_size, const u32* archetype_map);
+void snapshot_refs_to_indices(Archetype* archetype, u8* data, u32 count, Model** models, u32 model_count);
+bool snapshot_indices_to_refs(Archetype* archetype, u8* data, u32 count, Model** models, u32 model_count);
+u32 snapshot_chunk_latest_tick(Archetype* archetype, Chunk* chunk);
+u64 snapshot_ticks_size(Archetype* archetype);
+bool snapshot_pad(FILE* file, u64* cursor);
+
+bool snapshot_save(World* world, const char* path, Model** models, u32 model_count)
+{
+    return snapshot_write(world, path, models, model_count, false);
+}
+
+bool snapshot_save_delta(World* world, const char* path, Model** models, u32 model_count)
+{
+    if(world->snapshot_tick == 0)
+    {
+        BGL_LOG_ERROR("cannot save delta snapshot %s, world has no previous snapshot", path);
+        return false;
+    }
+
+    return snapshot_write(world, path, models, model_count, true);
+}
+
+bool snapshot_load(World* world, const char* path, Model** models, u32 model_count)
+{
+    if(world->archetype_count != 0 || world->entity_count != 0)
+    {
+        BGL_LOG_ERROR("snapshot %s must be loaded into an empty world", path);
+        return false;
+    }
+
+    u64 file_size;
+    u8* file = snapshot_map(world, path, &file_size, false);
+    if(file == NULL) return false;
+
+    /* chunks point into the file from here, so the world owns the mapping even on failure */
+    world->mapped = file;
+    world->mapped_size = file_size;
+
+    const SnapshotHeader* header = (const SnapshotHeader*)file;
+    u32* archetype_map = (u32*)BGL_MALLOC(sizeof(u32) * (header->archetype_count + 1));
+    BGL_ASSERT(archetype_map != NULL, "snapshot archetype map allocation failed");
+
+    bool success = snapshot_read_chunks(world, file, file_size, models, model_count, false, archetype_map) &&
+                   snapshot_read_records(world, file, file_size, archetype_map);
+    BGL_FREE(archetype_map);
+    if(!success)
+    {
+        BGL_LOG_ERROR("snapshot %s is corrupt", path);
+        return false;
+    }
+
+    BGL_LOG_INFO("loaded snapshot %s: %u entities", path, world->entity_count);
+    return true;
+}
+
+bool snapshot_load_delta(World* world, const char* path, Model** models, u32 model_count)
+{
+    u64 file_size;
+    u8* file = snapshot_map(world, path, &file_size, true);
+    if(file == NULL) return false;
+
+    const SnapshotHeader* header = (const SnapshotHeader*)file;
+    if(header->base_tick != world->snapshot_tick)
+    {
+        BGL_LOG_ERROR("delta snapshot %s was saved after tick %u, but world is at snapshot tick %u", path, header->base_tick, world->snapshot_tick);
+        platform_file_unmap(file, file_size);
+        return false;
+    }
+
+    u32* archetype_map = (u32*)BGL_MALLOC(sizeof(u32) * (header->archetype_count + 1));
+    BGL_ASSERT(archetype_map != NULL, "snapshot archetype map allocation failed");
+
+    bool success = snapshot_read_chunks(world, file, file_size, models, model_count, true, archetype_map) &&
+                   snapshot_read_records(world, file, file_size, archetype_map);
+    BGL_FREE(archetype_map);
+    if(!success) BGL_LOG_ERROR("delta snapshot %s is corrupt", path);
+
+    platform_file_unmap(file, file_size); // changed chunks were copied out
+    return success;
+}
+
+bool snapshot_write(World* world, const char* path, Model** models, u32 model_count, bool delta)
+{
+    BGL_ASSERT(!world->iterating, "cannot save a snapshot while systems are running");
+
+    SnapshotHeader header = {
+        .magic = BGL_SNAPSHOT_MAGIC,
+        .version = BGL_SNAPSHOT_VERSION,
+        .flags = delta ? SNAPSHOT_DELTA : 0,
+        .tick = world->tick,
+        .base_tick = delta ? world->snapshot_tick : 0,
+        .chunk_size = BGL_ECS_CHUNK_SIZE,
+        .component_count = world->component_count,
+        .archetype_count = world->archetype_count,
+        .record_count = world->record_count,
+        .free_count = world->free_count,
+        .entity_count = world->entity_count,
+        .model_count = model_count,
+    };
+
+    u32 chunk_count = 0;
+    for(u32 i = 0; i < world->archetype_count; i++)
+    {
+        chunk_count += world->archetypes[i].chunk_count;
+    }
+
+    FILE* file = fopen(path, "wb");
+    if(file == NULL)
+    {
+        BGL_LOG_ERROR("failed to open snapshot %s for writing", path);
+        return false;
+    }
+
+    /* lay out the blobs first so the chunk table can be written before them */
+    u64 cursor = sizeof(SnapshotHeader) + world->component_count * sizeof(ComponentInfo)
+               + world->archetype_count * sizeof(SnapshotArchetype) + chunk_count * sizeof(SnapshotChunk)
+               + world->record_count * sizeof(EntityRecord) + world->free_count * sizeof(u32);
+    u64 blob_cursor = SNAPSHOT_ALIGNED(cursor);
+
+    bool success = fwrite(&header, sizeof(SnapshotHeader), 1, file) == 1 &&
+                   fwrite(world->components, sizeof(ComponentInfo), world->component_count, file) == world->component_count;
+
+    for(u32 i = 0; i < world->archetype_count && success; i++)
+    {
+        Archetype* archetype = &world->archetypes[i];
+        SnapshotArchetype saved = { .mask = archetype->mask, .capacity = archetype->capacity, .chunk_count = archetype->chunk_count };
+        success = fwrite(&saved, sizeof(SnapshotArchetype), 1, file) == 1;
+    }
+
+    for(u32 i = 0; i < world->archetype_count && success; i++)
+    {
+        Archetype* archetype = &world->archetypes[i];
+        for(u32 j = 0; j < archetype->chunk_count && success; j++)
+        {
+            Chunk* chunk = &archetype->chunks[j];
+            SnapshotChunk saved = { .count = chunk->count, .structure_tick = chunk->structure_tick };
+
+            if(!delta || snapshot_chunk_latest_tick(archetype, chunk) > world->snapshot_tick)
+            {
+                saved.data_offset = blob_cursor;
+                blob_cursor += BGL_ECS_CHUNK_SIZE;
+                saved.ticks_offset = blob_cursor;
+                blob_cursor = SNAPSHOT_ALIGNED(blob_cursor + snapshot_ticks_size(archetype));
+            }
+            success = fwrite(&saved, sizeof(SnapshotChunk), 1, file) == 1;
+        }
+    }
+
+    success = success &&
+              fwrite(world->records, sizeof(EntityRecord), world->record_count, file) == world->record_count &&
+              fwrite(world->free_records, sizeof(u32), world->free_count, file) == world->free_count &&
+              snapshot_pad(file, &cursor);
+
+    /* second pass writes the blobs in the same order they were laid out */
+    u8* scratch = (u8*)BGL_MALLOC(BGL_ECS_CHUNK_SIZE);
+    BGL_ASSERT(scratch != NULL, "snapshot scratch allocation failed");
+
+    for(u32 i = 0; i < world->archetype_count && success; i++)
+    {
+        Archetype* archetype = &world->archetypes[i];
+        for(u32 j = 0; j < archetype->chunk_count && success; j++)
+        {
+            Chunk* chunk = &archetype->chunks[j];
+            if(delta && snapshot_chunk_latest_tick(archetype, chunk) <= world->snapshot_tick) continue;
+
+            memcpy(scratch, chunk->data, BGL_ECS_CHUNK_SIZE);
+            snapshot_refs_to_indices(archetype, scratch, chunk->count, models, model_count);
+
+            u64 ticks_size = snapshot_ticks_size(archetype);
+            success = fwrite(scratch, 1, BGL_ECS_CHUNK_SIZE, file) == BGL_ECS_CHUNK_SIZE &&
+                      fwrite(chunk->ticks, 1, ticks_size, file) == ticks_size;
+            cursor += BGL_ECS_CHUNK_SIZE + ticks_size;
+            success = success && snapshot_pad(file, &cursor);
+        }
+    }
+
+    BGL_FREE(scratch);
+    fclose(file);
+
+    if(!success)
+    {
+        BGL_LOG_ERROR("failed to write snapshot %s", path);
+        return false;
+    }
+
+    /* anything changed from now on is newer than the snapshot */
+    world->snapshot_tick = world->tick;
+    world->tick++;
+
+    BGL_LOG_INFO("saved %ssnapshot %s: %lluB", delta ? "delta " : "", path, (unsigned long long)cursor);
+    return true;
+}
+
+u8* snapshot_map(World* world, const char* path, u64* size_out, bool delta)
+{
+    u8* file = (u8*)platform_file_map(path, size_out);
+    if(file == NULL)
+    {
+        BGL_LOG_ERROR("failed to map snapshot %s", path);
+        return NULL;
+    }
+
+    const SnapshotHeader* header = (const SnapshotHeader*)file;
+    const char* error = NULL;
+    if(*size_out < sizeof(SnapshotHeader) + header->component_count * sizeof(ComponentInfo)) error = "file is truncated";
+    else if(header->magic != BGL_SNAPSHOT_MAGIC) error = "not a snapshot";
+    else if(header->version != BGL_SNAPSHOT_VERSION) error = "unsupported version";
+    else if(header->chunk_size != BGL_ECS_CHUNK_SIZE) error = "chunk size differs";
+    else if(delta != (bool)(header->flags & SNAPSHOT_DELTA)) error = delta ? "expected a delta snapshot" : "expected a full snapshot";
+    else if(header->component_count != world->component_count) error = "registered components differ";
+    else if(header->archetype_count > (*size_out - sizeof(SnapshotHeader)) / sizeof(SnapshotArchetype)) error = "file is truncated";
+    else
+    {
+        const ComponentInfo* components = (const ComponentInfo*)(file + sizeof(SnapshotHeader));
+        for(u32 i = 0; i < header->component_count; i++)
+        {
+            if(components[i].size != world->components[i].size || components[i].align != world->components[i].align ||
+               strncmp(components[i].name, world->components[i].name, BGL_ECS_MAX_NAME) != 0)
+            {
+                error = "registered components differ";
+                break;
+            }
+        }
+    }
+
+    if(error != NULL)
+    {
+        BGL_LOG_ERROR("cannot load snapshot %s: %s", path, error);
+        platform_file_unmap(file, *size_out);
+        return NULL;
+    }
+
+    return file;
+}
+
+bool snapshot_read_chunks(World* world, u8* file, u64 file_size, Model** models, u32 model_count, bool delta, u32* archetype_map)
+{
+    const SnapshotHeader* header = (const SnapshotHeader*)file;
+    const SnapshotArchetype* archetypes = (const SnapshotArchetype*)(file + sizeof(SnapshotHeader) + header->component_count * sizeof(ComponentInfo));
+    const SnapshotChunk* chunks = (const SnapshotChunk*)(archetypes + header->archetype_count);
+    if((u8*)chunks > file + file_size) return false;
+
+    u32 chunk_index = 0;
+    for(u32 i = 0; i < header->archetype_count; i++)
+    {
+        archetype_map[i] = ecs_find_archetype(world, archetypes[i].mask);
+        Archetype* archetype = &world->archetypes[archetype_map[i]];
+        if(archetype->capacity != archetypes[i].capacity) return false;
+        if((u8*)(chunks + chunk_index + archetypes[i].chunk_count) > file + file_size) return false;
+
+        /* drop chunks the saved world no longer has, then make room for new ones */
+        u32 new_count = archetypes[i].chunk_count;
+        u32 old_count = archetype->chunk_count;
+        for(u32 j = new_count; j < old_count; j++)
+        {
+            ecs_chunk_free(world, &archetype->chunks[j]);
+        }
+        if(new_count > old_count)
+        {
+            BLOCK_RESIZE_ARRAY(&archetype->chunks, Chunk, old_count, new_count - old_count);
+            memset(&archetype->chunks[old_count], 0, (new_count - old_count) * sizeof(Chunk)); // safe to free if we bail out below
+        }
+        archetype->chunk_count = new_count;
+
+        u64 ticks_size = snapshot_ticks_size(archetype);
+        for(u32 j = 0; j < new_count; j++)
+        {
+            const SnapshotChunk* saved = &chunks[chunk_index++];
+            Chunk* chunk = &archetype->chunks[j];
+            if(saved->count > archetype->capacity) return false;
+
+            if(saved->data_offset == 0)
+            {
+                if(!delta || j >= old_count) return false; // unchanged chunk we don't have
+                continue;
+            }
+            if(saved->data_offset + BGL_ECS_CHUNK_SIZE > file_size || saved->ticks_offset + ticks_size > file_size) return false;
+
+            if(!delta)
+            {
+                /* full snapshots point straight into the mapped file */
+                chunk->data = file + saved->data_offset;
+                chunk->ticks = (u32*)(file + saved->ticks_offset);
+            }
+            else
+            {
+                if(j >= old_count)
+                {
+                    chunk->data = (u8*)BGL_MALLOC(BGL_ECS_CHUNK_SIZE);
+                    chunk->ticks = (u32*)BGL_MALLOC(ticks_size);
+                    BGL_ASSERT(chunk->data != NULL && chunk->ticks != NULL, "chunk allocation failed");
+                }
+                memcpy(chunk->data, file + saved->data_offset, BGL_ECS_CHUNK_SIZE);
+                memcpy(chunk->ticks, file + saved->ticks_offset, ticks_size);
+            }
+            chunk->count = saved->count;
+            chunk->structure_tick = saved->structure_tick;
+
+            if(!snapshot_indices_to_refs(archetype, chunk->data, chunk->count, models, model_count)) return false;
+        }
+    }
+
+    /* systems haven't seen any of the loaded data */
+    for(u32 i = 0; i < world->system_count; i++)
+    {
+        world->systems[i].last_run_tick = 0;
+    }
+    memset(world->removed_count, 0, sizeof(world->removed_count));
+
+    world->tick = MAX(world->tick, header->tick) + 1;
+    world->snapshot_tick = header->tick;
+
+    return true;
+}
+
+bool snapshot_read_records(World* world, u8* file, u64 file_size, const u32* archetype_map)
+{
+    const SnapshotHeader* header = (const SnapshotHeader*)file;
+
+    u32 chunk_count = 0;
+    const SnapshotArchetype* archetypes = (const SnapshotArchetype*)(file + sizeof(SnapshotHeader) + header->component_count * sizeof(ComponentInfo));
+    for(u32 i = 0; i < header->archetype_count; i++)
+    {
+        chunk_count += archetypes[i].chunk_count;
+    }
+
+    const EntityRecord* records = (const EntityRecord*)((const u8*)(archetypes + header->archetype_count) + chunk_count * sizeof(SnapshotChunk));
+    const u32* free_records = (const u32*)(records + header->record_count);
+    if((u8*)(free_records + header->free_count) > file + file_size) return false;
+
+    /* records are small and grow with the world, so always copy them out */
+    ecs_grow((void**)&world->records, &world->record_capacity, header->record_count, sizeof(EntityRecord));
+    memcpy(world->records, records, header->record_count * sizeof(EntityRecord));
+    for(u32 i = 0; i < header->record_count; i++)
+    {
+        EntityRecord* record = &world->records[i];
+        if(record->archetype == 0xFFFFFFFF) continue; // dead
+        if(record->archetype >= header->archetype_count) return false;
+        record->archetype = archetype_map[record->archetype];
+    }
+    world->record_count = header->record_count;
+
+    ecs_grow((void**)&world->free_records, &world->free_capacity, header->free_count, sizeof(u32));
+    memcpy(world->free_records, free_records, header->free_count * sizeof(u32));
+    world->free_count = header->free_count;
+
+    world->entity_count = header->entity_count;
+    return true;
+}
+
+/* MeshRef is the only built-in component holding a pointer, store it as index + 1 so NULL stays 0 */
+void snapshot_refs_to_indices(Archetype* archetype, u8* data, u32 count, Model** models, u32 model_count)
+{
+    if(!(archetype->mask & BGL_COMPONENT_BIT(BGL_COMPONENT_MESH_REF))) return;
+
+    MeshRef* refs = (MeshRef*)(data + archetype->column_offsets[BGL_COMPONENT_MESH_REF]);
+    u32 last = 0; // entities in a chunk usually share their model
+    for(u32 i = 0; i < count; i++)
+    {
+        uintptr_t index = 0;
+        if(refs[i].model != NULL)
+        {
+            if(last >= model_count || models[last] != refs[i].model)
+            {
+                for(last = 0; last < model_count && models[last] != refs[i].model; last++);
+            }
+
+            if(last < model_count) index = last + 1;
+            else BGL_LOG_WARN("model referenced by entity %u not passed to snapshot, saving as NULL", ((Entity*)data)[i]);
+        }
+        memcpy(&refs[i].model, &index, sizeof(uintptr_t));
+    }
+}
+
+bool snapshot_indices_to_refs(Archetype* archetype, u8* data, u32 count, Model** models, u32 model_count)
+{
+    if(!(archetype->mask & BGL_COMPONENT_BIT(BGL_COMPONENT_MESH_REF))) return true;
+
+    MeshRef* refs = (MeshRef*)(data + archetype->column_offsets[BGL_COMPONENT_MESH_REF]);
+    for(u32 i = 0; i < count; i++)
+    {
+        uintptr_t index;
+        memcpy(&index, &refs[i].model, sizeof(uintptr_t));
+        if(index > model_count)
+        {
+            BGL_LOG_ERROR("snapshot references model %llu, but only %u models were passed", (unsigned long long)index - 1, model_count);
+            return false;
+        }
+        refs[i].model = index == 0 ? NULL : models[index - 1];
+    }
+
+    return true;
+}
+
+u32 snapshot_chunk_latest_tick(Archetype* archetype, Chunk* chunk)
+{
+    u32 latest = chunk->structure_tick;
+    for(u32 i = 0; i < archetype->column_count; i++)
+    {
+        u32 tick = chunk->ticks[i * (1 + 2 * archetype->capacity)];
+        if(tick > latest) latest = tick;
+    }
+
+    return latest;
+}
+
+u64 snapshot_ticks_size(Archetype* archetype)
+{
+    return (u64)archetype->column_count * (1 + 2 * archetype->capacity) * sizeof(u32);
+}
+
+bool snapshot_pad(FILE* file, u64* cursor)
+{
+    static const u8 zeroes[SNAPSHOT_BLOB_ALIGN] = {0};
+
+    u64 padding = SNAPSHOT_ALIGNED(*cursor) - *cursor;
+    *cursor += padding;
+    return fwrite(zeroes, 1, padding, file) == padding;
+}
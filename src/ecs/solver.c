@@ -0,0 +1,324 @@
+#include "ecs/solver.h"
+
+#define MAX_TRANSLATION 2.0f // per step, stops a bad contact from throwing a body across the world
+#define MAX_ROTATION (0.25f * BGL_PI)
+
+/**
+ * internal functions
+ */
+void solver_apply_impulse(SolverBody* a, SolverBody* b, vec3 r_a, vec3 r_b, vec3 impulse);
+void solver_apply_angular_impulse(SolverBody* a, SolverBody* b, vec3 impulse);
+void solver_solve_rolling(SolverBody* a, SolverBody* b, ContactConstraint* contact);
+f32 solver_prepare_row(const SolverBody* a, const SolverBody* b, ContactConstraintPoint* cp, u32 row, vec3 dir);
+
+static inline vec3 solver_relative_velocity(const SolverBody* a, const SolverBody* b, vec3 r_a, vec3 r_b)
+{
+    vec3 v_a = vec3_add(a->linear_velocity, vec_cross(a->angular_velocity, r_a));
+    vec3 v_b = vec3_add(b->linear_velocity, vec_cross(b->angular_velocity, r_b));
+    return vec3_sub(v_b, v_a);
+}
+
+/* the iterations run these thousands of times per step, so they're kept to plain float math */
+static inline f32 solver_dot(vec3 v1, vec3 v2)
+{
+    return v1.x * v2.x + v1.y * v2.y + v1.z * v2.z;
+}
+
+static inline void solver_add_scaled(vec3* v, vec3 dir, f32 s)
+{
+    v->x += dir.x * s;
+    v->y += dir.y * s;
+    v->z += dir.z * s;
+}
+
+/* closing speed of the contact point along one of its directions */
+static inline f32 solver_row_velocity(const SolverBody* a, const SolverBody* b, const ContactConstraintPoint* cp, u32 row, vec3 dir)
+{
+    vec3 dv = VEC3(b->linear_velocity.x - a->linear_velocity.x, b->linear_velocity.y - a->linear_velocity.y, b->linear_velocity.z - a->linear_velocity.z);
+    return solver_dot(dv, dir) + solver_dot(b->angular_velocity, cp->angular_b[row]) - solver_dot(a->angular_velocity, cp->angular_a[row]);
+}
+
+static inline void solver_apply_row(SolverBody* a, SolverBody* b, const ContactConstraintPoint* cp, u32 row, vec3 dir, f32 lambda)
+{
+    if(a->inv_mass > 0.0f)
+    {
+        solver_add_scaled(&a->linear_velocity, dir, -lambda * a->inv_mass);
+        solver_add_scaled(&a->angular_velocity, cp->delta_a[row], -lambda);
+    }
+    if(b->inv_mass > 0.0f)
+    {
+        solver_add_scaled(&b->linear_velocity, dir, lambda * b->inv_mass);
+        solver_add_scaled(&b->angular_velocity, cp->delta_b[row], lambda);
+    }
+}
+
+void solver_init_contact(ContactConstraint* contact, const SolverBody* bodies, const ContactManifold* manifold)
+{
+    const SolverBody* a = &bodies[manifold->proxy_a];
+    const SolverBody* b = &bodies[manifold->proxy_b];
+    const vec3 n = manifold->normal;
+
+    contact->body_a = manifold->proxy_a;
+    contact->body_b = manifold->proxy_b;
+    contact->normal = n;
+    contact->friction = sqrtf(a->friction * b->friction);
+    contact->restitution = MAX(a->restitution, b->restitution);
+    contact->rolling_impulse = VEC3(0.0f, 0.0f, 0.0f);
+    contact->point_count = manifold->point_count;
+
+    /* any basis works, the warm start impulses are stored as world vectors and projected onto it */
+    vec3 t = fabsf(n.x) >= 0.57735f ? VEC3(n.y, -n.x, 0.0f) : VEC3(0.0f, n.z, -n.y);
+    vec3_norm(&t);
+    contact->tangents[0] = t;
+    contact->tangents[1] = vec_cross(n, t);
+
+    for(u32 i = 0; i < manifold->point_count; i++)
+    {
+        const ContactPoint* point = &manifold->points[i];
+        ContactConstraintPoint* cp = &contact->points[i];
+        cp->r_a = vec3_sub(point->pos, a->pos);
+        cp->r_b = vec3_sub(point->pos, b->pos);
+        cp->depth = point->depth;
+        cp->id = point->id;
+        cp->normal_impulse = 0.0f;
+        cp->tangent_impulse[0] = 0.0f;
+        cp->tangent_impulse[1] = 0.0f;
+    }
+
+    /* rolling resistance acts at the radius of whichever body rolls on the contact */
+    f32 radius = 0.0f;
+    for(u32 i = 0; i < contact->point_count; i++)
+    {
+        if(a->inv_mass > 0.0f) radius = MAX(radius, fabsf(vec3_dot(contact->points[i].r_a, n)));
+        if(b->inv_mass > 0.0f) radius = MAX(radius, fabsf(vec3_dot(contact->points[i].r_b, n)));
+    }
+    contact->rolling_friction = MAX(a->rolling_friction, b->rolling_friction) * radius;
+}
+
+void solver_integrate_velocities(SolverBody* bodies, const u32* indices, u32 count, vec3 gravity, f32 dt)
+{
+    for(u32 i = 0; i < count; i++)
+    {
+        SolverBody* body = &bodies[indices[i]];
+        if(!(body->flags & BGL_SOLVER_BODY_DYNAMIC)) continue;
+
+        /* world inverse inertia is r * diag * r^T */
+        mat3 rot;
+        quat_to_mat3(&rot, body->rot);
+        for(u32 col = 0; col < 3; col++)
+        {
+            for(u32 row = 0; row < 3; row++)
+            {
+                f32 sum = 0.0f;
+                for(u32 k = 0; k < 3; k++)
+                {
+                    sum += rot.cols[k].data[row] * body->inv_inertia_local.data[k] * rot.cols[k].data[col];
+                }
+                body->inv_inertia.cols[col].data[row] = sum;
+            }
+        }
+
+        body->linear_velocity = vec3_add(body->linear_velocity, vec3_scale(gravity, body->gravity_scale * dt));
+
+        /* pade approximation of exp(-damping * dt), stays stable for any step */
+        body->linear_velocity = vec3_scale(body->linear_velocity, 1.0f / (1.0f + dt * body->linear_damping));
+        body->angular_velocity = vec3_scale(body->angular_velocity, 1.0f / (1.0f + dt * body->angular_damping));
+    }
+}
+
+void solver_prepare_contacts(SolverBody* bodies, ContactConstraint* contacts, u32 count, f32 dt)
+{
+    const f32 inv_dt = 1.0f / dt;
+
+    for(u32 i = 0; i < count; i++)
+    {
+        ContactConstraint* contact = &contacts[i];
+        SolverBody* a = &bodies[contact->body_a];
+        SolverBody* b = &bodies[contact->body_b];
+
+        for(u32 j = 0; j < contact->point_count; j++)
+        {
+            ContactConstraintPoint* cp = &contact->points[j];
+            cp->normal_mass = solver_prepare_row(a, b, cp, 0, contact->normal);
+            cp->tangent_mass[0] = solver_prepare_row(a, b, cp, 1, contact->tangents[0]);
+            cp->tangent_mass[1] = solver_prepare_row(a, b, cp, 2, contact->tangents[1]);
+
+            /* points still apart may close the gap within the step, but not more (speculative contact) */
+            if(cp->depth < 0.0f) cp->bias = cp->depth * inv_dt;
+            else cp->bias = MIN(BGL_SOLVER_BAUMGARTE * inv_dt * MAX(cp->depth - BGL_SOLVER_SLOP, 0.0f), BGL_SOLVER_MAX_BIAS_VELOCITY);
+
+            /* bounce off the closing speed before this step's impulses change it */
+            f32 closing = vec3_dot(solver_relative_velocity(a, b, cp->r_a, cp->r_b), contact->normal);
+            if(closing < -BGL_SOLVER_RESTITUTION_THRESHOLD) cp->bias = MAX(cp->bias, -contact->restitution * closing);
+
+            vec3 impulse = vec3_scale(contact->normal, cp->normal_impulse);
+            impulse = vec3_add(impulse, vec3_scale(contact->tangents[0], cp->tangent_impulse[0]));
+            impulse = vec3_add(impulse, vec3_scale(contact->tangents[1], cp->tangent_impulse[1]));
+            solver_apply_impulse(a, b, cp->r_a, cp->r_b, impulse);
+        }
+        solver_apply_angular_impulse(a, b, contact->rolling_impulse);
+    }
+}
+
+void solver_solve_contacts(SolverBody* bodies, ContactConstraint* contacts, u32 count)
+{
+    for(u32 i = 0; i < count; i++)
+    {
+        ContactConstraint* contact = &contacts[i];
+        SolverBody* a = &bodies[contact->body_a];
+        SolverBody* b = &bodies[contact->body_b];
+
+        /* friction first, it's bounded by the normal impulse which is solved more accurately last */
+        for(u32 j = 0; j < contact->point_count; j++)
+        {
+            ContactConstraintPoint* cp = &contact->points[j];
+            const f32 max_friction = contact->friction * cp->normal_impulse;
+
+            for(u32 k = 0; k < 2; k++)
+            {
+                f32 lambda = -cp->tangent_mass[k] * solver_row_velocity(a, b, cp, k + 1, contact->tangents[k]);
+
+                f32 total = CLAMP(cp->tangent_impulse[k] + lambda, -max_friction, max_friction);
+                lambda = total - cp->tangent_impulse[k];
+                cp->tangent_impulse[k] = total;
+
+                solver_apply_row(a, b, cp, k + 1, contact->tangents[k], lambda);
+            }
+        }
+        if(contact->rolling_friction > 0.0f) solver_solve_rolling(a, b, contact);
+
+        for(u32 j = 0; j < contact->point_count; j++)
+        {
+            ContactConstraintPoint* cp = &contact->points[j];
+            f32 lambda = cp->normal_mass * (cp->bias - solver_row_velocity(a, b, cp, 0, contact->normal));
+
+            /* the total can only push, individual iterations can pull back what earlier ones overdid */
+            f32 total = MAX(cp->normal_impulse + lambda, 0.0f);
+            lambda = total - cp->normal_impulse;
+            cp->normal_impulse = total;
+
+            solver_apply_row(a, b, cp, 0, contact->normal, lambda);
+        }
+    }
+}
+
+void solver_integrate_positions(SolverBody* bodies, const u32* indices, u32 count, f32 dt)
+{
+    for(u32 i = 0; i < count; i++)
+    {
+        SolverBody* body = &bodies[indices[i]];
+        if(!(body->flags & BGL_SOLVER_BODY_DYNAMIC)) continue;
+
+        vec3 translation = vec3_scale(body->linear_velocity, dt);
+        f32 translation_sq = vec3_dot(translation, translation);
+        if(translation_sq > MAX_TRANSLATION * MAX_TRANSLATION)
+        {
+            f32 scale = MAX_TRANSLATION / sqrtf(translation_sq);
+            body->linear_velocity = vec3_scale(body->linear_velocity, scale);
+            translation = vec3_scale(translation, scale);
+        }
+
+        f32 rotation_sq = vec3_dot(body->angular_velocity, body->angular_velocity) * dt * dt;
+        if(rotation_sq > MAX_ROTATION * MAX_ROTATION)
+        {
+            body->angular_velocity = vec3_scale(body->angular_velocity, MAX_ROTATION / sqrtf(rotation_sq));
+        }
+
+        body->pos = vec3_add(body->pos, translation);
+        if(!(body->flags & BGL_SOLVER_BODY_LOCK_ROTATION)) body->rot = quat_integrate(body->rot, body->angular_velocity, dt);
+        body->flags |= BGL_SOLVER_BODY_MOVED;
+    }
+}
+
+vec3 solver_shape_inv_inertia(const CollisionShape* shape, f32 mass)
+{
+    vec3 inertia;
+    switch(shape->type)
+    {
+        case BGL_COLLIDER_SPHERE:
+        {
+            f32 i = 0.4f * mass * shape->radius * shape->radius;
+            inertia = VEC3(i, i, i);
+        } break;
+
+        case BGL_COLLIDER_CAPSULE:
+        {
+            /* cylinder plus two hemispheres, split the mass by volume */
+            const f32 r = shape->radius, r_sq = r * r, length = 2.0f * shape->half_height;
+            const f32 cylinder_volume = BGL_PI * r_sq * length, sphere_volume = 4.0f / 3.0f * BGL_PI * r_sq * r;
+            const f32 cylinder_mass = mass * cylinder_volume / (cylinder_volume + sphere_volume);
+            const f32 sphere_mass = mass - cylinder_mass;
+
+            f32 axial = cylinder_mass * r_sq * 0.5f + sphere_mass * 0.4f * r_sq;
+            f32 across = cylinder_mass * (length * length / 12.0f + r_sq * 0.25f) +
+                         sphere_mass * (0.4f * r_sq + length * length * 0.25f + 0.375f * length * r);
+            inertia = VEC3(across, axial, across);
+        } break;
+
+        default:
+        {
+            const vec3 h = shape->half_extents;
+            inertia = VEC3(mass / 3.0f * (h.y * h.y + h.z * h.z), mass / 3.0f * (h.x * h.x + h.z * h.z), mass / 3.0f * (h.x * h.x + h.y * h.y));
+        } break;
+    }
+
+    return VEC3(inertia.x > 0.0f ? 1.0f / inertia.x : 0.0f, inertia.y > 0.0f ? 1.0f / inertia.y : 0.0f, inertia.z > 0.0f ? 1.0f / inertia.z : 0.0f);
+}
+
+/* impulse acts on b, the opposite on a. bodies without mass aren't written since other islands read them */
+void solver_apply_impulse(SolverBody* a, SolverBody* b, vec3 r_a, vec3 r_b, vec3 impulse)
+{
+    if(a->inv_mass > 0.0f)
+    {
+        a->linear_velocity = vec3_sub(a->linear_velocity, vec3_scale(impulse, a->inv_mass));
+        a->angular_velocity = vec3_sub(a->angular_velocity, mat3_mul_vec3(a->inv_inertia, vec_cross(r_a, impulse)));
+    }
+    if(b->inv_mass > 0.0f)
+    {
+        b->linear_velocity = vec3_add(b->linear_velocity, vec3_scale(impulse, b->inv_mass));
+        b->angular_velocity = vec3_add(b->angular_velocity, mat3_mul_vec3(b->inv_inertia, vec_cross(r_b, impulse)));
+    }
+}
+
+void solver_apply_angular_impulse(SolverBody* a, SolverBody* b, vec3 impulse)
+{
+    if(a->inv_mass > 0.0f) a->angular_velocity = vec3_sub(a->angular_velocity, mat3_mul_vec3(a->inv_inertia, impulse));
+    if(b->inv_mass > 0.0f) b->angular_velocity = vec3_add(b->angular_velocity, mat3_mul_vec3(b->inv_inertia, impulse));
+}
+
+/* stop the relative spin along its current axis, with the total bounded by the normal impulses like friction */
+void solver_solve_rolling(SolverBody* a, SolverBody* b, ContactConstraint* contact)
+{
+    vec3 spin = vec3_sub(b->angular_velocity, a->angular_velocity);
+    f32 speed = sqrtf(vec3_dot(spin, spin));
+    if(speed < 1e-6f) return;
+
+    vec3 axis = vec3_scale(spin, 1.0f / speed);
+    f32 k = 0.0f;
+    if(a->inv_mass > 0.0f) k += vec3_dot(axis, mat3_mul_vec3(a->inv_inertia, axis));
+    if(b->inv_mass > 0.0f) k += vec3_dot(axis, mat3_mul_vec3(b->inv_inertia, axis));
+    if(k <= 0.0f) return;
+
+    f32 normal_impulse = 0.0f;
+    for(u32 i = 0; i < contact->point_count; i++) normal_impulse += contact->points[i].normal_impulse;
+    const f32 max_impulse = contact->rolling_friction * normal_impulse;
+
+    vec3 total = vec3_add(contact->rolling_impulse, vec3_scale(axis, -speed / k));
+    f32 total_sq = vec3_dot(total, total);
+    if(total_sq > max_impulse * max_impulse) total = vec3_scale(total, max_impulse / sqrtf(total_sq));
+
+    solver_apply_angular_impulse(a, b, vec3_sub(total, contact->rolling_impulse));
+    contact->rolling_impulse = total;
+}
+
+/* fill the angular terms of one direction of a contact point and return its effective mass */
+f32 solver_prepare_row(const SolverBody* a, const SolverBody* b, ContactConstraintPoint* cp, u32 row, vec3 dir)
+{
+    cp->angular_a[row] = vec_cross(cp->r_a, dir);
+    cp->angular_b[row] = vec_cross(cp->r_b, dir);
+    cp->delta_a[row] = a->inv_mass > 0.0f ? mat3_mul_vec3(a->inv_inertia, cp->angular_a[row]) : VEC3(0.0f, 0.0f, 0.0f);
+    cp->delta_b[row] = b->inv_mass > 0.0f ? mat3_mul_vec3(b->inv_inertia, cp->angular_b[row]) : VEC3(0.0f, 0.0f, 0.0f);
+
+    f32 k = a->inv_mass + b->inv_mass + vec3_dot(cp->angular_a[row], cp->delta_a[row]) + vec3_dot(cp->angular_b[row], cp->delta_b[row]);
+    return k > 0.0f ? 1.0f / k : 0.0f;
+}
@@ -0,0 +1,27 @@
+#include "ecs/transform_system.h"
+
+#include "transform.h"
+
+u32 transform_system_register(World* world)
+{
+    u32 system = ecs_add_system(world, "transform", transform_system_update,
+                                BGL_COMPONENT_BIT(BGL_COMPONENT_TRANSFORM),
+                                BGL_COMPONENT_BIT(BGL_COMPONENT_MODEL_MATRIX), NULL);
+    ecs_system_set_filter(world, system, BGL_COMPONENT_BIT(BGL_COMPONENT_TRANSFORM));
+
+    return system;
+}
+
+void transform_system_update(ECSIter* iter)
+{
+    const Transform* transforms = ECS_ITER_COLUMN(iter, Transform, BGL_COMPONENT_TRANSFORM);
+    mat4* matrices = ECS_ITER_COLUMN(iter, mat4, BGL_COMPONENT_MODEL_MATRIX);
+
+    for(u32 i = 0; i < iter->count; i++)
+    {
+        if(!ecs_iter_changed(iter, BGL_COMPONENT_TRANSFORM, i)) continue;
+
+        transform_to_matrix(&transforms[i], &matrices[i]);
+        ecs_iter_mark_changed(iter, BGL_COMPONENT_MODEL_MATRIX, i);
+    }
+}
@@ -0,0 +1,276 @@
+#include "geometry_pool.h"
+
+#include <string.h>
+#include "defines.h"
+#include "vao.h"
+#include "bo.h"
+#include "renderer.h"
+
+typedef struct GeometryPoolBuffer
+{
+    VAO vao;
+    VBO vbo;
+    EBO ebo;
+    GeometryPoolRanges vertices;
+    GeometryPoolRanges indices;
+} GeometryPoolBuffer;
+
+static struct
+{
+    bool enabled;
+    bool multi_draw_indirect;
+    GeometryPoolBuffer buffers[BGL_VERTEX_FORMAT_COUNT]; // created by the first mesh of each format
+} geometry_pool;
+
+/**
+ * internal functions
+ */
+void geometry_pool_reserve(GeometryPoolBuffer* self, VertexFormat format, u32 vert_count, u32 ind_count, u32* first_vertex, u32* first_index);
+void geometry_pool_grow_buffer(BO* self, size_t used_size, size_t new_size);
+
+static inline u32 geometry_pool_vertex_size(VertexFormat format)
+{
+    u32 floats = 3;
+    if(format & BGL_VERTEX_NORMAL) floats += 3;
+    if(format & BGL_VERTEX_UV) floats += 2;
+    return floats * (u32)sizeof(f32);
+}
+
+void geometry_pool_init(bool multi_draw_indirect)
+{
+    memset(&geometry_pool, 0, sizeof(geometry_pool));
+    geometry_pool.enabled = true;
+    geometry_pool.multi_draw_indirect = multi_draw_indirect;
+}
+
+void geometry_pool_free(void)
+{
+    for(u32 i = 0; i < BGL_VERTEX_FORMAT_COUNT; i++)
+    {
+        GeometryPoolBuffer* buffer = &geometry_pool.buffers[i];
+        if(buffer->vertices.capacity == 0) continue;
+
+        vao_free(buffer->vao);
+        vbo_free(buffer->vbo);
+        ebo_free(buffer->ebo);
+        geometry_pool_ranges_free(&buffer->vertices);
+        geometry_pool_ranges_free(&buffer->indices);
+    }
+    memset(&geometry_pool, 0, sizeof(geometry_pool));
+}
+
+bool geometry_pool_enabled(void)
+{
+    return geometry_pool.enabled;
+}
+
+bool geometry_pool_multi_draw_indirect(void)
+{
+    return geometry_pool.enabled && geometry_pool.multi_draw_indirect;
+}
+
+void geometry_pool_add(Mesh* mesh, const VertexBuffer* vertex_buffer, const u32* indices)
+{
+    BGL_ASSERT(geometry_pool.enabled, "geometry pool used without BGL_RD_GEOMETRY_POOL");
+
+    const VertexFormat format = mesh->format;
+    const u32 vertex_size = geometry_pool_vertex_size(format);
+    GeometryPoolBuffer* buffer = &geometry_pool.buffers[format];
+    u32 first_vertex, first_index;
+    geometry_pool_reserve(buffer, format, mesh->vert_count, mesh->ind_count, &first_vertex, &first_index);
+
+    /* interleave so a vertex is read from one place */
+    f32* vertices = (f32*)BGL_MALLOC((size_t)mesh->vert_count * vertex_size);
+    BGL_ASSERT(vertices != NULL, "geometry pool vertex staging allocation failed");
+    f32* out = vertices;
+    for(u32 i = 0; i < mesh->vert_count; i++)
+    {
+        vec3 pos = vertex_buffer->pos[i];
+        *out++ = pos.x; *out++ = pos.y; *out++ = pos.z;
+        if(format & BGL_VERTEX_NORMAL)
+        {
+            vec3 normal = vertex_buffer->normal[i];
+            *out++ = normal.x; *out++ = normal.y; *out++ = normal.z;
+        }
+        if(format & BGL_VERTEX_UV)
+        {
+            vec2 uv = vertex_buffer->uv[i];
+            *out++ = uv.u; *out++ = uv.v;
+        }
+    }
+
+    vbo_set_buffer_region(buffer->vbo, vertices, (i32)(first_vertex * vertex_size), (size_t)mesh->vert_count * vertex_size);
+    ebo_set_buffer_region(buffer->ebo, indices, (i32)(first_index * sizeof(u32)), mesh->ind_count * sizeof(u32));
+    BGL_FREE(vertices);
+
+    mesh->vao = buffer->vao;
+    mesh->vbo.id = mesh->ebo.id = 0; // owned by the pool
+    mesh->base_vertex = (i32)first_vertex;
+    mesh->first_index = first_index;
+    mesh->pooled = true;
+}
+
+void geometry_pool_remove(const Mesh* mesh)
+{
+    if(!geometry_pool.enabled) return; // the pool was freed first, its buffers are already gone
+
+    GeometryPoolBuffer* buffer = &geometry_pool.buffers[mesh->format];
+    geometry_pool_ranges_release(&buffer->vertices, (u32)mesh->base_vertex, mesh->vert_count);
+    geometry_pool_ranges_release(&buffer->indices, mesh->first_index, mesh->ind_count);
+}
+
+u32 geometry_pool_ranges_alloc(GeometryPoolRanges* self, u32 count, u32 min_capacity)
+{
+    u32 best = self->free_count;
+    for(u32 i = 0; i < self->free_count && count > 0; i++)
+    {
+        if(self->free[i].count >= count && (best == self->free_count || self->free[i].count < self->free[best].count)) best = i;
+    }
+
+    u32 first = self->end;
+    if(best < self->free_count)
+    {
+        GeometryPoolRange* range = &self->free[best];
+        first = range->first;
+        range->first += count;
+        range->count -= count;
+        if(range->count == 0)
+        {
+            memmove(range, range + 1, (self->free_count - best - 1) * sizeof(GeometryPoolRange));
+            self->free_count--;
+        }
+    }
+    else
+    {
+        self->end += count;
+    }
+
+    if(self->capacity == 0 || self->end > self->capacity)
+    {
+        u32 capacity = MAX(self->capacity, min_capacity);
+        while(capacity < self->end) capacity *= 2;
+        self->capacity = capacity;
+    }
+    return first;
+}
+
+void geometry_pool_ranges_release(GeometryPoolRanges* self, u32 first, u32 count)
+{
+    if(count == 0) return;
+    BGL_ASSERT(first + count <= self->end, "geometry pool range %u - %u released past the end of its buffer", first, first + count);
+
+    /* first free range after this one */
+    u32 next = 0;
+    while(next < self->free_count && self->free[next].first < first) next++;
+    BGL_ASSERT(next == self->free_count || first + count <= self->free[next].first, "geometry pool range %u released twice", first);
+    BGL_ASSERT(next == 0 || self->free[next - 1].first + self->free[next - 1].count <= first, "geometry pool range %u released twice", first);
+
+    const bool merge_prev = next > 0 && self->free[next - 1].first + self->free[next - 1].count == first;
+    const bool merge_next = next < self->free_count && first + count == self->free[next].first;
+    if(merge_prev && merge_next)
+    {
+        self->free[next - 1].count += count + self->free[next].count;
+        memmove(&self->free[next], &self->free[next + 1], (self->free_count - next - 1) * sizeof(GeometryPoolRange));
+        self->free_count--;
+    }
+    else if(merge_prev)
+    {
+        self->free[next - 1].count += count;
+    }
+    else if(merge_next)
+    {
+        self->free[next].first = first;
+        self->free[next].count += count;
+    }
+    else
+    {
+        if(self->free_count == self->free_capacity)
+        {
+            self->free_capacity = MAX(self->free_capacity * 2, BGL_RESIZE_BLOCK_SIZE);
+            self->free = (GeometryPoolRange*)BGL_REALLOC(self->free, self->free_capacity * sizeof(GeometryPoolRange));
+            BGL_ASSERT(self->free != NULL, "geometry pool free list reallocation failed");
+        }
+        memmove(&self->free[next + 1], &self->free[next], (self->free_count - next) * sizeof(GeometryPoolRange));
+        self->free[next] = (GeometryPoolRange){ .first = first, .count = count };
+        self->free_count++;
+    }
+
+    /* free space at the end is just past end, so the buffer's used size shrinks with it */
+    GeometryPoolRange* last = &self->free[self->free_count - 1];
+    if(last->first + last->count == self->end)
+    {
+        self->end = last->first;
+        self->free_count--;
+    }
+}
+
+void geometry_pool_ranges_free(GeometryPoolRanges* self)
+{
+    if(self->free != NULL) BGL_FREE(self->free);
+    memset(self, 0, sizeof(GeometryPoolRanges));
+}
+
+void geometry_pool_reserve(GeometryPoolBuffer* self, VertexFormat format, u32 vert_count, u32 ind_count, u32* first_vertex, u32* first_index)
+{
+    const u32 vertex_size = geometry_pool_vertex_size(format);
+    if(self->vertices.capacity == 0)
+    {
+        self->vao = vao_create();
+        self->vbo = vbo_create();
+        self->ebo = ebo_create();
+    }
+
+    /* only what's before the old ends has to be copied if a buffer grows */
+    const GeometryPoolRanges old_vertices = self->vertices;
+    const GeometryPoolRanges old_indices = self->indices;
+    *first_vertex = geometry_pool_ranges_alloc(&self->vertices, vert_count, BGL_GEOMETRY_POOL_MIN_VERTICES);
+    *first_index = geometry_pool_ranges_alloc(&self->indices, ind_count, BGL_GEOMETRY_POOL_MIN_VERTICES * 3);
+
+    if(self->vertices.capacity == old_vertices.capacity && self->indices.capacity == old_indices.capacity) return;
+
+    if(self->vertices.capacity != old_vertices.capacity)
+    {
+        geometry_pool_grow_buffer(&self->vbo, (size_t)old_vertices.end * vertex_size, (size_t)self->vertices.capacity * vertex_size);
+    }
+    if(self->indices.capacity != old_indices.capacity)
+    {
+        geometry_pool_grow_buffer(&self->ebo, (size_t)old_indices.end * sizeof(u32), (size_t)self->indices.capacity * sizeof(u32));
+    }
+
+    /* the vao has to point at the new buffers, same attribute indices as mesh_create */
+    vao_element_buffer(self->vao, self->ebo);
+
+    size_t offset = 0;
+    vao_attribute(self->vao, self->vbo, 0, 3, GL_FLOAT, (GLsizei)vertex_size, offset);
+    offset += 3 * sizeof(f32);
+    if(format & BGL_VERTEX_NORMAL)
+    {
+        vao_attribute(self->vao, self->vbo, 1, 3, GL_FLOAT, (GLsizei)vertex_size, offset);
+        offset += 3 * sizeof(f32);
+    }
+    if(format & BGL_VERTEX_UV)
+    {
+        vao_attribute(self->vao, self->vbo, format & BGL_VERTEX_NORMAL ? 2 : 1, 2, GL_FLOAT, (GLsizei)vertex_size, offset);
+    }
+}
+
+void geometry_pool_grow_buffer(BO* self, size_t used_size, size_t new_size)
+{
+    /* copied on the gpu, by name or through the copy targets, so no vao's element buffer binding is touched */
+    BO grown = bo_create(self->type);
+    bo_set_buffer(grown, NULL, new_size, false);
+
+    if(used_size > 0 && rd_state_dsa())
+    {
+        glCopyNamedBufferSubData(self->id, grown.id, 0, 0, (GLsizeiptr)used_size);
+    }
+    else if(used_size > 0)
+    {
+        glBindBuffer(GL_COPY_READ_BUFFER, self->id);
+        glBindBuffer(GL_COPY_WRITE_BUFFER, grown.id);
+        glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, (GLsizeiptr)used_size);
+    }
+
+    bo_free(*self);
+    *self = grown;
+}
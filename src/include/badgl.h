@@ -14,7 +14,18 @@ extern "C" {
 #include "platform.h"
 #include "shapes.h"
 #include "quad.h"
+#include "render_queue.h"
 #include "arena.h"
+#include "jobs.h"
+#include "spatial_grid.h"
+#include "ecs/ecs.h"
+#include "ecs/transform_system.h"
+#include "ecs/narrowphase.h"
+#include "ecs/physics_system.h"
+#include "ecs/physics_query.h"
+#include "ecs/character_controller.h"
+#include "ecs/prefab.h"
+#include "ecs/snapshot.h"
 
 #ifdef __cplusplus
 }
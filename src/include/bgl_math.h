@@ -8,10 +8,18 @@
 
 #define      BGL_PI 3.14159265358979323846f
 #define BGL_DEG2RAD 0.01745329251994329576f // PI / 180
+#define BGL_RAD2DEG 57.2957795130823208768f // 180 / PI
 
 #define RADIANS(deg) ((deg) * BGL_DEG2RAD)
+#define DEGREES(rad) ((rad) * BGL_RAD2DEG)
 
-#define CLAMP(val, lower, upper) ((val) < (lower)) ? (lower) : ((val) > (upper)) ? (upper) : (val)
+#define CLAMP(val, lower, upper) (((val) < (lower)) ? (lower) : ((val) > (upper)) ? (upper) : (val))
+#ifndef MIN
+#define MIN(a, b) ((a) < (b) ? (a) : (b))
+#endif
+#ifndef MAX
+#define MAX(a, b) ((a) > (b) ? (a) : (b))
+#endif
 
 #define VEC4TOVEC3(vector) (vec3){vector.x, vector.y, vector.z}
 #define VEC3TOVEC4(vector, w) (vec4){vector.x, vector.y, vector.z, w}
@@ -116,6 +124,7 @@ mat4 mat4_zero(void);
 void mat4_identity(mat4* out);
 void mat4_mul(mat4* out, mat4 m1, mat4 m2);
 void mat4_transpose(mat4* out, mat4 mat);
+void mat4_normal_matrix(mat4* out, mat4 mat); // inverse transpose of the upper left 3x3, rest is identity
 void mat4_scale(mat4* out, vec3 s);
 void mat4_scale_scalar(mat4* out, f32 s);
 void mat4_trans(mat4* out, vec3 t);
@@ -128,4 +137,22 @@ void mat_perspective_frustrum(mat4* out, f32 near, f32 far, f32 left, f32 right,
 void mat_orthographic_frustrum(mat4* out, f32 near, f32 far, f32 left, f32 right, f32 bottom, f32 top);
 void mat_look_at(mat4* out, vec3 t, vec3 k, vec3 i); // t is pos or translation vec, k is dir or "z axis", i is right or "x axis"
 
+vec3 mat3_mul_vec3(mat3 m, vec3 v);
+void mat3_from_mat4(mat3* out, mat4 m); // upper left 3x3
+
+// quaternions are stored in a vec4 as (x, y, z, w), w is the real part
+vec4 quat_identity(void);
+vec4 quat_mul(vec4 q1, vec4 q2); // rotation q2 then q1
+vec4 quat_norm(vec4 q);
+vec4 quat_nlerp(vec4 q1, vec4 q2, f32 t); // takes the short way round
+vec3 quat_rotate(vec4 q, vec3 v);
+vec4 quat_integrate(vec4 q, vec3 angular_velocity, f32 dt); // angular velocity in world space, radians per second
+void quat_to_mat3(mat3* out, vec4 q);
+vec4 quat_from_mat3(mat3 m); // m must be a rotation, no scale
+vec4 quat_from_euler(vec3 euler); // radians, same order as transform_to_matrix (z * y * x)
+vec3 quat_to_euler(vec4 q);
+
+void mat4_transform_aabb(vec3* min_out, vec3* max_out, mat4 mat, vec3 min, vec3 max); // aabb enclosing the transformed box
+void mat4_frustum_planes(vec4* planes_out, mat4 view_proj); // 6 normalised planes (left, right, bottom, top, near, far), xyz points inside, dot(xyz, p) + w >= 0 inside
+
 #endif
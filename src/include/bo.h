@@ -11,6 +11,26 @@ typedef struct BO
     GLenum type;
 } BO;
 
+#define BGL_BO_STREAM_REGIONS 3 // the cpu writes one region while the gpu may still read the other two
+
+/**
+ * buffer rewritten every frame (or whenever its data changes) without the driver syncing implicitly.
+ * with buffer storage (gl 4.4+) it's BGL_BO_STREAM_REGIONS regions of immutable storage mapped once,
+ * persistently and coherently. each write goes to the next region, waiting on the fence placed when
+ * that region was last left, which only stalls if the gpu is that many writes behind.
+ * on older versions the buffer is one region that's orphaned before each write and mapped
+ * unsynchronized, so the driver hands out new memory instead of waiting.
+ * a write replaces the whole region, so every write has to give the full contents
+ */
+typedef struct BOStream
+{
+    BO bo;
+    u8* mapped; // all regions, NULL when orphaning instead
+    size_t region_size; // aligned for use as a uniform block range
+    u32 region; // written last
+    GLsync fences[BGL_BO_STREAM_REGIONS]; // NULL if nothing can still be reading the region
+} BOStream;
+
 #define VBO BO
 #define vbo_create() bo_create(GL_ARRAY_BUFFER)
 #define vbo_bind bo_bind
@@ -36,6 +56,12 @@ typedef struct BO
 #define ubo_free bo_free
 
 
+/**
+ * @brief  settle on how buffers are streamed, before any stream is created
+ * @param  buffer_storage: gl 4.4+, streams are persistently mapped instead of orphaned
+ */
+void bo_init(bool buffer_storage);
+
 BO bo_create(GLenum type);
 
 void bo_bind(BO self);
@@ -48,6 +74,45 @@ void bo_set_buffer_region(BO self, const void* data, i32 offset, size_t size);
 
 void bo_free(BO self); // free gpu allocation
 
+bool bo_buffer_storage(void); // immutable storage and persistent mapping are available
+
+/**
+ * @brief  immutable storage of size bytes, mapped for writing persistently and coherently
+ */
+void* bo_set_storage_mapped(BO self, size_t size);
+
+/**
+ * @brief  map for writing without waiting on the gpu, the caller makes sure it isn't reading the range
+ */
+void* bo_map_range_unsynchronized(BO self, size_t offset, size_t size);
+
+void bo_unmap(BO self);
+
+/**
+ * @brief  block until the gpu passes fence, flushing the commands before it
+ */
+void bo_fence_wait(GLsync fence);
+
+/**
+ * @param  size: of a region, grows with bo_stream_begin
+ */
+void bo_stream_create(BOStream* self, GLenum type, size_t size);
+
+void bo_stream_free(BOStream* self);
+
+/**
+ * @brief  move to the next region and give write only memory for size bytes of it
+ * @returns memory to write in order and not read back, valid until bo_stream_end
+ */
+void* bo_stream_begin(BOStream* self, size_t size);
+
+void bo_stream_end(BOStream* self);
+
+/**
+ * @brief  byte offset of the region last written, for binding it as a range or drawing from it
+ */
+size_t bo_stream_offset(const BOStream* self);
+
 /* UBO functions */
 void ubo_bind_buffer_base(UBO self, u32 index);
 
@@ -28,8 +28,17 @@ void camera_create(Camera* self, vec3 start_pos, f32 start_pitch, f32 start_yaw,
 
 void camera_update(Camera* self, BGLWindow* window, f32 delta_time);
 
+// wasd on the flat plane plus space/left control up and down, one unit per key held. camera_update moves by it
+vec3 camera_move_input(const Camera* self, BGLWindow* window);
+
+// camera_update without moving, for cameras moved by something else like a character controller
+void camera_update_look(Camera* self, BGLWindow* window);
+
 void camera_update_view(Camera* self); // recalculate up/right vecs and view matrix based on pos/dir
 
 void camera_update_proj(Camera* self, f32 fov, f32 aspect_ratio, f32 znear, f32 zfar);
 
+// world space ray through pixel (x, y) from the top left of a width by height window, dir is unit. for picking
+void camera_screen_ray(const Camera* self, f32 x, f32 y, f32 width, f32 height, vec3* origin_out, vec3* dir_out);
+
 #endif
@@ -0,0 +1,84 @@
+#ifndef BGL_DRAW_RING_H
+#define BGL_DRAW_RING_H
+
+#include <glad/glad.h>
+#include "defines.h"
+#include "bgl_math.h"
+#include "bo.h"
+#include "material.h"
+
+/* define the per draw struct only once in glsl and then include */
+#include "draw.glsl"
+typedef struct DrawData DrawData;
+
+/**
+ * per draw data (model, normal matrix, mvp and material) for the built-in shaders, replacing the
+ * uniforms that used to be set for every draw. draws are written front to back into one uniform
+ * buffer, wrapping around at the end, and the gpu reads them through the Draws block at
+ * BGL_GLSL_DRAW_BINDING. the block only sees BGL_GLSL_DRAWS_PER_BLOCK draws, so it's bound with
+ * glBindBufferRange at the window holding a draw, and each draw's index into the window comes from
+ * a per instance attribute pointed at the indices buffer.
+ *
+ * every frame's writes are fenced in rd_end_frame and space is only reused once the fence covering
+ * it has passed, so nothing a draw still has to read is overwritten. with buffer storage the ring
+ * is mapped once persistently, otherwise each write maps its range unsynchronized.
+ * the ring grows when one map wouldn't leave room for BGL_DRAW_RING_FRAMES of them
+ */
+
+#define BGL_DRAW_RING_FRAMES 3 // frames the gpu is expected to lag behind at most
+#define BGL_DRAW_RING_MAX_FENCES 8
+#define BGL_DRAW_RING_NO_WINDOW 0xFFFFFFFF
+
+typedef struct DrawRingFence
+{
+    GLsync sync;
+    u32 size; // slots written before it, freed once it has passed
+} DrawRingFence;
+
+typedef struct DrawRing
+{
+    UBO buffer; // capacity + BGL_GLSL_DRAWS_PER_BLOCK slots, so a window starting at any slot is whole
+    VBO indices; // slot i holds i % BGL_GLSL_DRAWS_PER_BLOCK, read as the BGL_GLSL_INSTANCE_DRAW_LOCATION attribute
+    DrawData* mapped; // the whole ring when persistently mapped, NULL if each write maps its range
+    u32 capacity; // slots
+    u32 head; // next slot written
+    u32 used; // slots the gpu may still read, including ones skipped to wrap around
+    u32 frame_used; // slots written since the last fence
+    DrawRingFence fences[BGL_DRAW_RING_MAX_FENCES]; // oldest first starting at fence_first
+    u32 fence_first;
+    u32 fence_count;
+    u32 window; // first slot of the range bound to BGL_GLSL_DRAW_BINDING
+} DrawRing;
+
+/**
+ * @param  capacity: slots to start with, rounded up to a power of two
+ */
+void draw_ring_create(DrawRing* self, u32 capacity);
+
+void draw_ring_free(DrawRing* self);
+
+/**
+ * @brief  reserve count sequential slots and map them for writing, only waits on the gpu if it's more than BGL_DRAW_RING_FRAMES behind
+ * @param  first_out: slot of the first draw, for draw_ring_bind_window
+ * @returns write only memory, fill it in order and don't read it back
+ */
+DrawData* draw_ring_map(DrawRing* self, u32 count, u32* first_out);
+
+void draw_ring_unmap(DrawRing* self);
+
+/**
+ * @brief  bind the BGL_GLSL_DRAWS_PER_BLOCK draws starting at slot, does nothing if they're already bound
+ */
+void draw_ring_bind_window(DrawRing* self, u32 slot);
+
+/**
+ * @brief  fence everything written since the last fence, once per frame after its draws
+ */
+void draw_ring_fence(DrawRing* self);
+
+/**
+ * @brief  per draw data of the built-in shaders
+ */
+void draw_data_write(DrawData* out, const mat4* view, const mat4* view_projection, const mat4* model, const Material* material);
+
+#endif
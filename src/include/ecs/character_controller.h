@@ -0,0 +1,74 @@
+#ifndef BGL_CHARACTER_CONTROLLER_H
+#define BGL_CHARACTER_CONTROLLER_H
+
+#include "defines.h"
+#include "bgl_math.h"
+#include "camera.h"
+#include "ecs/physics_query.h"
+
+/**
+ * kinematic capsule that walks on the physics world's colliders. it's moved only through shape
+ * casts (see physics_world_shape_cast) so it never tunnels, slides along what it hits and is never
+ * pushed by the simulation. a move runs in three passes like most character controllers:
+ *  - up: lift by step_height while on the ground, so low ledges are cleared by the side pass
+ *  - side: the horizontal part of the move, sliding along walls. slopes steeper than max_slope are
+ *    treated as walls so they can't be walked up
+ *  - down: the vertical part of the move plus the step height back, plus snap_distance while
+ *    walking so the capsule follows the ground down slopes and stairs instead of launching off them.
+ *    a step that lands on something steep is undone and the side pass runs again without it
+ *
+ * the capsule is kept skin away from everything so casts start outside, and pushed out of
+ * whatever moved into it before each move. nothing is allocated and the world is only read, so
+ * character_controller_update_batch moves many agents in parallel between physics steps
+ */
+
+#define BGL_CHARACTER_MAX_SLIDES 4 // hits handled per pass, the rest of the move is dropped
+#define BGL_CHARACTER_MAX_OVERLAPS 16 // colliders pushed out of per move
+
+typedef struct CharacterController
+{
+    vec3 pos; // bottom of the capsule
+    vec3 velocity; // vertical part is kept between updates for falling and jumping
+    f32 radius;
+    f32 height; // whole capsule, at least 2 * radius
+    f32 step_height;
+    f32 max_slope_cos; // cosine of the steepest walkable slope
+    f32 snap_distance;
+    f32 skin;
+    u32 proxy; // the character's own collider, skipped and used for layer filtering. BGL_PHYSICS_QUERY_NO_PROXY if it has none
+
+    /* set by moves */
+    bool grounded;
+    vec3 ground_normal; // up while in the air
+    Entity ground; // BGL_ENTITY_NULL while in the air
+} CharacterController;
+
+/**
+ * @brief  controller with a 0.3m step, 45 degree slopes, 0.3m ground snap and 1cm skin
+ * @param  pos: bottom of the capsule
+ */
+void character_controller_create(CharacterController* self, vec3 pos, f32 radius, f32 height);
+
+/**
+ * @brief  move by displacement, sliding along and stepping over what's in the way
+ */
+void character_controller_move(CharacterController* self, const PhysicsWorld* world, vec3 displacement);
+
+/**
+ * @brief  walk with a horizontal velocity while gravity and jumps drive the vertical velocity
+ * @param  walk_velocity: y is ignored
+ * @param  jump_speed: upwards speed given if grounded, 0 to not jump
+ */
+void character_controller_update(CharacterController* self, const PhysicsWorld* world, vec3 walk_velocity, f32 jump_speed, f32 delta_time);
+
+/**
+ * @brief  character_controller_update for many controllers in parallel, none of them jumping
+ */
+void character_controller_update_batch(CharacterController* controllers, const vec3* walk_velocities, u32 count, const PhysicsWorld* world, f32 delta_time);
+
+/**
+ * @brief  put the camera eye_height above the controller's bottom and update its view
+ */
+void character_controller_attach_camera(const CharacterController* self, Camera* camera, f32 eye_height);
+
+#endif
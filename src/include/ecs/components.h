@@ -1,4 +1,91 @@
 #ifndef BGL_COMPONENTS_H
 #define BGL_COMPONENTS_H
 
+#include "bgl_math.h"
+#include "transform.h"
+
+/* built-in components, registered by ecs_create in this order. user components are registered after these */
+typedef enum BuiltinComponent
+{
+    BGL_COMPONENT_TRANSFORM = 0,    // Transform
+    BGL_COMPONENT_MODEL_MATRIX,     // mat4, written by the transform system
+    BGL_COMPONENT_VELOCITY,         // Velocity, integrated by the physics system
+    BGL_COMPONENT_MESH_REF,         // MeshRef, drawn by the scene with the entity's ModelMatrix
+    BGL_COMPONENT_COLLIDER,         // Collider, placed in world space by the physics world from the ModelMatrix
+    BGL_COMPONENT_RIGID_BODY,       // RigidBody, simulated by the physics world, needs a Transform and a Collider
+
+    BGL_COMPONENT_BUILTIN_COUNT,
+} BuiltinComponent;
+
+typedef struct Velocity
+{
+    vec3 linear;
+    vec3 angular; // degrees per second around each euler axis
+} Velocity;
+
+typedef enum ColliderType
+{
+    BGL_COLLIDER_SPHERE = 0,
+    BGL_COLLIDER_AABB,    // stays axis aligned in world space, only scaled and moved by the model matrix
+    BGL_COLLIDER_OBB,
+    BGL_COLLIDER_CAPSULE, // along local y
+    BGL_COLLIDER_MESH,    // triangles from physics_world_add_mesh, never a dynamic body. one sided, counter clockwise faces out
+} ColliderType;
+
+typedef enum ColliderFlags
+{
+    BGL_COLLIDER_STATIC = 1 << 0, // level geometry, only costs anything in the frames it's changed
+} ColliderFlags;
+
+/* shapes are in local space, see physics_system.h for helpers to create them */
+typedef struct Collider
+{
+    ColliderType type;
+    ColliderFlags flags;
+    vec3 offset;       // centre
+    vec3 half_extents; // aabb, obb
+    f32 radius;        // sphere, capsule
+    f32 half_height;   // capsule, centre to the centre of each cap
+    u32 mesh;          // mesh, index from physics_world_add_mesh. offset and half_extents hold the mesh's bounds
+    u32 layer;         // layer bits the collider is in
+    u32 ignore;        // layer bits the collider doesn't collide with, so zeroed colliders collide with everything
+
+    /* managed by the physics world */
+    u32 proxy; // broadphase handle + 1, 0 if not in the broadphase yet
+    vec3 bounds_min, bounds_max; // world space
+} Collider;
+
+typedef enum RigidBodyFlags
+{
+    BGL_RIGID_BODY_KINEMATIC = 1 << 0,   // moved by its velocity alone, pushes dynamic bodies without being pushed
+    BGL_RIGID_BODY_NEVER_SLEEP = 1 << 1,
+    BGL_RIGID_BODY_SLEEPING = 1 << 2,    // set by the physics world, changing the component wakes the body
+    BGL_RIGID_BODY_FAST = 1 << 3,        // swept every step so it can't pass through thin colliders, for projectiles
+} RigidBodyFlags;
+
+/* the collider's centre is the centre of mass, the inertia comes from its shape */
+typedef struct RigidBody
+{
+    f32 mass; // kilograms, ignored for kinematic bodies
+    f32 friction;
+    f32 restitution;
+    f32 rolling_friction; // resists rolling and spinning on a contact, a fraction of the normal force at the contact's radius
+    f32 linear_damping; // fraction of velocity lost per second
+    f32 angular_damping;
+    f32 gravity_scale;
+    RigidBodyFlags flags;
+
+    /* written back by the physics world every step the body is awake */
+    vec3 linear_velocity;
+    vec3 angular_velocity; // world space, radians per second
+} RigidBody;
+
+struct Model;
+
+/* shared reference to a model's meshes and material, the model must outlive the entity (see prefab.h) */
+typedef struct MeshRef
+{
+    struct Model* model;
+} MeshRef;
+
 #endif
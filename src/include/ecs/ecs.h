@@ -1,4 +1,294 @@
 #ifndef BGL_ECS_H
 #define BGL_ECS_H
 
+#include "defines.h"
+#include "arena.h"
+#include "ecs/entity.h"
+#include "ecs/components.h"
+
+/**
+ * archetype based ecs. every unique set of components gets an archetype, which stores its
+ * entities in fixed size chunks. each chunk holds one tightly packed column per component,
+ * so systems iterate plain arrays and chunks can be handed to different threads
+ *
+ * change detection: every component of every row stores the world tick it was added and last
+ * changed at. systems compare these against the tick of their previous run to only do work
+ * for what changed. writes through ecs_set_component/ecs_get_component_mut are tracked for you,
+ * writes through ECS_ITER_COLUMN must be flagged with ecs_iter_mark_changed
+ */
+
+#define BGL_ECS_MAX_COMPONENTS 64
+#define BGL_ECS_MAX_SYSTEMS 64
+#define BGL_ECS_MAX_NAME 32
+#define BGL_ECS_CHUNK_SIZE KILOBYTES(16)
+#define BGL_ECS_MAX_ALIGN 16
+
+typedef u64 ComponentMask;
+#define BGL_COMPONENT_BIT(id) ((ComponentMask)1 << (id))
+
+typedef struct World World;
+
+typedef struct ComponentInfo
+{
+    u32 size;
+    u32 align;
+    char name[BGL_ECS_MAX_NAME];
+} ComponentInfo;
+
+typedef struct Chunk
+{
+    u8* data; // entities column then one column per component, see Archetype.column_offsets
+    u32* ticks; // per component: latest changed tick in chunk, then added ticks and changed ticks per row, see Archetype.tick_offsets
+    u32 count;
+    u32 structure_tick; // last tick rows were added, removed or moved
+} Chunk;
+
+typedef struct Archetype
+{
+    ComponentMask mask;
+    u32 column_offsets[BGL_ECS_MAX_COMPONENTS]; // byte offset of each component's column in a chunk, only valid for components in mask
+    u32 tick_offsets[BGL_ECS_MAX_COMPONENTS]; // index of each component's ticks in Chunk.ticks
+    u32 column_count;
+    u32 capacity; // entities per chunk
+
+    Chunk* chunks;
+    u32 chunk_count;
+} Archetype;
+
+typedef struct EntityRecord
+{
+    u32 generation;
+    u32 archetype;
+    u32 chunk;
+    u32 row;
+} EntityRecord;
+
+/* passed to systems, one per chunk */
+typedef struct ECSIter
+{
+    World* world;
+    Archetype* archetype;
+    Chunk* chunk;
+    u32 count;
+
+    f32 delta_time;
+    u32 worker; // thread index, see jobs.h
+    void* user;
+
+    u32 tick; // current world tick, stamped on changes
+    u32 last_run_tick; // tick of the system's previous run, anything stamped after it is new to the system
+} ECSIter;
+
+typedef void (*SystemFunc)(ECSIter* iter);
+
+typedef struct System
+{
+    char name[BGL_ECS_MAX_NAME];
+    SystemFunc func;
+    ComponentMask read;  // components the system reads
+    ComponentMask write; // components the system writes. the query matches entities with all of read | write
+    void* user;
+    ComponentMask changed_filter; // if set, chunks where none of these changed since the last run are skipped
+    u32 last_run_tick;
+    u32 stage; // systems in the same stage don't conflict and run concurrently
+    f64 last_time; // ms taken on last run, shared with the rest of the stage
+} System;
+
+/* internal, one per system per chunk when running a stage */
+typedef struct ECSWorkItem
+{
+    System* system;
+    u32 archetype;
+    u32 chunk;
+} ECSWorkItem;
+
+typedef struct World
+{
+    ComponentInfo components[BGL_ECS_MAX_COMPONENTS];
+    u32 component_count;
+
+    Archetype* archetypes;
+    u32 archetype_count;
+
+    EntityRecord* records;
+    u32 record_count;
+    u32 record_capacity;
+    u32* free_records;
+    u32 free_count;
+    u32 free_capacity;
+    u32 entity_count;
+
+    u32 tick;
+    u32 snapshot_tick; // tick of the last snapshot saved or loaded, see snapshot.h
+
+    /* snapshot file chunks point into when loaded by snapshot_load, chunks inside it aren't freed individually */
+    u8* mapped;
+    u64 mapped_size;
+
+    /* entities which lost each component (removed or destroyed) since the end of the previous ecs_run_systems */
+    Entity* removed[BGL_ECS_MAX_COMPONENTS];
+    u32 removed_count[BGL_ECS_MAX_COMPONENTS];
+    u32 removed_capacity[BGL_ECS_MAX_COMPONENTS];
+
+    System systems[BGL_ECS_MAX_SYSTEMS];
+    u32 system_count;
+    u32 stage_count;
+    ECSWorkItem* work_items;
+    u32 work_capacity;
+
+    bool iterating; // structural changes are not allowed while systems are running
+} World;
+
+/**
+ * @brief  create world and register built-in components (see components.h)
+ */
+void ecs_create(World* self);
+
+void ecs_free(World* self);
+
+/**
+ * @brief  register a component type
+ * @returns component id to use with BGL_COMPONENT_BIT and the component functions
+ */
+u32 ecs_register_component(World* self, const char* name, u32 size, u32 align);
+
+#define ECS_REGISTER_COMPONENT(world, type) ecs_register_component(world, #type, sizeof(type), _Alignof(type))
+
+/**
+ * @brief  create entity with the components in mask. component data is zeroed
+ */
+Entity ecs_create_entity(World* self, ComponentMask mask);
+
+/**
+ * @brief  create count entities with the components in mask, with every row copied from one template value per component
+ * @param  components: indexed by component id, each points at one value of that component. NULL entries (or a NULL array) are zeroed
+ * @param  entities_out: optional array of at least count entities
+ * @note   rows are written a chunk at a time with memcpy so this is much faster than count calls to ecs_create_entity
+ */
+void ecs_create_entities(World* self, ComponentMask mask, u32 count, const void* const* components, Entity* entities_out);
+
+void ecs_destroy_entity(World* self, Entity entity);
+
+bool ecs_entity_alive(World* self, Entity entity);
+
+/**
+ * @returns ptr to component data or NULL if entity doesn't have the component. ptr is invalidated by any structural change
+ * @note   use ecs_get_component_mut if you are going to write through the ptr
+ */
+void* ecs_get_component(World* self, Entity entity, u32 component);
+
+/**
+ * @brief  same as ecs_get_component, but flags the component as changed
+ */
+void* ecs_get_component_mut(World* self, Entity entity, u32 component);
+
+void ecs_set_component(World* self, Entity entity, u32 component, const void* data);
+
+/**
+ * @brief  add component to entity, moving it to a new archetype. data can be NULL to zero the component
+ */
+void ecs_add_component(World* self, Entity entity, u32 component, const void* data);
+
+void ecs_remove_component(World* self, Entity entity, u32 component);
+
+/**
+ * @brief  call func on the calling thread for every chunk that has all components in mask
+ */
+void ecs_query(World* self, ComponentMask mask, SystemFunc func, void* user);
+
+/**
+ * @brief  same as ecs_query, but ecs_iter_changed/ecs_iter_added compare against since_tick, for code that tracks changes outside of systems
+ * @param  since_tick: value returned by the previous call, 0 the first time
+ * @returns tick to pass as since_tick next time
+ */
+u32 ecs_query_since(World* self, ComponentMask mask, u32 since_tick, SystemFunc func, void* user);
+
+/**
+ * @brief  register a system. systems run in registration order, except systems whose component
+ *         access doesn't conflict (no shared writes, no read of something another writes) which
+ *         are batched into one stage and run concurrently with their chunks split across worker threads
+ * @param  read: components read by the system
+ * @param  write: components written by the system
+ * @returns system index
+ */
+u32 ecs_add_system(World* self, const char* name, SystemFunc func, ComponentMask read, ComponentMask write, void* user);
+
+/**
+ * @brief  only run the system on chunks where at least one of the components in changed has changed since its last run
+ * @note   this skips whole chunks, use ecs_iter_changed to skip individual rows
+ */
+void ecs_system_set_filter(World* self, u32 system, ComponentMask changed);
+
+/**
+ * @brief  run every system, stage by stage
+ */
+void ecs_run_systems(World* self, f32 delta_time);
+
+/**
+ * @returns entities that lost component (through removal or destruction) since the end of the previous ecs_run_systems
+ * @note   meant to be read from inside systems. the entities may be dead
+ */
+const Entity* ecs_removed(World* self, u32 component, u32* count_out);
+
+/**
+ * @returns ptr to the start of the component's column in the iterated chunk
+ */
+static inline void* ecs_iter_column(ECSIter* iter, u32 component)
+{
+    return iter->chunk->data + iter->archetype->column_offsets[component];
+}
+
+static inline Entity* ecs_iter_entities(ECSIter* iter)
+{
+    return (Entity*)iter->chunk->data;
+}
+
+static inline u32* ecs_iter_ticks(ECSIter* iter, u32 component)
+{
+    return iter->chunk->ticks + iter->archetype->tick_offsets[component];
+}
+
+/**
+ * @brief  flag component of row as changed, call after writing through ECS_ITER_COLUMN
+ */
+static inline void ecs_iter_mark_changed(ECSIter* iter, u32 component, u32 row)
+{
+    u32* ticks = ecs_iter_ticks(iter, component);
+    ticks[0] = iter->tick; // chunk latest
+    ticks[1 + iter->archetype->capacity + row] = iter->tick;
+}
+
+/**
+ * @returns if component of row changed since the system last ran
+ */
+static inline bool ecs_iter_changed(ECSIter* iter, u32 component, u32 row)
+{
+    return ecs_iter_ticks(iter, component)[1 + iter->archetype->capacity + row] > iter->last_run_tick;
+}
+
+/**
+ * @returns if component was added to row since the system last ran
+ */
+static inline bool ecs_iter_added(ECSIter* iter, u32 component, u32 row)
+{
+    return ecs_iter_ticks(iter, component)[1 + row] > iter->last_run_tick;
+}
+
+/**
+ * @returns if any row's component changed since the system last ran
+ */
+static inline bool ecs_iter_chunk_changed(ECSIter* iter, u32 component)
+{
+    return ecs_iter_ticks(iter, component)[0] > iter->last_run_tick;
+}
+
+/**
+ * internal functions - shared with snapshot.c
+ */
+void ecs_grow(void** ptr, u32* capacity, u32 needed, u32 element_size);
+u32 ecs_find_archetype(World* self, ComponentMask mask);
+void ecs_chunk_free(World* self, Chunk* chunk);
+
+#define ECS_ITER_COLUMN(iter, type, component) ((type*)ecs_iter_column(iter, component))
+
 #endif
@@ -1,4 +1,18 @@
 #ifndef BGL_ENTITY_H
 #define BGL_ENTITY_H
 
+#include "types.h"
+
+/* entity handle: low 24 bits index into the world's entity records, high 8 bits generation to catch stale handles */
+typedef u32 Entity;
+
+#define BGL_ENTITY_INDEX_BITS 24
+#define BGL_ENTITY_INDEX_MASK ((1u << BGL_ENTITY_INDEX_BITS) - 1)
+#define BGL_ENTITY_MAX_GENERATION 0xFFu
+#define BGL_ENTITY_NULL 0xFFFFFFFFu
+
+#define BGL_ENTITY_INDEX(entity) ((entity) & BGL_ENTITY_INDEX_MASK)
+#define BGL_ENTITY_GENERATION(entity) ((entity) >> BGL_ENTITY_INDEX_BITS)
+#define BGL_ENTITY_MAKE(index, generation) (Entity)(((u32)(generation) << BGL_ENTITY_INDEX_BITS) | ((u32)(index) & BGL_ENTITY_INDEX_MASK))
+
 #endif
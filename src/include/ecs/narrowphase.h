@@ -0,0 +1,108 @@
+#ifndef BGL_NARROWPHASE_H
+#define BGL_NARROWPHASE_H
+
+#include "defines.h"
+#include "bgl_math.h"
+#include "ecs/entity.h"
+#include "ecs/components.h"
+#include "triangle_mesh.h"
+
+/**
+ * contact generation for the pairs found by the broadphase. pairs are bucketed by shape kind and
+ * each bucket is run by its own kernel: sphere/sphere and sphere/box work on small structure of
+ * arrays batches the compiler can vectorise, box/box uses the separating axis test with face
+ * clipping, anything with a capsule goes through gjk and epa, with the ends of the capsule as two
+ * points when it lies flat on a box face or another capsule. shapes against a triangle mesh collide
+ * with the triangles under their bounds one at a time and the results are merged into one manifold
+ */
+
+#define BGL_MAX_CONTACT_POINTS 4
+#define BGL_NARROWPHASE_BATCH 64 // pairs gathered per kernel pass
+
+/* pair of overlapping broadphase proxies */
+typedef struct PhysicsPair
+{
+    Entity a, b;
+    u32 proxy_a, proxy_b;
+} PhysicsPair;
+
+/* collider in world space, an aabb collider becomes a box with the world axes */
+typedef struct CollisionShape
+{
+    ColliderType type; // never BGL_COLLIDER_AABB
+    vec3 centre;
+    vec3 axes[3]; // unit length
+    vec3 half_extents; // box, the scale along each axis for a mesh
+    f32 radius; // sphere, capsule
+    f32 half_height; // capsule, along axes[1]
+    const TriangleMesh* mesh; // mesh, centre is the model's origin
+} CollisionShape;
+
+typedef struct ContactPoint
+{
+    vec3 pos; // halfway between the two surfaces
+    f32 depth; // > 0 when penetrating, face contacts keep points slightly apart as speculative contacts
+    u32 id; // feature the point came from, stable between steps for warm starting
+} ContactPoint;
+
+typedef struct ContactManifold
+{
+    Entity a, b;
+    u32 proxy_a, proxy_b;
+    vec3 normal; // unit, from a to b
+    u32 point_count;
+    ContactPoint points[BGL_MAX_CONTACT_POINTS];
+} ContactManifold;
+
+typedef enum NarrowphaseKind
+{
+    BGL_NARROWPHASE_SPHERE_SPHERE = 0,
+    BGL_NARROWPHASE_SPHERE_BOX,
+    BGL_NARROWPHASE_BOX_BOX,
+    BGL_NARROWPHASE_CONVEX, // gjk/epa, any pair with a capsule
+    BGL_NARROWPHASE_MESH, // any pair with a mesh, the mesh is b
+
+    BGL_NARROWPHASE_KIND_COUNT,
+} NarrowphaseKind;
+
+/**
+ * @brief  kernel used for a pair of shape types
+ * @param  swap_out: set if the pair must be swapped so shape a is the sphere of a sphere/box pair, or b is the mesh
+ */
+NarrowphaseKind narrowphase_pair_kind(ColliderType a, ColliderType b, bool* swap_out);
+
+/**
+ * @brief  generate manifolds for count pairs of the same kind
+ * @param  shapes: indexed by proxy_a/proxy_b of each pair
+ * @param  manifolds_out: at least count manifolds, only touching pairs are written
+ * @returns number of manifolds written
+ */
+u32 narrowphase_collide(NarrowphaseKind kind, const CollisionShape* shapes, const PhysicsPair* pairs, u32 count, ContactManifold* manifolds_out);
+
+/**
+ * @brief  world space shape of collider placed by model
+ */
+void collider_compute_shape(const Collider* collider, const mat4* model, CollisionShape* shape_out);
+
+/**
+ * @brief  time of impact of shape a moving along dir with shape b, any pair of shapes but meshes
+ * @param  max_t: in multiples of dir
+ * @param  normal_out: unit, b's surface normal facing a, against dir if they overlap from the start
+ * @param  point_out: on b's surface
+ * @returns bool denoting if a reaches b within max_t
+ */
+bool narrowphase_cast(const CollisionShape* a, vec3 dir, f32 max_t, const CollisionShape* b, f32* t_out, vec3* normal_out, vec3* point_out);
+
+/**
+ * @brief  world space box moved into a mesh shape's unscaled space, for triangle_mesh queries
+ * @returns false if the mesh is scaled flat
+ */
+bool narrowphase_mesh_local_bounds(const CollisionShape* mesh, vec3 min, vec3 max, vec3* local_min_out, vec3* local_max_out);
+
+/**
+ * @brief  world space triangle of a mesh shape, a shape with its corners in axes wound counter clockwise
+ *         which narrowphase_cast accepts
+ */
+void narrowphase_mesh_triangle_shape(const CollisionShape* mesh, u32 triangle, CollisionShape* triangle_out);
+
+#endif
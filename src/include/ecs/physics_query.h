@@ -0,0 +1,69 @@
+#ifndef BGL_PHYSICS_QUERY_H
+#define BGL_PHYSICS_QUERY_H
+
+#include "defines.h"
+#include "bgl_math.h"
+#include "ecs/physics_system.h"
+
+/**
+ * closest hit queries against the colliders' shapes rather than their bounds: rays, swept spheres
+ * and swept boxes. every call is a batch. each block of queries is sorted by the octant its
+ * direction points into, then the static and dynamic trees are walked by packets of
+ * BGL_PHYSICS_QUERY_PACKET queries, so neighbouring queries share a traversal and each node is
+ * tested against the whole packet in one loop the compiler vectorises. the leaves the packet
+ * reaches are tested exactly per query: rays analytically against spheres, boxes and mesh
+ * triangles, everything else with gjk ray casting (narrowphase_cast).
+ *
+ * nothing is allocated, the sort uses the stack and results go into one PhysicsHit per query. the
+ * shapes are the ones from the last step and the world is only read, so several threads can query
+ * at once between steps.
+ *
+ * picking: camera_screen_ray gives the ray under the cursor
+ */
+
+#define BGL_PHYSICS_QUERY_PACKET 4
+#define BGL_PHYSICS_QUERY_BLOCK 256 // queries sorted together
+#define BGL_PHYSICS_QUERY_MESH_TRIANGLES 64 // triangles tested per mesh and section of a cast, more are dropped
+#define BGL_PHYSICS_QUERY_NO_PROXY 0xFFFFFFFF
+
+typedef struct PhysicsHit
+{
+    Entity entity; // BGL_ENTITY_NULL if nothing was hit
+    f32 t; // in multiples of the query's dir, 0 if it starts overlapping
+    vec3 pos; // on the surface hit
+    vec3 normal; // unit, facing the query
+    u32 triangle; // for mesh colliders, see TriangleMesh.source_ids. BGL_TRIANGLE_NULL otherwise
+} PhysicsHit;
+
+/**
+ * @brief  closest collider hit by each ray. triangles of meshes are hit from either side
+ * @param  dirs: don't need to be normalised
+ * @param  ignore: layer bits, colliders in any of them are skipped
+ * @param  hits_out: one per ray
+ * @returns number of rays which hit something
+ */
+u32 physics_world_raycast_closest(const PhysicsWorld* self, const vec3* origins, const vec3* dirs, u32 count, f32 max_t, u32 ignore, PhysicsHit* hits_out);
+
+/**
+ * @brief  first collider touched by a sphere moved along each dir. mesh triangles are one sided, like for collisions
+ * @returns number of spheres which hit something
+ */
+u32 physics_world_sphere_cast(const PhysicsWorld* self, const vec3* origins, const vec3* dirs, u32 count, f32 radius, f32 max_t, u32 ignore, PhysicsHit* hits_out);
+
+/**
+ * @brief  first collider touched by a box moved along each dir, the box doesn't turn
+ * @param  rot: of every box
+ * @returns number of boxes which hit something
+ */
+u32 physics_world_box_cast(const PhysicsWorld* self, const vec3* origins, const vec3* dirs, u32 count, vec3 half_extents, vec4 rot, f32 max_t, u32 ignore, PhysicsHit* hits_out);
+
+/**
+ * @brief  first collider touched by a single shape moved along dir, used for continuous collision
+ * @param  shape: placed where it starts, any type but BGL_COLLIDER_MESH
+ * @param  proxy: collider the shape belongs to, it's skipped and its layer and ignore bits filter
+ *         the others like pairs are. BGL_PHYSICS_QUERY_NO_PROXY for none
+ * @returns bool denoting if anything was hit
+ */
+bool physics_world_shape_cast(const PhysicsWorld* self, const CollisionShape* shape, vec3 dir, f32 max_t, u32 proxy, PhysicsHit* hit_out);
+
+#endif
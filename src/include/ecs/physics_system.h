@@ -0,0 +1,311 @@
+#ifndef BGL_PHYSICS_SYSTEM_H
+#define BGL_PHYSICS_SYSTEM_H
+
+#include "ecs/ecs.h"
+#include "ecs/narrowphase.h"
+#include "ecs/solver.h"
+#include "triangle_mesh.h"
+
+/**
+ * collision detection for entities with a Collider and ModelMatrix. the physics world keeps one
+ * broadphase proxy per collider and finds overlapping pairs with sweep and prune. proxies are kept
+ * sorted along one axis between steps, so moving objects only shift a few places and an
+ * insertion sort restores the order in close to linear time.
+ *
+ * every proxy is also a leaf in one of two dynamic aabb trees, used for spatial queries. static
+ * colliders (BGL_COLLIDER_STATIC) are only in the static tree, so level geometry isn't sorted or
+ * swept every step. dynamic proxies cache the static leaves touching their fattened bounds and only
+ * query the static tree again after leaving them.
+ *
+ * the narrowphase then turns the pairs into contact manifolds, see ecs/narrowphase.h. triangle
+ * meshes are registered with the world once and referenced from colliders by index, so colliders
+ * stay plain data for snapshots
+ *
+ * entities with a RigidBody are simulated in fixed steps of fixed_dt, independent of the frame
+ * time. bodies joined by contacts form islands which are solved in parallel (see ecs/solver.h).
+ * an island that stays at rest for a while falls asleep: its proxies move into the static tree
+ * and it's skipped until something awake touches it, so resting piles cost close to nothing.
+ * after stepping, poses are written back to Transform and ModelMatrix, interpolated between the
+ * last two steps so motion stays smooth when frames and steps don't line up
+ *
+ * bodies flagged BGL_RIGID_BODY_FAST get continuous collision: after the solver moves them, a
+ * sphere smaller than the body is swept along the step (see physics_world_shape_cast) and the body
+ * is moved back to where it first touched something. the contact is then solved by the next step
+ * like any other, so projectiles can't pass through thin colliders without raising the tick rate
+ */
+
+#define BGL_PHYSICS_FIXED_DT (1.0f / 60.0f)
+#define BGL_PHYSICS_MAX_SUBSTEPS 4 // per frame, time past this is dropped so slow frames can't snowball
+#define BGL_PHYSICS_CCD_RADIUS 0.5f // of the largest sphere inside a fast body, swept when the body moves further than it in a step
+
+#define BGL_AABB_TREE_NULL 0xFFFFFFFF
+#define BGL_AABB_TREE_MAX_DEPTH 64 // traversal stack size, rotations keep trees far shallower than this
+
+typedef struct AABBTreeNode
+{
+    vec3 min, max; // fattened for leaves in trees with a margin
+    u32 parent; // next free node if the node is free
+    u32 child1, child2; // BGL_AABB_TREE_NULL for leaves
+    i32 height; // 0 for leaves, -1 if free
+    u32 user;
+} AABBTreeNode;
+
+/* bounding volume hierarchy, leaves can be inserted, moved and removed at any time */
+typedef struct AABBTree
+{
+    AABBTreeNode* nodes;
+    u32 node_count;
+    u32 node_capacity;
+    u32 root;
+    u32 free_list;
+    u32 leaf_count;
+    f32 margin; // leaves are grown by this so small movements don't touch the tree
+} AABBTree;
+
+/* query result, t is the distance along the ray for raycasts */
+typedef struct AABBTreeHit
+{
+    u32 query;
+    u32 user;
+    f32 t;
+} AABBTreeHit;
+
+typedef struct BroadphaseProxy
+{
+    vec3 min, max;
+    Entity entity; // BGL_ENTITY_NULL if the proxy is free
+    u32 layer, ignore;
+    u32 seen; // step the collider was last found in, proxies not seen are removed
+    u32 leaf; // node in static_tree or dynamic_tree
+    bool is_static;
+
+    /* dynamic proxies, static proxies which might overlap the proxy's fattened leaf */
+    u32 static_first; // into PhysicsWorld.static_candidates
+    u32 static_count;
+    u32 static_epoch; // cache is stale if this isn't PhysicsWorld.static_epoch
+} BroadphaseProxy;
+
+/* proxy bounds copied next to the sort key so the sweep reads memory in order. the bounds are
+   stored relative to the sweep axis so the sweep doesn't index by axis */
+typedef struct SAPEntry
+{
+    f32 min, max; // along sap_axis
+    f32 min1, max1; // along (sap_axis + 1) % 3
+    f32 min2, max2; // along (sap_axis + 2) % 3
+    u32 proxy;
+} SAPEntry;
+
+/* per proxy body data the solver doesn't need */
+typedef struct PhysicsBodyState
+{
+    vec3 prev_pos; // pose before the last step, for interpolating the write back
+    vec4 prev_rot;
+    vec3 com_offset; // from the transform's position to the centre of mass, in body space
+    f32 sleep_time; // seconds spent below the sleep thresholds
+    u32 sleep_next; // next body of the island it fell asleep with, the bodies form a loop
+    u32 island_parent; // union find while building islands
+    u32 island;
+    bool listed; // in PhysicsWorld.awake_bodies
+} PhysicsBodyState;
+
+/* bodies and contacts connected by contacts, solved as one */
+typedef struct PhysicsIsland
+{
+    u32 body_first, body_count; // into PhysicsWorld.island_bodies
+    u32 contact_first, contact_count; // into PhysicsWorld.contacts
+    f32 sleep_time; // lowest of its bodies
+} PhysicsIsland;
+
+typedef struct PhysicsWorld
+{
+    BroadphaseProxy* proxies;
+    u32 proxy_count;
+    u32 proxy_capacity;
+    u32* free_proxies;
+    u32 free_proxy_count;
+    u32 free_proxy_capacity;
+
+    SAPEntry* sap; // dynamic proxies sorted by min along sap_axis
+    u32 sap_count;
+    u32 sap_capacity;
+    u32 sap_axis;
+    u32 sap_unsorted; // entries appended since the last sort
+    bool sap_compact; // proxies were removed or made static, remove their entries
+
+    AABBTree static_tree;
+    AABBTree dynamic_tree;
+
+    u32* static_candidates; // per dynamic proxy caches, replaced caches are left behind until the pool is reset
+    u32 static_candidate_count;
+    u32 static_candidate_capacity;
+    u32 static_candidate_live; // sum of static_count of all proxies
+    u32 static_epoch; // bumped when the static tree changes
+
+    PhysicsPair* pairs; // overlapping pairs found by the last step
+    u32 pair_count;
+    u32 pair_capacity;
+
+    CollisionShape* shapes; // world space shape of each proxy, indexed like proxies
+    u32 shape_capacity;
+    const TriangleMesh** meshes; // for mesh colliders, not owned
+    u32 mesh_count;
+    u32 mesh_capacity;
+    PhysicsPair* kind_pairs; // pairs grouped by NarrowphaseKind for the narrowphase
+    u32 kind_pair_capacity;
+
+    ContactManifold* manifolds; // touching pairs found by the last step
+    u32 manifold_count;
+    u32 manifold_capacity;
+
+    SolverBody* bodies; // indexed like proxies, colliders without a RigidBody are bodies without mass
+    u32 body_capacity;
+    PhysicsBodyState* body_states;
+    u32 body_state_capacity;
+    u32* awake_bodies; // dynamic and kinematic bodies which aren't asleep
+    u32 awake_count;
+    u32 awake_capacity;
+    u32* wake_queue; // sleeping bodies touched during a step, woken after it
+    u32 wake_count;
+    u32 wake_capacity;
+
+    ContactConstraint* contacts; // contacts solved by the last step, grouped by island
+    u32 contact_count;
+    u32 contact_capacity;
+    ContactConstraint* contact_scratch; // contacts before grouping
+    u32 contact_scratch_capacity;
+    u32* contact_table; // open addressing hash of contacts by body pair, for warm starting
+    u32 contact_table_capacity;
+
+    PhysicsIsland* islands;
+    u32 island_count;
+    u32 island_capacity;
+    u32* island_bodies; // awake dynamic bodies grouped by island
+    u32 island_body_capacity;
+    u32* fast_bodies; // awake fast bodies which moved far enough in the last step to be swept
+    u32 fast_body_count;
+    u32 fast_body_capacity;
+
+    vec3 gravity;
+    f32 fixed_dt;
+    f32 accumulator; // time not stepped yet
+    u32 max_substeps;
+    u32 substep_count; // steps taken by the last physics_world_step
+
+    u32 step;
+    u32 last_tick; // world tick of the last sync or write back, see ecs_query_since
+    f64 broadphase_time; // ms taken by the broadphase in the last physics_world_step
+    f64 narrowphase_time; // ms taken by the narrowphase in the last physics_world_step
+    f64 solver_time; // ms taken by islands, solving and sleeping in the last physics_world_step
+    f64 integrate_time; // ms taken by continuous collision, moving shapes and proxies and the write back in the last physics_world_step
+} PhysicsWorld;
+
+/**
+ * @brief  register the system which integrates Velocity into Transform
+ * @returns system index
+ */
+u32 physics_system_register(World* world);
+
+void physics_world_create(PhysicsWorld* self);
+
+void physics_world_free(PhysicsWorld* self);
+
+/**
+ * @brief  make a triangle mesh available to mesh colliders, it must outlive the world
+ * @returns index for collider_mesh, the same meshes added in the same order give the same indices
+ */
+u32 physics_world_add_mesh(PhysicsWorld* self, const TriangleMesh* mesh);
+
+/**
+ * @brief  sync with the ecs, run as many fixed steps as fit in the accumulated time, then write
+ *         the bodies back to their Transform, ModelMatrix and RigidBody
+ * @note   call after the transform system has run so ModelMatrix is up to date
+ */
+void physics_world_step(PhysicsWorld* self, World* world, f32 delta_time);
+
+/**
+ * @brief  sync colliders and bodies with the ecs and rebuild self->pairs, without simulating
+ */
+void physics_world_update_broadphase(PhysicsWorld* self, World* world);
+
+/**
+ * @brief  generate contact manifolds for self->pairs into self->manifolds
+ */
+void physics_world_update_narrowphase(PhysicsWorld* self);
+
+/**
+ * @brief  find colliders whose world bounds overlap each box
+ * @param  hits_out: hit.query is the index of the box, hit.user the entity
+ * @returns total number of hits, only the first max_hits are written
+ */
+u32 physics_world_query_overlap(const PhysicsWorld* self, const vec3* mins, const vec3* maxs, u32 count, AABBTreeHit* hits_out, u32 max_hits);
+
+/**
+ * @brief  find colliders whose world bounds are hit by each ray within max_t, dirs don't need to be normalised
+ * @param  hits_out: hit.query is the index of the ray, hit.user the entity and hit.t where the ray enters the bounds, unsorted
+ * @returns total number of hits, only the first max_hits are written
+ */
+u32 physics_world_raycast(const PhysicsWorld* self, const vec3* origins, const vec3* dirs, u32 count, f32 max_t, AABBTreeHit* hits_out, u32 max_hits);
+
+/**
+ * @brief  find colliders whose world bounds are at least partly inside the frustum
+ * @param  planes: 6 planes from mat4_frustum_planes
+ * @returns total number of hits, only the first max_hits are written
+ */
+u32 physics_world_query_frustum(const PhysicsWorld* self, const vec4* planes, AABBTreeHit* hits_out, u32 max_hits);
+
+/**
+ * @param  margin: 0 for trees of things that rarely move
+ */
+void aabb_tree_create(AABBTree* self, f32 margin);
+
+void aabb_tree_free(AABBTree* self);
+
+/**
+ * @returns leaf node, stable until the leaf is removed
+ */
+u32 aabb_tree_insert(AABBTree* self, vec3 min, vec3 max, u32 user);
+
+void aabb_tree_remove(AABBTree* self, u32 leaf);
+
+/**
+ * @brief  update a leaf's bounds, nothing happens if they are still inside the fattened bounds
+ * @param  displacement: movement since the last update, the fattened bounds are stretched along it
+ * @returns true if the leaf was reinserted
+ */
+bool aabb_tree_move(AABBTree* self, u32 leaf, vec3 min, vec3 max, vec3 displacement);
+
+/**
+ * @brief  batched queries. all leaves whose (fattened) bounds pass the test are reported
+ * @returns total number of hits, only the first max_hits are written
+ */
+u32 aabb_tree_query_overlap(const AABBTree* self, const vec3* mins, const vec3* maxs, u32 count, AABBTreeHit* hits_out, u32 max_hits);
+u32 aabb_tree_raycast(const AABBTree* self, const vec3* origins, const vec3* dirs, u32 count, f32 max_t, AABBTreeHit* hits_out, u32 max_hits);
+u32 aabb_tree_query_frustum(const AABBTree* self, const vec4* planes, AABBTreeHit* hits_out, u32 max_hits);
+
+Collider collider_sphere(vec3 offset, f32 radius);
+Collider collider_aabb(vec3 offset, vec3 half_extents);
+Collider collider_obb(vec3 offset, vec3 half_extents);
+Collider collider_capsule(vec3 offset, f32 radius, f32 half_height);
+
+/**
+ * @param  mesh: index from physics_world_add_mesh
+ * @param  triangles: the mesh added, for its bounds
+ */
+Collider collider_mesh(u32 mesh, const TriangleMesh* triangles);
+
+/**
+ * @param  mass: kilograms, 0 for a kinematic body
+ */
+RigidBody rigid_body_create(f32 mass);
+
+/**
+ * @brief  world space aabb of collider placed by model
+ */
+void collider_compute_bounds(const Collider* collider, const mat4* model, vec3* min_out, vec3* max_out);
+
+/**
+ * internal function - system callback
+ */
+void physics_system_integrate(ECSIter* iter);
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef BGL_PREFAB_H
+#define BGL_PREFAB_H
+
+#include "ecs/ecs.h"
+#include "model.h"
+
+/**
+ * a frozen template of entities and their component values. instantiating copies the template
+ * straight into ecs chunks, so spawning thousands of copies costs a few memcpys per chunk.
+ * models given to the prefab are stored once and shared by every instance through MeshRef
+ */
+
+#define BGL_PREFAB_MAX_ENTITIES 16
+
+typedef struct Prefab
+{
+    ComponentMask masks[BGL_PREFAB_MAX_ENTITIES];
+    void* components[BGL_PREFAB_MAX_ENTITIES][BGL_ECS_MAX_COMPONENTS]; // template value of each component, NULL means zeroed
+    u32 entity_count;
+
+    Model models[BGL_PREFAB_MAX_ENTITIES]; // referenced by instances, so must stay where they are
+    u32 model_count;
+
+    bool frozen; // set by the first instantiation, the template can't change after
+} Prefab;
+
+void prefab_create(Prefab* self);
+
+/**
+ * @brief  add an entity to the template
+ * @returns index of the entity in the prefab
+ */
+u32 prefab_add_entity(Prefab* self, ComponentMask mask);
+
+/**
+ * @brief  set the value every instance of entity starts with. prefab copies data
+ * @param  world: world the prefab will be instantiated into, used for component sizes
+ */
+void prefab_set_component(Prefab* self, World* world, u32 entity, u32 component, const void* data);
+
+/**
+ * @brief  make entity draw model. prefab copies the model and frees it in prefab_free, the same as scene_add_model
+ * @note   adds Transform, ModelMatrix and MeshRef to the entity, the Transform starts as model->transform unless already set
+ */
+void prefab_set_model(Prefab* self, World* world, u32 entity, const Model* model);
+
+/**
+ * @brief  spawn count copies of the prefab in one go
+ * @param  transforms: optional per-instance transform, applied on top of the template Transform of each entity (positions and eulers add, scales multiply)
+ * @param  entities_out: optional array of count * entity_count entities. entity e of instance i is at [e * count + i]
+ */
+void prefab_instantiate(Prefab* self, World* world, u32 count, const Transform* transforms, Entity* entities_out);
+
+/**
+ * @note   instances still referencing the prefab's models must be destroyed first
+ */
+void prefab_free(Prefab* self);
+
+#endif
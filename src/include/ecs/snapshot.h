@@ -0,0 +1,45 @@
+#ifndef BGL_SNAPSHOT_H
+#define BGL_SNAPSHOT_H
+
+#include "ecs/ecs.h"
+#include "model.h"
+
+/**
+ * binary world snapshots. chunks are written verbatim, so a full snapshot loads by mapping the
+ * file and pointing the world's chunks straight into it, the only per-entity work is fixing up
+ * MeshRef pointers. delta snapshots only hold the chunks changed since the previous snapshot
+ *
+ * models referenced by MeshRef are saved as indices into the models array passed in, the same
+ * array (or one with the same models in the same order) must be passed when loading.
+ * user components are copied as raw bytes, so they must not hold pointers
+ */
+
+#define BGL_SNAPSHOT_MAGIC 0x57474C42 // "BGLW"
+#define BGL_SNAPSHOT_VERSION 1
+
+/**
+ * @brief  save every entity in world to path
+ * @returns bool denoting if the snapshot was written
+ */
+bool snapshot_save(World* world, const char* path, Model** models, u32 model_count);
+
+/**
+ * @brief  save only the chunks which changed since the last snapshot saved or loaded by world
+ * @returns bool denoting if the snapshot was written
+ */
+bool snapshot_save_delta(World* world, const char* path, Model** models, u32 model_count);
+
+/**
+ * @brief  load a full snapshot into world. world must be freshly created, with the same components registered as when it was saved
+ * @note   the file stays mapped until ecs_free
+ * @returns bool denoting if the snapshot was loaded
+ */
+bool snapshot_load(World* world, const char* path, Model** models, u32 model_count);
+
+/**
+ * @brief  apply a delta snapshot on top of the snapshot it was saved after. deltas must be applied in the order they were saved
+ * @returns bool denoting if the delta was applied
+ */
+bool snapshot_load_delta(World* world, const char* path, Model** models, u32 model_count);
+
+#endif
@@ -0,0 +1,108 @@
+#ifndef BGL_SOLVER_H
+#define BGL_SOLVER_H
+
+#include "defines.h"
+#include "bgl_math.h"
+#include "ecs/narrowphase.h"
+
+/**
+ * sequential impulse contact solver. each contact point gets a normal impulse which stops the
+ * bodies closing and two friction impulses bounded by the normal one, and each contact gets an
+ * angular impulse against rolling and spinning so round shapes come to rest. the impulses are
+ * accumulated over the iterations and clamped on the total, and the totals from the last step are
+ * applied up front (warm starting) so stacks settle in a few iterations instead of re-solving from
+ * zero. penetration is fed back as a velocity bias (baumgarte) with some slop so resting contacts
+ * don't jitter.
+ *
+ * functions work on one island at a time, islands share no dynamic bodies so they can be solved
+ * on different threads. bodies with zero inverse mass are only read
+ */
+
+#define BGL_SOLVER_ITERATIONS 15
+#define BGL_SOLVER_BAUMGARTE 0.2f // fraction of the penetration fixed per step
+#define BGL_SOLVER_SLOP 0.005f // penetration that's left alone, keeps contacts touching between steps
+#define BGL_SOLVER_RESTITUTION_THRESHOLD 1.0f // closing speed below which contacts don't bounce
+#define BGL_SOLVER_MAX_BIAS_VELOCITY 4.0f // separation speed added to fix penetration
+
+typedef enum SolverBodyFlags
+{
+    BGL_SOLVER_BODY_DYNAMIC = 1 << 0, // has a RigidBody and mass
+    BGL_SOLVER_BODY_KINEMATIC = 1 << 1, // has a RigidBody moved by its velocity
+    BGL_SOLVER_BODY_SLEEPING = 1 << 2,
+    BGL_SOLVER_BODY_NEVER_SLEEP = 1 << 3,
+    BGL_SOLVER_BODY_LOCK_ROTATION = 1 << 4, // aabb colliders can't turn
+    BGL_SOLVER_BODY_MOVED = 1 << 5, // pose changed since the last write back
+    BGL_SOLVER_BODY_FAST = 1 << 6, // continuous collision, see physics_sweep_fast_bodies
+} SolverBodyFlags;
+
+typedef struct SolverBody
+{
+    vec3 pos; // centre of mass
+    vec4 rot;
+    vec3 linear_velocity;
+    vec3 angular_velocity; // world space, radians per second
+    vec3 inv_inertia_local; // diagonal, principal axes are the collider's axes
+    mat3 inv_inertia; // world space, updated with the rotation
+    f32 inv_mass; // 0 for anything that isn't a dynamic body
+    f32 friction, restitution, rolling_friction;
+    f32 linear_damping, angular_damping, gravity_scale;
+    u32 flags; // SolverBodyFlags
+} SolverBody;
+
+typedef struct ContactConstraintPoint
+{
+    vec3 r_a, r_b; // from each centre of mass
+    vec3 angular_a[3], angular_b[3]; // r x direction for the normal and both tangents, set by prepare
+    vec3 delta_a[3], delta_b[3]; // angular velocity change per unit impulse along each direction
+    f32 depth;
+    f32 normal_mass, tangent_mass[2];
+    f32 normal_impulse, tangent_impulse[2]; // accumulated
+    f32 bias; // target separating speed
+    u32 id;
+} ContactConstraintPoint;
+
+typedef struct ContactConstraint
+{
+    u32 body_a, body_b; // indices into the bodies array, match the manifold's proxies
+    vec3 normal; // from a to b
+    vec3 tangents[2];
+    f32 friction, restitution;
+    f32 rolling_friction; // max angular impulse per unit of normal impulse, already scaled by the radius
+    vec3 rolling_impulse; // accumulated, angular impulse acting on b
+    u32 island;
+    u32 point_count;
+    ContactConstraintPoint points[BGL_MAX_CONTACT_POINTS];
+} ContactConstraint;
+
+/**
+ * @brief  fill a constraint from a manifold. impulses are zeroed, set them after for warm starting
+ */
+void solver_init_contact(ContactConstraint* contact, const SolverBody* bodies, const ContactManifold* manifold);
+
+/**
+ * @brief  apply gravity and damping to the dynamic bodies and update their world inertia
+ * @param  indices: bodies to integrate
+ */
+void solver_integrate_velocities(SolverBody* bodies, const u32* indices, u32 count, vec3 gravity, f32 dt);
+
+/**
+ * @brief  compute effective masses and biases, then apply the warm start impulses
+ */
+void solver_prepare_contacts(SolverBody* bodies, ContactConstraint* contacts, u32 count, f32 dt);
+
+/**
+ * @brief  one pass over the contacts, call BGL_SOLVER_ITERATIONS times
+ */
+void solver_solve_contacts(SolverBody* bodies, ContactConstraint* contacts, u32 count);
+
+/**
+ * @brief  move the dynamic bodies by their velocities
+ */
+void solver_integrate_positions(SolverBody* bodies, const u32* indices, u32 count, f32 dt);
+
+/**
+ * @brief  diagonal inverse inertia of a solid shape, shape sizes are in world units
+ */
+vec3 solver_shape_inv_inertia(const CollisionShape* shape, f32 mass);
+
+#endif
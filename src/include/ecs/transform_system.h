@@ -0,0 +1,17 @@
+#ifndef BGL_TRANSFORM_SYSTEM_H
+#define BGL_TRANSFORM_SYSTEM_H
+
+#include "ecs/ecs.h"
+
+/**
+ * @brief  register the system which writes ModelMatrix from Transform
+ * @returns system index
+ */
+u32 transform_system_register(World* world);
+
+/**
+ * internal function - system callback
+ */
+void transform_system_update(ECSIter* iter);
+
+#endif
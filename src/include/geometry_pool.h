@@ -0,0 +1,68 @@
+#ifndef BGL_GEOMETRY_POOL_H
+#define BGL_GEOMETRY_POOL_H
+
+#include "defines.h"
+#include "mesh.h"
+
+/**
+ * optional shared storage for mesh geometry, enabled with BGL_RD_GEOMETRY_POOL. there is one
+ * interleaved vertex buffer and one index buffer per VertexFormat, each with a vao, and mesh_create
+ * appends to the buffers of the mesh's format instead of creating its own. a mesh is then a range
+ * of them, drawn with glDrawElementsBaseVertex, and meshes of a format never need a vao change
+ * between them. on gl 4.3+ the render queue draws runs of them with one glMultiDrawElementsIndirect.
+ *
+ * buffers grow by copying into a bigger buffer on the gpu. freed ranges go on a free list per buffer,
+ * merged with free neighbours, and new meshes take the smallest free range they fit in before the
+ * buffer is grown, so meshes can be streamed in and out without the buffers growing forever.
+ * there is only one gl context so the pool is static like texture_ctx
+ */
+
+#define BGL_GEOMETRY_POOL_MIN_VERTICES 65536
+
+typedef struct GeometryPoolRange
+{
+    u32 first, count;
+} GeometryPoolRange;
+
+/* space in one of the pool's buffers, counted in vertices or indices */
+typedef struct GeometryPoolRanges
+{
+    GeometryPoolRange* free; // sorted, never touching each other or end
+    u32 free_count, free_capacity;
+    u32 end; // nothing at or after it is used
+    u32 capacity;
+} GeometryPoolRanges;
+
+/**
+ * engine/internal functions
+ */
+void geometry_pool_init(bool multi_draw_indirect);
+void geometry_pool_free(void);
+bool geometry_pool_enabled(void);
+bool geometry_pool_multi_draw_indirect(void); // pooled meshes can be drawn with glMultiDrawElementsIndirect
+
+/**
+ * @brief  copy the geometry into the buffers of its format, setting the mesh's vao and range
+ */
+void geometry_pool_add(Mesh* mesh, const VertexBuffer* vertex_buffer, const u32* indices);
+
+/**
+ * @brief  give the mesh's ranges back to be reused by the next meshes added
+ */
+void geometry_pool_remove(const Mesh* mesh);
+
+/**
+ * @brief  take the smallest free range that fits, or append at the end, doubling the capacity from min_capacity if needed
+ * @note   doesn't touch gl, the caller grows the buffer when the capacity changes
+ * @return the first element of the range
+ */
+u32 geometry_pool_ranges_alloc(GeometryPoolRanges* self, u32 count, u32 min_capacity);
+
+/**
+ * @brief  put a range back on the free list, merged with its free neighbours, a range reaching end moves end back instead
+ */
+void geometry_pool_ranges_release(GeometryPoolRanges* self, u32 first, u32 count);
+
+void geometry_pool_ranges_free(GeometryPoolRanges* self);
+
+#endif
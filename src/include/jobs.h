@@ -0,0 +1,37 @@
+#ifndef BGL_JOBS_H
+#define BGL_JOBS_H
+
+#include "defines.h"
+
+/* global worker thread pool. the calling thread always helps out, so with 0 workers everything runs inline */
+
+#define BGL_JOBS_MAX_WORKERS 63
+
+/**
+ * @param  start: first index of the batch
+ * @param  end: one past the last index of the batch
+ * @param  worker: index of the thread running the batch (0 is the calling thread), useful for per-thread scratch data
+ */
+typedef void (*JobFunc)(void* data, u32 start, u32 end, u32 worker);
+
+/**
+ * @brief  start worker threads
+ * @param  worker_count: amount of threads to spawn, pass 0 to use (processor count - 1)
+ * @note   called by rd_init, only call yourself if you are running without a renderer
+ */
+void jobs_init(u32 worker_count);
+
+/**
+ * @returns amount of threads that can run a job, including the calling thread
+ */
+u32 jobs_thread_count(void);
+
+/**
+ * @brief  split [0, count) into batches of batch_size and run func on them across all threads. blocks until done
+ * @note   calling this from inside a job runs the work inline on the current thread
+ */
+void jobs_parallel_for(u32 count, u32 batch_size, JobFunc func, void* data);
+
+void jobs_free(void);
+
+#endif
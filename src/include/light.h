@@ -32,10 +32,5 @@ static inline void dir_light_create(DirLight* light, vec3 dir, vec3 ambient, vec
     light->specular = specular;
 }
 
-/**
- * engine/internal functions
- */
-void dir_light_set_uniforms(DirLight* light, Shader* shader);
-
 #endif
 
@@ -11,20 +11,57 @@ typedef enum MaterialFlags {
     BGL_MATERIAL_USE_CUBEMAP_TEXTURES = 1 << 2, 
 } MaterialFlags;
 
+/* how the render queue orders a material's draws and whether they're blended */
+typedef enum MaterialBlend {
+    BGL_MATERIAL_BLEND_OPAQUE,      // not blended, drawn front to back so early depth testing discards what's behind
+    BGL_MATERIAL_BLEND_TRANSPARENT, // alpha blended without writing depth, drawn back to front after everything opaque
+} MaterialBlend;
+
 typedef struct Material {
     vec3 ambient;
     vec3 diffuse;
     vec3 specular;
     f32 shininess;
+    f32 opacity; // multiplied with the diffuse texture's alpha, only used when blended
 
     MaterialFlags flags;
+    MaterialBlend blend;
 
     Texture* textures;
     u32 tex_count;
 } Material;
 
+#define BGL_MATERIAL_TABLE_PAGE_SIZE 256
+#define BGL_MATERIAL_NONE 0xFFFFFFFF
+
+typedef struct MaterialTableEntry {
+    Material material;
+    u32 shader_idx;
+    u32 hash;
+    u32 refs; // 0 once released
+    u32 next; // next entry in its bucket, or the next free entry once released
+} MaterialTableEntry;
+
 /**
- * @brief  creates material with colour materials and global default white 1x1 textures
+ * materials interned by content, so every model drawn with equal materials shares one entry and id.
+ * two materials are equal when their shader, colours, flags, blend mode and textures (by gl id) are,
+ * the render queue sorts and batches by the id so copies of a model draw as instances of one draw.
+ * entries are reference counted and reused once released. they're allocated a page at a time and
+ * never move, so pointers to them stay valid while more are interned.
+ * textures are still owned by whoever created them, an entry points at the first interned copy's
+ */
+typedef struct MaterialTable {
+    MaterialTableEntry** pages;
+    u32 page_count;
+    u32 count; // entries handed out so far, used or free
+    u32 free_first;
+    u32* buckets; // first entry of each hash bucket
+    u32 bucket_count; // power of 2, grown with the used entries
+    u32 used;
+} MaterialTable;
+
+/**
+ * @brief  creates an opaque material with colour materials and global default white 1x1 textures
  * @note   if you are using textures then the respective colours will be ignored
  * @param  is_cubemap_shader: if the object for this material uses cubemaps put true
  */
@@ -40,11 +77,48 @@ void material_create(Material* mat, bool is_cubemap_shader, vec3 ambient, vec3 d
  */
 void material_add_texture(Material* mat, TextureType type, const char* texture_path);
 
+/**
+ * @brief  make the material transparent or opaque again
+ * @param  opacity: 0 - 1, ignored when opaque
+ */
+void material_set_blend(Material* mat, MaterialBlend blend, f32 opacity);
+
 void material_free(Material* mat);
 
+void material_table_create(MaterialTable* self);
+
+/**
+ * @brief  frees the table's memory, not the textures of the materials in it
+ */
+void material_table_free(MaterialTable* self);
+
+/**
+ * @brief  id of the entry equal to the material drawn with the shader, adding one if there isn't any
+ * @note   adds a reference, pair it with material_table_release
+ */
+u32 material_table_intern(MaterialTable* self, const Material* mat, u32 shader_idx);
+
+/**
+ * @brief  id of the entry equal to the material drawn with the shader without adding a reference
+ * @return BGL_MATERIAL_NONE if it hasn't been interned
+ */
+u32 material_table_find(const MaterialTable* self, const Material* mat, u32 shader_idx);
+
+/**
+ * @brief  remove a reference, the entry and its id are reused once nothing references it
+ */
+void material_table_release(MaterialTable* self, u32 id);
+
+Material* material_table_get(const MaterialTable* self, u32 id);
+
 /**
  * engine/internal functions
  */
 void material_set_uniforms(Material* mat, Shader* shader);
 
+/**
+ * @brief  set blending and depth writes for the material's blend mode, through the renderer's state cache
+ */
+void material_set_blend_state(const Material* mat);
+
 #endif
@@ -8,6 +8,8 @@
 #include "shader.h"
 #include "arena.h"
 
+struct TriangleMesh;
+
 typedef struct VertexBuffer
 {
     vec3* pos;
@@ -15,17 +17,34 @@ typedef struct VertexBuffer
     vec2* uv;
 } VertexBuffer;
 
+/* attributes a mesh has besides position, from its vertex buffer's non NULL arrays */
+typedef enum VertexFormat
+{
+    BGL_VERTEX_POS = 0,
+    BGL_VERTEX_NORMAL = 1 << 0,
+    BGL_VERTEX_UV = 1 << 1,
+    BGL_VERTEX_FORMAT_COUNT = 4,
+} VertexFormat;
+
 typedef struct Mesh
 {
     u32* tex_indices; // indexes into parent structure's array
     u32 vert_count, ind_count, tex_count;
+    vec3 bounds_min, bounds_max; // local space aabb
+    struct TriangleMesh* triangles; // cpu copy for collision and raycasts, NULL unless the model was loaded with BGL_MODEL_KEEP_TRIANGLES
+
+    VertexFormat format;
+    bool pooled; // geometry is a range of the geometry pool's buffers, vao is shared and vbo and ebo are unused
+    u32 first_index; // range of the bound index buffer, 0 unless pooled
+    i32 base_vertex;
 
     VAO vao;
     VBO vbo;
     EBO ebo;
 } Mesh;
 
-/* vertices and indices are freed by caller as they are not stored but tex_indices are stored by mesh and so freed by mesh */
+/* vertices and indices are freed by caller as they are not stored but tex_indices are stored by mesh and so freed by mesh.
+ * the geometry goes into the geometry pool if the renderer was created with BGL_RD_GEOMETRY_POOL */
 void mesh_create(Mesh* self,
                  const VertexBuffer vertex_buffer, u32 vert_count,
                  const u32* indices, u32 ind_count,
@@ -35,4 +54,10 @@ void mesh_draw(Mesh* self, Shader* shader, Texture* textures);
 
 void mesh_free(Mesh* self);
 
+/**
+ * engine/internal functions
+ */
+void mesh_bind_textures(Mesh* self, Shader* shader, Texture* textures); // bind the mesh's textures to units 0..tex_count-1
+
+
 #endif
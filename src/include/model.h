@@ -13,6 +13,12 @@
 
 #define MAX_PATH_LENGTH 128
 
+typedef enum ModelLoadFlags
+{
+    BGL_MODEL_KEEP_TRIANGLES = 1 << 0,  // keep each mesh's triangles on the cpu with a bvh, see Mesh.triangles
+    BGL_MODEL_CACHE_TRIANGLES = 1 << 1, // also keep, load the bvhs from <path>.<mesh>.bvh if they're up to date and save them there if not
+} ModelLoadFlags;
+
 typedef struct Model
 {
     Mesh* meshes;
@@ -37,14 +43,36 @@ typedef struct Model
  */
 bool model_load(Model* self, Arena* scratch, const char* path, u32 shader_idx);
 
+/**
+ * @brief  model_load with options, e.g. to keep level geometry's triangles for collision
+ * @param  flags: ModelLoadFlags
+ */
+bool model_load_with_flags(Model* self, Arena* scratch, const char* path, u32 shader_idx, ModelLoadFlags flags);
+
 /**
  * @brief  update model transform and matrix
+ * @note   for a model in a scene, call scene_sync_model afterwards so the scene draws it there
  * @param  transform: position, rotation and scale
  */
 void model_update_transform(Model* self, const Transform* transform);
 
 void model_draw(Model* self, Renderer* rd, Camera* cam);
 
+/**
+ * @brief  draw model's meshes and material with a different model matrix, used for entities sharing the model
+ */
+void model_draw_matrix(Model* self, Renderer* rd, Camera* cam, mat4* model);
+
+/**
+ * @brief  local space aabb of all of the model's meshes
+ */
+void model_get_bounds(const Model* self, vec3* min_out, vec3* max_out);
+
+/**
+ * engine/internal functions
+ */
+void model_draw_meshes(Mesh* meshes, u32 mesh_count, Material* material, u32 shader_idx, Renderer* rd, Camera* cam, mat4* model);
+
 void model_free(Model* self);
 
 #endif
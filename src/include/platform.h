@@ -36,6 +36,12 @@
 
 #define BGL_MAX_EXECUTABLE_DIR_LENGTH 512
 
+/* opaque threading primitives, allocated by the platform layer */
+typedef struct PlatformThread PlatformThread;
+typedef struct PlatformMutex PlatformMutex;
+typedef struct PlatformCondition PlatformCondition;
+typedef void (*PlatformThreadFunc)(void* arg);
+
 void platform_reset_time(void);
 
 double platform_get_time(void);
@@ -61,10 +67,36 @@ void platform_get_executable_path(char* buffer, u32 length);
 
 bool platform_file_exists(const char* filename);
 
+void* platform_file_map(const char* filename, u64* size_out); // copy on write mapping of whole file, writes never reach the file. NULL on failure
+
+void platform_file_unmap(void* ptr, u64 size);
+
 bool platform_gl_extension_supported(const char* extension);
 
 bool platform_init_vsync(void);
 
 void platform_toggle_vsync(bool on);
 
+u32 platform_get_processor_count(void);
+
+PlatformThread* platform_thread_create(PlatformThreadFunc func, void* arg);
+
+void platform_thread_join(PlatformThread* thread); // waits for thread to finish and frees it
+
+PlatformMutex* platform_mutex_create(void);
+
+void platform_mutex_lock(PlatformMutex* mutex);
+
+void platform_mutex_unlock(PlatformMutex* mutex);
+
+void platform_mutex_free(PlatformMutex* mutex);
+
+PlatformCondition* platform_condition_create(void);
+
+void platform_condition_wait(PlatformCondition* cond, PlatformMutex* mutex); // mutex must be locked by caller
+
+void platform_condition_broadcast(PlatformCondition* cond);
+
+void platform_condition_free(PlatformCondition* cond);
+
 #endif
@@ -0,0 +1,155 @@
+#ifndef BGL_RENDER_QUEUE_H
+#define BGL_RENDER_QUEUE_H
+
+#include "defines.h"
+#include "bgl_math.h"
+#include "mesh.h"
+#include "material.h"
+#include "camera.h"
+#include "renderer.h"
+
+/**
+ * per frame list of draws which is sorted before anything is sent to the gpu, so draws sharing a
+ * shader, material or mesh end up next to each other and their state is only set once.
+ * every draw has a 64 bit key, most significant bits first:
+ *  - opaque:      0 (1) | pass (2) | shader (10) | material (16) | mesh (16) | depth (19)
+ *  - transparent: 1 (1) | pass (2) | inverted depth (19) | shader (10) | material (16) | mesh (16)
+ * so every opaque draw comes before every transparent one, passes draw in order within each, opaque
+ * draws are grouped by state and front to back within a group, and transparent draws go back to front.
+ * whether a draw is transparent comes from its material's blend mode, which also decides blending
+ * and depth writes when it's drawn. the opaque and transparent halves are submitted separately, so
+ * anything that has to be behind the transparent draws (the skybox) can go in between.
+ * materials are told apart by their id in a MaterialTable, not their address, so equal materials
+ * copied into different models still share a batch
+ *
+ * the keys are sorted with an lsd radix sort, one pass per byte, skipping bytes every key shares.
+ * the sort is stable so draws with equal keys keep the order they were pushed in
+ *
+ * after sorting, neighbouring draws of the same shader, material id and mesh are one instanced draw.
+ * every draw's data is written to the renderer's draw ring in sorted order, so each batch reads a
+ * contiguous range of it. batches don't cross a BGL_GLSL_DRAWS_PER_BLOCK boundary, so each one is
+ * inside a single window of the ring and the window is only rebound every BGL_GLSL_DRAWS_PER_BLOCK draws.
+ * with the geometry pool on gl 4.3+, neighbouring batches in the same window that only differ in which
+ * range of the pool's buffers they draw go out as one glMultiDrawElementsIndirect. each command's base
+ * instance is where its draws start, so the instance attribute doesn't have to be moved between them
+ */
+
+#define BGL_RENDER_QUEUE_MAX_PASS 3
+#define BGL_RENDER_QUEUE_MAX_SHADERS 1024
+
+typedef struct RenderItem
+{
+    Mesh* mesh;
+    Material* material; // any material with the id's content, read for uniforms and textures
+    mat4* model; // read by render_queue_submit, must still be valid then
+    u32 material_id; // from a MaterialTable, draws with the same id are batched
+    u32 shader_idx;
+} RenderItem;
+
+typedef struct RenderSortEntry
+{
+    u64 key;
+    u32 item;
+} RenderSortEntry;
+
+/* a run of sorted entries with the same shader, material id and mesh, drawn as one instanced draw */
+typedef struct RenderBatch
+{
+    u32 first; // index into entries and the draws written by render_queue_submit
+    u32 count;
+} RenderBatch;
+
+/* layout read by glMultiDrawElementsIndirect */
+typedef struct RenderIndirectCommand
+{
+    u32 count;
+    u32 instance_count;
+    u32 first_index;
+    i32 base_vertex;
+    u32 base_instance;
+} RenderIndirectCommand;
+
+typedef struct RenderQueue
+{
+    RenderItem* items;
+    RenderSortEntry* entries; // sorted by render_queue_sort
+    RenderSortEntry* scratch; // radix sort ping pong buffer
+    RenderBatch* batches;
+    RenderIndirectCommand* commands; // one per batch, only uploaded when multi draw indirect is used
+    u32 count;
+    u32 capacity;
+    u32 batch_count;
+    u32 opaque_batch_count; // batches before the first transparent one
+    u32 ring_first; // draw ring slot of the first sorted entry
+    BOStream indirect_buffer;
+    size_t indirect_offset; // of this frame's commands
+
+    /* set by the last render_queue_submit */
+    u32 draw_count; // instanced and multi draw calls
+    u32 instance_count;
+    u32 shader_changes;
+    u32 material_changes;
+    u32 mesh_changes;
+} RenderQueue;
+
+/**
+ * @brief  create the queue and its indirect buffer, needs a gl context
+ */
+void render_queue_create(RenderQueue* self);
+
+void render_queue_free(RenderQueue* self);
+
+/**
+ * @brief  empty the queue for a new frame, the memory is kept
+ */
+void render_queue_clear(RenderQueue* self);
+
+/**
+ * @param  pass: 0 - BGL_RENDER_QUEUE_MAX_PASS, lower passes are drawn first within the opaque and transparent draws
+ * @param  material_id: the material's id in a MaterialTable, only the low 16 bits are in the key
+ * @param  depth: distance from the camera in 0 - 1, see render_queue_depth. clamped
+ */
+u64 render_queue_key(u32 pass, bool transparent, u32 shader_idx, u32 material_id, const Mesh* mesh, f32 depth);
+
+/**
+ * @brief  view depth of a world position divided by the camera's far plane
+ */
+f32 render_queue_depth(const Camera* cam, vec3 pos);
+
+void render_queue_push(RenderQueue* self, u64 key, const RenderItem* item);
+
+/**
+ * @brief  push a draw per mesh, all at the same depth, transparent if the material is
+ * @param  material_id: the material's id in a MaterialTable, every material equal to it must be pushed with the same one
+ */
+void render_queue_push_meshes(RenderQueue* self, u32 pass, Mesh* meshes, u32 mesh_count, Material* material, u32 material_id,
+                              u32 shader_idx, mat4* model, f32 depth);
+
+void render_queue_sort(RenderQueue* self);
+
+/**
+ * @brief  draw the sorted queue as instanced batches with the renderer's frame block, only changing the shader, material uniforms, textures and vao when they differ from the last batch
+ * @note   same as render_queue_submit_opaque followed by render_queue_submit_transparent
+ */
+void render_queue_submit(RenderQueue* self, Renderer* rd);
+
+/**
+ * @brief  write every draw's data and draw the opaque batches without blending
+ */
+void render_queue_submit_opaque(RenderQueue* self, Renderer* rd);
+
+/**
+ * @brief  draw the transparent batches blended after render_queue_submit_opaque, then turn blending off and depth writes back on
+ */
+void render_queue_submit_transparent(RenderQueue* self, Renderer* rd);
+
+/**
+ * engine/internal functions
+ */
+
+/**
+ * @brief  split the sorted queue into batches and their indirect commands, done by render_queue_submit_opaque
+ */
+void render_queue_build_batches(RenderQueue* self);
+
+#endif
@@ -7,6 +7,14 @@
 #include "defines.h"
 #include "window.h"
 #include "shader.h"
+#include "bo.h"
+#include "camera.h"
+#include "light.h"
+#include "draw_ring.h"
+
+/* define the per frame block only once in glsl and then include */
+#include "frame.glsl"
+typedef struct FrameData FrameData;
 
 typedef enum RendererFlags
 {
@@ -17,8 +25,35 @@ typedef enum RendererFlags
 
     /* user should not modify these flags, internal use only */
     _BGL_RD_VSYNC_ENABLED = 1 << 3,
+
+    BGL_RD_GEOMETRY_POOL = 1 << 4, // meshes share vertex and index buffers, see geometry_pool.h
 } RendererFlags;
 
+/* fixed function state tracked by the state cache */
+typedef enum RendererCapability
+{
+    BGL_RD_CAP_BLEND,
+    BGL_RD_CAP_DEPTH_TEST,
+    BGL_RD_CAP_CULL_FACE,
+    BGL_RD_CAP_COUNT,
+} RendererCapability;
+
+typedef enum RendererStateKind
+{
+    BGL_RD_STATE_PROGRAM,
+    BGL_RD_STATE_VAO,
+    BGL_RD_STATE_TEXTURE, // binds and active unit changes
+    BGL_RD_STATE_SAMPLER, // sampler uniforms pointed at a texture unit
+    BGL_RD_STATE_FIXED_FUNCTION, // enables, cull face, blend and depth state
+    BGL_RD_STATE_KIND_COUNT,
+} RendererStateKind;
+
+typedef struct RendererStateStats
+{
+    u32 issued[BGL_RD_STATE_KIND_COUNT]; // gl calls made
+    u32 skipped[BGL_RD_STATE_KIND_COUNT]; // gl calls avoided because the state was already set
+} RendererStateStats;
+
 /* engine debug editor constants */
 #ifdef BGL_EDITOR
 #define BGL_MAX_EDITOR_PANES 16
@@ -35,6 +70,14 @@ typedef struct Renderer
 
     f64 last_time, delta_time;
     u64 framecount;
+    RendererStateStats state_stats; // of the last frame
+
+    /* uniform block at BGL_GLSL_FRAME_BINDING read by every built-in shader */
+    FrameData frame;
+    BOStream frame_ubo;
+    bool frame_dirty; // frame changed since the last rd_frame_upload
+
+    DrawRing draws; // per draw data of the built-in shaders, see draw_ring.h
 
     ImGuiContext* imgui_ctx; 
     ImGuiIO* imgui_io; 
@@ -138,6 +181,46 @@ void rd_editor_add_pane(Renderer* self, const char* name, bool* user);
 /**
  * engine/internal functions
  */
+/**
+ * @brief  camera part of the frame block, only marked for upload if the camera moved
+ */
+void rd_frame_set_camera(Renderer* self, const Camera* cam);
+void rd_frame_set_lights(Renderer* self, const DirLight* dir_light, u32 light_count);
+void rd_frame_upload(Renderer* self); // does nothing if the frame block hasn't changed
+
 void rd_draw_triangles(u32 ind_count);
+void rd_draw_triangles_base_vertex(u32 ind_count, u32 first_index, i32 base_vertex);
+void rd_draw_triangles_instanced(u32 ind_count, u32 first_index, i32 base_vertex, u32 instance_count); // per instance attributes must be set up on the bound vao
+void rd_multi_draw_triangles_indirect(size_t offset, u32 draw_count); // commands read from the bound GL_DRAW_INDIRECT_BUFFER at offset, gl 4.3+
+
+/**
+ * shadow copy of the gl state the engine changes, so binding what's already bound costs nothing.
+ * all engine code binds programs, vaos and textures and toggles fixed function state through these
+ * instead of calling gl directly, otherwise the cache goes stale. call rd_state_invalidate after
+ * code outside the engine has touched gl state
+ */
+void rd_state_invalidate(void);
+void rd_state_use_program(u32 program);
+void rd_state_bind_vao(u32 vao);
+void rd_state_active_texture(u32 unit);
+void rd_state_bind_texture(u32 unit, bool cubemap, u32 texture); // unit is only made active if the texture wasn't bound to it
+void rd_state_forget_texture(u32 texture); // call when deleting, gl unbinds deleted textures
+void rd_state_forget_vao(u32 vao);
+void rd_state_enable(RendererCapability capability, bool on);
+void rd_state_cull_face(bool back);
+void rd_state_blend_func(u32 src_factor, u32 dst_factor);
+void rd_state_depth_func(u32 func);
+void rd_state_depth_mask(bool write);
+
+/**
+ * @brief  gl 4.5+, resources are created and edited by name through direct state access instead of
+ *         being bound, so loading doesn't touch the state above. set once by rd_init
+ */
+bool rd_state_dsa(void);
+
+/**
+ * @brief  point a sampler uniform at a texture unit, remembered per shader. without dsa the program must be in use
+ */
+void rd_state_sampler(Shader* shader, UniformHandle sampler, u32 unit);
 
 #endif
@@ -4,15 +4,46 @@
 #include "defines.h"
 #include "camera.h"
 #include "model.h"
+#include "render_queue.h"
 #include "skybox.h"
 #include "arena.h"
 #include "bgl_math.h"
 #include "light.h"
+#include "ecs/ecs.h"
+#include "ecs/physics_system.h"
 
 #include "defines.glsl"
 
 /* uv sphere resolution for default light model */
 #define BGL_LIGHT_SPHERE_RES 8
+#define BGL_LIGHT_SPHERE_SCALE 0.3f
+#define BGL_SCENE_LIGHT_GIZMO 0xFFFFFFFF // light_models entry of a light drawn with the scene's shared sphere
+
+/**
+ * packed per model data read by scene_draw, kept apart from the rest of Model (directory, transform etc.)
+ * so drawing doesn't drag unused data through the cache. mirrors scene->models, see scene_sync_model.
+ * the materials are interned in the draw list's material table, so models with equal materials share
+ * one entry and are batched together. the render queue reads the blend mode, colours and textures
+ * from the entries instead of the models
+ */
+typedef struct SceneDrawItem
+{
+    mat4 model;
+    vec3 bounds_min, bounds_max; // world space
+    Mesh* meshes;
+    Material* material; // entry of material_id, entries don't move
+    u32 mesh_count;
+    u32 shader_idx;
+    u32 material_id; // in the draw list's materials
+    MaterialFlags flags;
+} SceneDrawItem;
+
+typedef struct SceneDrawList
+{
+    SceneDrawItem* items;
+    MaterialTable materials; // one entry per distinct material, the light gizmo's and entities' too
+    u32 count;
+} SceneDrawList;
 
 /* need to do this to define callback and also have it in the scene struct */
 typedef struct Scene Scene;
@@ -20,21 +51,34 @@ typedef void (*SceneUpdateFunc)(Scene* scene);
 
 typedef enum SceneFlags {
     BGL_SCENE_HAS_SKYBOX = 1 << 0,
+    BGL_SCENE_HAS_LIGHT_GIZMO = 1 << 1,
 } SceneFlags;
 
 typedef struct Scene {
     Camera cam;
 
-    Model* models;
+    Model* models; // cold data, drawing reads draw_list
     u32 model_count;
+    u32 model_capacity;
+    SceneDrawList draw_list;
+    RenderQueue queue; // refilled and sorted by every scene_draw
     Model skybox;
 
     // TODO: move into it's own light manager thingy?
     Light lights[BGL_GLSL_MAX_POINT_LIGHTS];
-    u32 light_models[BGL_GLSL_MAX_POINT_LIGHTS];
+    u32 light_models[BGL_GLSL_MAX_POINT_LIGHTS]; // index into models or BGL_SCENE_LIGHT_GIZMO
+    Model light_gizmo; // one sphere instanced at every light added without a model
+    u32 light_gizmo_material; // id in draw_list.materials
+    mat4 light_gizmo_matrices[BGL_GLSL_MAX_POINT_LIGHTS];
     i32 light_count;
-    UBO light_ubo;
+    BOStream light_stream; // gl 4.4+, every light is written to the next region when any changes
+    UBO light_ubo; // gl 3.3, only the dirty lights are uploaded
     DirLight dir_light;
+    u32 dirty_lights; // bit per light which needs uploading, flushed in scene_update
+
+    /* entities, updated by the scene's systems each scene_update */
+    World world;
+    PhysicsWorld physics; // stepped after the systems so collider transforms are current
 
     SceneUpdateFunc user_update_func;
 
@@ -62,6 +106,13 @@ void scene_set_skybox(Scene* self, Arena* scratch, Renderer* rd, const char* cub
  */
 void scene_set_update_callback(Scene* self, SceneUpdateFunc func);
 
+/**
+ * @brief  add a system to the scene's world. runs after the built-in physics and transform systems if it conflicts with them
+ * @note   see ecs_add_system for how read/write access is used to run systems in parallel
+ * @returns system index
+ */
+u32 scene_add_system(Scene* self, const char* name, SystemFunc func, ComponentMask read, ComponentMask write, void* user);
+
 /**
  * @brief add model to scene. scene copies the inputted model, if heap allocated must free yourself
  * @returns the index of the model in scene->models
@@ -71,7 +122,7 @@ u32 scene_add_model(Scene* self, const Model* model);
 /**
  * @brief adds light to scene. scene copies the inputted light and model. if heap allocated, must free yourself
  * @param  scratch:  if a specific model is specified this is not necessary and can be set to NULL. arena for doing temp work in. arena is reset back to its initial position before returning.
- * @param  model: an optional model that is aligned with the light and has the same material (pass NULL to create default sphere, must provide an arena)
+ * @param  model: an optional model that is aligned with the light and has the same material (pass NULL to use the default sphere, an arena must be provided for the first)
  * @returns bool denoting if light was successfully added
  */
 bool scene_add_light(Scene* self, Arena* scratch, Renderer* rd, const Light* light, const Model* model);
@@ -83,13 +134,25 @@ bool scene_add_light(Scene* self, Arena* scratch, Renderer* rd, const Light* lig
 bool scene_set_dir_light(Scene* self, const DirLight* light);
 
 /**
- * @brief  a function which updates the light data and syncs it with the GPU
- * @note   call this when you have added or changed some of the lights
+ * @brief  replace a light, it's uploaded on the next scene_update
+ * @note   see scene_update_light_data for what's uploaded
+ * @returns bool denoting if index was valid
+ */
+bool scene_set_light(Scene* self, u32 index, const Light* light);
+
+/**
+ * @brief  a function which updates all of the light data and syncs it with the GPU
+ * @note   call this when you have changed lights directly through self->lights. prefer scene_set_light, which only marks that light
+ *         dirty, so on gl 3.3 only it is uploaded
  */
 void scene_update_lights(Scene* self, Renderer* rd);
 
 /**
- * @brief  update light data without rendering it to the screen
+ * @brief  upload dirty light data without rendering it to the screen
+ * @note   with persistent mapping (gl 4.4+) each upload goes to the next region of a stream so it never waits
+ *         on the gpu, and the region doesn't have the last one's lights so all of them are written (at most
+ *         BGL_GLSL_MAX_POINT_LIGHTS, a few kilobytes). on gl 3.3 orphaning would rewrite everything too, so
+ *         each run of dirty lights is uploaded in place with glBufferSubData instead
  * @note   use this if you want to update light data for another scene while a different one is being rendered, so as to prevent disturbing that scene's graphics
  */
 void scene_update_light_data(Scene* self);
@@ -100,10 +163,30 @@ void scene_update_light_data(Scene* self);
  */
 void scene_switch(Scene* self, Renderer* rd);
 
+/**
+ * @brief  calls the user update callback, runs the scene's ecs systems and updates the camera
+ */
 void scene_update(Scene* self, Renderer* rd);
 
+/**
+ * @brief  draws the scene's models and every entity with a ModelMatrix and MeshRef (e.g. prefab instances)
+ *         through the render queue, opaque draws sorted by shader, material and mesh, then the skybox,
+ *         then transparent draws back to front
+ */
 void scene_draw(Scene* self, Renderer* rd);
 
+/**
+ * @brief  fill the scene's render queue with every draw scene_draw makes, without sorting or drawing them
+ * @note   the queue points into the scene's draw data and entities, so it's only valid until they change
+ */
+void scene_queue_draws(Scene* self);
+
 void scene_free(Scene* self);
 
+/**
+ * @brief  copy scene->models[index] into the draw data, interning its material and releasing the one it had
+ * @note   call it after model_update_transform on a scene model, or after changing its shader, meshes or material (flags, blend, colours or textures) directly
+ */
+void scene_sync_model(Scene* self, u32 index);
+
 #endif
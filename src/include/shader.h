@@ -8,16 +8,38 @@
 /* internal definitions */
 #define MAX_UNIFORM_NAME 128 
 #define MAX_SHADER_FILEPATH 128
+#define BGL_UNIFORM_NONE 0xFFFFFFFF // handle of a uniform the program doesn't have, setting it does nothing
+
+/* index into Shader.uniforms, resolve once with shader_uniform_handle and set with shader_set_* */
+typedef u32 UniformHandle;
+
+/* per draw uniforms set by the engine, their handles are resolved when the shader is created.
+ * camera and lights are in the frame block, see renderer.h */
+typedef enum ShaderBuiltinUniform
+{
+    BGL_UNIFORM_MATERIAL_AMBIENT,
+    BGL_UNIFORM_MATERIAL_DIFFUSE,
+    BGL_UNIFORM_MATERIAL_SPECULAR,
+    BGL_UNIFORM_MATERIAL_SHININESS,
+    BGL_UNIFORM_TEXTURE_DIFFUSE,
+    BGL_UNIFORM_TEXTURE_SPECULAR,
+    BGL_UNIFORM_TEXTURE_NORMAL,
+    BGL_UNIFORM_BUILTIN_COUNT,
+} ShaderBuiltinUniform;
+
 typedef struct Uniform {
     char name[MAX_UNIFORM_NAME];
+    u32 hash; // of the name, compared before the name when looking one up
     i32 location;
+    i32 sampler_unit; // unit last given to this sampler by rd_state_sampler, -1 if not known
 } Uniform;
 
 typedef struct Shader
 {
     u32 id;
-    Uniform* uniforms;
+    Uniform* uniforms; // every active uniform outside of blocks, from glGetActiveUniform
     u32 uniform_count;
+    UniformHandle builtins[BGL_UNIFORM_BUILTIN_COUNT];
     #ifdef BGL_EDITOR
     char sources[3][MAX_SHADER_FILEPATH];
     char name[MAX_SHADER_FILEPATH];
@@ -26,8 +48,26 @@ typedef struct Shader
 
 bool shader_create(Shader* self, Arena* scratch, const char* const* shader_filepaths, u32 shader_count, const char* version_str, bool no_uniform_bindings);
 
-i32 shader_find_uniform(Shader* self, const char* name);
+/**
+ * @brief  look up a uniform once so it can be set without the name
+ * @returns BGL_UNIFORM_NONE if the program has no active uniform called name
+ */
+UniformHandle shader_uniform_handle(const Shader* self, const char* name);
+
+/**
+ * @returns location of the uniform, -1 if the program doesn't have it
+ */
+i32 shader_find_uniform(const Shader* self, const char* name);
+
+/* set uniforms by handle, the shader has to be in use unless dsa is available (see rd_state_dsa) */
+void shader_set_mat4(Shader* self, UniformHandle handle, const mat4* mat);
+void shader_set_vec4(Shader* self, UniformHandle handle, const vec4* vec);
+void shader_set_vec3(Shader* self, UniformHandle handle, const vec3* vec);
+void shader_set_vec2(Shader* self, UniformHandle handle, const vec2* vec);
+void shader_set_f32(Shader* self, UniformHandle handle, f32 f);
+void shader_set_int(Shader* self, UniformHandle handle, i32 i);
 
+/* set uniforms by name, same as the handle versions otherwise, each call looks the name up. prefer handles for anything set every frame */
 void shader_uniform_mat4(Shader* self, const char* name, mat4* mat);
 void shader_uniform_vec4(Shader* self, const char* name, vec4* vec);
 void shader_uniform_vec3(Shader* self, const char* name, vec3* vec);
@@ -47,6 +47,6 @@ typedef struct ShaderParser
     } shader_type;
 } ShaderParser;
 
-char* shader_process(ShaderParser* parser, Shader* shader, Arena* scratch);
+char* shader_process(ShaderParser* parser, Arena* scratch);
 
 #endif
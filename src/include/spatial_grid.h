@@ -0,0 +1,67 @@
+#ifndef BGL_SPATIAL_GRID_H
+#define BGL_SPATIAL_GRID_H
+
+#include "defines.h"
+#include "bgl_math.h"
+#include "arena.h"
+
+/**
+ * uniform grid over points, meant to be rebuilt every frame for crowds, projectiles and boids where
+ * a tree costs more to keep up than it saves. space is split into cubes of cell_size and the cubes
+ * are hashed into a power of two table of buckets, so the world has no bounds.
+ *
+ * the build is a counting sort run with jobs_parallel_for: every point's bucket is found and
+ * counted, the counts are prefix summed into bucket starts and the points are scattered into their
+ * bucket. each bucket is then sorted by input index, so the result doesn't depend on the thread count.
+ * the points of a bucket end up next to each other together with their ids.
+ *
+ * everything is allocated from the arena passed to the build (about 24 bytes per point and 8 per
+ * bucket), nothing is freed, collapse or reset the arena once the grid isn't needed anymore.
+ * queries only read the grid so any thread can run them.
+ *
+ * pick a cell_size close to the radius of the queries, a query then visits 27 cells at most
+ */
+
+#define BGL_SPATIAL_GRID_NULL 0xFFFFFFFF
+
+typedef struct SpatialGrid
+{
+    f32 cell_size;
+    f32 inv_cell_size;
+    u32 bucket_mask; // bucket count - 1
+    u32 count;
+    u32* bucket_starts; // bucket_mask + 2 entries, the points of bucket b are [bucket_starts[b], bucket_starts[b + 1])
+    u32* ids; // of the points in bucket order
+    vec3* points; // in bucket order
+} SpatialGrid;
+
+/**
+ * @brief  sort points into the grid
+ * @param  ids: stored with the points and returned by queries, pass NULL to use the point's index
+ * @param  cell_size: bigger than 0
+ */
+void spatial_grid_build(SpatialGrid* self, Arena* arena, const vec3* points, const u32* ids, u32 count, f32 cell_size);
+
+/**
+ * @brief  find the points within radius of centre
+ * @returns total number of points found, only the first max_ids are written
+ */
+u32 spatial_grid_query_radius(const SpatialGrid* self, vec3 centre, f32 radius, u32* ids_out, u32 max_ids);
+
+/**
+ * @brief  closest point within max_radius of centre, skipping the one with ignore_id
+ * @param  ignore_id: BGL_SPATIAL_GRID_NULL to skip nothing
+ * @returns id of the point, BGL_SPATIAL_GRID_NULL if there is none
+ */
+u32 spatial_grid_query_nearest(const SpatialGrid* self, vec3 centre, f32 max_radius, u32 ignore_id);
+
+/**
+ * @brief  find the neighbours of every point in the grid in parallel. points are handled in bucket
+ *         order (the order of ids and points) which keeps the cells being read in cache
+ * @param  neighbours_out: max_neighbours ids per point, the ones of points[i] start at i * max_neighbours. a point isn't its own neighbour
+ * @param  counts_out: neighbours written per point
+ * @returns total number of neighbours found, including ones that didn't fit
+ */
+u64 spatial_grid_neighbours(const SpatialGrid* self, f32 radius, u32 max_neighbours, u32* neighbours_out, u32* counts_out);
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <glad/glad.h>
 #include "defines.h"
+#include "shader.h"
 
 #define MAX_PATH_LENGTH 128
 
@@ -71,10 +72,11 @@ void texture_free(Texture* self);
  */
 void textures_init(void);
 
-void texture_bind(Texture* self);
+void texture_bind(Texture* self, u32 unit);
 
 void texture_unit_active(u32 unit);
 
 const char* texture_type_get_str(TextureType type);
+ShaderBuiltinUniform texture_type_get_uniform(TextureType type); // sampler uniform of the type
 
 #endif
@@ -1,6 +1,8 @@
 #ifndef BGL_TRANSFORM_H
 #define BGL_TRANSFORM_H
 
+#include "bgl_math.h"
+
 typedef struct Transform {
     vec3 pos;
     vec3 euler;
@@ -17,4 +19,20 @@ static inline void transform_reset(Transform* transform)
     transform->scale = VEC3(1.0f, 1.0f, 1.0f);
 }
 
-#endif
\ No newline at end of file
+/**
+ * @brief  calculate model matrix from transform (scale, then pitch/yaw/roll, then translation)
+ */
+static inline void transform_to_matrix(const Transform* transform, mat4* out)
+{
+    mat4_identity(out);
+
+    mat4_scale(out, transform->scale);
+
+    mat4_rotate_x(out, RADIANS(transform->euler.x)); // pitch
+    mat4_rotate_y(out, RADIANS(transform->euler.y)); // yaw
+    mat4_rotate_z(out, RADIANS(transform->euler.z)); // roll
+
+    mat4_trans(out, transform->pos);
+}
+
+#endif
@@ -0,0 +1,118 @@
+#ifndef BGL_TRIANGLE_MESH_H
+#define BGL_TRIANGLE_MESH_H
+
+#include "defines.h"
+#include "bgl_math.h"
+
+/**
+ * cpu copy of a mesh's triangles for collision and raycasts, with a bounding volume hierarchy built
+ * using the surface area heuristic. each leaf holds up to BGL_TRIANGLE_PACKET_SIZE triangles in one
+ * structure of arrays packet, so a leaf is tested with a single loop the compiler vectorises.
+ *
+ * the top of the tree is split on the calling thread and the subtrees below it are built in
+ * parallel with jobs_parallel_for. every node gets a slot from the split that made it,
+ * so the result doesn't depend on the thread count.
+ *
+ * everything lives in one block laid out like the file, so saving writes the block and loading
+ * maps the file and points into it, no rebuild needed.
+ *
+ * triangles are numbered in the order of the packets (packet * BGL_TRIANGLE_PACKET_SIZE + lane),
+ * source_ids maps them back to the triangle in the indices the mesh was built from
+ */
+
+#define BGL_TRIANGLE_PACKET_SIZE 4
+#define BGL_TRIANGLE_MESH_MAX_DEPTH 64 // traversal stack size, the build keeps the tree inside it
+#define BGL_TRIANGLE_MESH_MAGIC 0x544C4742 // "BGLT"
+#define BGL_TRIANGLE_MESH_VERSION 1
+#define BGL_TRIANGLE_NULL 0xFFFFFFFF // source id of the unused lanes of a packet
+
+/* corners are corner0, corner0 + edge1 and corner0 + edge2, unused lanes are degenerate */
+typedef struct TrianglePacket
+{
+    f32 corner0[3][BGL_TRIANGLE_PACKET_SIZE]; // x, y and z of every lane
+    f32 edge1[3][BGL_TRIANGLE_PACKET_SIZE];
+    f32 edge2[3][BGL_TRIANGLE_PACKET_SIZE];
+} TrianglePacket;
+
+typedef struct TriangleMeshNode
+{
+    vec3 min;
+    u32 first; // leaves: packet, interior nodes: first child, the second child follows it
+    vec3 max;
+    u32 count; // triangles in a leaf's packet, 0 for interior nodes
+} TriangleMeshNode;
+
+typedef struct TriangleMesh
+{
+    TriangleMeshNode* nodes; // root first
+    TrianglePacket* packets;
+    u32* source_ids; // source triangle of every packet lane
+    u32 node_count;
+    u32 packet_count;
+    u32 triangle_count; // in the source, degenerate ones included
+    u64 source_hash; // see triangle_mesh_hash
+
+    void* memory; // block the arrays point into, mapped when loaded from a file
+    u64 memory_size;
+    bool mapped;
+} TriangleMesh;
+
+typedef struct TriangleMeshHit
+{
+    f32 t; // in multiples of the ray's dir
+    u32 triangle;
+    vec3 normal; // unit, counter clockwise winding faces it
+} TriangleMeshHit;
+
+/**
+ * @brief  copy the triangles and build the bvh, degenerate triangles are kept but never hit
+ * @param  indices: three per triangle, all below vertex_count
+ * @returns bool denoting if the mesh was built
+ */
+bool triangle_mesh_create(TriangleMesh* self, const vec3* vertices, u32 vertex_count, const u32* indices, u32 index_count);
+
+void triangle_mesh_free(TriangleMesh* self);
+
+/**
+ * @brief  write the mesh so triangle_mesh_load can map it instead of building it again
+ * @returns bool denoting if the file was written
+ */
+bool triangle_mesh_save(const TriangleMesh* self, const char* path);
+
+/**
+ * @brief  map a file written by triangle_mesh_save, compare source_hash with triangle_mesh_hash to see if it's stale
+ * @note   the file stays mapped until triangle_mesh_free
+ * @returns bool denoting if the mesh was loaded
+ */
+bool triangle_mesh_load(TriangleMesh* self, const char* path);
+
+/**
+ * @brief  hash of the data a mesh is built from, stored in the mesh as source_hash
+ */
+u64 triangle_mesh_hash(const vec3* vertices, u32 vertex_count, const u32* indices, u32 index_count);
+
+/**
+ * @brief  bounds of every triangle, zero for an empty mesh
+ */
+void triangle_mesh_get_bounds(const TriangleMesh* self, vec3* min_out, vec3* max_out);
+
+/**
+ * @brief  corners of a triangle returned by a query
+ */
+void triangle_mesh_get_triangle(const TriangleMesh* self, u32 triangle, vec3 corners_out[3]);
+
+/**
+ * @brief  closest triangle hit by the ray within max_t, triangles are hit from either side
+ * @param  dir: doesn't need to be normalised
+ * @returns bool denoting if anything was hit
+ */
+bool triangle_mesh_raycast(const TriangleMesh* self, vec3 origin, vec3 dir, f32 max_t, TriangleMeshHit* hit_out);
+
+/**
+ * @brief  find triangles touching a box or a sphere, exact tests rather than bounds, degenerate triangles are skipped
+ * @returns total number of triangles found, only the first max_triangles are written
+ */
+u32 triangle_mesh_query_box(const TriangleMesh* self, vec3 min, vec3 max, u32* triangles_out, u32 max_triangles);
+u32 triangle_mesh_query_sphere(const TriangleMesh* self, vec3 centre, f32 radius, u32* triangles_out, u32 max_triangles);
+
+#endif
@@ -4,6 +4,8 @@
 #include <glad/glad.h>
 #include <stddef.h>
 #include "defines.h"
+#include "bgl_math.h"
+#include "bo.h"
 
 typedef struct VAO
 {
@@ -16,7 +18,23 @@ void vao_bind(VAO self);
 
 void vao_unbind(void);
 
-void vao_attribute(GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset);
+/**
+ * @note   the setup functions edit the vao by name with dsa, otherwise they bind it and leave it bound
+ */
+void vao_attribute(VAO self, VBO vbo, GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset);
+
+void vao_element_buffer(VAO self, EBO ebo);
+
+/**
+ * @brief  point an integer attribute at tightly packed u32s in vbo, advancing once per instance
+ * @param  offset: byte offset of the first instance's value
+ */
+void vao_instance_uint(VAO self, VBO vbo, GLuint index, size_t offset);
+
+/**
+ * @brief  give every vertex the same value for an integer attribute, for drawing without an instance buffer
+ */
+void vao_constant_uint(VAO self, GLuint index, u32 value);
 
 void vao_free(VAO self);
 
@@ -0,0 +1,182 @@
+#include "jobs.h"
+
+#include <stdatomic.h>
+#include "defines.h"
+#include "platform.h"
+
+/**
+ * only one parallel_for is in flight at a time, so the pool just holds the current task.
+ * workers sleep on the wake condition until the task generation changes, then grab batches
+ * off the shared counter until it runs past the end
+ */
+static struct
+{
+    PlatformThread* threads[BGL_JOBS_MAX_WORKERS];
+    u32 worker_count;
+
+    PlatformMutex* mutex;
+    PlatformCondition* wake;
+    PlatformCondition* done;
+
+    /* current task, only written while holding the mutex and no workers are active */
+    JobFunc func;
+    void* data;
+    u32 count;
+    u32 batch_size;
+    u64 generation;
+    u32 active_workers; // workers which have read the current task and may still touch the counters
+    bool quit;
+
+    atomic_uint next;
+    atomic_uint remaining;
+} jobs_ctx;
+
+static _Thread_local bool jobs_in_job = false;
+
+/**
+ * internal functions
+ */
+void jobs_worker_main(void* arg);
+void jobs_run_batches(u32 worker);
+
+void jobs_init(u32 worker_count)
+{
+    if(worker_count == 0)
+    {
+        worker_count = platform_get_processor_count() - 1;
+    }
+    worker_count = worker_count > BGL_JOBS_MAX_WORKERS ? BGL_JOBS_MAX_WORKERS : worker_count;
+
+    jobs_ctx.worker_count = worker_count;
+    jobs_ctx.mutex = platform_mutex_create();
+    jobs_ctx.wake = platform_condition_create();
+    jobs_ctx.done = platform_condition_create();
+    jobs_ctx.func = NULL;
+    jobs_ctx.generation = 0;
+    jobs_ctx.active_workers = 0;
+    jobs_ctx.quit = false;
+    atomic_init(&jobs_ctx.next, 0);
+    atomic_init(&jobs_ctx.remaining, 0);
+
+    for(u32 i = 0; i < worker_count; i++)
+    {
+        /* worker 0 is the calling thread */
+        jobs_ctx.threads[i] = platform_thread_create(jobs_worker_main, (void*)(u64)(i + 1));
+    }
+
+    BGL_LOG_INFO("started %u worker threads", worker_count);
+}
+
+u32 jobs_thread_count(void)
+{
+    return jobs_ctx.worker_count + 1;
+}
+
+void jobs_parallel_for(u32 count, u32 batch_size, JobFunc func, void* data)
+{
+    if(count == 0) return;
+    batch_size = batch_size == 0 ? 1 : batch_size;
+
+    /* nothing to share the work with, or we are already a job and the pool is busy */
+    if(jobs_ctx.worker_count == 0 || jobs_in_job || count <= batch_size)
+    {
+        func(data, 0, count, 0);
+        return;
+    }
+
+    platform_mutex_lock(jobs_ctx.mutex);
+        jobs_ctx.func = func;
+        jobs_ctx.data = data;
+        jobs_ctx.count = count;
+        jobs_ctx.batch_size = batch_size;
+        atomic_store(&jobs_ctx.next, 0);
+        atomic_store(&jobs_ctx.remaining, count);
+        jobs_ctx.generation++;
+        platform_condition_broadcast(jobs_ctx.wake);
+    platform_mutex_unlock(jobs_ctx.mutex);
+
+    jobs_in_job = true;
+    jobs_run_batches(0);
+    jobs_in_job = false;
+
+    /* wait for stragglers, and for every worker to stop touching the counters before the task can be replaced */
+    platform_mutex_lock(jobs_ctx.mutex);
+        while(atomic_load(&jobs_ctx.remaining) != 0 || jobs_ctx.active_workers != 0)
+        {
+            platform_condition_wait(jobs_ctx.done, jobs_ctx.mutex);
+        }
+        jobs_ctx.func = NULL;
+    platform_mutex_unlock(jobs_ctx.mutex);
+}
+
+void jobs_free(void)
+{
+    if(jobs_ctx.mutex == NULL) return;
+
+    platform_mutex_lock(jobs_ctx.mutex);
+        jobs_ctx.quit = true;
+        platform_condition_broadcast(jobs_ctx.wake);
+    platform_mutex_unlock(jobs_ctx.mutex);
+
+    for(u32 i = 0; i < jobs_ctx.worker_count; i++)
+    {
+        platform_thread_join(jobs_ctx.threads[i]);
+    }
+
+    platform_condition_free(jobs_ctx.wake);
+    platform_condition_free(jobs_ctx.done);
+    platform_mutex_free(jobs_ctx.mutex);
+    jobs_ctx.mutex = NULL;
+    jobs_ctx.worker_count = 0;
+}
+
+void jobs_run_batches(u32 worker)
+{
+    const u32 count = jobs_ctx.count;
+    const u32 batch_size = jobs_ctx.batch_size;
+
+    while(true)
+    {
+        u32 start = atomic_fetch_add(&jobs_ctx.next, batch_size);
+        if(start >= count) return;
+
+        u32 end = start + batch_size > count ? count : start + batch_size;
+        jobs_ctx.func(jobs_ctx.data, start, end, worker);
+
+        if(atomic_fetch_sub(&jobs_ctx.remaining, end - start) == end - start) // we finished the last batch
+        {
+            platform_mutex_lock(jobs_ctx.mutex);
+                platform_condition_broadcast(jobs_ctx.done);
+            platform_mutex_unlock(jobs_ctx.mutex);
+        }
+    }
+}
+
+void jobs_worker_main(void* arg)
+{
+    const u32 worker = (u32)(u64)arg;
+    u64 seen_generation = 0;
+
+    jobs_in_job = true;
+
+    platform_mutex_lock(jobs_ctx.mutex);
+    while(true)
+    {
+        while(!jobs_ctx.quit && (jobs_ctx.generation == seen_generation || jobs_ctx.func == NULL))
+        {
+            platform_condition_wait(jobs_ctx.wake, jobs_ctx.mutex);
+        }
+        if(jobs_ctx.quit) break;
+
+        seen_generation = jobs_ctx.generation;
+        jobs_ctx.active_workers++;
+        platform_mutex_unlock(jobs_ctx.mutex);
+
+        jobs_run_batches(worker);
+
+        platform_mutex_lock(jobs_ctx.mutex);
+        jobs_ctx.active_workers--;
+        if(jobs_ctx.active_workers == 0) platform_condition_broadcast(jobs_ctx.done);
+    }
+    platform_mutex_unlock(jobs_ctx.mutex);
+}
@@ -2,15 +2,31 @@
 
 #include "defines.h"
 #include "texture.h"
+#include "renderer.h"
 #include <stdlib.h>
 #include <string.h>
 
-static const char* material_members[] = {
-    "material.ambient",
-    "material.diffuse",
-    "material.specular",
-    "material.shininess",
-};
+#define MATERIAL_TABLE_MIN_BUCKETS 64
+
+/**
+ * internal functions
+ */
+u32 material_table_hash(const Material* mat, u32 shader_idx);
+bool material_table_equal(const MaterialTableEntry* entry, const Material* mat, u32 shader_idx, u32 hash);
+void material_table_rehash(MaterialTable* self, u32 bucket_count);
+
+static inline MaterialTableEntry* material_table_entry(const MaterialTable* self, u32 id)
+{
+    return &self->pages[id / BGL_MATERIAL_TABLE_PAGE_SIZE][id % BGL_MATERIAL_TABLE_PAGE_SIZE];
+}
+
+/* fnv-1a, floats are hashed and compared by their bits so the two always agree */
+static inline u32 material_hash_bytes(u32 hash, const void* data, size_t size)
+{
+    const u8* bytes = (const u8*)data;
+    for(size_t i = 0; i < size; i++) hash = (hash ^ bytes[i]) * 16777619u;
+    return hash;
+}
 
 void material_create(Material* mat, bool is_cubemap_shader, vec3 ambient, vec3 diffuse, vec3 specular, f32 shininess)
 {
@@ -18,8 +34,10 @@ void material_create(Material* mat, bool is_cubemap_shader, vec3 ambient, vec3 d
     mat->diffuse = diffuse;
     mat->specular = specular;
     mat->shininess = shininess;
+    mat->opacity = 1.0f;
 
     mat->flags = is_cubemap_shader ? BGL_MATERIAL_USE_CUBEMAP_TEXTURES : 0;
+    mat->blend = BGL_MATERIAL_BLEND_OPAQUE;
 
     mat->textures = (Texture*)BGL_MALLOC(2 * sizeof(Texture)); // diffuse and specular
     mat->tex_count = 2;
@@ -83,10 +101,24 @@ void material_set_uniforms(Material* mat, Shader* shader)
 {
     if(mat->flags & BGL_MATERIAL_NO_LIGHTING) return;
 
-    shader_uniform_vec3(shader, material_members[0], &mat->ambient);
-    shader_uniform_vec3(shader, material_members[1], &mat->diffuse);
-    shader_uniform_vec3(shader, material_members[2], &mat->specular);
-    shader_uniform_f32(shader, material_members[3], mat->shininess);
+    shader_set_vec3(shader, shader->builtins[BGL_UNIFORM_MATERIAL_AMBIENT], &mat->ambient);
+    shader_set_vec3(shader, shader->builtins[BGL_UNIFORM_MATERIAL_DIFFUSE], &mat->diffuse);
+    shader_set_vec3(shader, shader->builtins[BGL_UNIFORM_MATERIAL_SPECULAR], &mat->specular);
+    shader_set_f32(shader, shader->builtins[BGL_UNIFORM_MATERIAL_SHININESS], mat->shininess);
+}
+
+void material_set_blend(Material* mat, MaterialBlend blend, f32 opacity)
+{
+    mat->blend = blend;
+    mat->opacity = blend == BGL_MATERIAL_BLEND_OPAQUE ? 1.0f : CLAMP(opacity, 0.0f, 1.0f);
+}
+
+void material_set_blend_state(const Material* mat)
+{
+    /* transparent draws are still depth tested against the opaque ones, but don't hide each other */
+    const bool transparent = mat->blend == BGL_MATERIAL_BLEND_TRANSPARENT;
+    rd_state_enable(BGL_RD_CAP_BLEND, transparent);
+    rd_state_depth_mask(!transparent);
 }
 
 void material_free(Material* mat)
@@ -103,3 +135,158 @@ void material_free(Material* mat)
     }
     BGL_FREE(mat->textures);
 }
+
+void material_table_create(MaterialTable* self)
+{
+    memset(self, 0, sizeof(MaterialTable));
+    self->free_first = BGL_MATERIAL_NONE;
+    material_table_rehash(self, MATERIAL_TABLE_MIN_BUCKETS);
+}
+
+void material_table_free(MaterialTable* self)
+{
+    for(u32 i = 0; i < self->page_count; i++)
+    {
+        BGL_FREE(self->pages[i]);
+    }
+    if(self->pages != NULL) BGL_FREE(self->pages);
+    if(self->buckets != NULL) BGL_FREE(self->buckets);
+    memset(self, 0, sizeof(MaterialTable));
+}
+
+u32 material_table_intern(MaterialTable* self, const Material* mat, u32 shader_idx)
+{
+    u32 id = material_table_find(self, mat, shader_idx);
+    if(id != BGL_MATERIAL_NONE)
+    {
+        material_table_entry(self, id)->refs++;
+        return id;
+    }
+
+    if(self->free_first != BGL_MATERIAL_NONE)
+    {
+        id = self->free_first;
+        self->free_first = material_table_entry(self, id)->next;
+    }
+    else
+    {
+        if(self->count == self->page_count * BGL_MATERIAL_TABLE_PAGE_SIZE)
+        {
+            self->pages = (MaterialTableEntry**)BGL_REALLOC(self->pages, (self->page_count + 1) * sizeof(MaterialTableEntry*));
+            BGL_ASSERT(self->pages != NULL, "material table reallocation failed");
+            self->pages[self->page_count] = (MaterialTableEntry*)BGL_MALLOC(BGL_MATERIAL_TABLE_PAGE_SIZE * sizeof(MaterialTableEntry));
+            BGL_ASSERT(self->pages[self->page_count] != NULL, "material table page allocation failed");
+            self->page_count++;
+        }
+        id = self->count++;
+    }
+
+    MaterialTableEntry* entry = material_table_entry(self, id);
+    entry->material = *mat;
+    entry->shader_idx = shader_idx;
+    entry->hash = material_table_hash(mat, shader_idx);
+    entry->refs = 1;
+
+    /* growing links every used entry, this one included */
+    if(++self->used > self->bucket_count)
+    {
+        material_table_rehash(self, self->bucket_count * 2);
+        return id;
+    }
+
+    u32* bucket = &self->buckets[entry->hash & (self->bucket_count - 1)];
+    entry->next = *bucket;
+    *bucket = id;
+    return id;
+}
+
+u32 material_table_find(const MaterialTable* self, const Material* mat, u32 shader_idx)
+{
+    const u32 hash = material_table_hash(mat, shader_idx);
+    for(u32 id = self->buckets[hash & (self->bucket_count - 1)]; id != BGL_MATERIAL_NONE;)
+    {
+        const MaterialTableEntry* entry = material_table_entry(self, id);
+        if(material_table_equal(entry, mat, shader_idx, hash)) return id;
+        id = entry->next;
+    }
+    return BGL_MATERIAL_NONE;
+}
+
+void material_table_release(MaterialTable* self, u32 id)
+{
+    BGL_ASSERT(id < self->count, "material id %u given to material_table_release is out of range", id);
+    MaterialTableEntry* entry = material_table_entry(self, id);
+    BGL_ASSERT(entry->refs > 0, "material id %u released more times than it was interned", id);
+    if(--entry->refs > 0) return;
+
+    /* unlink it from its bucket, then it's the first to be reused */
+    u32* link = &self->buckets[entry->hash & (self->bucket_count - 1)];
+    while(*link != id) link = &material_table_entry(self, *link)->next;
+    *link = entry->next;
+
+    entry->next = self->free_first;
+    self->free_first = id;
+    self->used--;
+}
+
+Material* material_table_get(const MaterialTable* self, u32 id)
+{
+    BGL_ASSERT(id < self->count, "material id %u out of range", id);
+    return &material_table_entry(self, id)->material;
+}
+
+u32 material_table_hash(const Material* mat, u32 shader_idx)
+{
+    u32 hash = 2166136261u;
+    hash = material_hash_bytes(hash, &shader_idx, sizeof(u32));
+    hash = material_hash_bytes(hash, &mat->ambient, sizeof(vec3));
+    hash = material_hash_bytes(hash, &mat->diffuse, sizeof(vec3));
+    hash = material_hash_bytes(hash, &mat->specular, sizeof(vec3));
+    hash = material_hash_bytes(hash, &mat->shininess, sizeof(f32));
+    hash = material_hash_bytes(hash, &mat->opacity, sizeof(f32));
+    hash = material_hash_bytes(hash, &mat->flags, sizeof(MaterialFlags));
+    hash = material_hash_bytes(hash, &mat->blend, sizeof(MaterialBlend));
+    hash = material_hash_bytes(hash, &mat->tex_count, sizeof(u32));
+    for(u32 i = 0; i < mat->tex_count; i++)
+    {
+        hash = material_hash_bytes(hash, &mat->textures[i].id, sizeof(u32));
+        hash = material_hash_bytes(hash, &mat->textures[i].type, sizeof(TextureType));
+    }
+    return hash;
+}
+
+bool material_table_equal(const MaterialTableEntry* entry, const Material* mat, u32 shader_idx, u32 hash)
+{
+    const Material* other = &entry->material;
+    if(entry->hash != hash || entry->shader_idx != shader_idx) return false;
+    if(other->flags != mat->flags || other->blend != mat->blend || other->tex_count != mat->tex_count) return false;
+    if(memcmp(&other->ambient, &mat->ambient, sizeof(vec3)) != 0 || memcmp(&other->diffuse, &mat->diffuse, sizeof(vec3)) != 0 ||
+       memcmp(&other->specular, &mat->specular, sizeof(vec3)) != 0 || memcmp(&other->shininess, &mat->shininess, sizeof(f32)) != 0 ||
+       memcmp(&other->opacity, &mat->opacity, sizeof(f32)) != 0) return false;
+
+    if(other->textures == mat->textures) return true;
+    for(u32 i = 0; i < mat->tex_count; i++)
+    {
+        if(other->textures[i].id != mat->textures[i].id || other->textures[i].type != mat->textures[i].type) return false;
+    }
+    return true;
+}
+
+void material_table_rehash(MaterialTable* self, u32 bucket_count)
+{
+    if(self->buckets != NULL) BGL_FREE(self->buckets);
+    self->buckets = (u32*)BGL_MALLOC(bucket_count * sizeof(u32));
+    BGL_ASSERT(self->buckets != NULL, "material table bucket allocation failed");
+    memset(self->buckets, 0xFF, bucket_count * sizeof(u32)); // BGL_MATERIAL_NONE
+    self->bucket_count = bucket_count;
+
+    for(u32 id = 0; id < self->count; id++)
+    {
+        MaterialTableEntry* entry = material_table_entry(self, id);
+        if(entry->refs == 0) continue; // free, linked through next
+
+        u32* bucket = &self->buckets[entry->hash & (bucket_count - 1)];
+        entry->next = *bucket;
+        *bucket = id;
+    }
+}
@@ -7,6 +7,8 @@
 #include "vao.h"
 #include "renderer.h"
 #include "bo.h"
+#include "triangle_mesh.h"
+#include "geometry_pool.h"
 
 void mesh_create(Mesh* self,
                  const VertexBuffer vertex_buffer, u32 vert_count,
@@ -19,6 +21,15 @@ void mesh_create(Mesh* self,
     self->vert_count = vert_count;
     self->ind_count = ind_count;
     self->tex_count = tex_count;
+    self->triangles = NULL;
+
+    self->bounds_min = self->bounds_max = vert_count > 0 ? vertex_buffer.pos[0] : VEC3(0.0f, 0.0f, 0.0f);
+    for(u32 i = 1; i < vert_count; i++)
+    {
+        vec3 pos = vertex_buffer.pos[i];
+        self->bounds_min = VEC3(MIN(self->bounds_min.x, pos.x), MIN(self->bounds_min.y, pos.y), MIN(self->bounds_min.z, pos.z));
+        self->bounds_max = VEC3(MAX(self->bounds_max.x, pos.x), MAX(self->bounds_max.y, pos.y), MAX(self->bounds_max.z, pos.z));
+    }
 
     size_t vertex_size = 3;
     bool use_normals = false, use_UVs = false;
@@ -33,14 +44,20 @@ void mesh_create(Mesh* self,
         vertex_size += 2;
     }
 
+    self->format = (use_normals ? BGL_VERTEX_NORMAL : 0) | (use_UVs ? BGL_VERTEX_UV : 0);
+    self->pooled = false;
+    self->first_index = 0;
+    self->base_vertex = 0;
+    if(geometry_pool_enabled())
+    {
+        geometry_pool_add(self, &vertex_buffer, indices);
+        return;
+    }
+
     self->vao = vao_create();
     self->vbo = vbo_create();
     self->ebo = ebo_create();
 
-    vao_bind(self->vao);
-
-    vbo_bind(self->vbo);
-
     size_t single_size = self->vert_count * sizeof(f32);
     vbo_set_buffer(self->vbo, NULL, single_size * vertex_size, false);
 
@@ -53,44 +70,40 @@ void mesh_create(Mesh* self,
         vbo_set_buffer_region(self->vbo, vertex_buffer.uv, offset, 2 * single_size);
     }
 
-    ebo_bind(self->ebo);
     ebo_set_buffer(self->ebo, &indices[0], ind_count * sizeof(u32), false);
 
-    vao_attribute(0, 3, GL_FLOAT, 3 * sizeof(f32), 0);
-    if(use_normals) vao_attribute(1, 3, GL_FLOAT, 3 * sizeof(f32), 3 * single_size);
+    vao_element_buffer(self->vao, self->ebo);
+    vao_attribute(self->vao, self->vbo, 0, 3, GL_FLOAT, 3 * sizeof(f32), 0);
+    if(use_normals) vao_attribute(self->vao, self->vbo, 1, 3, GL_FLOAT, 3 * sizeof(f32), 3 * single_size);
 
     if(use_UVs)
     {
         u32 index = 1 + (u32)use_normals; // if normals used then will be 2, otherwise 1
         size_t offset = use_normals ? 6 * single_size : 3 * single_size;
 
-        vao_attribute(index, 2, GL_FLOAT, 2 * sizeof(f32), offset);
+        vao_attribute(self->vao, self->vbo, index, 2, GL_FLOAT, 2 * sizeof(f32), offset);
     }
-
-    vao_unbind();
 }
 
 void mesh_draw(Mesh* self, Shader* shader, Texture* textures)
+{
+    mesh_bind_textures(self, shader, textures);
+
+    vao_bind(self->vao);
+    rd_draw_triangles_base_vertex(self->ind_count, self->first_index, self->base_vertex);
+}
+
+void mesh_bind_textures(Mesh* self, Shader* shader, Texture* textures)
 {
     for(u32 i = 0; i < self->tex_count; i++)
     {
-        Texture curr_tex = textures[self->tex_indices[i]];
-
-        texture_unit_active(i); // activate next tex unit
+        Texture* curr_tex = &textures[self->tex_indices[i]];
 
         // tell sampler which unit is associated with it
-        shader_uniform_int(shader, texture_type_get_str(curr_tex.type), (i32)i);
+        rd_state_sampler(shader, shader->builtins[texture_type_get_uniform(curr_tex->type)], i);
 
-        texture_bind(&curr_tex); // associate texture with current bound unit
+        texture_bind(curr_tex, i);
     }
-
-    vao_bind(self->vao);
-    rd_draw_triangles(self->ind_count);
-    #ifndef BGL_NO_DEBUG
-        vao_unbind(); // shouldn't need this if code works properly lol
-    #endif
-
-    texture_unit_active(0);
 }
 
 void mesh_free(Mesh* self)
@@ -99,7 +112,19 @@ void mesh_free(Mesh* self)
     {
         BGL_FREE(self->tex_indices);
     }
+
+    if(self->triangles != NULL)
+    {
+        triangle_mesh_free(self->triangles);
+        BGL_FREE(self->triangles);
+    }
     
+    if(self->pooled)
+    {
+        geometry_pool_remove(self);
+        return;
+    }
+
     vao_free(self->vao);
     vbo_free(self->vbo);
     ebo_free(self->ebo);
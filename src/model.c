@@ -13,16 +13,25 @@
 #include "texture.h"
 #include "renderer.h"
 #include "light.h"
+#include "triangle_mesh.h"
+#include "vao.h"
+#include "defines.glsl"
 
 /**
  * internal functions
  */
 bool model_add_mesh(Model* self, Mesh* mesh, u32 total_meshes);
-bool model_process_node(Model* self, Arena* arena, struct aiNode* node, const struct aiScene* scene);
-bool model_process_mesh(Model* self, Arena* arena, struct aiMesh* mesh, const struct aiScene* scene, Mesh* mesh_out);
+bool model_process_node(Model* self, Arena* arena, struct aiNode* node, const struct aiScene* scene, ModelLoadFlags flags, const char* path);
+bool model_process_mesh(Model* self, Arena* arena, struct aiMesh* mesh, const struct aiScene* scene, ModelLoadFlags flags, const char* path, Mesh* mesh_out);
+bool model_keep_triangles(Mesh* mesh, const vec3* vertices, const u32* indices, const char* cache_path);
 bool model_load_textures(Model* self, struct aiMaterial* mat, TextureType type, u32** tex_indices_out, u32* tex_count_out);
 
 bool model_load(Model* self, Arena* scratch, const char* path, u32 shader_idx)
+{
+    return model_load_with_flags(self, scratch, path, shader_idx, 0);
+}
+
+bool model_load_with_flags(Model* self, Arena* scratch, const char* path, u32 shader_idx, ModelLoadFlags flags)
 {
     BGL_PERFORMANCE_START();
 
@@ -53,7 +62,7 @@ bool model_load(Model* self, Arena* scratch, const char* path, u32 shader_idx)
 
     u8* arena_init_pos = arena_alloc(scratch, 0);
 
-    bool success = model_process_node(self, scratch, scene->mRootNode, scene);
+    bool success = model_process_node(self, scratch, scene->mRootNode, scene, flags, full_path);
 
     arena_collapse(scratch, arena_init_pos);
 
@@ -88,41 +97,59 @@ bool model_load(Model* self, Arena* scratch, const char* path, u32 shader_idx)
 void model_update_transform(Model* self, const Transform* transform)
 {
     self->transform = *transform;
-    mat4_identity(&self->model);
-
-    mat4_scale(&self->model, self->transform.scale);
-
-    mat4_rotate_x(&self->model, RADIANS(self->transform.euler.x)); // pitch
-    mat4_rotate_y(&self->model, RADIANS(self->transform.euler.y)); // yaw
-    mat4_rotate_z(&self->model, RADIANS(self->transform.euler.z)); // roll
-
-    mat4_trans(&self->model, self->transform.pos);
+    transform_to_matrix(&self->transform, &self->model);
 }
 
 void model_draw(Model* self, Renderer* rd, Camera* cam)
 {
-    Shader* shader = &rd->shaders[self->shader_idx]; // TODO: move draw funcs into rendersystem to fix this
-
-    // TODO: calculate normal matrix here instead of in shader
-    mat4 mvp, model_view;
-    mat4_mul(&model_view, cam->view, self->model);
-    mat4_mul(&mvp, cam->projection, model_view);
+    model_draw_matrix(self, rd, cam, &self->model);
+}
 
-    rd_use_shader(rd, self->shader_idx);
-    
-    material_set_uniforms(&self->material, shader);
+void model_draw_matrix(Model* self, Renderer* rd, Camera* cam, mat4* model)
+{
+    model_draw_meshes(self->meshes, self->mesh_count, &self->material, self->shader_idx, rd, cam, model);
+}
 
-    shader_uniform_mat4(shader, "mvp", &mvp);
-    if(!(self->material.flags & (BGL_MATERIAL_NO_LIGHTING | BGL_MATERIAL_IS_LIGHT)))
+void model_get_bounds(const Model* self, vec3* min_out, vec3* max_out)
+{
+    *min_out = *max_out = VEC3(0.0f, 0.0f, 0.0f);
+    for(u32 i = 0; i < self->mesh_count; i++)
     {
-        shader_uniform_mat4(shader, "model_view", &model_view);
-        shader_uniform_mat4(shader, "model", &self->model);
-        shader_uniform_mat4(shader, "view", &cam->view);
+        const Mesh* mesh = &self->meshes[i];
+        if(i == 0)
+        {
+            *min_out = mesh->bounds_min;
+            *max_out = mesh->bounds_max;
+            continue;
+        }
+        *min_out = VEC3(MIN(min_out->x, mesh->bounds_min.x), MIN(min_out->y, mesh->bounds_min.y), MIN(min_out->z, mesh->bounds_min.z));
+        *max_out = VEC3(MAX(max_out->x, mesh->bounds_max.x), MAX(max_out->y, mesh->bounds_max.y), MAX(max_out->z, mesh->bounds_max.z));
     }
+}
 
-    for(u32 i = 0; i < self->mesh_count; i++)
+void model_draw_meshes(Mesh* meshes, u32 mesh_count, Material* material, u32 shader_idx, Renderer* rd, Camera* cam, mat4* model)
+{
+    Shader* shader = &rd->shaders[shader_idx]; // TODO: move draw funcs into rendersystem to fix this
+
+    rd_use_shader(rd, shader_idx);
+    
+    material_set_uniforms(material, shader);
+    rd_frame_set_camera(rd, cam);
+    rd_frame_upload(rd);
+
+    u32 slot;
+    DrawData* draw = draw_ring_map(&rd->draws, 1, &slot);
+    draw_data_write(draw, &rd->frame.view, &rd->frame.view_projection, model, material);
+    draw_ring_unmap(&rd->draws);
+    draw_ring_bind_window(&rd->draws, slot);
+    material_set_blend_state(material);
+
+    /* a single draw, so its index is given as a constant instead of through the ring's indices */
+    for(u32 i = 0; i < mesh_count; i++)
     {
-        mesh_draw(&self->meshes[i], shader, self->material.textures);
+        vao_bind(meshes[i].vao);
+        vao_constant_uint(meshes[i].vao, BGL_GLSL_INSTANCE_DRAW_LOCATION, 0);
+        mesh_draw(&meshes[i], shader, material->textures);
     }
 }
 
@@ -139,25 +166,25 @@ bool model_add_mesh(Model* self, Mesh* mesh, u32 total_meshes)
     return true;
 }
 
-bool model_process_node(Model* self, Arena* arena, struct aiNode* node, const struct aiScene* scene)
+bool model_process_node(Model* self, Arena* arena, struct aiNode* node, const struct aiScene* scene, ModelLoadFlags flags, const char* path)
 {
     Mesh mesh;
     for(u32 i = 0; i < node->mNumMeshes; i++)
     {
         struct aiMesh* ai_mesh = scene->mMeshes[node->mMeshes[i]]; // node meshes are indices into scene's meshes
-        if(!model_process_mesh(self, arena, ai_mesh, scene, &mesh)) return false;
+        if(!model_process_mesh(self, arena, ai_mesh, scene, flags, path, &mesh)) return false;
         if(!model_add_mesh(self, &mesh, scene->mNumMeshes)) return false;
     }
 
     for(u32 i = 0; i < node->mNumChildren; i++)
     {
-        if(!model_process_node(self, arena, node->mChildren[i], scene)) return false;
+        if(!model_process_node(self, arena, node->mChildren[i], scene, flags, path)) return false;
     }
 
     return true;
 }
 
-bool model_process_mesh(Model* self, Arena* arena, struct aiMesh* model_mesh, const struct aiScene* scene, Mesh* mesh_out)
+bool model_process_mesh(Model* self, Arena* arena, struct aiMesh* model_mesh, const struct aiScene* scene, ModelLoadFlags flags, const char* path, Mesh* mesh_out)
 {
     Mesh mesh;
 
@@ -252,10 +279,46 @@ bool model_process_mesh(Model* self, Arena* arena, struct aiMesh* model_mesh, co
     }
 
     mesh_create(&mesh, vertex_buffer, total_vertices, indices, total_indices, tex_indices, total_textures);
+
+    /* the vertices are in the scratch arena, this is the last chance to copy them */
+    if(flags & (BGL_MODEL_KEEP_TRIANGLES | BGL_MODEL_CACHE_TRIANGLES))
+    {
+        char cache_path[1024 + 16];
+        snprintf(cache_path, sizeof(cache_path), "%s.%u.bvh", path, self->mesh_count);
+        if(!model_keep_triangles(&mesh, vertex_buffer.pos, indices, (flags & BGL_MODEL_CACHE_TRIANGLES) ? cache_path : NULL))
+        {
+            mesh_free(&mesh);
+            return false;
+        }
+    }
+
     *mesh_out = mesh;
     return true;
 }
 
+bool model_keep_triangles(Mesh* mesh, const vec3* vertices, const u32* indices, const char* cache_path)
+{
+    mesh->triangles = (TriangleMesh*)BGL_MALLOC(sizeof(TriangleMesh));
+    BGL_ASSERT(mesh->triangles != NULL, "triangle mesh allocation failed");
+
+    /* a cache from an older version of the model is rebuilt and overwritten */
+    if(cache_path != NULL && platform_file_exists(cache_path) && triangle_mesh_load(mesh->triangles, cache_path))
+    {
+        if(mesh->triangles->source_hash == triangle_mesh_hash(vertices, mesh->vert_count, indices, mesh->ind_count)) return true;
+        triangle_mesh_free(mesh->triangles);
+    }
+
+    if(!triangle_mesh_create(mesh->triangles, vertices, mesh->vert_count, indices, mesh->ind_count))
+    {
+        BGL_FREE(mesh->triangles);
+        mesh->triangles = NULL;
+        return false;
+    }
+
+    if(cache_path != NULL) triangle_mesh_save(mesh->triangles, cache_path); // failing only costs a rebuild next load
+    return true;
+}
+
 bool model_load_textures(Model* self, struct aiMaterial* mat, TextureType type, u32** tex_indices_out, u32* tex_count_out)
 {
     enum aiTextureType ai_type = type == BGL_TEXTURE_PHONG_DIFFUSE ? aiTextureType_DIFFUSE : aiTextureType_SPECULAR;
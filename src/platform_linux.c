@@ -3,8 +3,11 @@
 #ifdef __linux__
 
 #include <unistd.h>
+#include <pthread.h>
 #include <sys/time.h>
 #include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
 #include <errno.h>
 #include <GL/glx.h>
 #include <GL/glxext.h>
@@ -21,6 +24,23 @@ static struct
     char directory[BGL_MAX_EXECUTABLE_DIR_LENGTH];
 } linux_ctx;
 
+struct PlatformThread
+{
+    pthread_t handle;
+    PlatformThreadFunc func;
+    void* arg;
+};
+
+struct PlatformMutex
+{
+    pthread_mutex_t handle;
+};
+
+struct PlatformCondition
+{
+    pthread_cond_t handle;
+};
+
 static PFNGLXSWAPINTERVALEXTPROC glXSwapIntervalEXT = NULL;
 
 void platform_init(void)
@@ -80,6 +100,31 @@ bool platform_file_exists(const char* filename)
     return access(filename, F_OK) == 0;
 }
 
+void* platform_file_map(const char* filename, u64* size_out)
+{
+    i32 fd = open(filename, O_RDONLY);
+    if(fd == -1) return NULL;
+
+    struct stat st;
+    if(fstat(fd, &st) == -1 || st.st_size == 0)
+    {
+        close(fd);
+        return NULL;
+    }
+
+    void* ptr = mmap(NULL, (size_t)st.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    close(fd); // mapping keeps its own reference to the file
+    if(ptr == MAP_FAILED) return NULL;
+
+    *size_out = (u64)st.st_size;
+    return ptr;
+}
+
+void platform_file_unmap(void* ptr, u64 size)
+{
+    munmap(ptr, size);
+}
+
 bool platform_gl_extension_supported(const char* extension)
 {
     //Display* display = XOpenDisplay(":0");
@@ -134,4 +179,85 @@ f64 platform_get_time(void)
     return time - linux_ctx.time_offset;
 }
 
+u32 platform_get_processor_count(void)
+{
+    i64 count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (u32)count : 1;
+}
+
+/* pthreads wants a void* return so wrap the user function */
+static void* platform_thread_start(void* arg)
+{
+    PlatformThread* thread = (PlatformThread*)arg;
+    thread->func(thread->arg);
+    return NULL;
+}
+
+PlatformThread* platform_thread_create(PlatformThreadFunc func, void* arg)
+{
+    PlatformThread* thread = (PlatformThread*)BGL_MALLOC(sizeof(PlatformThread));
+    BGL_ASSERT(thread != NULL, "thread allocation failed");
+    thread->func = func;
+    thread->arg = arg;
+
+    i32 err = pthread_create(&thread->handle, NULL, platform_thread_start, thread);
+    BGL_ASSERT(err == 0, "unable to create thread. err: %d", err);
+
+    return thread;
+}
+
+void platform_thread_join(PlatformThread* thread)
+{
+    pthread_join(thread->handle, NULL);
+    BGL_FREE(thread);
+}
+
+PlatformMutex* platform_mutex_create(void)
+{
+    PlatformMutex* mutex = (PlatformMutex*)BGL_MALLOC(sizeof(PlatformMutex));
+    BGL_ASSERT(mutex != NULL, "mutex allocation failed");
+    pthread_mutex_init(&mutex->handle, NULL);
+    return mutex;
+}
+
+void platform_mutex_lock(PlatformMutex* mutex)
+{
+    pthread_mutex_lock(&mutex->handle);
+}
+
+void platform_mutex_unlock(PlatformMutex* mutex)
+{
+    pthread_mutex_unlock(&mutex->handle);
+}
+
+void platform_mutex_free(PlatformMutex* mutex)
+{
+    pthread_mutex_destroy(&mutex->handle);
+    BGL_FREE(mutex);
+}
+
+PlatformCondition* platform_condition_create(void)
+{
+    PlatformCondition* cond = (PlatformCondition*)BGL_MALLOC(sizeof(PlatformCondition));
+    BGL_ASSERT(cond != NULL, "condition variable allocation failed");
+    pthread_cond_init(&cond->handle, NULL);
+    return cond;
+}
+
+void platform_condition_wait(PlatformCondition* cond, PlatformMutex* mutex)
+{
+    pthread_cond_wait(&cond->handle, &mutex->handle);
+}
+
+void platform_condition_broadcast(PlatformCondition* cond)
+{
+    pthread_cond_broadcast(&cond->handle);
+}
+
+void platform_condition_free(PlatformCondition* cond)
+{
+    pthread_cond_destroy(&cond->handle);
+    BGL_FREE(cond);
+}
+
 #endif
@@ -20,6 +20,23 @@ static struct
     char directory[BGL_MAX_EXECUTABLE_DIR_LENGTH];
 } win_ctx;
 
+struct PlatformThread
+{
+    HANDLE handle;
+    PlatformThreadFunc func;
+    void* arg;
+};
+
+struct PlatformMutex
+{
+    CRITICAL_SECTION handle;
+};
+
+struct PlatformCondition
+{
+    CONDITION_VARIABLE handle;
+};
+
 static PFNWGLSWAPINTERVALEXTPROC wglSwapIntervalEXT = NULL;
 
 void platform_init(void)
@@ -87,6 +104,36 @@ bool platform_file_exists(const char* filename)
     return _access(filename, 0) != -1;
 }
 
+void* platform_file_map(const char* filename, u64* size_out)
+{
+    HANDLE file = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if(file == INVALID_HANDLE_VALUE) return NULL;
+
+    LARGE_INTEGER size;
+    if(!GetFileSizeEx(file, &size) || size.QuadPart == 0)
+    {
+        CloseHandle(file);
+        return NULL;
+    }
+
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_WRITECOPY, 0, 0, NULL);
+    CloseHandle(file);
+    if(mapping == NULL) return NULL;
+
+    void* ptr = MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0);
+    CloseHandle(mapping); // view keeps the mapping alive
+    if(ptr == NULL) return NULL;
+
+    *size_out = (u64)size.QuadPart;
+    return ptr;
+}
+
+void platform_file_unmap(void* ptr, u64 size)
+{
+    (void)size;
+    UnmapViewOfFile(ptr);
+}
+
 bool platform_gl_extension_supported(const char* extension)
 {
     PFNWGLGETEXTENSIONSSTRINGEXTPROC wglGetExtensionsStringEXT = NULL;
@@ -135,4 +182,86 @@ f64 platform_get_time(void)
     return time - win_ctx.time_offset;
 }
 
+u32 platform_get_processor_count(void)
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (u32)info.dwNumberOfProcessors : 1;
+}
+
+/* win32 wants a DWORD return so wrap the user function */
+static DWORD WINAPI platform_thread_start(LPVOID arg)
+{
+    PlatformThread* thread = (PlatformThread*)arg;
+    thread->func(thread->arg);
+    return 0;
+}
+
+PlatformThread* platform_thread_create(PlatformThreadFunc func, void* arg)
+{
+    PlatformThread* thread = (PlatformThread*)BGL_MALLOC(sizeof(PlatformThread));
+    BGL_ASSERT(thread != NULL, "thread allocation failed");
+    thread->func = func;
+    thread->arg = arg;
+
+    thread->handle = CreateThread(NULL, 0, platform_thread_start, thread, 0, NULL);
+    BGL_ASSERT(thread->handle != NULL, "unable to create thread. err: %lu", GetLastError());
+
+    return thread;
+}
+
+void platform_thread_join(PlatformThread* thread)
+{
+    WaitForSingleObject(thread->handle, INFINITE);
+    CloseHandle(thread->handle);
+    BGL_FREE(thread);
+}
+
+PlatformMutex* platform_mutex_create(void)
+{
+    PlatformMutex* mutex = (PlatformMutex*)BGL_MALLOC(sizeof(PlatformMutex));
+    BGL_ASSERT(mutex != NULL, "mutex allocation failed");
+    InitializeCriticalSection(&mutex->handle);
+    return mutex;
+}
+
+void platform_mutex_lock(PlatformMutex* mutex)
+{
+    EnterCriticalSection(&mutex->handle);
+}
+
+void platform_mutex_unlock(PlatformMutex* mutex)
+{
+    LeaveCriticalSection(&mutex->handle);
+}
+
+void platform_mutex_free(PlatformMutex* mutex)
+{
+    DeleteCriticalSection(&mutex->handle);
+    BGL_FREE(mutex);
+}
+
+PlatformCondition* platform_condition_create(void)
+{
+    PlatformCondition* cond = (PlatformCondition*)BGL_MALLOC(sizeof(PlatformCondition));
+    BGL_ASSERT(cond != NULL, "condition variable allocation failed");
+    InitializeConditionVariable(&cond->handle);
+    return cond;
+}
+
+void platform_condition_wait(PlatformCondition* cond, PlatformMutex* mutex)
+{
+    SleepConditionVariableCS(&cond->handle, &mutex->handle, INFINITE);
+}
+
+void platform_condition_broadcast(PlatformCondition* cond)
+{
+    WakeAllConditionVariable(&cond->handle);
+}
+
+void platform_condition_free(BGL_UNUSED PlatformCondition* cond)
+{
+    BGL_FREE(cond); // condition variables don't need to be destroyed on win32
+}
+
 #endif
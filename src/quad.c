@@ -22,18 +22,12 @@ Quad quad_create(vec2 pos, vec2 size, const char* texture_path)
         3, 2, 0 
     };
 
-    vao_bind(self.vao);
-
-    vbo_bind(self.vbo);
     vbo_set_buffer(self.vbo, vertices, (size_t)4 * 5 * sizeof(f32), false);
-
-    ebo_bind(self.ebo);
     ebo_set_buffer(self.ebo, indices, (size_t)6 * sizeof(u32), false);
 
-    vao_attribute(0, 3, GL_FLOAT, 5 * sizeof(f32), 0); // vertex position
-    vao_attribute(1, 2, GL_FLOAT, 5 * sizeof(f32), 3 * sizeof(f32)); // vertex uv
-
-    vao_unbind();
+    vao_element_buffer(self.vao, self.ebo);
+    vao_attribute(self.vao, self.vbo, 0, 3, GL_FLOAT, 5 * sizeof(f32), 0); // vertex position
+    vao_attribute(self.vao, self.vbo, 1, 2, GL_FLOAT, 5 * sizeof(f32), 3 * sizeof(f32)); // vertex uv
 
     if(texture_path != NULL) texture_create(&self.texture, BGL_TEXTURE_PHONG_DIFFUSE, texture_path, false); // type not really necessary
 
@@ -44,13 +38,14 @@ void quad_draw(Quad* self, Renderer* rd)
 {
     rd_use_shader(rd, rd->quad_shader);
 
-    texture_bind(&self->texture); // only one texture so no need to use uniform to associate with sampler n stuff
+    texture_bind(&self->texture, 0); // only one texture so no need to use uniform to associate with sampler n stuff
 
-    glDisable(GL_DEPTH_TEST);
+    rd_state_enable(BGL_RD_CAP_DEPTH_TEST, false);
+    rd_state_enable(BGL_RD_CAP_BLEND, true); // the texture's alpha is kept
         vao_bind(self->vao);
         rd_draw_triangles(6);
-        vao_unbind();
-    glEnable(GL_DEPTH_TEST);
+    rd_state_enable(BGL_RD_CAP_BLEND, false);
+    rd_state_enable(BGL_RD_CAP_DEPTH_TEST, true);
 }
 
 void quad_free(Quad* self)
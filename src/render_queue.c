@@ -0,0 +1,331 @@
+#include "render_queue.h"
+
+#include <string.h>
+#include "defines.h"
+#include "model.h"
+#include "vao.h"
+#include "bo.h"
+#include "geometry_pool.h"
+#include "defines.glsl"
+
+#define DEPTH_BITS 19
+#define MESH_BITS 16
+#define MATERIAL_BITS 16
+#define SHADER_BITS 10
+#define DEPTH_MAX ((1u << DEPTH_BITS) - 1)
+#define MIN_CAPACITY 256
+
+/**
+ * internal functions
+ */
+void render_queue_grow(RenderQueue* self, u32 needed);
+void render_queue_draw_batches(RenderQueue* self, Renderer* rd, u32 first, u32 end);
+
+/* meshes in the geometry pool share a vao, so their range is hashed into the low bits to keep each
+ * mesh's draws together. the vao stays in the high bits so meshes sharing one still sort next to each other */
+static inline u32 render_queue_mesh_id(const Mesh* mesh)
+{
+    if(!mesh->pooled) return mesh->vao.id & ((1u << MESH_BITS) - 1);
+    return ((mesh->vao.id & 0xF) << (MESH_BITS - 4)) | ((mesh->first_index * 0x9E3779B1u) >> (32 - (MESH_BITS - 4)));
+}
+
+/* a multi draw binds one set of textures for all of its commands */
+static inline bool render_queue_same_textures(const Mesh* a, const Mesh* b)
+{
+    return a->tex_count == b->tex_count && (a->tex_count == 0 || memcmp(a->tex_indices, b->tex_indices, a->tex_count * sizeof(u32)) == 0);
+}
+
+void render_queue_create(RenderQueue* self)
+{
+    memset(self, 0, sizeof(RenderQueue));
+    bo_stream_create(&self->indirect_buffer, GL_DRAW_INDIRECT_BUFFER, MIN_CAPACITY * sizeof(RenderIndirectCommand));
+}
+
+void render_queue_free(RenderQueue* self)
+{
+    if(self->items != NULL) BGL_FREE(self->items);
+    if(self->entries != NULL) BGL_FREE(self->entries);
+    if(self->scratch != NULL) BGL_FREE(self->scratch);
+    if(self->batches != NULL) BGL_FREE(self->batches);
+    if(self->commands != NULL) BGL_FREE(self->commands);
+    bo_stream_free(&self->indirect_buffer);
+    memset(self, 0, sizeof(RenderQueue));
+}
+
+void render_queue_clear(RenderQueue* self)
+{
+    self->count = 0;
+}
+
+u64 render_queue_key(u32 pass, bool transparent, u32 shader_idx, u32 material_id, const Mesh* mesh, f32 depth)
+{
+    BGL_ASSERT(pass <= BGL_RENDER_QUEUE_MAX_PASS, "render pass %u out of range", pass);
+    BGL_ASSERT(shader_idx < BGL_RENDER_QUEUE_MAX_SHADERS, "shader index %u too large for the render queue", shader_idx);
+
+    /* ids past 16 bits share key bits with lower ones, which only interleaves them in the sort, batching compares the whole id */
+    const u64 quantised_depth = (u64)(CLAMP(depth, 0.0f, 1.0f) * (f32)DEPTH_MAX);
+    const u64 state = ((u64)shader_idx << (MATERIAL_BITS + MESH_BITS)) |
+                      ((u64)(material_id & ((1u << MATERIAL_BITS) - 1)) << MESH_BITS) |
+                      ((u64)render_queue_mesh_id(mesh));
+
+    u64 key = (u64)pass << 61;
+    if(transparent)
+    {
+        key |= 1ull << 63;
+        key |= (DEPTH_MAX - quantised_depth) << (SHADER_BITS + MATERIAL_BITS + MESH_BITS); // far draws first
+        key |= state;
+    }
+    else
+    {
+        key |= state << DEPTH_BITS;
+        key |= quantised_depth;
+    }
+    return key;
+}
+
+f32 render_queue_depth(const Camera* cam, vec3 pos)
+{
+    /* view space looks down -z */
+    const mat4* view = &cam->view;
+    f32 view_z = view->m31 * pos.x + view->m32 * pos.y + view->m33 * pos.z + view->m34;
+    return -view_z / cam->zfar;
+}
+
+void render_queue_push(RenderQueue* self, u64 key, const RenderItem* item)
+{
+    if(self->count == self->capacity) render_queue_grow(self, self->count + 1);
+
+    self->items[self->count] = *item;
+    self->entries[self->count] = (RenderSortEntry){ .key = key, .item = self->count };
+    self->count++;
+}
+
+void render_queue_push_meshes(RenderQueue* self, u32 pass, Mesh* meshes, u32 mesh_count, Material* material, u32 material_id,
+                              u32 shader_idx, mat4* model, f32 depth)
+{
+    for(u32 i = 0; i < mesh_count; i++)
+    {
+        RenderItem item = { .mesh = &meshes[i], .material = material, .model = model, .material_id = material_id, .shader_idx = shader_idx };
+        const bool transparent = material->blend == BGL_MATERIAL_BLEND_TRANSPARENT;
+        render_queue_push(self, render_queue_key(pass, transparent, shader_idx, material_id, &meshes[i], depth), &item);
+    }
+}
+
+void render_queue_sort(RenderQueue* self)
+{
+    if(self->count < 2) return;
+
+    /* every byte's histogram in one read */
+    u32 histograms[8][256];
+    memset(histograms, 0, sizeof(histograms));
+    for(u32 i = 0; i < self->count; i++)
+    {
+        const u64 key = self->entries[i].key;
+        for(u32 byte = 0; byte < 8; byte++) histograms[byte][(key >> (byte * 8)) & 0xFF]++;
+    }
+
+    RenderSortEntry* src = self->entries;
+    RenderSortEntry* dst = self->scratch;
+    for(u32 byte = 0; byte < 8; byte++)
+    {
+        u32* histogram = histograms[byte];
+        const u32 shift = byte * 8;
+
+        /* nothing to do if every key has the same byte, e.g. the pass or unused shader bits */
+        if(histogram[(src[0].key >> shift) & 0xFF] == self->count) continue;
+
+        u32 offset = 0;
+        for(u32 digit = 0; digit < 256; digit++)
+        {
+            u32 count = histogram[digit];
+            histogram[digit] = offset;
+            offset += count;
+        }
+
+        for(u32 i = 0; i < self->count; i++)
+        {
+            dst[histogram[(src[i].key >> shift) & 0xFF]++] = src[i];
+        }
+
+        RenderSortEntry* temp = src;
+        src = dst;
+        dst = temp;
+    }
+
+    /* keep entries as the sorted buffer */
+    if(src != self->entries)
+    {
+        self->scratch = self->entries;
+        self->entries = src;
+    }
+}
+
+void render_queue_submit(RenderQueue* self, Renderer* rd)
+{
+    render_queue_submit_opaque(self, rd);
+    render_queue_submit_transparent(self, rd);
+}
+
+void render_queue_submit_opaque(RenderQueue* self, Renderer* rd)
+{
+    self->draw_count = self->shader_changes = self->material_changes = self->mesh_changes = 0;
+    self->instance_count = self->count;
+    self->batch_count = self->opaque_batch_count = 0;
+    if(self->count == 0) return;
+
+    rd_frame_upload(rd); // camera and lights are shared by every draw
+
+    /* every draw is written now, the transparent batches read their slots in render_queue_submit_transparent */
+    DrawData* draws = draw_ring_map(&rd->draws, self->count, &self->ring_first);
+    for(u32 i = 0; i < self->count; i++)
+    {
+        const RenderItem* item = &self->items[self->entries[i].item];
+        draw_data_write(&draws[i], &rd->frame.view, &rd->frame.view_projection, item->model, item->material);
+    }
+    draw_ring_unmap(&rd->draws);
+
+    render_queue_build_batches(self);
+    if(geometry_pool_multi_draw_indirect())
+    {
+        const size_t size = self->batch_count * sizeof(RenderIndirectCommand);
+        memcpy(bo_stream_begin(&self->indirect_buffer, size), self->commands, size);
+        bo_stream_end(&self->indirect_buffer);
+        self->indirect_offset = bo_stream_offset(&self->indirect_buffer);
+    }
+
+    render_queue_draw_batches(self, rd, 0, self->opaque_batch_count);
+}
+
+void render_queue_submit_transparent(RenderQueue* self, Renderer* rd)
+{
+    if(self->opaque_batch_count == self->batch_count) return;
+
+    render_queue_draw_batches(self, rd, self->opaque_batch_count, self->batch_count);
+
+    /* back to the opaque defaults, a depth mask left off would also stop the next frame's depth clear */
+    rd_state_enable(BGL_RD_CAP_BLEND, false);
+    rd_state_depth_mask(true);
+}
+
+void render_queue_build_batches(RenderQueue* self)
+{
+    self->batch_count = self->opaque_batch_count = 0;
+    u32 i = 0;
+    while(i < self->count)
+    {
+        const RenderItem* item = &self->items[self->entries[i].item];
+        if(item->material->blend != BGL_MATERIAL_BLEND_TRANSPARENT) self->opaque_batch_count++; // sorted before every transparent batch
+
+        u32 end = i + 1;
+        while(end < self->count)
+        {
+            const RenderItem* next = &self->items[self->entries[end].item];
+            if(next->shader_idx != item->shader_idx || next->material_id != item->material_id || next->mesh != item->mesh) break;
+            if(end % BGL_GLSL_DRAWS_PER_BLOCK == 0) break; // the next window of the draw ring
+            end++;
+        }
+
+        const Mesh* mesh = item->mesh;
+        self->batches[self->batch_count] = (RenderBatch){ .first = i, .count = end - i };
+        self->commands[self->batch_count] = (RenderIndirectCommand){
+            .count = mesh->ind_count,
+            .instance_count = end - i,
+            .first_index = mesh->first_index,
+            .base_vertex = mesh->base_vertex,
+            .base_instance = i,
+        };
+        self->batch_count++;
+        i = end;
+    }
+}
+
+void render_queue_grow(RenderQueue* self, u32 needed)
+{
+    u32 capacity = MAX(self->capacity * 2, MIN_CAPACITY);
+    while(capacity < needed) capacity *= 2;
+
+    self->items = (RenderItem*)BGL_REALLOC(self->items, capacity * sizeof(RenderItem));
+    self->entries = (RenderSortEntry*)BGL_REALLOC(self->entries, capacity * sizeof(RenderSortEntry));
+    self->scratch = (RenderSortEntry*)BGL_REALLOC(self->scratch, capacity * sizeof(RenderSortEntry));
+    self->batches = (RenderBatch*)BGL_REALLOC(self->batches, capacity * sizeof(RenderBatch));
+    self->commands = (RenderIndirectCommand*)BGL_REALLOC(self->commands, capacity * sizeof(RenderIndirectCommand));
+    BGL_ASSERT(self->items != NULL && self->entries != NULL && self->scratch != NULL &&
+               self->batches != NULL && self->commands != NULL, "render queue reallocation failed");
+    self->capacity = capacity;
+}
+
+void render_queue_draw_batches(RenderQueue* self, Renderer* rd, u32 first, u32 end)
+{
+    const bool multi_draw = geometry_pool_multi_draw_indirect();
+    if(multi_draw) bo_bind(self->indirect_buffer.bo); // the draws read the region written by render_queue_submit_opaque
+
+    u32 shader_idx = BGL_RENDER_QUEUE_MAX_SHADERS;
+    Shader* shader = NULL;
+    Material* material = NULL;
+    u32 material_id = BGL_MATERIAL_NONE;
+    Mesh* mesh = NULL;
+    u32 b = first;
+    while(b < end)
+    {
+        const RenderBatch* batch = &self->batches[b];
+        RenderItem* item = &self->items[self->entries[batch->first].item];
+        const u32 window = batch->first / BGL_GLSL_DRAWS_PER_BLOCK;
+        draw_ring_bind_window(&rd->draws, self->ring_first + window * BGL_GLSL_DRAWS_PER_BLOCK);
+
+        /* a new program has none of the last one's uniforms or sampler units */
+        if(item->shader_idx != shader_idx)
+        {
+            shader_idx = item->shader_idx;
+            shader = &rd->shaders[shader_idx];
+            rd_use_shader(rd, shader_idx);
+            material_id = BGL_MATERIAL_NONE;
+            mesh = NULL;
+            self->shader_changes++;
+        }
+
+        bool material_changed = item->material_id != material_id;
+        if(material_changed)
+        {
+            material_id = item->material_id;
+            material = item->material;
+            material_set_uniforms(material, shader);
+            material_set_blend_state(material);
+            self->material_changes++;
+        }
+
+        /* the textures bound depend on both the mesh's texture indices and the material's textures */
+        if(material_changed || item->mesh != mesh) mesh_bind_textures(item->mesh, shader, material->textures);
+        if(item->mesh != mesh)
+        {
+            mesh = item->mesh;
+            vao_bind(mesh->vao);
+            self->mesh_changes++;
+        }
+
+        if(multi_draw && mesh->pooled)
+        {
+            /* take the following batches in the same window which only differ in their range of the pool */
+            u32 run_end = b + 1;
+            while(run_end < end)
+            {
+                const RenderBatch* next_batch = &self->batches[run_end];
+                const RenderItem* next = &self->items[self->entries[next_batch->first].item];
+                if(next_batch->first / BGL_GLSL_DRAWS_PER_BLOCK != window) break;
+                if(next->shader_idx != shader_idx || next->material_id != material_id || !next->mesh->pooled ||
+                   next->mesh->vao.id != mesh->vao.id || !render_queue_same_textures(next->mesh, mesh)) break;
+                run_end++;
+            }
+
+            vao_instance_uint(mesh->vao, rd->draws.indices, BGL_GLSL_INSTANCE_DRAW_LOCATION, 0); // each command's base instance picks its draws
+            rd_multi_draw_triangles_indirect(self->indirect_offset + b * sizeof(RenderIndirectCommand), run_end - b);
+            b = run_end;
+        }
+        else
+        {
+            vao_instance_uint(mesh->vao, rd->draws.indices, BGL_GLSL_INSTANCE_DRAW_LOCATION, batch->first * sizeof(u32));
+            rd_draw_triangles_instanced(mesh->ind_count, mesh->first_index, mesh->base_vertex, batch->count);
+            b++;
+        }
+        self->draw_count++;
+    }
+}
@@ -15,10 +15,50 @@
 #include "shader.h"
 #include "texture.h"
 #include "util.h"
+#include "jobs.h"
+#include "geometry_pool.h"
+#include "defines.glsl"
 
 #define BGL_RD_VERSION_STRLEN 24 // bit extra to make it multiple of 8
+#define BGL_RD_DRAW_RING_CAPACITY 4096 // draws before the ring first has to grow, 1mb
 #define RD_NO_BLOCK_BINDINGS(self) !(CHAR_TO_INT((self)->version[0]) == 4 && CHAR_TO_INT((self)->version[2]) >= 2)
 
+#define RD_STATE_UNKNOWN 0xFFFFFFFF // never a valid gl name or enum, so the next call always goes through
+#define RD_STATE_MAX_TEXTURE_UNITS 32 // units past this aren't cached
+
+/**
+ * shadow of the gl state, there is only one gl context so this is static like texture_ctx
+ */
+static struct
+{
+    u32 program;
+    u32 vao;
+    u32 active_unit;
+    u32 textures[RD_STATE_MAX_TEXTURE_UNITS][2]; // 2d and cubemap binding of each unit
+    u32 capabilities[BGL_RD_CAP_COUNT]; // 0, 1 or RD_STATE_UNKNOWN
+    u32 cull_face;
+    u32 blend_src, blend_dst;
+    u32 depth_func;
+    u32 depth_mask;
+    bool dsa; // not part of the shadowed state, kept by rd_state_invalidate
+    RendererStateStats stats;
+} rd_state;
+
+static const GLenum rd_capability_enums[BGL_RD_CAP_COUNT] = { GL_BLEND, GL_DEPTH_TEST, GL_CULL_FACE };
+
+/* true if the gl call should be made, counting it either way */
+static inline bool rd_state_changed(RendererStateKind kind, u32* cached, u32 value)
+{
+    if(*cached == value)
+    {
+        rd_state.stats.skipped[kind]++;
+        return false;
+    }
+    *cached = value;
+    rd_state.stats.issued[kind]++;
+    return true;
+}
+
 /**
  * internal functions
  */
@@ -56,11 +96,21 @@ void rd_init(Renderer* self, i32 width, i32 height, const char* win_title, Rende
     window_set_resize_callback(&self->window, (BGLWindowResizeFunc)rd_resize_callback);
 
     BGL_ASSERT(gladLoadGL(), "failed to init GLAD");
+    rd_state.dsa = major == 4 && minor >= 5;
 
     rd_configure_gl(self);
+    bo_init(major == 4 && minor >= 4);
+    if(self->flags & BGL_RD_GEOMETRY_POOL) geometry_pool_init(major == 4 && minor >= 3);
+
+    memset(&self->frame, 0, sizeof(FrameData));
+    bo_stream_create(&self->frame_ubo, GL_UNIFORM_BUFFER, sizeof(FrameData));
+    self->frame_dirty = true;
+    draw_ring_create(&self->draws, BGL_RD_DRAW_RING_CAPACITY);
 
     platform_init();
 
+    jobs_init(0); // one worker per extra core
+
     Arena arena;
     arena_create_sized(&arena, MEGABYTES(1)); // definitely big enough for these files
     const char* shader_filepaths[] = {"shaders/skybox.glsl", "shaders/quad.glsl", "shaders/light.glsl"};
@@ -82,6 +132,8 @@ void rd_init(Renderer* self, i32 width, i32 height, const char* win_title, Rende
 
 void rd_configure_gl(Renderer* self)
 {
+    rd_state_invalidate();
+
     #ifndef BGL_NO_DEBUG
     i32 flags, major, minor;
     rd_get_version_major_minor(self, &major, &minor);
@@ -110,27 +162,78 @@ void rd_configure_gl(Renderer* self)
 
     glViewport(0, 0, self->window.width, self->window.height);
 
-    glEnable(GL_BLEND); // enable transparent textures
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    /* only turned on while drawing transparent materials, opaque draws don't pay for blending */
+    rd_state_enable(BGL_RD_CAP_BLEND, false);
+    rd_state_blend_func(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     //glEnable(GL_FRAMEBUFFER_SRGB); // this makes everything look oversaturated and garbage
 
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
+    rd_state_enable(BGL_RD_CAP_DEPTH_TEST, true);
+    rd_state_depth_func(GL_LEQUAL);
 
-    glEnable(GL_CULL_FACE);
+    rd_state_enable(BGL_RD_CAP_CULL_FACE, true);
     glFrontFace(GL_CCW); // front face has counter-clockwise vertices
-    glCullFace(GL_BACK);
+    rd_state_cull_face(true);
 
     glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
     glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
 }
 
+void rd_frame_set_camera(Renderer* self, const Camera* cam)
+{
+    FrameData* frame = &self->frame;
+    if(memcmp(&frame->view, &cam->view, sizeof(mat4)) == 0 && memcmp(&frame->projection, &cam->projection, sizeof(mat4)) == 0) return;
+
+    frame->view = cam->view;
+    frame->projection = cam->projection;
+    mat4_mul(&frame->view_projection, cam->projection, cam->view);
+    frame->camera_pos = VEC3TOVEC4(cam->pos, 1.0f);
+    self->frame_dirty = true;
+}
+
+void rd_frame_set_lights(Renderer* self, const DirLight* dir_light, u32 light_count)
+{
+    FrameData* frame = &self->frame;
+    frame->dir_light_dir = VEC3TOVEC4(dir_light->dir, 0.0f);
+    frame->dir_light_ambient = VEC3TOVEC4(dir_light->ambient, 1.0f);
+    frame->dir_light_diffuse = VEC3TOVEC4(dir_light->diffuse, 1.0f);
+    frame->dir_light_specular = VEC3TOVEC4(dir_light->specular, 1.0f);
+    frame->light_count = (i32)light_count;
+    self->frame_dirty = true;
+}
+
+void rd_frame_upload(Renderer* self)
+{
+    if(!self->frame_dirty) return;
+
+    /* a new region each upload, so draws still reading the last one aren't waited on */
+    memcpy(bo_stream_begin(&self->frame_ubo, sizeof(FrameData)), &self->frame, sizeof(FrameData));
+    bo_stream_end(&self->frame_ubo);
+    ubo_bind_buffer_range(self->frame_ubo.bo, BGL_GLSL_FRAME_BINDING, (i32)bo_stream_offset(&self->frame_ubo), sizeof(FrameData));
+    self->frame_dirty = false;
+}
+
 void rd_draw_triangles(u32 ind_count)
 {
     glDrawElements(GL_TRIANGLES, (i32)ind_count, GL_UNSIGNED_INT, 0);
 }
 
+void rd_draw_triangles_base_vertex(u32 ind_count, u32 first_index, i32 base_vertex)
+{
+    glDrawElementsBaseVertex(GL_TRIANGLES, (i32)ind_count, GL_UNSIGNED_INT, (void*)((size_t)first_index * sizeof(u32)), base_vertex);
+}
+
+void rd_draw_triangles_instanced(u32 ind_count, u32 first_index, i32 base_vertex, u32 instance_count)
+{
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, (i32)ind_count, GL_UNSIGNED_INT, (void*)((size_t)first_index * sizeof(u32)),
+                                      (i32)instance_count, base_vertex);
+}
+
+void rd_multi_draw_triangles_indirect(size_t offset, u32 draw_count)
+{
+    glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)offset, (i32)draw_count, 0);
+}
+
 // annoying fix, sometimes resize callback is delayed
 void rd_update_viewport(Renderer* self)
 {
@@ -176,11 +279,9 @@ bool rd_add_shader(Renderer* self, Arena *scratch, const char** shader_filepaths
 
 void rd_use_shader(Renderer* self, u32 index)
 {
-    if(index != self->current_shader)
-    {
-        shader_use(&self->shaders[index]);
-        self->current_shader = index;
-    }
+    /* the program id is compared, not the index, as hot reloading gives an index a new program */
+    rd_state_use_program(self->shaders[index].id);
+    self->current_shader = index;
 }
 
 void rd_reload_shader(Renderer* self, u32 index)
@@ -212,28 +313,14 @@ void rd_reload_shader(Renderer* self, u32 index)
 
 void rd_toggle_wireframe(bool on)
 {
-    if(on)
-    {
-        glDisable(GL_CULL_FACE);
-        glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
-    }
-    else
-    {
-        glEnable(GL_CULL_FACE);
-        glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-    }
+    rd_state_enable(BGL_RD_CAP_CULL_FACE, !on);
+    glPolygonMode(GL_FRONT_AND_BACK, on ? GL_LINE : GL_FILL);
 }
 
 void rd_cull_face(bool on, bool back)
 {
-    glCullFace(back ? GL_BACK : GL_FRONT);
-    if(on)
-    {
-        glEnable(GL_CULL_FACE);
-    }
-    else {
-        glDisable(GL_CULL_FACE);
-    }
+    rd_state_cull_face(back);
+    rd_state_enable(BGL_RD_CAP_CULL_FACE, on);
 }
 
 void rd_toggle_vsync(bool on)
@@ -247,11 +334,19 @@ void rd_begin_frame(Renderer* self)
     ImGui_ImplGlfw_NewFrame();
     igNewFrame();
 
+    rd_state_depth_mask(true); // the depth clear is masked too, transparent draws turn it off
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
     f64 curr_time = platform_get_time();
+
+    self->state_stats = rd_state.stats;
+    memset(&rd_state.stats, 0, sizeof(RendererStateStats));
     self->delta_time = curr_time - self->last_time;
     self->last_time = curr_time; 
 
+    /* uploaded and bound by the first draw that needs it, once the scene has set the camera and lights */
+    self->frame.time = (f32)curr_time;
+    self->frame_dirty = true;
+
     #ifdef BGL_EDITOR
     if(!self->window.mouse_enabled) rd_editor_toggle_open_panes(self);
     if(self->editor_open) rd_editor_pane(self); 
@@ -335,6 +430,14 @@ void rd_editor_pane(Renderer* self)
         {
             rd_reload_shader(self, current_index);
         }
+
+        /* what the state cache saved last frame */
+        static const char* state_names[BGL_RD_STATE_KIND_COUNT] = { "programs", "vaos", "textures", "samplers", "fixed function" };
+        igText("gl state calls (made / skipped):");
+        for(u32 i = 0; i < BGL_RD_STATE_KIND_COUNT; i++)
+        {
+            igText("  %s: %u / %u", state_names[i], self->state_stats.issued[i], self->state_stats.skipped[i]);
+        }
     igEnd();
 }
 
@@ -342,6 +445,8 @@ void rd_end_frame(Renderer* self)
 {
     igRender();
     ImGui_ImplOpenGL3_RenderDrawData(igGetDrawData());
+    rd_state_invalidate(); // imgui binds its own program, vao and texture
+    draw_ring_fence(&self->draws); // after every draw reading this frame's data
 
     window_swap_buffers(&self->window);
     window_poll_events(&self->window);
@@ -366,7 +471,12 @@ void rd_free(Renderer* self)
     ImGui_ImplGlfw_Shutdown();
     igDestroyContext(self->imgui_ctx);
 
+    geometry_pool_free();
+    bo_stream_free(&self->frame_ubo);
+    draw_ring_free(&self->draws);
     window_free(&self->window);
+
+    jobs_free();
 }
 
 void rd_editor_add_pane(Renderer* self, const char* name, bool* user)
@@ -444,3 +554,132 @@ void rd_get_version_string(Renderer* self, char* buffer)
     buffer[9] = INT_TO_CHAR(major);
     buffer[10] = INT_TO_CHAR(minor);
 }
+
+void rd_state_invalidate(void)
+{
+    rd_state.program = RD_STATE_UNKNOWN;
+    rd_state.vao = RD_STATE_UNKNOWN;
+    rd_state.active_unit = RD_STATE_UNKNOWN;
+    for(u32 i = 0; i < RD_STATE_MAX_TEXTURE_UNITS; i++)
+    {
+        rd_state.textures[i][0] = rd_state.textures[i][1] = RD_STATE_UNKNOWN;
+    }
+    for(u32 i = 0; i < BGL_RD_CAP_COUNT; i++)
+    {
+        rd_state.capabilities[i] = RD_STATE_UNKNOWN;
+    }
+    rd_state.cull_face = RD_STATE_UNKNOWN;
+    rd_state.blend_src = rd_state.blend_dst = RD_STATE_UNKNOWN;
+    rd_state.depth_func = RD_STATE_UNKNOWN;
+    rd_state.depth_mask = RD_STATE_UNKNOWN;
+}
+
+void rd_state_use_program(u32 program)
+{
+    if(rd_state_changed(BGL_RD_STATE_PROGRAM, &rd_state.program, program)) glUseProgram(program);
+}
+
+void rd_state_bind_vao(u32 vao)
+{
+    if(rd_state_changed(BGL_RD_STATE_VAO, &rd_state.vao, vao)) glBindVertexArray(vao);
+}
+
+void rd_state_active_texture(u32 unit)
+{
+    if(rd_state_changed(BGL_RD_STATE_TEXTURE, &rd_state.active_unit, unit)) glActiveTexture(GL_TEXTURE0 + unit);
+}
+
+void rd_state_bind_texture(u32 unit, bool cubemap, u32 texture)
+{
+    const GLenum target = cubemap ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D;
+    if(unit >= RD_STATE_MAX_TEXTURE_UNITS)
+    {
+        rd_state_active_texture(unit);
+        rd_state.stats.issued[BGL_RD_STATE_TEXTURE]++;
+        glBindTexture(target, texture);
+        return;
+    }
+
+    /* bindings are per unit, so the active unit only has to change when something is bound */
+    if(rd_state.textures[unit][cubemap] == texture)
+    {
+        rd_state.stats.skipped[BGL_RD_STATE_TEXTURE]++;
+        return;
+    }
+    rd_state_active_texture(unit);
+    rd_state.textures[unit][cubemap] = texture;
+    rd_state.stats.issued[BGL_RD_STATE_TEXTURE]++;
+    glBindTexture(target, texture);
+}
+
+void rd_state_forget_texture(u32 texture)
+{
+    /* deleting a bound texture binds 0 in its place */
+    for(u32 i = 0; i < RD_STATE_MAX_TEXTURE_UNITS; i++)
+    {
+        if(rd_state.textures[i][0] == texture) rd_state.textures[i][0] = 0;
+        if(rd_state.textures[i][1] == texture) rd_state.textures[i][1] = 0;
+    }
+}
+
+void rd_state_forget_vao(u32 vao)
+{
+    if(rd_state.vao == vao) rd_state.vao = 0;
+}
+
+void rd_state_enable(RendererCapability capability, bool on)
+{
+    if(!rd_state_changed(BGL_RD_STATE_FIXED_FUNCTION, &rd_state.capabilities[capability], on)) return;
+
+    if(on) glEnable(rd_capability_enums[capability]);
+    else glDisable(rd_capability_enums[capability]);
+}
+
+void rd_state_cull_face(bool back)
+{
+    const u32 mode = back ? GL_BACK : GL_FRONT;
+    if(rd_state_changed(BGL_RD_STATE_FIXED_FUNCTION, &rd_state.cull_face, mode)) glCullFace(mode);
+}
+
+void rd_state_blend_func(u32 src_factor, u32 dst_factor)
+{
+    if(rd_state.blend_src == src_factor && rd_state.blend_dst == dst_factor)
+    {
+        rd_state.stats.skipped[BGL_RD_STATE_FIXED_FUNCTION]++;
+        return;
+    }
+    rd_state.blend_src = src_factor;
+    rd_state.blend_dst = dst_factor;
+    rd_state.stats.issued[BGL_RD_STATE_FIXED_FUNCTION]++;
+    glBlendFunc(src_factor, dst_factor);
+}
+
+void rd_state_depth_func(u32 func)
+{
+    if(rd_state_changed(BGL_RD_STATE_FIXED_FUNCTION, &rd_state.depth_func, func)) glDepthFunc(func);
+}
+
+void rd_state_depth_mask(bool write)
+{
+    if(rd_state_changed(BGL_RD_STATE_FIXED_FUNCTION, &rd_state.depth_mask, write)) glDepthMask(write ? GL_TRUE : GL_FALSE);
+}
+
+void rd_state_sampler(Shader* shader, UniformHandle sampler, u32 unit)
+{
+    if(sampler == BGL_UNIFORM_NONE) return;
+
+    /* sampler values live in the program, so they survive switching programs */
+    Uniform* uniform = &shader->uniforms[sampler];
+    u32 cached = (u32)uniform->sampler_unit;
+    bool changed = rd_state_changed(BGL_RD_STATE_SAMPLER, &cached, unit);
+    uniform->sampler_unit = (i32)cached;
+    if(!changed) return;
+
+    if(rd_state.dsa) glProgramUniform1i(shader->id, uniform->location, (i32)unit);
+    else glUniform1i(uniform->location, (i32)unit);
+}
+
+bool rd_state_dsa(void)
+{
+    return rd_state.dsa;
+}
@@ -1,8 +1,11 @@
 #include "scene.h"
 
+#include <string.h>
 #include "defines.h"
 #include "shapes.h"
 #include "model.h"
+#include "ecs/physics_system.h"
+#include "ecs/transform_system.h"
 #include "defines.glsl" // constants shared between c and glsl
 
 #define DEFAULT_FOV 90.0f
@@ -17,7 +20,8 @@
  */
 void scene_update_light_model(Scene* self, u32 index);
 void scene_send_lights(Scene* self, Renderer* rd);
-void scene_editor_pane(Scene* self, Renderer* rd);
+void scene_editor_pane(Scene* self);
+void scene_draw_entities(ECSIter* iter);
 
 void scene_create(Scene* self, Renderer* rd, vec3 start_pos, vec2 start_euler)
 {
@@ -26,24 +30,39 @@ void scene_create(Scene* self, Renderer* rd, vec3 start_pos, vec2 start_euler)
     camera_update_proj(&self->cam, DEFAULT_FOV, aspect_ratio, DEFAULT_ZNEAR, DEFAULT_ZFAR);
 
     self->models = NULL;
-    self->model_count = 0;
+    self->model_count = self->model_capacity = 0;
+    memset(&self->draw_list, 0, sizeof(SceneDrawList));
+    material_table_create(&self->draw_list.materials);
+    render_queue_create(&self->queue);
     self->light_count = 0;
+    self->dirty_lights = 0;
     self->flags = 0;
     self->user_update_func = NULL;
 
+    ecs_create(&self->world);
+    physics_system_register(&self->world);
+    transform_system_register(&self->world);
+    physics_world_create(&self->physics);
+
     self->dir_light.dir = VEC3(0.0f, 0.0f, 0.0f);
     self->dir_light.ambient = VEC3(0.0f, 0.0f, 0.0f);
     self->dir_light.diffuse = VEC3(0.0f, 0.0f, 0.0f);
     self->dir_light.specular = VEC3(0.0f, 0.0f, 0.0f);
 
+    memset(&self->light_stream, 0, sizeof(BOStream));
+    memset(&self->light_ubo, 0, sizeof(UBO));
     if(rd->flags & BGL_RD_LIGHTING_OFF) return;
 
-    self->light_ubo = ubo_create();
-
-    u32 light_ubo_size = BGL_GLSL_MAX_POINT_LIGHTS * sizeof(Light) + BGL_GLSL_INT_SIZE;
-    ubo_bind(self->light_ubo);
-    ubo_set_buffer(self->light_ubo, NULL, light_ubo_size, true); // configure buffer size
-    ubo_unbind(self->light_ubo);
+    const size_t light_size = BGL_GLSL_MAX_POINT_LIGHTS * sizeof(Light); // the count is in the renderer's frame block
+    if(bo_buffer_storage())
+    {
+        bo_stream_create(&self->light_stream, GL_UNIFORM_BUFFER, light_size);
+    }
+    else
+    {
+        self->light_ubo = ubo_create();
+        ubo_set_buffer(self->light_ubo, NULL, light_size, true);
+    }
 
     #ifdef BGL_EDITOR
     rd_editor_add_pane(rd, "scene", &self->editor_open);
@@ -64,10 +83,25 @@ void scene_set_update_callback(Scene* self, SceneUpdateFunc func)
     self->user_update_func = func;
 }
 
+u32 scene_add_system(Scene* self, const char* name, SystemFunc func, ComponentMask read, ComponentMask write, void* user)
+{
+    return ecs_add_system(&self->world, name, func, read, write, user);
+}
+
 u32 scene_add_model(Scene* self, const Model* model)
 {
-    BLOCK_RESIZE_ARRAY(&self->models, Model, self->model_count, 1);
+    /* doubled rather than grown a block at a time, scenes can have hundreds of thousands of models */
+    if(self->model_count == self->model_capacity)
+    {
+        self->model_capacity = MAX(self->model_capacity * 2, BGL_RESIZE_BLOCK_SIZE);
+        self->models = (Model*)BGL_REALLOC(self->models, self->model_capacity * sizeof(Model));
+        self->draw_list.items = (SceneDrawItem*)BGL_REALLOC(self->draw_list.items, self->model_capacity * sizeof(SceneDrawItem));
+        BGL_ASSERT(self->models != NULL && self->draw_list.items != NULL, "scene model reallocation failed");
+    }
+
     self->models[self->model_count++] = *model;
+    self->draw_list.items[self->draw_list.count++].material_id = BGL_MATERIAL_NONE; // nothing to release on the first sync
+    scene_sync_model(self, self->model_count - 1);
 
     return self->model_count - 1;
 }
@@ -86,42 +120,42 @@ bool scene_add_light(Scene* self, Arena* scratch, Renderer* rd, const Light* lig
         return false;
     }
 
-    u32 model_idx;
-    if(model != NULL)
-    {
-        model_idx = scene_add_model(self, model);
-    }
-    else
+    /* lights without a model share one sphere, drawn as instances of a single draw */
+    if(model == NULL && !(self->flags & BGL_SCENE_HAS_LIGHT_GIZMO))
     {
-        Model sphere;
-        Transform transform;
-
         if(scratch == NULL)
         {
             BGL_LOG_WARN("no arena passed to scene_add_light, even though a model was not specified. creating one");
-            arena_create_sized(scratch, KILOBYTES(8));
-            shapes_uv_sphere(&sphere, scratch, BGL_LIGHT_SPHERE_RES, NULL, 0);
-            arena_free(scratch);
+            Arena arena;
+            arena_create_sized(&arena, KILOBYTES(8));
+            shapes_uv_sphere(&self->light_gizmo, &arena, BGL_LIGHT_SPHERE_RES, NULL, 0);
+            arena_free(&arena);
         }
         else
         {
-            shapes_uv_sphere(&sphere, scratch, BGL_LIGHT_SPHERE_RES, NULL, 0);
+            shapes_uv_sphere(&self->light_gizmo, scratch, BGL_LIGHT_SPHERE_RES, NULL, 0);
         }
 
-        transform_reset(&transform);
-        transform.scale = VEC3(0.3f, 0.3f, 0.3f);
-        model_update_transform(&sphere, &transform);
+        self->light_gizmo.shader_idx = rd->light_shader;
+        self->light_gizmo.material.flags |= BGL_MATERIAL_IS_LIGHT;
+        self->light_gizmo_material = material_table_intern(&self->draw_list.materials, &self->light_gizmo.material, self->light_gizmo.shader_idx);
+        self->flags |= BGL_SCENE_HAS_LIGHT_GIZMO;
+    }
 
-        model_idx = scene_add_model(self, &sphere);
+    u32 model_idx = BGL_SCENE_LIGHT_GIZMO;
+    if(model != NULL)
+    {
+        model_idx = scene_add_model(self, model);
+        self->models[model_idx].shader_idx = rd->light_shader; // enforce shader as light shader
+        self->models[model_idx].material.flags |= BGL_MATERIAL_IS_LIGHT;
+        scene_sync_model(self, model_idx);
     }
 
     self->lights[self->light_count] = *light;
     self->light_models[self->light_count] = model_idx;
+    self->dirty_lights |= 1u << self->light_count;
     self->light_count++;
 
-    self->models[model_idx].shader_idx = rd->light_shader; // enforce shader as light shader
-    self->models[model_idx].material.flags |= BGL_MATERIAL_IS_LIGHT;
-
     return true;
 }
 
@@ -133,7 +167,20 @@ bool scene_set_dir_light(Scene* self, const DirLight* light)
         return false;
     }
 
-    self->dir_light = *light;
+    self->dir_light = *light; // copied into the frame block by scene_draw
+    return true;
+}
+
+bool scene_set_light(Scene* self, u32 index, const Light* light)
+{
+    if(light == NULL || index >= (u32)self->light_count)
+    {
+        BGL_LOG_ERROR("invalid light passed to scene_set_light");
+        return false;
+    }
+
+    self->lights[index] = *light;
+    self->dirty_lights |= 1u << index;
     return true;
 }
 
@@ -141,6 +188,7 @@ void scene_update_lights(Scene* self, Renderer* rd)
 {
     if(rd->flags & BGL_RD_LIGHTING_OFF) return;
 
+    self->dirty_lights = self->light_count >= 32 ? 0xFFFFFFFF : (1u << self->light_count) - 1;
     scene_update_light_data(self);
     scene_send_lights(self, rd);
 }
@@ -156,15 +204,25 @@ void scene_switch(Scene* self, Renderer* rd)
 void scene_update(Scene* self, Renderer* rd)
 {
     #ifdef BGL_EDITOR
-    if(self->editor_open) scene_editor_pane(self, rd);
+    if(self->editor_open) scene_editor_pane(self);
     #endif
 
     if(self->user_update_func != NULL) self->user_update_func(self);
 
+    ecs_run_systems(&self->world, (f32)rd->delta_time);
+    physics_world_step(&self->physics, &self->world, (f32)rd->delta_time);
+
+    /* only touch the gpu for lights that changed this frame */
+    if(!(rd->flags & BGL_RD_LIGHTING_OFF) && self->dirty_lights)
+    {
+        scene_update_light_data(self);
+        scene_send_lights(self, rd); // with a stream the data moved to another region of the buffer
+    }
+
     camera_update(&self->cam, &rd->window, (f32)rd->delta_time);
 }
 
-void scene_editor_pane(Scene* self, Renderer* rd)
+void scene_editor_pane(Scene* self)
 {
     igBegin("scene", NULL, 0);
         igText("light editor");
@@ -176,14 +234,17 @@ void scene_editor_pane(Scene* self, Renderer* rd)
         Light* light = &self->lights[light_editor_index];
         DirLight* dir_light = &self->dir_light;
 
+        /* widgets return true when edited, so only the edited light gets re-uploaded */
+        bool light_changed = false;
         igText("position:");
-        igInputFloat("x", (f32*)&light->pos.x, 0.5f, 0.5f, "%.1f", 0);
-        igInputFloat("y", (f32*)&light->pos.y, 0.5f, 0.5f, "%.1f", 0);
-        igInputFloat("z", (f32*)&light->pos.z, 0.5f, 0.5f, "%.1f", 0);
-        igColorEdit3("ambient", (f32*)&light->ambient, 0);
-        igColorEdit3("diffuse", (f32*)&light->diffuse, 0);
-        igColorEdit3("specular", (f32*)&light->specular, 0);
-        igSliderFloat3("attenuation", (f32*)&light->attenuation, 0.0f, 1.0f, "%.3f", 0);
+        light_changed |= igInputFloat("x", (f32*)&light->pos.x, 0.5f, 0.5f, "%.1f", 0);
+        light_changed |= igInputFloat("y", (f32*)&light->pos.y, 0.5f, 0.5f, "%.1f", 0);
+        light_changed |= igInputFloat("z", (f32*)&light->pos.z, 0.5f, 0.5f, "%.1f", 0);
+        light_changed |= igColorEdit3("ambient", (f32*)&light->ambient, 0);
+        light_changed |= igColorEdit3("diffuse", (f32*)&light->diffuse, 0);
+        light_changed |= igColorEdit3("specular", (f32*)&light->specular, 0);
+        light_changed |= igSliderFloat3("attenuation", (f32*)&light->attenuation, 0.0f, 1.0f, "%.3f", 0);
+        if(light_changed && self->light_count > 0) self->dirty_lights |= 1u << light_editor_index;
 
         igDummy((ImVec2){1, 1}); // spacing
         igText("directional light");
@@ -193,41 +254,71 @@ void scene_editor_pane(Scene* self, Renderer* rd)
         igColorEdit3("diffuse##1", (f32*)&dir_light->diffuse, 0);
         igColorEdit3("specular##1", (f32*)&dir_light->specular, 0);
 
-        static bool always_update_lights = true;
-        if(igButton("light updates:", (ImVec2){0, 0})) always_update_lights = !always_update_lights; // stop lights updating every frame
-        igSameLine(0.0f, 7.0f);                                                                                 
-        if(always_update_lights) 
-        {
-            igText("on");
-            scene_update_lights(self, rd); // this updates light data and light graphics as well, because we are rendering this scene
-        }
-        else
-        {
-            igText("off");
-        }
+        igDummy((ImVec2){1, 1});
+        igText("draws: %u, instances: %u, shader changes: %u, material changes: %u, mesh changes: %u", self->queue.draw_count,
+               self->queue.instance_count, self->queue.shader_changes, self->queue.material_changes, self->queue.mesh_changes);
     igEnd();
 }
 
 void scene_draw(Scene* self, Renderer* rd)
 {
-    for(u32 i = 0; i < self->model_count; i++)
+    /* everything drawn below reads the camera and lights from the frame block */
+    rd_frame_set_camera(rd, &self->cam);
+    rd_frame_set_lights(rd, &self->dir_light, (u32)self->light_count);
+
+    scene_queue_draws(self);
+    render_queue_sort(&self->queue);
+    render_queue_submit_opaque(&self->queue, rd);
+
+    /* drawn after the opaque draws filled the depth buffer, but before the transparent ones which have to blend over it */
+    if(self->flags & BGL_SCENE_HAS_SKYBOX) skybox_draw(&self->skybox, rd, &self->cam);
+
+    render_queue_submit_transparent(&self->queue, rd);
+}
+
+void scene_queue_draws(Scene* self)
+{
+    render_queue_clear(&self->queue);
+
+    for(u32 i = 0; i < self->draw_list.count; i++)
+    {
+        SceneDrawItem* item = &self->draw_list.items[i];
+        vec3 centre = vec3_scale(vec3_add(item->bounds_min, item->bounds_max), 0.5f);
+        render_queue_push_meshes(&self->queue, 0, item->meshes, item->mesh_count, item->material, item->material_id,
+                                 item->shader_idx, &item->model, render_queue_depth(&self->cam, centre));
+    }
+
+    for(u32 i = 0; i < (u32)self->light_count; i++)
     {
-        model_draw(&self->models[i], rd, &self->cam);
+        if(self->light_models[i] != BGL_SCENE_LIGHT_GIZMO) continue;
+        render_queue_push_meshes(&self->queue, 0, self->light_gizmo.meshes, self->light_gizmo.mesh_count, &self->light_gizmo.material,
+                                 self->light_gizmo_material, self->light_gizmo.shader_idx, &self->light_gizmo_matrices[i],
+                                 render_queue_depth(&self->cam, VEC4TOVEC3(self->lights[i].pos)));
     }
 
-    if(self->flags & BGL_SCENE_HAS_SKYBOX) skybox_draw(&self->skybox, rd, &self->cam); // drawn last after depth buffer filled
+    /* no entities are created or destroyed before the submit, so the matrices pushed stay where they are */
+    ecs_query(&self->world, BGL_COMPONENT_BIT(BGL_COMPONENT_MODEL_MATRIX) | BGL_COMPONENT_BIT(BGL_COMPONENT_MESH_REF),
+              scene_draw_entities, self);
 }
 
 void scene_free(Scene* self)
 {
     skybox_free(&self->skybox);
+    if(self->flags & BGL_SCENE_HAS_LIGHT_GIZMO) model_free(&self->light_gizmo);
     for(u32 i = 0; i < self->model_count; i++)
     {
         model_free(&self->models[i]);
     }
     if(self->models != NULL) BGL_FREE(self->models); // in case no models were added
+    if(self->draw_list.items != NULL) BGL_FREE(self->draw_list.items);
+    material_table_free(&self->draw_list.materials);
+    render_queue_free(&self->queue);
 
-    ubo_free(self->light_ubo);
+    physics_world_free(&self->physics);
+    ecs_free(&self->world);
+
+    bo_stream_free(&self->light_stream);
+    if(self->light_ubo.id != 0) ubo_free(self->light_ubo);
 }
 
 void scene_update_light_model(Scene* self, u32 index)
@@ -235,6 +326,17 @@ void scene_update_light_model(Scene* self, u32 index)
     BGL_ASSERT(index < (u32)self->light_count, "light index given to update light model exceeds end of light buffer"); // internal func so assert here instead of return
 
     Light* light = &self->lights[index];
+    if(self->light_models[index] == BGL_SCENE_LIGHT_GIZMO)
+    {
+        /* the light shader takes the colour from the light buffer, only the position is needed */
+        Transform transform;
+        transform_reset(&transform);
+        transform.pos = VEC4TOVEC3(light->pos);
+        transform.scale = VEC3(BGL_LIGHT_SPHERE_SCALE, BGL_LIGHT_SPHERE_SCALE, BGL_LIGHT_SPHERE_SCALE);
+        transform_to_matrix(&transform, &self->light_gizmo_matrices[index]);
+        return;
+    }
+
     Model* light_model = &self->models[self->light_models[index]];
     Transform transform = light_model->transform;
 
@@ -244,50 +346,102 @@ void scene_update_light_model(Scene* self, u32 index)
 
     transform.pos = VEC4TOVEC3(light->pos); // TODO: make this optional/move light relative to model?
     model_update_transform(light_model, &transform);
+    scene_sync_model(self, self->light_models[index]);
 }
 
 void scene_update_light_data(Scene* self)
 {
-    const u32 light_buf_size = BGL_GLSL_MAX_POINT_LIGHTS * sizeof(Light);
-    ubo_bind(self->light_ubo);
-    ubo_set_buffer_region(self->light_ubo, self->lights,       0,                   light_buf_size);
-    ubo_set_buffer_region(self->light_ubo, &self->light_count, (i32)light_buf_size, BGL_GLSL_INT_SIZE);
-    ubo_unbind(self->light_ubo);
+    if(self->dirty_lights == 0) return;
 
-    for(i32 i = 0; i < self->light_count; i++)
+    for(u32 i = 0; i < (u32)self->light_count; i++)
+    {
+        if(self->dirty_lights & (1u << i)) scene_update_light_model(self, i);
+    }
+
+    if(bo_buffer_storage())
+    {
+        /* each write is a new region of the stream, so every light goes in it, not only the dirty ones */
+        const size_t size = BGL_GLSL_MAX_POINT_LIGHTS * sizeof(Light);
+        memcpy(bo_stream_begin(&self->light_stream, size), self->lights, (u32)self->light_count * sizeof(Light));
+        bo_stream_end(&self->light_stream);
+    }
+    else
     {
-        scene_update_light_model(self, (u32)i);
+        /* upload each contiguous run of dirty lights with one call, the driver keeps what the gpu is still reading */
+        u32 i = 0;
+        while(i < (u32)self->light_count)
+        {
+            if(!(self->dirty_lights & (1u << i)))
+            {
+                i++;
+                continue;
+            }
+
+            u32 start = i;
+            while(i < (u32)self->light_count && (self->dirty_lights & (1u << i))) i++;
+            ubo_set_buffer_region(self->light_ubo, &self->lights[start], (i32)(start * sizeof(Light)), (i - start) * sizeof(Light));
+        }
     }
+
+    self->dirty_lights = 0;
 }
 
 void scene_send_lights(Scene* self, Renderer* rd)
 {
     if(rd->flags & BGL_RD_LIGHTING_OFF) return;
 
-    ubo_bind_buffer_range(self->light_ubo, 0, 0, BGL_GLSL_MAX_POINT_LIGHTS * sizeof(Light) + BGL_GLSL_INT_SIZE); // TODO: remove hardcoding of location/index
-
-    // TODO: add dir_light to ubo so as to not do this (light index 0)
-    /* updating dir_light for all shaders */
+    /* the directional light and light count are in the renderer's frame block, so only the point lights are bound */
+    const size_t size = BGL_GLSL_MAX_POINT_LIGHTS * sizeof(Light);
+    if(bo_buffer_storage()) ubo_bind_buffer_range(self->light_stream.bo, BGL_GLSL_LIGHTS_BINDING, (i32)bo_stream_offset(&self->light_stream), size);
+    else ubo_bind_buffer_range(self->light_ubo, BGL_GLSL_LIGHTS_BINDING, 0, size);
+}
 
-    u32 shaders[self->model_count];
-    u32 shader_count = 0;
-    for(u32 i = 0; i < self->model_count; i++)
+void scene_draw_entities(ECSIter* iter)
+{
+    Scene* scene = (Scene*)iter->user;
+    mat4* matrices = ECS_ITER_COLUMN(iter, mat4, BGL_COMPONENT_MODEL_MATRIX);
+    const MeshRef* refs = ECS_ITER_COLUMN(iter, MeshRef, BGL_COMPONENT_MESH_REF);
+
+    /* instances of a prefab share its model, so the material is only looked up when the model changes.
+     * nothing tells the scene when a prefab is freed, so their materials stay interned until scene_free */
+    Model* last_model = NULL;
+    u32 material_id = BGL_MATERIAL_NONE;
+    for(u32 i = 0; i < iter->count; i++)
     {
-        const Model* curr_model = &self->models[i];
-        if(curr_model->material.flags & (BGL_MATERIAL_NO_LIGHTING | BGL_MATERIAL_IS_LIGHT)) continue;
-
-        u32 curr_shader = curr_model->shader_idx;
-        for(u32 i = 0; i < shader_count; i++)
+        Model* model = refs[i].model;
+        if(model != last_model)
         {
-            if(curr_shader == shaders[i]) continue;
+            last_model = model;
+            material_id = material_table_find(&scene->draw_list.materials, &model->material, model->shader_idx);
+            if(material_id == BGL_MATERIAL_NONE) material_id = material_table_intern(&scene->draw_list.materials, &model->material, model->shader_idx);
         }
 
-        shaders[shader_count++] = curr_shader;
+        vec3 pos = VEC3(matrices[i].m14, matrices[i].m24, matrices[i].m34);
+        render_queue_push_meshes(&scene->queue, 0, model->meshes, model->mesh_count, &model->material, material_id, model->shader_idx,
+                                 &matrices[i], render_queue_depth(&scene->cam, pos));
     }
+}
 
-    for(u32 i = 0; i < shader_count; i++)
-    {
-        rd_use_shader(rd, shaders[i]);
-        dir_light_set_uniforms(&self->dir_light, &rd->shaders[shaders[i]]);
-    }
+void scene_sync_model(Scene* self, u32 index)
+{
+    BGL_ASSERT(index < self->model_count, "model index %u given to scene_sync_model exceeds model count", index);
+    SceneDrawList* list = &self->draw_list;
+    const Model* model = &self->models[index];
+    SceneDrawItem* item = &list->items[index];
+
+    item->model = model->model;
+    item->meshes = model->meshes;
+    item->mesh_count = model->mesh_count;
+    item->shader_idx = model->shader_idx;
+    item->flags = model->material.flags;
+
+    /* interned before the old one is released, so a material that didn't change keeps its entry */
+    const u32 material_id = material_table_intern(&list->materials, &model->material, model->shader_idx);
+    if(item->material_id != BGL_MATERIAL_NONE) material_table_release(&list->materials, item->material_id);
+    item->material_id = material_id;
+    item->material = material_table_get(&list->materials, material_id);
+
+    vec3 local_min, local_max;
+    model_get_bounds(model, &local_min, &local_max);
+    mat4_transform_aabb(&item->bounds_min, &item->bounds_max, model->model, local_min, local_max);
 }
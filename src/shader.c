@@ -7,6 +7,8 @@
 #include "util.h"
 #include "bgl_math.h"
 #include "arena.h"
+#include "renderer.h"
+#include "defines.glsl"
 
 #define INFO_LOG_SIZE 512 
 
@@ -26,10 +28,33 @@
 #define SHADER_ADD_SOURCE(path, index)
 #endif
 
+static const char* shader_builtin_names[BGL_UNIFORM_BUILTIN_COUNT] = {
+    "material.ambient",
+    "material.diffuse",
+    "material.specular",
+    "material.shininess",
+    MACRO_TO_STR(BGL_GLSL_TEXTURE_DIFFUSE),
+    MACRO_TO_STR(BGL_GLSL_TEXTURE_SPECULAR),
+    MACRO_TO_STR(BGL_GLSL_TEXTURE_NORMAL),
+};
+
 /**
  * internal functions
  */
 bool shader_compile(const char* shader_code, GLenum shader_type, u32* shader_out);
+void shader_reflect_uniforms(Shader* self);
+
+/* fnv-1a */
+static inline u32 shader_hash_name(const char* name)
+{
+    u32 hash = 2166136261u;
+    for(const char* c = name; *c != '\0'; c++)
+    {
+        hash ^= (u8)*c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
 
 bool shader_create(Shader* self, Arena* scratch, const char* const* shader_filepaths, u32 shader_count, const char* version_str, bool no_uniform_bindings)
 {
@@ -97,7 +122,7 @@ bool shader_create(Shader* self, Arena* scratch, const char* const* shader_filep
     {
         parser.path = shader_filepaths[i];
         parser.code = shader_code[i];
-        char* code = shader_process(&parser, self, scratch);
+        char* code = shader_process(&parser, scratch);
         CREATION_ASSERT(code != NULL, "shader code not processed");
 
         /* deal with #type directives */
@@ -151,16 +176,8 @@ bool shader_create(Shader* self, Arena* scratch, const char* const* shader_filep
         CREATION_ASSERT(false, "shader program creation failed. info log:\n%s", info_log);
     }
 
-    /* get locations here because needs to be done after linking program */
-    for(u32 i = 0; i < self->uniform_count; i++)
-    {
-        i32 location = glGetUniformLocation(self->id, self->uniforms[i].name);
-        if(location == -1)
-        {
-            BGL_LOG_WARN("uniform %s was not given a location in program. name of one of the shader sources: %s", self->uniforms[i].name, shader_filepaths[0]);
-        }
-        self->uniforms[i].location = location;
-    }
+    /* uniforms come from the linked program, so ones the compiler removed aren't looked up */
+    shader_reflect_uniforms(self);
 
     /* set ubo block bindings if opengl version < 4.2 */
     for(u32 i = 0; i < parser.ubo_count; i++)
@@ -206,29 +223,57 @@ bool shader_compile(const char* shader_code, GLenum shader_type, u32* shader_out
     return true;
 }
 
-i32 shader_find_uniform(Shader* self, const char* name)
+UniformHandle shader_uniform_handle(const Shader* self, const char* name)
 {
     BGL_ASSERT(name != NULL, "uniform name cannot be NULL");
 
+    const u32 hash = shader_hash_name(name);
     for(u32 i = 0; i < self->uniform_count; i++)
     {
-        Uniform curr = self->uniforms[i];
-        if(strcmp(name, curr.name) == 0) return curr.location;
+        if(self->uniforms[i].hash == hash && strcmp(name, self->uniforms[i].name) == 0) return i;
     }
+    return BGL_UNIFORM_NONE;
+}
 
-    BGL_LOG_INFO("uniform %s not found. Caching...", name);
-    i32 location = glGetUniformLocation(self->id, name);
+i32 shader_find_uniform(const Shader* self, const char* name)
+{
+    UniformHandle handle = shader_uniform_handle(self, name);
+    return handle != BGL_UNIFORM_NONE ? self->uniforms[handle].location : -1;
+}
+
+void shader_reflect_uniforms(Shader* self)
+{
+    i32 count = 0;
+    glGetProgramiv(self->id, GL_ACTIVE_UNIFORMS, &count);
+    if(count > 0)
+    {
+        self->uniforms = (Uniform*)BGL_MALLOC((size_t)count * sizeof(Uniform));
+        BGL_ASSERT(self->uniforms != NULL, "uniform allocation failed");
+    }
 
-    /* just in case there is a name longer, still allow to work but don't cache */
-    if(strlen(name) <= MAX_UNIFORM_NAME)
+    for(u32 i = 0; i < (u32)count; i++)
     {
-        BLOCK_RESIZE_ARRAY(&self->uniforms, Uniform, self->uniform_count, 1);
-        strncpy(self->uniforms[self->uniform_count].name, name, MAX_UNIFORM_NAME);
-        self->uniforms[self->uniform_count].location = location;
+        Uniform* uniform = &self->uniforms[self->uniform_count];
+        GLsizei length;
+        GLint size;
+        GLenum type;
+        glGetActiveUniform(self->id, i, MAX_UNIFORM_NAME, &length, &size, &type, uniform->name);
+
+        uniform->location = glGetUniformLocation(self->id, uniform->name);
+        if(uniform->location == -1) continue; // member of a uniform block
+
+        /* arrays are listed as name[0], they're looked up by the plain name */
+        if(length > 3 && strcmp(uniform->name + length - 3, "[0]") == 0) uniform->name[length - 3] = '\0';
+
+        uniform->hash = shader_hash_name(uniform->name);
+        uniform->sampler_unit = -1;
         self->uniform_count++;
     }
 
-    return location;
+    for(u32 i = 0; i < BGL_UNIFORM_BUILTIN_COUNT; i++)
+    {
+        self->builtins[i] = shader_uniform_handle(self, shader_builtin_names[i]);
+    }
 }
 
 void shader_use(Shader* self)
@@ -242,40 +287,82 @@ void shader_free(Shader* self)
     BGL_FREE(self->uniforms);
 }
 
+void shader_set_mat4(Shader* self, UniformHandle handle, const mat4* mat)
+{
+    if(handle == BGL_UNIFORM_NONE) return;
+    const i32 location = self->uniforms[handle].location;
+    if(rd_state_dsa()) glProgramUniformMatrix4fv(self->id, location, 1, GL_FALSE, mat->data); // transposing matrix is false
+    else glUniformMatrix4fv(location, 1, GL_FALSE, mat->data);
+}
+
+void shader_set_vec4(Shader* self, UniformHandle handle, const vec4* vec)
+{
+    if(handle == BGL_UNIFORM_NONE) return;
+    const i32 location = self->uniforms[handle].location;
+    if(rd_state_dsa()) glProgramUniform4fv(self->id, location, 1, vec->data);
+    else glUniform4fv(location, 1, vec->data);
+}
+
+void shader_set_vec3(Shader* self, UniformHandle handle, const vec3* vec)
+{
+    if(handle == BGL_UNIFORM_NONE) return;
+    const i32 location = self->uniforms[handle].location;
+    if(rd_state_dsa()) glProgramUniform3fv(self->id, location, 1, vec->data);
+    else glUniform3fv(location, 1, vec->data);
+}
+
+void shader_set_vec2(Shader* self, UniformHandle handle, const vec2* vec)
+{
+    if(handle == BGL_UNIFORM_NONE) return;
+    const i32 location = self->uniforms[handle].location;
+    if(rd_state_dsa()) glProgramUniform2fv(self->id, location, 1, vec->data);
+    else glUniform2fv(location, 1, vec->data);
+}
+
+void shader_set_f32(Shader* self, UniformHandle handle, f32 f)
+{
+    if(handle == BGL_UNIFORM_NONE) return;
+    const i32 location = self->uniforms[handle].location;
+    if(rd_state_dsa()) glProgramUniform1f(self->id, location, f);
+    else glUniform1f(location, f);
+}
+
+void shader_set_int(Shader* self, UniformHandle handle, i32 i)
+{
+    if(handle == BGL_UNIFORM_NONE) return;
+    const i32 location = self->uniforms[handle].location;
+    if(rd_state_dsa()) glProgramUniform1i(self->id, location, i);
+    else glUniform1i(location, i);
+}
+
 void shader_uniform_mat4(Shader* self, const char* name, mat4* mat)
 {
-    i32 location = shader_find_uniform(self, name);
-    glUniformMatrix4fv(location, 1, GL_FALSE, (f32*)mat->data); // transposing matrix is false
+    shader_set_mat4(self, shader_uniform_handle(self, name), mat);
 }
 
 void shader_uniform_vec4(Shader* self, const char* name, vec4* vec)
 {
-    i32 location = shader_find_uniform(self, name);
-    glUniform4fv(location, 1, (f32*)vec->data);
+    shader_set_vec4(self, shader_uniform_handle(self, name), vec);
 }
 
 void shader_uniform_vec3(Shader* self, const char* name, vec3* vec)
 {
-    i32 location = shader_find_uniform(self, name);
-    glUniform3fv(location, 1, (f32*)vec->data);
+    shader_set_vec3(self, shader_uniform_handle(self, name), vec);
 }
 
 void shader_uniform_vec2(Shader* self, const char* name, vec2* vec)
 {
-    i32 location = shader_find_uniform(self, name);
-    glUniform2fv(location, 1, (f32*)vec->data);
+    shader_set_vec2(self, shader_uniform_handle(self, name), vec);
 }
 
 void shader_uniform_f32(Shader* self, const char* name, f32 f)
 {
-    i32 location = shader_find_uniform(self, name);
-    glUniform1f(location, f);
+    shader_set_f32(self, shader_uniform_handle(self, name), f);
 }
 
 void shader_uniform_int(Shader* self, const char* name, i32 i)
 {
-    i32 location = shader_find_uniform(self, name);
-    glUniform1i(location, i);
+    shader_set_int(self, shader_uniform_handle(self, name), i);
 }
 
 void shader_ubo_set_binding(Shader* self, const char* uniform_block, u32 binding)
@@ -1,6 +1,5 @@
 #include "shader_parser.h"
 #include "util.h"
-#include "defines.glsl"
 
 // TODO: test geometry shader
 
@@ -25,17 +24,15 @@
 void skip_whitespace(ShaderParser* parser);
 void next_token(ShaderParser* parser);
 bool token_strequal(ShaderParser* parser, const char* string);
-bool token_add_uniform_name(ShaderParser* parser, Uniform* uniform);
 
 bool parser_alloc(ShaderParser* parser, Arena* scratch, u64 size);
 bool add_version_directive(ShaderParser* parser, Arena* scratch);
 bool process_binding(ShaderParser* parser);
-void process_uniform(ShaderParser* parser, Shader* shader);
 bool process_type_directive(ShaderParser* parser);
 bool process_version_directive(ShaderParser* parser);
 bool process_include_directive(ShaderParser* parser, Arena* scratch);
 
-char* shader_process(ShaderParser* parser, Shader* shader, Arena* scratch)
+char* shader_process(ShaderParser* parser, Arena* scratch)
 {
     char* processed_code = (char*)arena_alloc_unaligned(scratch, 0);
     bool processed_type_directive = false;
@@ -51,11 +48,7 @@ char* shader_process(ShaderParser* parser, Shader* shader, Arena* scratch)
     parser->first--; // hack to prevent first character from being skipped
     while(parser->code[parser->last] != '\0')
     {
-        if(token_strequal(parser, "uniform"))
-        {
-            process_uniform(parser, shader);
-        }
-        else if(parser->no_uniform_bindings && token_strequal(parser, "(binding"))
+        if(parser->no_uniform_bindings && token_strequal(parser, "(binding"))
         {
             PARSER_CHECK(parser_alloc(parser, scratch, PARSER_ALLOC_SIZE(parser)));
             PARSER_CHECK(process_binding(parser));
@@ -189,21 +182,6 @@ bool add_version_directive(ShaderParser* parser, Arena* scratch)
     return true;
 }
 
-bool token_add_uniform_name(ShaderParser* parser, Uniform* uniform)
-{
-    u64 length = parser->last - parser->first;
-    if(length >= MAX_UNIFORM_NAME - 1) // consider \0
-    {
-        BGL_LOG_INFO("length of uniform name too long to add to cache");
-        return false;
-    }
-
-    memcpy(uniform->name, parser->code + parser->first, length);
-    uniform->name[length] = '\0';
-
-    return true;
-}
-
 bool process_binding(ShaderParser* parser)
 {
     const char* p = parser->code;
@@ -244,56 +222,6 @@ bool process_binding(ShaderParser* parser)
 
 /* assumes immediate whitespace after semicolon, it may have a comment
  * after or another uniform with no newline in between which messes this up */
-void process_uniform(ShaderParser* parser, Shader* shader)
-{
-    Uniform uniform;
-
-    next_token(parser);
-    if(token_strequal(parser, "sampler2D") || token_strequal(parser, "samplerCube")) // TODO: add more 
-    {
-        next_token(parser);
-        // TODO: remove texture macro system?
-        parser->last--; // remove semicolon
-        if(token_strequal(parser, MACRO_TO_MACRO_NAME(BGL_GLSL_TEXTURE_DIFFUSE)))
-        {
-            strncpy(uniform.name, MACRO_TO_STR(BGL_GLSL_TEXTURE_DIFFUSE), MAX_UNIFORM_NAME);
-        }
-        else if(token_strequal(parser, MACRO_TO_MACRO_NAME(BGL_GLSL_TEXTURE_SPECULAR)))
-        {
-            strncpy(uniform.name, MACRO_TO_STR(BGL_GLSL_TEXTURE_SPECULAR), MAX_UNIFORM_NAME);
-        }
-        else
-        {
-            parser->last++;
-            if(!token_add_uniform_name(parser, &uniform)) return; // parser name too long - don't fail
-            BGL_LOG_INFO("non-standard name for sampler uniform: %s", uniform.name);
-            parser->last--;
-        }
-        parser->last++; // add back semicolon
-    }
-    else if(token_strequal(parser, "Material") || token_strequal(parser, "DirLight")) // struct uniforms are too complicated
-    {
-        parser->last++;
-        return;
-    }
-    else
-    {
-        next_token(parser);
-        if(parser->code[parser->first] == '{') return; // ubo - don't bother with it now will be cached later
-        if(!token_add_uniform_name(parser, &uniform)) return; // parser name too long - don't fail
-    }
-
-    /* ignore duplicates from previously processed shaders */
-    for(u32 i = 0; i < shader->uniform_count; i++)
-    {
-        if(strcmp(uniform.name, shader->uniforms[i].name) == 0) return;
-    }
-    if(strcmp(uniform.name, "") == 0) BGL_LOG_ERROR("%s", parser->code + parser->first);
-
-    BLOCK_RESIZE_ARRAY(&shader->uniforms, Uniform, shader->uniform_count, 1);
-    shader->uniforms[shader->uniform_count++] = uniform;
-}
-
 bool process_type_directive(ShaderParser* parser)
 {
     next_token(parser);
@@ -20,14 +20,13 @@ void skybox_draw(Model* self, Renderer* rd, Camera* cam)
 {
     Shader* shader = &rd->shaders[self->shader_idx];
 
-    mat4 vp; // no translation allowed to keep skybox at consistent distance
-    mat4 corrected_view = cam->view;
-    corrected_view.m14 = corrected_view.m24 = corrected_view.m34 = 0.0f; // remove translation
-    mat4_mul(&vp, cam->projection, corrected_view);
+    /* the shader drops the view's translation itself to keep the skybox at a consistent distance */
+    rd_frame_set_camera(rd, cam);
+    rd_frame_upload(rd);
 
     rd_cull_face(true, false); // cull front face since we are inside the box
     rd_use_shader(rd, self->shader_idx);
-    shader_uniform_mat4(shader, "mvp", &vp);
+    material_set_blend_state(&self->material); // opaque, it's only drawn where nothing else is
 
     mesh_draw(&self->meshes[0], shader, self->material.textures);
     rd_cull_face(true, true);
@@ -0,0 +1,350 @@
+#include "spatial_grid.h"
+
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jobs.h"
+
+#define POINT_BATCH_SIZE 8192
+#define BUCKET_BATCH_SIZE 16384 // also the block size of the prefix sum
+#define NEIGHBOUR_BATCH_SIZE 1024
+#define INSERTION_SORT_MAX 32 // bigger buckets use qsort
+#define CELL_COORD_MAX 1e9f // coordinates are clamped to stay inside i32
+
+typedef struct GridBuild
+{
+    SpatialGrid* grid;
+    const vec3* points;
+    const u32* ids;
+    u32* point_buckets;
+    u32* point_ranks; // position of the point inside its bucket, in the order the threads counted
+    atomic_uint* counts;
+    u32* block_sums;
+} GridBuild;
+
+/* state of a walk over the cells touching a sphere, either gathering ids or keeping the nearest point */
+typedef struct GridScan
+{
+    vec3 centre;
+    f32 radius_sq;
+    u32 skip_slot; // slot never reported, BGL_SPATIAL_GRID_NULL for none
+    u32 ignore_id;
+    u32* ids_out;
+    u32 max_ids;
+    u32 found;
+    bool nearest;
+    u32 best_id;
+} GridScan;
+
+typedef struct GridNeighbours
+{
+    const SpatialGrid* grid;
+    f32 radius;
+    u32 max_neighbours;
+    u32* neighbours_out;
+    u32* counts_out;
+    u64 totals[BGL_JOBS_MAX_WORKERS + 1]; // per worker
+} GridNeighbours;
+
+/**
+ * internal functions
+ */
+void spatial_grid_count(void* data, u32 start, u32 end, u32 worker);
+void spatial_grid_sum_blocks(void* data, u32 start, u32 end, u32 worker);
+void spatial_grid_write_starts(void* data, u32 start, u32 end, u32 worker);
+void spatial_grid_scatter(void* data, u32 start, u32 end, u32 worker);
+void spatial_grid_sort_buckets(void* data, u32 start, u32 end, u32 worker);
+void spatial_grid_map_ids(void* data, u32 start, u32 end, u32 worker);
+void spatial_grid_neighbours_job(void* data, u32 start, u32 end, u32 worker);
+void spatial_grid_scan(const SpatialGrid* self, GridScan* scan, f32 radius);
+int spatial_grid_compare_indices(const void* a, const void* b);
+
+static inline i32 spatial_grid_coord(const SpatialGrid* self, f32 x)
+{
+    return (i32)floorf(MIN(MAX(x * self->inv_cell_size, -CELL_COORD_MAX), CELL_COORD_MAX));
+}
+
+static inline u32 spatial_grid_hash(const SpatialGrid* self, i32 x, i32 y, i32 z)
+{
+    u32 h = ((u32)x * 73856093u) ^ ((u32)y * 19349663u) ^ ((u32)z * 83492791u);
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    return h & self->bucket_mask;
+}
+
+static inline u32 spatial_grid_bucket(const SpatialGrid* self, vec3 point)
+{
+    return spatial_grid_hash(self, spatial_grid_coord(self, point.x), spatial_grid_coord(self, point.y), spatial_grid_coord(self, point.z));
+}
+
+/* test the points of one bucket. cells sharing a bucket would be reported twice, so if check_cell is set
+   only points inside cell (x, y, z) count */
+static inline void spatial_grid_scan_bucket(const SpatialGrid* self, GridScan* scan, u32 bucket, i32 x, i32 y, i32 z, bool check_cell)
+{
+    for(u32 slot = self->bucket_starts[bucket]; slot < self->bucket_starts[bucket + 1]; slot++)
+    {
+        vec3 p = self->points[slot];
+        f32 dx = p.x - scan->centre.x, dy = p.y - scan->centre.y, dz = p.z - scan->centre.z;
+        f32 dist_sq = dx * dx + dy * dy + dz * dz;
+        if(dist_sq > scan->radius_sq || slot == scan->skip_slot) continue;
+        if(check_cell && (spatial_grid_coord(self, p.x) != x || spatial_grid_coord(self, p.y) != y || spatial_grid_coord(self, p.z) != z)) continue;
+
+        if(scan->nearest)
+        {
+            if(self->ids[slot] == scan->ignore_id) continue;
+            scan->radius_sq = dist_sq;
+            scan->best_id = self->ids[slot];
+            continue;
+        }
+        if(scan->found < scan->max_ids) scan->ids_out[scan->found] = self->ids[slot];
+        scan->found++;
+    }
+}
+
+void spatial_grid_build(SpatialGrid* self, Arena* arena, const vec3* points, const u32* ids, u32 count, f32 cell_size)
+{
+    BGL_ASSERT(cell_size > 0.0f, "spatial grid cell size must be positive, got %f", (f64)cell_size);
+
+    u32 bucket_count = 1;
+    while(bucket_count < count && bucket_count < 0x80000000u) bucket_count <<= 1;
+
+    *self = (SpatialGrid){
+        .cell_size = cell_size,
+        .inv_cell_size = 1.0f / cell_size,
+        .bucket_mask = bucket_count - 1,
+        .count = count,
+        .bucket_starts = (u32*)arena_alloc(arena, ((u64)bucket_count + 1) * sizeof(u32)),
+        .ids = (u32*)arena_alloc(arena, (u64)count * sizeof(u32)),
+        .points = (vec3*)arena_alloc(arena, (u64)count * sizeof(vec3))
+    };
+
+    u32 block_count = (bucket_count + BUCKET_BATCH_SIZE - 1) / BUCKET_BATCH_SIZE;
+    GridBuild build = {
+        .grid = self,
+        .points = points,
+        .ids = ids,
+        .point_buckets = (u32*)arena_alloc(arena, (u64)count * sizeof(u32)),
+        .point_ranks = (u32*)arena_alloc(arena, (u64)count * sizeof(u32)),
+        .counts = (atomic_uint*)arena_alloc(arena, (u64)bucket_count * sizeof(atomic_uint)),
+        .block_sums = (u32*)arena_alloc(arena, (u64)block_count * sizeof(u32))
+    };
+    memset(build.counts, 0, (u64)bucket_count * sizeof(atomic_uint));
+
+    jobs_parallel_for(count, POINT_BATCH_SIZE, spatial_grid_count, &build);
+
+    /* prefix sum: every block of buckets is summed in parallel, the block sums are scanned here and
+       the blocks then write their starts from their offset */
+    jobs_parallel_for(bucket_count, BUCKET_BATCH_SIZE, spatial_grid_sum_blocks, &build);
+    u32 offset = 0;
+    for(u32 i = 0; i < block_count; i++)
+    {
+        u32 sum = build.block_sums[i];
+        build.block_sums[i] = offset;
+        offset += sum;
+    }
+    jobs_parallel_for(bucket_count, BUCKET_BATCH_SIZE, spatial_grid_write_starts, &build);
+    self->bucket_starts[bucket_count] = count;
+
+    /* the scatter stores the points with their input index in ids. the ranks, and so the order inside
+       a bucket, depend on the threads until the buckets are sorted. the caller's ids replace the
+       indices last */
+    jobs_parallel_for(count, POINT_BATCH_SIZE, spatial_grid_scatter, &build);
+    jobs_parallel_for(bucket_count, BUCKET_BATCH_SIZE, spatial_grid_sort_buckets, &build);
+    if(ids != NULL) jobs_parallel_for(count, POINT_BATCH_SIZE, spatial_grid_map_ids, &build);
+}
+
+u32 spatial_grid_query_radius(const SpatialGrid* self, vec3 centre, f32 radius, u32* ids_out, u32 max_ids)
+{
+    GridScan scan = {
+        .centre = centre,
+        .radius_sq = radius * radius,
+        .skip_slot = BGL_SPATIAL_GRID_NULL,
+        .ids_out = ids_out,
+        .max_ids = max_ids
+    };
+    spatial_grid_scan(self, &scan, radius);
+    return scan.found;
+}
+
+u32 spatial_grid_query_nearest(const SpatialGrid* self, vec3 centre, f32 max_radius, u32 ignore_id)
+{
+    GridScan scan = {
+        .centre = centre,
+        .skip_slot = BGL_SPATIAL_GRID_NULL,
+        .ignore_id = ignore_id,
+        .nearest = true,
+        .best_id = BGL_SPATIAL_GRID_NULL
+    };
+
+    /* grow the searched sphere until it holds a point, anything closer than the radius searched is
+       in the cells visited so the first point found within it is the nearest */
+    f32 radius = MIN(self->cell_size, max_radius);
+    while(true)
+    {
+        scan.radius_sq = radius * radius;
+        spatial_grid_scan(self, &scan, radius);
+        if(scan.best_id != BGL_SPATIAL_GRID_NULL || radius >= max_radius) break;
+        radius = MIN(radius * 2.0f, max_radius);
+    }
+    return scan.best_id;
+}
+
+u64 spatial_grid_neighbours(const SpatialGrid* self, f32 radius, u32 max_neighbours, u32* neighbours_out, u32* counts_out)
+{
+    GridNeighbours neighbours = {
+        .grid = self,
+        .radius = radius,
+        .max_neighbours = max_neighbours,
+        .neighbours_out = neighbours_out,
+        .counts_out = counts_out
+    };
+    jobs_parallel_for(self->count, NEIGHBOUR_BATCH_SIZE, spatial_grid_neighbours_job, &neighbours);
+
+    u64 total = 0;
+    for(u32 i = 0; i <= BGL_JOBS_MAX_WORKERS; i++) total += neighbours.totals[i];
+    return total;
+}
+
+void spatial_grid_count(void* data, u32 start, u32 end, u32 worker)
+{
+    (void)worker;
+    GridBuild* build = (GridBuild*)data;
+    for(u32 i = start; i < end; i++)
+    {
+        u32 bucket = spatial_grid_bucket(build->grid, build->points[i]);
+        build->point_buckets[i] = bucket;
+        build->point_ranks[i] = atomic_fetch_add_explicit(&build->counts[bucket], 1, memory_order_relaxed);
+    }
+}
+
+void spatial_grid_sum_blocks(void* data, u32 start, u32 end, u32 worker)
+{
+    (void)worker;
+    GridBuild* build = (GridBuild*)data;
+    u32 sum = 0;
+    for(u32 i = start; i < end; i++) sum += atomic_load_explicit(&build->counts[i], memory_order_relaxed);
+    build->block_sums[start / BUCKET_BATCH_SIZE] = sum;
+}
+
+void spatial_grid_write_starts(void* data, u32 start, u32 end, u32 worker)
+{
+    (void)worker;
+    GridBuild* build = (GridBuild*)data;
+    u32 offset = build->block_sums[start / BUCKET_BATCH_SIZE];
+    for(u32 i = start; i < end; i++)
+    {
+        build->grid->bucket_starts[i] = offset;
+        offset += atomic_load_explicit(&build->counts[i], memory_order_relaxed);
+    }
+}
+
+void spatial_grid_scatter(void* data, u32 start, u32 end, u32 worker)
+{
+    (void)worker;
+    GridBuild* build = (GridBuild*)data;
+    SpatialGrid* grid = build->grid;
+    for(u32 i = start; i < end; i++)
+    {
+        u32 slot = grid->bucket_starts[build->point_buckets[i]] + build->point_ranks[i];
+        grid->ids[slot] = i;
+        grid->points[slot] = build->points[i];
+    }
+}
+
+void spatial_grid_sort_buckets(void* data, u32 start, u32 end, u32 worker)
+{
+    (void)worker;
+    GridBuild* build = (GridBuild*)data;
+    SpatialGrid* grid = build->grid;
+    for(u32 bucket = start; bucket < end; bucket++)
+    {
+        u32 first = grid->bucket_starts[bucket], last = grid->bucket_starts[bucket + 1];
+        u32 i = first + 1;
+        while(i < last && grid->ids[i - 1] < grid->ids[i]) i++;
+        if(i >= last) continue; // counted in order, always the case with one thread
+
+        if(last - first > INSERTION_SORT_MAX)
+        {
+            qsort(grid->ids + first, last - first, sizeof(u32), spatial_grid_compare_indices);
+            for(u32 slot = first; slot < last; slot++) grid->points[slot] = build->points[grid->ids[slot]];
+            continue;
+        }
+        for(; i < last; i++)
+        {
+            u32 index = grid->ids[i], j = i;
+            vec3 point = grid->points[i];
+            for(; j > first && grid->ids[j - 1] > index; j--)
+            {
+                grid->ids[j] = grid->ids[j - 1];
+                grid->points[j] = grid->points[j - 1];
+            }
+            grid->ids[j] = index;
+            grid->points[j] = point;
+        }
+    }
+}
+
+void spatial_grid_map_ids(void* data, u32 start, u32 end, u32 worker)
+{
+    (void)worker;
+    GridBuild* build = (GridBuild*)data;
+    for(u32 slot = start; slot < end; slot++) build->grid->ids[slot] = build->ids[build->grid->ids[slot]];
+}
+
+void spatial_grid_neighbours_job(void* data, u32 start, u32 end, u32 worker)
+{
+    GridNeighbours* neighbours = (GridNeighbours*)data;
+    const SpatialGrid* grid = neighbours->grid;
+    u64 total = 0;
+    for(u32 slot = start; slot < end; slot++)
+    {
+        GridScan scan = {
+            .centre = grid->points[slot],
+            .radius_sq = neighbours->radius * neighbours->radius,
+            .skip_slot = slot,
+            .ids_out = neighbours->neighbours_out + (u64)slot * neighbours->max_neighbours,
+            .max_ids = neighbours->max_neighbours
+        };
+        spatial_grid_scan(grid, &scan, neighbours->radius);
+        neighbours->counts_out[slot] = MIN(scan.found, neighbours->max_neighbours);
+        total += scan.found;
+    }
+    neighbours->totals[worker] += total;
+}
+
+void spatial_grid_scan(const SpatialGrid* self, GridScan* scan, f32 radius)
+{
+    if(self->count == 0) return;
+
+    i32 lo[3], hi[3];
+    u64 cells = 1;
+    for(u32 i = 0; i < 3; i++)
+    {
+        lo[i] = spatial_grid_coord(self, scan->centre.data[i] - radius);
+        hi[i] = spatial_grid_coord(self, scan->centre.data[i] + radius);
+        cells *= (u64)((i64)hi[i] - lo[i] + 1);
+    }
+
+    /* more cells than buckets, every bucket is visited once so no cell check is needed */
+    if(cells > (u64)self->bucket_mask + 1)
+    {
+        for(u32 bucket = 0; bucket <= self->bucket_mask; bucket++) spatial_grid_scan_bucket(self, scan, bucket, 0, 0, 0, false);
+        return;
+    }
+
+    bool check_cell = cells > 1;
+    for(i32 z = lo[2]; z <= hi[2]; z++)
+    {
+        for(i32 y = lo[1]; y <= hi[1]; y++)
+        {
+            for(i32 x = lo[0]; x <= hi[0]; x++) spatial_grid_scan_bucket(self, scan, spatial_grid_hash(self, x, y, z), x, y, z, check_cell);
+        }
+    }
+}
+
+int spatial_grid_compare_indices(const void* a, const void* b)
+{
+    u32 x = *(const u32*)a, y = *(const u32*)b;
+    return (x > y) - (x < y);
+}
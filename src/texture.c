@@ -34,9 +34,41 @@ static struct
     Texture cubemap_default;
 } texture_ctx;
 
+/* without dsa creating a texture edits it through unit 0, going through the state cache keeps it in sync */
+static inline void texture_bind_for_edit(u32 id, bool cubemap)
+{
+    rd_state_active_texture(0);
+    rd_state_bind_texture(0, cubemap, id);
+}
+
+/* with dsa the texture is edited by name and nothing is bound, otherwise it's left bound for the edits after */
+static inline u32 texture_gen(bool cubemap)
+{
+    u32 id;
+    if(rd_state_dsa())
+    {
+        glCreateTextures(cubemap ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, 1, &id);
+        return id;
+    }
+
+    glGenTextures(1, &id);
+    texture_bind_for_edit(id, cubemap);
+    return id;
+}
+
+static inline void texture_parameter(u32 id, bool cubemap, GLenum name, GLint value)
+{
+    if(rd_state_dsa()) glTextureParameteri(id, name, value);
+    else glTexParameteri(cubemap ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D, name, value);
+}
+
 /**
  * internal functions
  */
+void texture_storage(u32 id, bool alpha, i32 width, i32 height, bool use_mipmap);
+void texture_upload(u32 id, bool cubemap, i32 face, bool alpha, i32 width, i32 height, const u8* img_data);
+void texture_generate_mipmap(u32 id);
+
 void texture_single_image_cubemap_create(Texture* self, const char* texture_path);
 void texture_multi_image_cubemap_create(Texture* self, const char* generic_path);
 
@@ -64,30 +96,29 @@ void texture_create(Texture* self, TextureType type, const char* path, bool use_
     char full_path[1024];
     platform_prepend_executable_directory(full_path, 1024, path);
 
-    glGenTextures(1, &self->id);
-
     i32 width, height, num_channels;
     stbi_set_flip_vertically_on_load(true);
     u8* img_data = stbi_load(full_path, &width, &height, &num_channels, 4);
     BGL_ASSERT(img_data, "could not load image %s", full_path);
 
-    glBindTexture(GL_TEXTURE_2D, self->id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, img_data);
+    self->id = texture_gen(false);
+    texture_storage(self->id, true, width, height, use_mipmap);
+    texture_upload(self->id, false, 0, true, width, height, img_data);
 
     stbi_image_free(img_data);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    texture_parameter(self->id, false, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    texture_parameter(self->id, false, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    texture_parameter(self->id, false, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
     if(use_mipmap)
     {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        glGenerateMipmap(GL_TEXTURE_2D);
+        texture_parameter(self->id, false, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        texture_generate_mipmap(self->id);
     }
     else
     {
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        texture_parameter(self->id, false, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     }
 
     self->width = width;
@@ -101,17 +132,16 @@ void texture_create(Texture* self, TextureType type, const char* path, bool use_
 
 void texture_default_create(Texture* self, u8 brightness, TextureType type)
 {
-    glGenTextures(1, &self->id);
-
     u8 img_data[] = {brightness, brightness, brightness, 255}; // 1 white pixel
 
-    glBindTexture(GL_TEXTURE_2D, self->id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, img_data);
+    self->id = texture_gen(false);
+    texture_storage(self->id, false, 1, 1, false);
+    texture_upload(self->id, false, 0, false, 1, 1, img_data);
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    texture_parameter(self->id, false, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    texture_parameter(self->id, false, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    texture_parameter(self->id, false, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    texture_parameter(self->id, false, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 
     self->width = 1;
     self->height = 1;
@@ -123,20 +153,19 @@ void texture_default_create(Texture* self, u8 brightness, TextureType type)
 
 void texture_default_cubemap_create(Texture* self, u8 brightness, TextureType type)
 {
-    glGenTextures(1, &self->id);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, self->id);
+    self->id = texture_gen(true);
 
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE); // since it can be sampled in 3 dimensions
+    texture_parameter(self->id, true, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    texture_parameter(self->id, true, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    texture_parameter(self->id, true, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    texture_parameter(self->id, true, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    texture_parameter(self->id, true, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE); // since it can be sampled in 3 dimensions
 
     u8 img_data[] = {brightness, brightness, brightness, 255}; // 1 white pixel
+    texture_storage(self->id, false, 1, 1, false);
     for(i32 i = 0; i < 6; i++)
     {
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)i, 0, GL_RGB,
-                     1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, img_data);
+        texture_upload(self->id, true, i, false, 1, 1, img_data);
     }
 
     self->width = 1; 
@@ -154,14 +183,13 @@ void texture_cubemap_create(Texture* self, TextureType type, const char* path)
     char full_path[1024];
     platform_prepend_executable_directory(full_path, 1024, path);
 
-    glGenTextures(1, &self->id);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, self->id);
+    self->id = texture_gen(true);
 
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE); // since it can be sampled in 3 dimensions
+    texture_parameter(self->id, true, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    texture_parameter(self->id, true, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    texture_parameter(self->id, true, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    texture_parameter(self->id, true, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    texture_parameter(self->id, true, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE); // since it can be sampled in 3 dimensions
 
     if(platform_file_exists(full_path))
     {
@@ -179,20 +207,21 @@ void texture_cubemap_create(Texture* self, TextureType type, const char* path)
     BGL_PERFORMANCE_END("loading cubemap texture");
 }
 
-void texture_bind(Texture* self)
+void texture_bind(Texture* self, u32 unit)
 {
-    GLenum target = self->type & BGL_TEXTURE_PHONG_CUBEMAP ? GL_TEXTURE_CUBE_MAP : GL_TEXTURE_2D; 
-    glBindTexture(target, self->id);
+    BGL_ASSERT((i32)unit <= texture_ctx.max_texture_units - 1, " GL texture unit out of range");
+    rd_state_bind_texture(unit, (self->type & BGL_TEXTURE_PHONG_CUBEMAP) != 0, self->id);
 }
 
 void texture_unit_active(u32 num)
 {
     BGL_ASSERT((i32)num <= texture_ctx.max_texture_units - 1, " GL texture unit out of range");
-    glActiveTexture(GL_TEXTURE0 + num);
+    rd_state_active_texture(num);
 }
 
 void texture_free(Texture* self)
 {
+    rd_state_forget_texture(self->id);
     glDeleteTextures(1, &self->id);
 }
 
@@ -205,6 +234,15 @@ const char* texture_type_get_str(TextureType type)
     return NULL;
 }
 
+ShaderBuiltinUniform texture_type_get_uniform(TextureType type)
+{
+    if(type & BGL_TEXTURE_PHONG_DIFFUSE) return BGL_UNIFORM_TEXTURE_DIFFUSE;
+    if(type & BGL_TEXTURE_PHONG_SPECULAR) return BGL_UNIFORM_TEXTURE_SPECULAR;
+    if(type & BGL_TEXTURE_PHONG_NORMAL) return BGL_UNIFORM_TEXTURE_NORMAL;
+    BGL_ASSERT(false, "invalid texture type %d", (i32)type);
+    return BGL_UNIFORM_TEXTURE_DIFFUSE;
+}
+
 void texture_single_image_cubemap_create(Texture* self, const char* texture_path)
 {
     i32 width, height, num_channels;
@@ -225,6 +263,7 @@ void texture_single_image_cubemap_create(Texture* self, const char* texture_path
         3 * grid_size, grid_size, // nz 
     };
 
+    texture_storage(self->id, false, grid_size, grid_size, false);
     glPixelStorei(GL_UNPACK_ROW_LENGTH, width); // ! won't work on OpenGL ES
     for(i32 i = 0; i < 6; i++)
     {
@@ -233,8 +272,7 @@ void texture_single_image_cubemap_create(Texture* self, const char* texture_path
         i32 sub_y = sub_image_starts[idx + 1];
         u8* sub_image = img_data + ((sub_y * width) + sub_x) * 4;
 
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)i, 0, GL_RGB,
-                     grid_size, grid_size, 0, GL_RGBA, GL_UNSIGNED_BYTE, sub_image);
+        texture_upload(self->id, true, i, false, grid_size, grid_size, sub_image);
     }
     glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
     stbi_image_free(img_data);
@@ -279,8 +317,9 @@ void texture_multi_image_cubemap_create(Texture* self, const char* generic_path)
         u8* img_data = stbi_load(img_path, &width, &height, &num_channels, 4);
         BGL_ASSERT(img_data, "could not load image %s", img_path);
 
-        glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)i, 0, GL_RGB,
-                     width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, img_data);
+        /* immutable storage needs the size up front, the faces are assumed to match the first */
+        if(i == 0) texture_storage(self->id, false, width, height, false);
+        texture_upload(self->id, true, i, false, width, height, img_data);
 
         stbi_image_free(img_data);
     }
@@ -288,3 +327,36 @@ void texture_multi_image_cubemap_create(Texture* self, const char* generic_path)
     self->width = width;
     self->height = height;
 }
+
+void texture_storage(u32 id, bool alpha, i32 width, i32 height, bool use_mipmap)
+{
+    /* without dsa the storage is allocated by each glTexImage2D in texture_upload */
+    if(!rd_state_dsa()) return;
+
+    i32 levels = 1;
+    if(use_mipmap)
+    {
+        for(i32 size = MAX(width, height); size > 1; size /= 2) levels++;
+    }
+    glTextureStorage2D(id, levels, alpha ? GL_RGBA8 : GL_RGB8, width, height);
+}
+
+void texture_upload(u32 id, bool cubemap, i32 face, bool alpha, i32 width, i32 height, const u8* img_data)
+{
+    if(rd_state_dsa())
+    {
+        /* a cubemap's faces are its layers */
+        if(cubemap) glTextureSubImage3D(id, 0, 0, 0, face, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, img_data);
+        else glTextureSubImage2D(id, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, img_data);
+        return;
+    }
+
+    const GLenum target = cubemap ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + (GLenum)face : GL_TEXTURE_2D;
+    glTexImage2D(target, 0, alpha ? GL_RGBA : GL_RGB, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, img_data);
+}
+
+void texture_generate_mipmap(u32 id)
+{
+    if(rd_state_dsa()) glGenerateTextureMipmap(id);
+    else glGenerateMipmap(GL_TEXTURE_2D);
+}
@@ -0,0 +1,764 @@
+#include "triangle_mesh.h"
+
+#include <float.h>
+#include <stdio.h>
+#include <string.h>
+#include "jobs.h"
+#include "platform.h"
+
+#define BIN_COUNT 16
+#define SUBTREE_TRIANGLES 4096 // ranges smaller than this are built whole by one job
+#define MEDIAN_SPLIT_DEPTH 32 // past this depth ranges are halved by count, 30 more levels reach single packets from 2^32 triangles
+#define REF_BATCH_SIZE 4096
+#define BLOCK_ALIGN 64
+#define BLOCK_ALIGNED(offset) (((offset) + BLOCK_ALIGN - 1) & ~(u64)(BLOCK_ALIGN - 1))
+#define DEGENERATE_EPSILON 1e-12f
+
+/* start of the block and the file, offsets are from here */
+typedef struct TriangleMeshHeader
+{
+    u32 magic;
+    u32 version;
+    u32 packet_size;
+    u32 node_count;
+    u32 packet_count;
+    u32 triangle_count;
+    u64 source_hash;
+    u64 nodes_offset;
+    u64 packets_offset;
+    u64 source_ids_offset;
+    u64 size;
+} TriangleMeshHeader;
+
+/* triangle bounds gathered before the build, reordered in place until each leaf's are together */
+typedef struct BuildRef
+{
+    vec3 min, max, centroid;
+    u32 triangle;
+} BuildRef;
+
+/* refs [start, start + count) and the slot its node goes in. children split at ref m take slots
+   2m - 2 and 2m - 1 and the root takes the last one, every boundary is split at most once so ranges
+   never share slots and jobs need no locking */
+typedef struct BuildRange
+{
+    u32 start, count;
+    u32 depth;
+    u32 slot;
+} BuildRange;
+
+typedef struct BuildNode
+{
+    vec3 min, max;
+    u32 start, count;
+    u32 left, right; // slots, interior nodes only
+    bool leaf;
+} BuildNode;
+
+typedef struct MeshBuild
+{
+    const vec3* vertices;
+    const u32* indices;
+    BuildRef* refs;
+    BuildNode* nodes;
+    BuildRange* jobs; // ranges left for the parallel pass
+    u32 job_count;
+} MeshBuild;
+
+/**
+ * internal functions
+ */
+void triangle_mesh_compute_refs(void* data, u32 start, u32 end, u32 worker);
+void triangle_mesh_build_jobs(void* data, u32 start, u32 end, u32 worker);
+bool triangle_mesh_build_node(MeshBuild* build, BuildRange range, BuildRange* left_out, BuildRange* right_out);
+u32 triangle_mesh_sah_split(BuildRef* refs, u32 count, vec3 centroid_min, vec3 centroid_max);
+bool triangle_mesh_emit(TriangleMesh* self, const MeshBuild* build, u32 triangle_count, u64 source_hash);
+void triangle_mesh_point_into(TriangleMesh* self, void* memory, u64 size, bool mapped);
+bool triangle_mesh_validate(const TriangleMeshHeader* header, u64 size);
+
+static inline f32 triangle_mesh_area(vec3 min, vec3 max)
+{
+    vec3 d = VEC3(max.x - min.x, max.y - min.y, max.z - min.z);
+    return d.x * d.y + d.y * d.z + d.z * d.x;
+}
+
+static inline void triangle_mesh_grow(vec3* min, vec3* max, vec3 point_min, vec3 point_max)
+{
+    *min = VEC3(MIN(min->x, point_min.x), MIN(min->y, point_min.y), MIN(min->z, point_min.z));
+    *max = VEC3(MAX(max->x, point_max.x), MAX(max->y, point_max.y), MAX(max->z, point_max.z));
+}
+
+static inline bool triangle_mesh_box_overlap(const TriangleMeshNode* node, vec3 min, vec3 max)
+{
+    return (node->min.x <= max.x) & (min.x <= node->max.x) & (node->min.y <= max.y) & (min.y <= node->max.y) &
+           (node->min.z <= max.z) & (min.z <= node->max.z);
+}
+
+/* slab test, NaNs from rays in the plane of a face are ignored by the comparisons and count as a hit */
+static inline bool triangle_mesh_slab(const TriangleMeshNode* node, vec3 origin, vec3 inv_dir, f32 max_t, f32* t_out)
+{
+    f32 t_min = 0.0f, t_max = max_t;
+    for(u32 i = 0; i < 3; i++)
+    {
+        f32 t1 = (node->min.data[i] - origin.data[i]) * inv_dir.data[i];
+        f32 t2 = (node->max.data[i] - origin.data[i]) * inv_dir.data[i];
+        if(t1 > t2)
+        {
+            f32 temp = t1;
+            t1 = t2;
+            t2 = temp;
+        }
+        if(t1 > t_min) t_min = t1;
+        if(t2 < t_max) t_max = t2;
+    }
+    *t_out = t_min;
+    return t_min <= t_max;
+}
+
+/* one axis of the separating axis test, corners are relative to the box centre */
+static inline bool triangle_mesh_axis_separates(f32 x, f32 y, f32 z, const f32 corners[3][3], vec3 half)
+{
+    f32 p0 = x * corners[0][0] + y * corners[0][1] + z * corners[0][2];
+    f32 p1 = x * corners[1][0] + y * corners[1][1] + z * corners[1][2];
+    f32 p2 = x * corners[2][0] + y * corners[2][1] + z * corners[2][2];
+    f32 r = half.x * fabsf(x) + half.y * fabsf(y) + half.z * fabsf(z);
+    return (MIN(p0, MIN(p1, p2)) > r) | (MAX(p0, MAX(p1, p2)) < -r);
+}
+
+/* squared distance from p to the closest point of segment a + t * ab */
+static inline f32 triangle_mesh_segment_dist_sq(f32 px, f32 py, f32 pz, f32 ax, f32 ay, f32 az, f32 bx, f32 by, f32 bz)
+{
+    f32 dx = px - ax, dy = py - ay, dz = pz - az;
+    f32 t = (dx * bx + dy * by + dz * bz) / MAX(bx * bx + by * by + bz * bz, DEGENERATE_EPSILON);
+    t = MIN(MAX(t, 0.0f), 1.0f);
+    dx -= bx * t;
+    dy -= by * t;
+    dz -= bz * t;
+    return dx * dx + dy * dy + dz * dz;
+}
+
+bool triangle_mesh_create(TriangleMesh* self, const vec3* vertices, u32 vertex_count, const u32* indices, u32 index_count)
+{
+    BGL_PERFORMANCE_START();
+    memset(self, 0, sizeof(TriangleMesh));
+
+    if(index_count % 3 != 0)
+    {
+        BGL_LOG_ERROR("triangle mesh index count %u isn't a multiple of 3", index_count);
+        return false;
+    }
+    for(u32 i = 0; i < index_count; i++)
+    {
+        if(indices[i] < vertex_count) continue;
+        BGL_LOG_ERROR("triangle mesh index %u is out of range (%u vertices)", indices[i], vertex_count);
+        return false;
+    }
+
+    const u32 triangle_count = index_count / 3;
+    const u64 source_hash = triangle_mesh_hash(vertices, vertex_count, indices, index_count);
+    MeshBuild build = { .vertices = vertices, .indices = indices };
+    if(triangle_count == 0) return triangle_mesh_emit(self, &build, 0, source_hash);
+
+    build.refs = (BuildRef*)BGL_MALLOC(triangle_count * sizeof(BuildRef));
+    build.nodes = (BuildNode*)BGL_MALLOC((2 * (u64)triangle_count - 1) * sizeof(BuildNode));
+    build.jobs = (BuildRange*)BGL_MALLOC(triangle_count * sizeof(BuildRange));
+    BGL_ASSERT(build.refs != NULL && build.nodes != NULL && build.jobs != NULL, "triangle mesh build allocation failed");
+
+    jobs_parallel_for(triangle_count, REF_BATCH_SIZE, triangle_mesh_compute_refs, &build);
+
+    /* split the top of the tree here until the ranges are small enough to hand out */
+    BuildRange stack[2 * BGL_TRIANGLE_MESH_MAX_DEPTH];
+    u32 top = 0;
+    stack[top++] = (BuildRange){ 0, triangle_count, 0, 2 * triangle_count - 2 };
+    while(top > 0)
+    {
+        BuildRange range = stack[--top];
+        if(range.count < SUBTREE_TRIANGLES)
+        {
+            build.jobs[build.job_count++] = range;
+            continue;
+        }
+
+        BuildRange left, right;
+        if(!triangle_mesh_build_node(&build, range, &left, &right)) continue;
+        stack[top++] = right;
+        stack[top++] = left;
+    }
+    jobs_parallel_for(build.job_count, 1, triangle_mesh_build_jobs, &build);
+
+    bool success = triangle_mesh_emit(self, &build, triangle_count, source_hash);
+
+    BGL_FREE(build.refs);
+    BGL_FREE(build.nodes);
+    BGL_FREE(build.jobs);
+
+    BGL_PERFORMANCE_END("building triangle mesh bvh");
+    return success;
+}
+
+void triangle_mesh_free(TriangleMesh* self)
+{
+    if(self->memory != NULL)
+    {
+        if(self->mapped) platform_file_unmap(self->memory, self->memory_size);
+        else BGL_FREE(self->memory);
+    }
+    memset(self, 0, sizeof(TriangleMesh));
+}
+
+bool triangle_mesh_save(const TriangleMesh* self, const char* path)
+{
+    FILE* file = fopen(path, "wb");
+    if(file == NULL)
+    {
+        BGL_LOG_ERROR("failed to open triangle mesh %s for writing", path);
+        return false;
+    }
+
+    bool success = fwrite(self->memory, 1, self->memory_size, file) == self->memory_size;
+    success = fclose(file) == 0 && success;
+    if(!success) BGL_LOG_ERROR("failed to write triangle mesh %s", path);
+    return success;
+}
+
+bool triangle_mesh_load(TriangleMesh* self, const char* path)
+{
+    memset(self, 0, sizeof(TriangleMesh));
+
+    u64 size;
+    void* file = platform_file_map(path, &size);
+    if(file == NULL)
+    {
+        BGL_LOG_ERROR("failed to map triangle mesh %s", path);
+        return false;
+    }
+
+    if(!triangle_mesh_validate((const TriangleMeshHeader*)file, size))
+    {
+        BGL_LOG_ERROR("triangle mesh %s is corrupt or from another version", path);
+        platform_file_unmap(file, size);
+        return false;
+    }
+
+    triangle_mesh_point_into(self, file, size, true);
+    return true;
+}
+
+/* fnv-1a, only has to notice when a cached mesh is stale */
+u64 triangle_mesh_hash(const vec3* vertices, u32 vertex_count, const u32* indices, u32 index_count)
+{
+    u64 hash = 0xCBF29CE484222325ull;
+    const u8* bytes = (const u8*)vertices;
+    for(u64 i = 0; i < (u64)vertex_count * sizeof(vec3); i++) hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    bytes = (const u8*)indices;
+    for(u64 i = 0; i < (u64)index_count * sizeof(u32); i++) hash = (hash ^ bytes[i]) * 0x100000001B3ull;
+    return hash;
+}
+
+void triangle_mesh_get_bounds(const TriangleMesh* self, vec3* min_out, vec3* max_out)
+{
+    *min_out = self->node_count > 0 ? self->nodes[0].min : VEC3(0.0f, 0.0f, 0.0f);
+    *max_out = self->node_count > 0 ? self->nodes[0].max : VEC3(0.0f, 0.0f, 0.0f);
+}
+
+void triangle_mesh_get_triangle(const TriangleMesh* self, u32 triangle, vec3 corners_out[3])
+{
+    const TrianglePacket* packet = &self->packets[triangle / BGL_TRIANGLE_PACKET_SIZE];
+    const u32 lane = triangle % BGL_TRIANGLE_PACKET_SIZE;
+    for(u32 i = 0; i < 3; i++)
+    {
+        corners_out[0].data[i] = packet->corner0[i][lane];
+        corners_out[1].data[i] = packet->corner0[i][lane] + packet->edge1[i][lane];
+        corners_out[2].data[i] = packet->corner0[i][lane] + packet->edge2[i][lane];
+    }
+}
+
+bool triangle_mesh_raycast(const TriangleMesh* self, vec3 origin, vec3 dir, f32 max_t, TriangleMeshHit* hit_out)
+{
+    if(self->node_count == 0) return false;
+
+    const vec3 inv_dir = VEC3(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+    f32 best_t = max_t;
+    u32 best = BGL_TRIANGLE_NULL;
+
+    f32 t;
+    u32 stack[BGL_TRIANGLE_MESH_MAX_DEPTH];
+    u32 top = 0;
+    if(triangle_mesh_slab(&self->nodes[0], origin, inv_dir, best_t, &t)) stack[top++] = 0;
+    while(top > 0)
+    {
+        const TriangleMeshNode* node = &self->nodes[stack[--top]];
+
+        if(node->count == 0)
+        {
+            /* nearer child on top, the further one is skipped if something closer turns up first */
+            f32 t1, t2;
+            bool hit1 = triangle_mesh_slab(&self->nodes[node->first], origin, inv_dir, best_t, &t1);
+            bool hit2 = triangle_mesh_slab(&self->nodes[node->first + 1], origin, inv_dir, best_t, &t2);
+            if(hit1 && hit2)
+            {
+                stack[top++] = t1 <= t2 ? node->first + 1 : node->first;
+                stack[top++] = t1 <= t2 ? node->first : node->first + 1;
+            }
+            else if(hit1 || hit2)
+            {
+                stack[top++] = hit1 ? node->first : node->first + 1;
+            }
+            continue;
+        }
+
+        /* moller trumbore on every lane, then keep the closest */
+        const TrianglePacket* packet = &self->packets[node->first];
+        f32 lane_t[BGL_TRIANGLE_PACKET_SIZE];
+        for(u32 lane = 0; lane < BGL_TRIANGLE_PACKET_SIZE; lane++)
+        {
+            const f32 e1x = packet->edge1[0][lane], e1y = packet->edge1[1][lane], e1z = packet->edge1[2][lane];
+            const f32 e2x = packet->edge2[0][lane], e2y = packet->edge2[1][lane], e2z = packet->edge2[2][lane];
+            const f32 px = dir.y * e2z - dir.z * e2y, py = dir.z * e2x - dir.x * e2z, pz = dir.x * e2y - dir.y * e2x;
+            const f32 det = e1x * px + e1y * py + e1z * pz;
+            const bool valid = fabsf(det) > DEGENERATE_EPSILON;
+            const f32 inv_det = 1.0f / (valid ? det : 1.0f);
+
+            const f32 sx = origin.x - packet->corner0[0][lane], sy = origin.y - packet->corner0[1][lane], sz = origin.z - packet->corner0[2][lane];
+            const f32 u = (sx * px + sy * py + sz * pz) * inv_det;
+            const f32 qx = sy * e1z - sz * e1y, qy = sz * e1x - sx * e1z, qz = sx * e1y - sy * e1x;
+            const f32 v = (dir.x * qx + dir.y * qy + dir.z * qz) * inv_det;
+            const f32 lt = (e2x * qx + e2y * qy + e2z * qz) * inv_det;
+
+            const bool hit = valid & (u >= 0.0f) & (v >= 0.0f) & (u + v <= 1.0f) & (lt >= 0.0f) & (lane < node->count);
+            lane_t[lane] = hit ? lt : FLT_MAX;
+        }
+
+        for(u32 lane = 0; lane < node->count; lane++)
+        {
+            if(lane_t[lane] >= best_t) continue;
+            best_t = lane_t[lane];
+            best = node->first * BGL_TRIANGLE_PACKET_SIZE + lane;
+        }
+    }
+
+    if(best == BGL_TRIANGLE_NULL) return false;
+
+    vec3 corners[3];
+    triangle_mesh_get_triangle(self, best, corners);
+    vec3 normal = vec_cross(vec3_sub(corners[1], corners[0]), vec3_sub(corners[2], corners[0]));
+    vec3_norm(&normal);
+
+    hit_out->t = best_t;
+    hit_out->triangle = best;
+    hit_out->normal = normal;
+    return true;
+}
+
+u32 triangle_mesh_query_box(const TriangleMesh* self, vec3 min, vec3 max, u32* triangles_out, u32 max_triangles)
+{
+    if(self->node_count == 0) return 0;
+
+    const vec3 centre = vec3_scale(vec3_add(min, max), 0.5f);
+    const vec3 half = vec3_scale(vec3_sub(max, min), 0.5f);
+
+    u32 total = 0;
+    u32 stack[BGL_TRIANGLE_MESH_MAX_DEPTH];
+    u32 top = 0;
+    stack[top++] = 0;
+    while(top > 0)
+    {
+        const TriangleMeshNode* node = &self->nodes[stack[--top]];
+        if(!triangle_mesh_box_overlap(node, min, max)) continue;
+
+        if(node->count == 0)
+        {
+            stack[top++] = node->first + 1;
+            stack[top++] = node->first;
+            continue;
+        }
+
+        /* separating axis test: the box's axes, the triangle's normal and the 9 edge cross products */
+        const TrianglePacket* packet = &self->packets[node->first];
+        bool touching[BGL_TRIANGLE_PACKET_SIZE];
+        for(u32 lane = 0; lane < BGL_TRIANGLE_PACKET_SIZE; lane++)
+        {
+            f32 corners[3][3], edges[3][3];
+            for(u32 i = 0; i < 3; i++)
+            {
+                corners[0][i] = packet->corner0[i][lane] - centre.data[i];
+                corners[1][i] = corners[0][i] + packet->edge1[i][lane];
+                corners[2][i] = corners[0][i] + packet->edge2[i][lane];
+            }
+            for(u32 i = 0; i < 3; i++)
+            {
+                edges[0][i] = corners[1][i] - corners[0][i];
+                edges[1][i] = corners[2][i] - corners[1][i];
+                edges[2][i] = corners[0][i] - corners[2][i];
+            }
+
+            bool separated = triangle_mesh_axis_separates(1.0f, 0.0f, 0.0f, corners, half) |
+                             triangle_mesh_axis_separates(0.0f, 1.0f, 0.0f, corners, half) |
+                             triangle_mesh_axis_separates(0.0f, 0.0f, 1.0f, corners, half);
+            const f32 nx = edges[0][1] * edges[1][2] - edges[0][2] * edges[1][1];
+            const f32 ny = edges[0][2] * edges[1][0] - edges[0][0] * edges[1][2];
+            const f32 nz = edges[0][0] * edges[1][1] - edges[0][1] * edges[1][0];
+            separated |= triangle_mesh_axis_separates(nx, ny, nz, corners, half) | (nx * nx + ny * ny + nz * nz <= DEGENERATE_EPSILON);
+            for(u32 i = 0; i < 3; i++)
+            {
+                const f32* e = edges[i];
+                separated |= triangle_mesh_axis_separates(0.0f, -e[2], e[1], corners, half) |
+                             triangle_mesh_axis_separates(e[2], 0.0f, -e[0], corners, half) |
+                             triangle_mesh_axis_separates(-e[1], e[0], 0.0f, corners, half);
+            }
+            touching[lane] = !separated & (lane < node->count);
+        }
+
+        for(u32 lane = 0; lane < node->count; lane++)
+        {
+            if(!touching[lane]) continue;
+            if(total < max_triangles) triangles_out[total] = node->first * BGL_TRIANGLE_PACKET_SIZE + lane;
+            total++;
+        }
+    }
+    return total;
+}
+
+u32 triangle_mesh_query_sphere(const TriangleMesh* self, vec3 centre, f32 radius, u32* triangles_out, u32 max_triangles)
+{
+    if(self->node_count == 0) return 0;
+
+    const vec3 min = vec3_add_scalar(centre, -radius), max = vec3_add_scalar(centre, radius);
+    const f32 radius_sq = radius * radius;
+
+    u32 total = 0;
+    u32 stack[BGL_TRIANGLE_MESH_MAX_DEPTH];
+    u32 top = 0;
+    stack[top++] = 0;
+    while(top > 0)
+    {
+        const TriangleMeshNode* node = &self->nodes[stack[--top]];
+        if(!triangle_mesh_box_overlap(node, min, max)) continue;
+
+        if(node->count == 0)
+        {
+            stack[top++] = node->first + 1;
+            stack[top++] = node->first;
+            continue;
+        }
+
+        /* distance to the plane if the centre is over the triangle, otherwise to the closest edge */
+        const TrianglePacket* packet = &self->packets[node->first];
+        bool touching[BGL_TRIANGLE_PACKET_SIZE];
+        for(u32 lane = 0; lane < BGL_TRIANGLE_PACKET_SIZE; lane++)
+        {
+            const f32 e1x = packet->edge1[0][lane], e1y = packet->edge1[1][lane], e1z = packet->edge1[2][lane];
+            const f32 e2x = packet->edge2[0][lane], e2y = packet->edge2[1][lane], e2z = packet->edge2[2][lane];
+            const f32 px = centre.x - packet->corner0[0][lane], py = centre.y - packet->corner0[1][lane], pz = centre.z - packet->corner0[2][lane];
+            const f32 nx = e1y * e2z - e1z * e2y, ny = e1z * e2x - e1x * e2z, nz = e1x * e2y - e1y * e2x;
+
+            /* which side of each edge the centre is on, relative to the corner the edge starts from */
+            const f32 s0 = nx * (e1y * pz - e1z * py) + ny * (e1z * px - e1x * pz) + nz * (e1x * py - e1y * px);
+            const f32 qx = px - e1x, qy = py - e1y, qz = pz - e1z, fx = e2x - e1x, fy = e2y - e1y, fz = e2z - e1z;
+            const f32 s1 = nx * (fy * qz - fz * qy) + ny * (fz * qx - fx * qz) + nz * (fx * qy - fy * qx);
+            const f32 s2 = nx * (py * e2z - pz * e2y) + ny * (pz * e2x - px * e2z) + nz * (px * e2y - py * e2x);
+
+            const f32 plane = px * nx + py * ny + pz * nz;
+            const f32 normal_sq = nx * nx + ny * ny + nz * nz;
+            const f32 plane_sq = plane * plane / MAX(normal_sq, DEGENERATE_EPSILON);
+            const f32 edge_sq = MIN(triangle_mesh_segment_dist_sq(px, py, pz, 0.0f, 0.0f, 0.0f, e1x, e1y, e1z),
+                                MIN(triangle_mesh_segment_dist_sq(px, py, pz, e1x, e1y, e1z, fx, fy, fz),
+                                    triangle_mesh_segment_dist_sq(px, py, pz, e2x, e2y, e2z, -e2x, -e2y, -e2z)));
+
+            const bool inside = (s0 >= 0.0f) & (s1 >= 0.0f) & (s2 >= 0.0f);
+            touching[lane] = ((inside ? plane_sq : edge_sq) <= radius_sq) & (normal_sq > DEGENERATE_EPSILON) & (lane < node->count);
+        }
+
+        for(u32 lane = 0; lane < node->count; lane++)
+        {
+            if(!touching[lane]) continue;
+            if(total < max_triangles) triangles_out[total] = node->first * BGL_TRIANGLE_PACKET_SIZE + lane;
+            total++;
+        }
+    }
+    return total;
+}
+
+void triangle_mesh_compute_refs(void* data, u32 start, u32 end, u32 worker)
+{
+    MeshBuild* build = (MeshBuild*)data;
+    (void)worker;
+
+    for(u32 i = start; i < end; i++)
+    {
+        const vec3 a = build->vertices[build->indices[3 * i]];
+        const vec3 b = build->vertices[build->indices[3 * i + 1]];
+        const vec3 c = build->vertices[build->indices[3 * i + 2]];
+
+        BuildRef* ref = &build->refs[i];
+        ref->min = VEC3(MIN(a.x, MIN(b.x, c.x)), MIN(a.y, MIN(b.y, c.y)), MIN(a.z, MIN(b.z, c.z)));
+        ref->max = VEC3(MAX(a.x, MAX(b.x, c.x)), MAX(a.y, MAX(b.y, c.y)), MAX(a.z, MAX(b.z, c.z)));
+        ref->centroid = VEC3((ref->min.x + ref->max.x) * 0.5f, (ref->min.y + ref->max.y) * 0.5f, (ref->min.z + ref->max.z) * 0.5f);
+        ref->triangle = i;
+    }
+}
+
+void triangle_mesh_build_jobs(void* data, u32 start, u32 end, u32 worker)
+{
+    MeshBuild* build = (MeshBuild*)data;
+    (void)worker;
+
+    BuildRange stack[2 * BGL_TRIANGLE_MESH_MAX_DEPTH];
+    for(u32 i = start; i < end; i++)
+    {
+        u32 top = 0;
+        stack[top++] = build->jobs[i];
+        while(top > 0)
+        {
+            BuildRange left, right;
+            if(!triangle_mesh_build_node(build, stack[--top], &left, &right)) continue;
+            stack[top++] = right;
+            stack[top++] = left;
+        }
+    }
+}
+
+/* fill in the node for range, returns false for a leaf or the two halves to build next */
+bool triangle_mesh_build_node(MeshBuild* build, BuildRange range, BuildRange* left_out, BuildRange* right_out)
+{
+    BuildRef* refs = &build->refs[range.start];
+    BuildNode* node = &build->nodes[range.slot];
+
+    vec3 min = refs[0].min, max = refs[0].max;
+    vec3 centroid_min = refs[0].centroid, centroid_max = refs[0].centroid;
+    for(u32 i = 1; i < range.count; i++)
+    {
+        triangle_mesh_grow(&min, &max, refs[i].min, refs[i].max);
+        triangle_mesh_grow(&centroid_min, &centroid_max, refs[i].centroid, refs[i].centroid);
+    }
+
+    node->min = min;
+    node->max = max;
+    node->start = range.start;
+    node->count = range.count;
+    node->leaf = range.count <= BGL_TRIANGLE_PACKET_SIZE;
+    if(node->leaf) return false;
+
+    u32 split = range.depth < MEDIAN_SPLIT_DEPTH ? triangle_mesh_sah_split(refs, range.count, centroid_min, centroid_max) : 0;
+    if(split == 0 || split >= range.count) split = range.count / 2; // centroids all in one place, any split is as good
+
+    const u32 boundary = range.start + split;
+    *left_out = (BuildRange){ range.start, split, range.depth + 1, 2 * boundary - 2 };
+    *right_out = (BuildRange){ boundary, range.count - split, range.depth + 1, 2 * boundary - 1 };
+    node->left = left_out->slot;
+    node->right = right_out->slot;
+    return true;
+}
+
+/**
+ * bin the centroids along each axis and take the bin boundary with the lowest surface area cost,
+ * then partition refs around it
+ * returns refs on the left, 0 if no boundary separates anything
+ */
+u32 triangle_mesh_sah_split(BuildRef* refs, u32 count, vec3 centroid_min, vec3 centroid_max)
+{
+    u32 best_axis = 3, best_bin = 0;
+    f32 best_cost = FLT_MAX;
+    for(u32 axis = 0; axis < 3; axis++)
+    {
+        const f32 extent = centroid_max.data[axis] - centroid_min.data[axis];
+        if(extent <= 0.0f) continue;
+        const f32 scale = (f32)BIN_COUNT / extent;
+
+        u32 bin_counts[BIN_COUNT] = { 0 };
+        vec3 bin_min[BIN_COUNT], bin_max[BIN_COUNT];
+        for(u32 i = 0; i < BIN_COUNT; i++)
+        {
+            bin_min[i] = VEC3(FLT_MAX, FLT_MAX, FLT_MAX);
+            bin_max[i] = VEC3(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        }
+        for(u32 i = 0; i < count; i++)
+        {
+            const u32 bin = MIN((u32)((refs[i].centroid.data[axis] - centroid_min.data[axis]) * scale), BIN_COUNT - 1);
+            bin_counts[bin]++;
+            triangle_mesh_grow(&bin_min[bin], &bin_max[bin], refs[i].min, refs[i].max);
+        }
+
+        /* left_area[i] covers bins 0..i, sweep right to left to cost each boundary */
+        f32 left_area[BIN_COUNT];
+        u32 left_count[BIN_COUNT];
+        vec3 min = bin_min[0], max = bin_max[0];
+        u32 running = 0;
+        for(u32 i = 0; i < BIN_COUNT - 1; i++)
+        {
+            triangle_mesh_grow(&min, &max, bin_min[i], bin_max[i]);
+            running += bin_counts[i];
+            left_area[i] = running > 0 ? triangle_mesh_area(min, max) : 0.0f;
+            left_count[i] = running;
+        }
+
+        min = bin_min[BIN_COUNT - 1];
+        max = bin_max[BIN_COUNT - 1];
+        running = 0;
+        for(u32 i = BIN_COUNT - 1; i > 0; i--)
+        {
+            triangle_mesh_grow(&min, &max, bin_min[i], bin_max[i]);
+            running += bin_counts[i];
+            if(running == 0 || left_count[i - 1] == 0) continue;
+
+            const f32 cost = left_area[i - 1] * (f32)left_count[i - 1] + triangle_mesh_area(min, max) * (f32)running;
+            if(cost >= best_cost) continue;
+            best_cost = cost;
+            best_axis = axis;
+            best_bin = i - 1;
+        }
+    }
+    if(best_axis == 3) return 0;
+
+    const f32 scale = (f32)BIN_COUNT / (centroid_max.data[best_axis] - centroid_min.data[best_axis]);
+    u32 left = 0, right = count;
+    while(left < right)
+    {
+        const u32 bin = MIN((u32)((refs[left].centroid.data[best_axis] - centroid_min.data[best_axis]) * scale), BIN_COUNT - 1);
+        if(bin <= best_bin)
+        {
+            left++;
+            continue;
+        }
+        BuildRef temp = refs[left];
+        refs[left] = refs[--right];
+        refs[right] = temp;
+    }
+    return left;
+}
+
+/* copy the tree into the block depth first, children side by side, and fill a packet per leaf */
+bool triangle_mesh_emit(TriangleMesh* self, const MeshBuild* build, u32 triangle_count, u64 source_hash)
+{
+    const u32 root = triangle_count > 0 ? 2 * triangle_count - 2 : 0;
+
+    u32 packet_count = 0;
+    u32 stack[BGL_TRIANGLE_MESH_MAX_DEPTH];
+    u32 top = 0;
+    if(triangle_count > 0) stack[top++] = root;
+    while(top > 0)
+    {
+        const BuildNode* node = &build->nodes[stack[--top]];
+        if(node->leaf)
+        {
+            packet_count++;
+            continue;
+        }
+        stack[top++] = node->right;
+        stack[top++] = node->left;
+    }
+    const u32 node_count = packet_count > 0 ? 2 * packet_count - 1 : 0;
+
+    TriangleMeshHeader header = {
+        .magic = BGL_TRIANGLE_MESH_MAGIC,
+        .version = BGL_TRIANGLE_MESH_VERSION,
+        .packet_size = BGL_TRIANGLE_PACKET_SIZE,
+        .node_count = node_count,
+        .packet_count = packet_count,
+        .triangle_count = triangle_count,
+        .source_hash = source_hash,
+    };
+    header.nodes_offset = BLOCK_ALIGNED(sizeof(TriangleMeshHeader));
+    header.packets_offset = BLOCK_ALIGNED(header.nodes_offset + node_count * sizeof(TriangleMeshNode));
+    header.source_ids_offset = BLOCK_ALIGNED(header.packets_offset + packet_count * sizeof(TrianglePacket));
+    header.size = header.source_ids_offset + (u64)packet_count * BGL_TRIANGLE_PACKET_SIZE * sizeof(u32);
+
+    u8* memory = (u8*)BGL_CALLOC(1, header.size); // padding is zeroed so saved files are reproducible
+    if(memory == NULL)
+    {
+        BGL_LOG_ERROR("triangle mesh allocation of %llu bytes failed", (unsigned long long)header.size);
+        return false;
+    }
+    memcpy(memory, &header, sizeof(TriangleMeshHeader));
+    triangle_mesh_point_into(self, memory, header.size, false);
+    if(triangle_count == 0) return true;
+
+    /* pairs: build slot of a node and the index it's copied to */
+    u32 pairs[2 * BGL_TRIANGLE_MESH_MAX_DEPTH];
+    u32 next_node = 1, next_packet = 0;
+    top = 0;
+    pairs[top++] = root;
+    pairs[top++] = 0;
+    while(top > 0)
+    {
+        const u32 index = pairs[--top];
+        const BuildNode* node = &build->nodes[pairs[--top]];
+        TriangleMeshNode* out = &self->nodes[index];
+        out->min = node->min;
+        out->max = node->max;
+
+        if(!node->leaf)
+        {
+            out->first = next_node;
+            out->count = 0;
+            next_node += 2;
+            pairs[top++] = node->right;
+            pairs[top++] = out->first + 1;
+            pairs[top++] = node->left;
+            pairs[top++] = out->first;
+            continue;
+        }
+
+        out->first = next_packet++;
+        out->count = node->count;
+        TrianglePacket* packet = &self->packets[out->first];
+        u32* ids = &self->source_ids[out->first * BGL_TRIANGLE_PACKET_SIZE];
+        for(u32 lane = 0; lane < BGL_TRIANGLE_PACKET_SIZE; lane++)
+        {
+            ids[lane] = BGL_TRIANGLE_NULL;
+            if(lane >= node->count) continue;
+
+            const u32 triangle = build->refs[node->start + lane].triangle;
+            const vec3 a = build->vertices[build->indices[3 * triangle]];
+            const vec3 b = build->vertices[build->indices[3 * triangle + 1]];
+            const vec3 c = build->vertices[build->indices[3 * triangle + 2]];
+            for(u32 i = 0; i < 3; i++)
+            {
+                packet->corner0[i][lane] = a.data[i];
+                packet->edge1[i][lane] = b.data[i] - a.data[i];
+                packet->edge2[i][lane] = c.data[i] - a.data[i];
+            }
+            ids[lane] = triangle;
+        }
+    }
+    return true;
+}
+
+void triangle_mesh_point_into(TriangleMesh* self, void* memory, u64 size, bool mapped)
+{
+    const TriangleMeshHeader* header = (const TriangleMeshHeader*)memory;
+    self->nodes = (TriangleMeshNode*)((u8*)memory + header->nodes_offset);
+    self->packets = (TrianglePacket*)((u8*)memory + header->packets_offset);
+    self->source_ids = (u32*)((u8*)memory + header->source_ids_offset);
+    self->node_count = header->node_count;
+    self->packet_count = header->packet_count;
+    self->triangle_count = header->triangle_count;
+    self->source_hash = header->source_hash;
+    self->memory = memory;
+    self->memory_size = size;
+    self->mapped = mapped;
+}
+
+/* everything traversal relies on, so a damaged file can't send a query out of bounds or round in circles */
+bool triangle_mesh_validate(const TriangleMeshHeader* header, u64 size)
+{
+    if(size < sizeof(TriangleMeshHeader)) return false;
+    if(header->magic != BGL_TRIANGLE_MESH_MAGIC || header->version != BGL_TRIANGLE_MESH_VERSION) return false;
+    if(header->packet_size != BGL_TRIANGLE_PACKET_SIZE || header->size != size) return false;
+    if(header->node_count != (header->packet_count > 0 ? 2 * header->packet_count - 1 : 0)) return false;
+    if(header->nodes_offset + (u64)header->node_count * sizeof(TriangleMeshNode) > header->packets_offset) return false;
+    if(header->packets_offset + (u64)header->packet_count * sizeof(TrianglePacket) > header->source_ids_offset) return false;
+    if(header->source_ids_offset + (u64)header->packet_count * BGL_TRIANGLE_PACKET_SIZE * sizeof(u32) > size) return false;
+    if(header->nodes_offset % BLOCK_ALIGN != 0 || header->packets_offset % BLOCK_ALIGN != 0 || header->source_ids_offset % BLOCK_ALIGN != 0) return false;
+
+    /* children always come after their parent, which rules out cycles */
+    const TriangleMeshNode* nodes = (const TriangleMeshNode*)((const u8*)header + header->nodes_offset);
+    for(u32 i = 0; i < header->node_count; i++)
+    {
+        const TriangleMeshNode* node = &nodes[i];
+        bool valid = node->count == 0 ? node->first > i && node->first + 1 < header->node_count :
+                                        node->count <= BGL_TRIANGLE_PACKET_SIZE && node->first < header->packet_count;
+        if(!valid) return false;
+    }
+    return true;
+}
@@ -1,30 +1,92 @@
 #include "vao.h"
 
+#include "renderer.h"
+
 VAO vao_create(void)
 {
     VAO self;
-    glGenVertexArrays(1, &self.id);
+    if(rd_state_dsa()) glCreateVertexArrays(1, &self.id);
+    else glGenVertexArrays(1, &self.id);
     return self;
 }
 
 void vao_bind(VAO self)
 {
-    glBindVertexArray(self.id);
+    rd_state_bind_vao(self.id);
 }
 
 void vao_unbind(void)
 {
-    glBindVertexArray(0);
+    rd_state_bind_vao(0);
 }
 
-void vao_attribute(GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset)
+void vao_attribute(VAO self, VBO vbo, GLuint index, GLint size, GLenum type, GLsizei stride, size_t offset)
 {
     // fix when integer attribute is integer (glVertexAttribIPointer)
+    if(rd_state_dsa())
+    {
+        /* every attribute gets the buffer binding of the same index, like the fallback's pointers */
+        glVertexArrayVertexBuffer(self.id, index, vbo.id, (GLintptr)offset, stride);
+        glVertexArrayAttribFormat(self.id, index, size, type, GL_FALSE, 0);
+        glVertexArrayAttribBinding(self.id, index, index);
+        glEnableVertexArrayAttrib(self.id, index);
+        return;
+    }
+
+    vao_bind(self);
+    vbo_bind(vbo);
     glVertexAttribPointer(index, size, type, GL_FALSE, stride, (void*)offset);
     glEnableVertexAttribArray(index);
 }
 
+void vao_element_buffer(VAO self, EBO ebo)
+{
+    if(rd_state_dsa())
+    {
+        glVertexArrayElementBuffer(self.id, ebo.id);
+        return;
+    }
+
+    vao_bind(self);
+    ebo_bind(ebo);
+}
+
+void vao_instance_uint(VAO self, VBO vbo, GLuint index, size_t offset)
+{
+    if(rd_state_dsa())
+    {
+        glVertexArrayVertexBuffer(self.id, index, vbo.id, (GLintptr)offset, sizeof(u32));
+        glVertexArrayAttribIFormat(self.id, index, 1, GL_UNSIGNED_INT, 0);
+        glVertexArrayAttribBinding(self.id, index, index);
+        glVertexArrayBindingDivisor(self.id, index, 1);
+        glEnableVertexArrayAttrib(self.id, index);
+        return;
+    }
+
+    vao_bind(self);
+    vbo_bind(vbo);
+    glVertexAttribIPointer(index, 1, GL_UNSIGNED_INT, sizeof(u32), (void*)offset);
+    glEnableVertexAttribArray(index);
+    glVertexAttribDivisor(index, 1);
+}
+
+void vao_constant_uint(VAO self, GLuint index, u32 value)
+{
+    /* disabled arrays read the current attribute value instead, which isn't part of the vao */
+    if(rd_state_dsa())
+    {
+        glDisableVertexArrayAttrib(self.id, index);
+    }
+    else
+    {
+        vao_bind(self);
+        glDisableVertexAttribArray(index);
+    }
+    glVertexAttribI4ui(index, value, 0, 0, 1);
+}
+
 void vao_free(VAO self)
 {
+    rd_state_forget_vao(self.id);
     glDeleteVertexArrays(1, &self.id);
 }
\ No newline at end of file
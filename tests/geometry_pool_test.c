@@ -0,0 +1,104 @@
+#include <stdio.h>
+#include <string.h>
+#include "badgl.h"
+#include "geometry_pool.h"
+
+/**
+ * headless test of the geometry pool's range allocator, no gl context is created.
+ * meshes are removed and added again in a loop, which has to reuse the freed ranges instead of
+ * growing the buffer, and removing everything has to give the whole buffer back
+ */
+
+#define TEST_MESHES 256
+#define TEST_ROUNDS 10000
+#define TEST_MIN_CAPACITY 1024
+#define TEST_SEED 0x12345678
+
+#define TEST_CHECK(cond, ...)                          \
+do {                                                   \
+    if(!(cond))                                        \
+    {                                                  \
+        printf("%s:%d: ", __FILE__, __LINE__);         \
+        printf(__VA_ARGS__);                           \
+        printf("\n");                                  \
+        failures++;                                    \
+    }                                                  \
+} while(0)
+
+static u32 failures = 0;
+static u32 rng_state = TEST_SEED;
+static GeometryPoolRange meshes[TEST_MESHES];
+static u8 used[TEST_MIN_CAPACITY * 64]; // which elements a mesh owns, to catch overlapping ranges
+
+u32 test_rand(u32 max)
+{
+    rng_state = rng_state * 1664525u + 1013904223u;
+    return (rng_state >> 8) % max;
+}
+
+void test_add(GeometryPoolRanges* ranges, u32 mesh)
+{
+    meshes[mesh].first = geometry_pool_ranges_alloc(ranges, meshes[mesh].count, TEST_MIN_CAPACITY);
+    TEST_CHECK(ranges->capacity <= sizeof(used), "capacity grew to %u", ranges->capacity);
+    if(ranges->capacity > sizeof(used)) return;
+
+    for(u32 i = meshes[mesh].first; i < meshes[mesh].first + meshes[mesh].count; i++)
+    {
+        TEST_CHECK(!used[i], "mesh %u was given element %u which is already used", mesh, i);
+        used[i] = 1;
+    }
+}
+
+void test_remove(GeometryPoolRanges* ranges, u32 mesh)
+{
+    geometry_pool_ranges_release(ranges, meshes[mesh].first, meshes[mesh].count);
+    memset(&used[meshes[mesh].first], 0, meshes[mesh].count);
+}
+
+int main(void)
+{
+    GeometryPoolRanges ranges;
+    memset(&ranges, 0, sizeof(GeometryPoolRanges));
+
+    for(u32 i = 0; i < TEST_MESHES; i++)
+    {
+        meshes[i].count = 1 + test_rand(256);
+        test_add(&ranges, i);
+    }
+    const u32 capacity = ranges.capacity;
+    const u32 end = ranges.end;
+
+    for(u32 round = 0; round < TEST_ROUNDS && failures == 0; round++)
+    {
+        const u32 mesh = test_rand(TEST_MESHES);
+        test_remove(&ranges, mesh);
+        test_add(&ranges, mesh);
+        TEST_CHECK(ranges.capacity == capacity && ranges.end == end, "round %u grew the buffer to %u used of %u, from %u of %u",
+                   round, ranges.end, ranges.capacity, end, capacity);
+    }
+
+    /* the holes don't touch each other or the end, so in any order every mesh finds one of its size */
+    for(u32 i = 1; i < TEST_MESHES - 1; i += 2) test_remove(&ranges, i);
+    TEST_CHECK(ranges.free_count == TEST_MESHES / 2 - 1, "%u free ranges for %u holes", ranges.free_count, TEST_MESHES / 2 - 1);
+    for(u32 i = 1; i < TEST_MESHES - 1; i += 2) test_add(&ranges, TEST_MESHES - 2 - i);
+    TEST_CHECK(ranges.capacity == capacity && ranges.end == end && ranges.free_count == 0, "re-adding every other mesh left %u used of %u and %u free ranges",
+               ranges.end, ranges.capacity, ranges.free_count);
+
+    /* every other mesh, then the rest, so freed ranges are merged from both sides */
+    for(u32 i = 0; i < TEST_MESHES; i += 2) test_remove(&ranges, i);
+    for(u32 i = 1; i < TEST_MESHES; i += 2) test_remove(&ranges, i);
+    TEST_CHECK(ranges.end == 0 && ranges.free_count == 0, "%u used and %u free ranges left after removing every mesh", ranges.end, ranges.free_count);
+
+    for(u32 i = 0; i < TEST_MESHES; i++) test_add(&ranges, TEST_MESHES - 1 - i);
+    TEST_CHECK(ranges.capacity == capacity, "adding the meshes again grew the buffer to %u from %u", ranges.capacity, capacity);
+
+    geometry_pool_ranges_free(&ranges);
+
+    if(failures > 0)
+    {
+        printf("%u checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}
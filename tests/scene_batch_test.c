@@ -0,0 +1,169 @@
+#include <stdio.h>
+#include <string.h>
+#include "badgl.h"
+
+/**
+ * headless test, no window or gl context is created.
+ * copies of one model added with scene_add_model share an interned material, so sorting the
+ * scene's draws puts them all in one batch. the scene is set up the same way as scene_draw_bench
+ */
+
+#define TEST_COPIES BGL_GLSL_DRAWS_PER_BLOCK // a batch never crosses a window of the draw ring
+
+#define TEST_CHECK(cond, ...)                          \
+do {                                                   \
+    if(!(cond))                                        \
+    {                                                  \
+        printf("%s:%d: ", __FILE__, __LINE__);         \
+        printf(__VA_ARGS__);                           \
+        printf("\n");                                  \
+        failures++;                                    \
+    }                                                  \
+} while(0)
+
+static u32 failures = 0;
+static Mesh mesh;
+static Texture textures[2];
+static Texture texture_copies[2]; // same gl ids as textures
+
+void test_create_scene(Scene* scene)
+{
+    memset(scene, 0, sizeof(Scene));
+    camera_create(&scene->cam, VEC3(0.0f, 0.0f, 10.0f), 0.0f, -90.0f, 1.0f, 1.0f);
+    camera_update_proj(&scene->cam, 45.0f, 1.0f, 0.1f, 100.0f);
+    ecs_create(&scene->world);
+    material_table_create(&scene->draw_list.materials);
+}
+
+void test_free_scene(Scene* scene)
+{
+    BGL_FREE(scene->queue.items);
+    BGL_FREE(scene->queue.entries);
+    BGL_FREE(scene->queue.scratch);
+    BGL_FREE(scene->queue.batches);
+    BGL_FREE(scene->queue.commands);
+    BGL_FREE(scene->models);
+    BGL_FREE(scene->draw_list.items);
+    material_table_free(&scene->draw_list.materials);
+    ecs_free(&scene->world);
+}
+
+/* only what the queue reads, no gl objects are made */
+void test_create_model(Model* model, Texture* model_textures, f32 x)
+{
+    memset(model, 0, sizeof(Model));
+    model->meshes = &mesh;
+    model->mesh_count = 1;
+    model->material.ambient = model->material.diffuse = VEC3(0.8f, 0.4f, 0.2f);
+    model->material.specular = VEC3(1.0f, 1.0f, 1.0f);
+    model->material.shininess = 32.0f;
+    model->material.opacity = 1.0f;
+    model->material.textures = model_textures;
+    model->material.tex_count = 2;
+
+    transform_reset(&model->transform);
+    model->transform.pos = VEC3(x, 0.0f, 0.0f);
+    transform_to_matrix(&model->transform, &model->model);
+}
+
+/* enough distinct materials to cross pages and grow the buckets, released ids are reused before new ones */
+void test_material_table(void)
+{
+    const u32 count = BGL_MATERIAL_TABLE_PAGE_SIZE * 4 + 1;
+    MaterialTable table;
+    material_table_create(&table);
+
+    Model model;
+    test_create_model(&model, textures, 0.0f);
+    for(u32 round = 0; round < 2; round++)
+    {
+        for(u32 i = 0; i < count; i++)
+        {
+            model.material.shininess = (f32)i;
+            const u32 id = material_table_intern(&table, &model.material, 0);
+            TEST_CHECK(material_table_intern(&table, &model.material, 0) == id, "material %u interned twice with different ids", i);
+            TEST_CHECK(material_table_get(&table, id)->shininess == (f32)i, "material %u has the wrong entry", i);
+        }
+        TEST_CHECK(table.used == count && table.count == count, "%u materials interned as %u used of %u", count, table.used, table.count);
+
+        for(u32 i = 0; i < count; i++)
+        {
+            model.material.shininess = (f32)i;
+            const u32 id = material_table_find(&table, &model.material, 0);
+            material_table_release(&table, id);
+            material_table_release(&table, id);
+            TEST_CHECK(material_table_find(&table, &model.material, 0) == BGL_MATERIAL_NONE, "material %u still found once released", i);
+        }
+        TEST_CHECK(table.used == 0, "%u materials still used after releasing them all", table.used);
+    }
+
+    material_table_free(&table);
+}
+
+u32 test_batch_count(Scene* scene)
+{
+    scene_queue_draws(scene);
+    render_queue_sort(&scene->queue);
+    render_queue_build_batches(&scene->queue);
+    return scene->queue.batch_count;
+}
+
+int main(void)
+{
+    memset(&mesh, 0, sizeof(Mesh));
+    mesh.vao.id = 1;
+    mesh.ind_count = 36;
+    mesh.vert_count = 24;
+    mesh.bounds_min = VEC3(-0.5f, -0.5f, -0.5f);
+    mesh.bounds_max = VEC3(0.5f, 0.5f, 0.5f);
+
+    textures[0] = (Texture){ .id = 1, .type = BGL_TEXTURE_PHONG_DIFFUSE };
+    textures[1] = (Texture){ .id = 2, .type = BGL_TEXTURE_PHONG_SPECULAR };
+    memcpy(texture_copies, textures, sizeof(textures));
+
+    Scene scene;
+    test_create_scene(&scene);
+
+    /* the last copy is made separately, equal materials are shared even when they aren't copies of one */
+    Model model;
+    test_create_model(&model, textures, 0.0f);
+    for(u32 i = 0; i < TEST_COPIES - 1; i++)
+    {
+        model.transform.pos.x = (f32)i;
+        transform_to_matrix(&model.transform, &model.model);
+        scene_add_model(&scene, &model);
+    }
+    Model equal;
+    test_create_model(&equal, texture_copies, -1.0f);
+    const u32 equal_idx = scene_add_model(&scene, &equal);
+
+    TEST_CHECK(scene.draw_list.materials.used == 1, "%u copies of one material interned as %u", TEST_COPIES, scene.draw_list.materials.used);
+    TEST_CHECK(test_batch_count(&scene) == 1, "%u copies of one model drawn in %u batches", TEST_COPIES, scene.queue.batch_count);
+
+    /* a different colour is a different material, and changing it back shares the first one again */
+    scene.models[equal_idx].material.diffuse = VEC3(0.0f, 1.0f, 0.0f);
+    scene_sync_model(&scene, equal_idx);
+    TEST_CHECK(scene.draw_list.materials.used == 2, "changed material interned as %u materials", scene.draw_list.materials.used);
+    TEST_CHECK(test_batch_count(&scene) == 2, "changed material drawn in %u batches", scene.queue.batch_count);
+
+    scene.models[equal_idx].material.diffuse = model.material.diffuse;
+    scene_sync_model(&scene, equal_idx);
+    TEST_CHECK(scene.draw_list.materials.used == 1, "restored material interned as %u materials", scene.draw_list.materials.used);
+    TEST_CHECK(test_batch_count(&scene) == 1, "restored material drawn in %u batches", scene.queue.batch_count);
+
+    /* so are different textures */
+    texture_copies[0].id = 3;
+    scene_sync_model(&scene, equal_idx);
+    TEST_CHECK(test_batch_count(&scene) == 2, "different textures drawn in %u batches", scene.queue.batch_count);
+
+    test_free_scene(&scene);
+    test_material_table();
+
+    if(failures > 0)
+    {
+        printf("%u checks failed\n", failures);
+        return 1;
+    }
+    printf("all checks passed\n");
+    return 0;
+}